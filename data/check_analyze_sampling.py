@@ -0,0 +1,69 @@
+import argparse
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+
+from generate_test_txt import generate_complex_text
+
+# Default block size of huffman_analyze
+BLOCK_SIZE = 256 * 1024
+
+# Largest accepted gap between sampled and full-file order-0 entropy, in bits/byte
+ENTROPY_TOLERANCE = 0.25
+
+
+def build_mixed_file(filename, seed):
+    """Write a few blocks each of text, random bytes and zeros, in that order."""
+    rng = random.Random(seed)
+    random.seed(seed)
+
+    text = bytearray()
+    while len(text) < 2 * BLOCK_SIZE:
+        text += generate_complex_text().encode("utf-8")
+
+    with open(filename, "wb") as file:
+        file.write(text[:2 * BLOCK_SIZE])
+        file.write(rng.randbytes(2 * BLOCK_SIZE))
+        file.write(bytes(BLOCK_SIZE))
+        file.write(rng.randbytes(BLOCK_SIZE))
+
+
+def analyze(analyzer, filename, fraction):
+    """Run huffman_analyze and return (distinct byte values, order-0 entropy)."""
+    output = subprocess.run([analyzer, "--sample", str(fraction), filename],
+                            capture_output=True, text=True, check=True).stdout
+    distinct = int(re.search(r"Distinct byte values:\s+(\d+)", output).group(1))
+    entropy = float(re.search(r"Order-0 entropy:\s+([\d.]+)", output).group(1))
+    return distinct, entropy
+
+
+def parse_arguments():
+    """Parse command line arguments."""
+    parser = argparse.ArgumentParser(
+        description="Check that huffman_analyze --sample sees every region of a small mixed file."
+    )
+    parser.add_argument('analyzer', help='Path to the huffman_analyze executable')
+    parser.add_argument('--sample', type=float, default=0.1, help='Sample fraction to check (default: 0.1)')
+    parser.add_argument('--seed', type=int, default=1, help='Random seed for the test file (default: 1)')
+    return parser.parse_args()
+
+
+if __name__ == "__main__":
+    args = parse_arguments()
+
+    with tempfile.TemporaryDirectory() as directory:
+        filename = os.path.join(directory, "mixed.bin")
+        build_mixed_file(filename, args.seed)
+
+        full_distinct, full_entropy = analyze(args.analyzer, filename, 1.0)
+        sampled_distinct, sampled_entropy = analyze(args.analyzer, filename, args.sample)
+
+    print(f"Full file:    {full_distinct} distinct bytes, {full_entropy:.3f} bits/byte")
+    print(f"Sample {args.sample:<5}: {sampled_distinct} distinct bytes, {sampled_entropy:.3f} bits/byte")
+
+    if sampled_distinct != full_distinct or abs(sampled_entropy - full_entropy) > ENTROPY_TOLERANCE:
+        print("Error: sampled analysis does not match the full file")
+        sys.exit(1)
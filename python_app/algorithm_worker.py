@@ -1,28 +1,67 @@
 from PySide6.QtCore import QObject, Signal, Slot
 import subprocess
+import threading
+import json
 import re
+import os
+
+from benchmark_stats import files_identical
 
 
 class AlgorithmWorker(QObject):
     output_line = Signal(str)
     execution_time = Signal(int)
+    verified = Signal(bool)
+    started = Signal(int)
+    progress = Signal(dict)
     finished = Signal()
     error = Signal(str)
 
-    def __init__(self, command):
+    def __init__(self, command, verify_paths=None, stream_progress=True):
         super().__init__()
         self.command = command
+        # (original, decoded): compared after the process exits, decoded file is removed afterwards
+        self.verify_paths = verify_paths
+        # Pass `--progress /dev/fd/<n>` and forward the engine's JSON progress events
+        self.stream_progress = stream_progress
+
+    def read_progress(self, read_fd):
+        """Runs on its own thread so the stdout loop never waits on the progress pipe."""
+        with os.fdopen(read_fd, "r") as events:
+            for line in events:
+                try:
+                    self.progress.emit(json.loads(line))
+                except ValueError:
+                    pass
 
     @Slot()
     def run(self):
         try:
-            process = subprocess.Popen(
-                self.command,
-                stdout=subprocess.PIPE,
-                stderr=subprocess.STDOUT,
-                text=True,
-                bufsize=1
-            )
+            command = self.command
+            pass_fds = ()
+            progress_reader = None
+            if self.stream_progress:
+                read_fd, write_fd = os.pipe()
+                # Options go before the file arguments, which every engine accepts
+                command = [command[0], "--progress", f"/dev/fd/{write_fd}"] + list(command[1:])
+                pass_fds = (write_fd,)
+                progress_reader = threading.Thread(target=self.read_progress, args=(read_fd,), daemon=True)
+                progress_reader.start()
+
+            try:
+                process = subprocess.Popen(
+                    command,
+                    stdout=subprocess.PIPE,
+                    stderr=subprocess.STDOUT,
+                    text=True,
+                    bufsize=1,
+                    pass_fds=pass_fds
+                )
+            finally:
+                # Only the child keeps the write end, so the reader sees EOF when it exits
+                for fd in pass_fds:
+                    os.close(fd)
+            self.started.emit(process.pid)
 
             for line in process.stdout:
                 line = line.rstrip()
@@ -38,6 +77,16 @@ class AlgorithmWorker(QObject):
                         self.execution_time.emit(total_ms)
 
             process.wait()
+            if progress_reader:
+                progress_reader.join()
+
+            if self.verify_paths:
+                original, decoded = self.verify_paths
+                identical = process.returncode == 0 and os.path.isfile(decoded) and files_identical(original, decoded)
+                if os.path.isfile(decoded):
+                    os.remove(decoded)
+                self.verified.emit(identical)
+
             self.finished.emit()
 
         except Exception as e:
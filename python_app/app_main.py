@@ -1,4 +1,5 @@
 import os.path
+import sqlite3
 
 from PySide6.QtWidgets import QMainWindow, QWidget
 from PySide6 import QtWidgets
@@ -11,6 +12,9 @@ from system_monitor.system_monitor_widget import SystemMonitorWidget
 from algorithm_worker import AlgorithmWorker
 from button_menu import ControlButtonsWidget
 from graph_viewer import ExecutionTimeChartPopup
+from history_viewer import RunHistoryDialog
+from run_history import RunHistory
+from benchmark_stats import summarize, evict_file_cache, drop_page_cache, stage_durations
 
 
 class CompressionApp(QMainWindow):
@@ -47,11 +51,26 @@ class CompressionApp(QMainWindow):
         # Connect buttons from the button menus
         self.buttons_connect()
 
-        # Dict for comparison data
+        # Comparison results per algorithm:
+        # {"times": [s, ...], "input_bytes": n, "verified": bool | None, "resources": [process summary, ...],
+        #  "backend": "CPU" | "GPU", "threads": n | None,
+        #  "runs": [{"input_bytes", "seconds", "compressed_bytes", "stages": {stage: s}}, ...]}
         self.execution_data = {}
         self.running_jobs = []
         self.comparison_runs = 1
 
+        # Compressor processes being sampled by the resource monitor, pid -> job
+        self.process_jobs = {}
+        self.stats_worker = self.system_monitor.resource_monitor.worker
+        self.stats_worker.process_summary_ready.connect(self.handle_process_summary)
+
+        # Every measured run is also kept on disk; "Clear data" only resets the current comparison
+        try:
+            self.history = RunHistory()
+        except (OSError, sqlite3.Error) as e:
+            print(f"[WARN] Run history disabled: {e}")
+            self.history = None
+
     def run_current_algorithm(self):
         # Build command with flags
         input_path = self.file_dialog_widget.get_input_file_path()
@@ -74,6 +93,13 @@ class CompressionApp(QMainWindow):
             cpu_flag = "cpu_"
 
         command = [f"../build/{cpu_flag}huffman{mode}", input_path, output_path]
+        self.single_job = {
+            "name": f"{'CPU' if cpu_select else 'GPU'} Huffman{'' if mode == '_compression' else ' decompression'}",
+            "backend": "CPU" if cpu_select else "GPU",
+            "command": command,
+            "input_path": input_path,
+            "output_path": output_path if mode == "_compression" else None,
+        }
 
         # Disable the buttons to prevent duplicate presses
         self.control_buttons.algorithm_button.setEnabled(False)
@@ -87,8 +113,18 @@ class CompressionApp(QMainWindow):
 
         self.algo_worker.moveToThread(self.algo_thread)
 
-        # Connect the worker output to the terminal
+        # Connect the worker output to the terminal and its progress events to the live graph
         self.algo_worker.output_line.connect(self.system_monitor.terminal_output.append_text)
+        self.system_monitor.throughput_graph.start_run(os.path.basename(command[0]))
+        self.algo_worker.progress.connect(self.system_monitor.throughput_graph.add_event)
+
+        # Timing and stage events of the run go to the history once it has finished
+        job = self.single_job
+        self.algo_worker.execution_time.connect(lambda time_ms: job.__setitem__("seconds", time_ms / 1000),
+                                                Qt.DirectConnection)
+        self.algo_worker.progress.connect(lambda event: job.setdefault("events", []).append(event),
+                                          Qt.DirectConnection)
+        self.algo_worker.finished.connect(self.record_single_run)
 
         # When the worker is done, re-enable the button
         self.algo_worker.finished.connect(self.control_buttons.enable_button)
@@ -110,6 +146,7 @@ class CompressionApp(QMainWindow):
         self.control_buttons.algorithm_button.clicked.connect(self.run_current_algorithm)
         self.control_buttons.comparison_button.clicked.connect(self.run_comparisons)
         self.options_panel.comparison.clear_data_button.clicked.connect(self.clear_comparison_data)
+        self.control_buttons.history_button.clicked.connect(self.show_history)
 
     def run_comparisons(self):
         input_path = self.file_dialog_widget.get_input_file_path()
@@ -124,12 +161,37 @@ class CompressionApp(QMainWindow):
             print("Output requires a path or file name!")
             return
 
-        self.comparison_runs = self.options_panel.comparison.get_run_count()
-
-        self.algorithms_to_run = [
-            ("CPU Huffman", ["../build/cpu_huffman_compression", input_path, output_path], self.comparison_runs),
-            ("GPU Huffman", ["../build/huffman_compression", input_path, output_path], self.comparison_runs),
-        ]
+        settings = self.options_panel.comparison
+        self.comparison_runs = settings.get_run_count()
+        self.cache_mode = settings.get_cache_mode()
+        self.comparison_input_path = input_path
+        self.comparison_input_bytes = os.path.getsize(input_path)
+
+        # (name, compress command, matching decompress command for the round-trip check)
+        decoded_path = output_path + ".verify"
+        algorithms = []
+        variants = {}
+        # A thread sweep compares the CPU path once per thread count (block container via --threads)
+        for threads in settings.get_thread_counts() or [None]:
+            name = f"CPU Huffman ({threads} threads)" if threads else "CPU Huffman"
+            options = ["--threads", str(threads)] if threads else []
+            algorithms.append((name, ["../build/cpu_huffman_compression", *options, input_path, output_path],
+                               ["../build/cpu_huffman_decompression", *options, output_path, decoded_path]))
+            variants[name] = ("CPU", threads)
+        algorithms.append(("GPU Huffman", ["../build/huffman_compression", input_path, output_path],
+                           ["../build/huffman_decompression", output_path, decoded_path]))
+        variants["GPU Huffman"] = ("GPU", None)
+
+        for name, _, _ in algorithms:
+            results = self.execution_data.setdefault(name, {"times": [], "verified": None, "resources": [],
+                                                            "runs": []})
+            results["input_bytes"] = self.comparison_input_bytes
+            results["backend"], results["threads"] = variants[name]
+        self.comparison_output_path = output_path
+
+        self.algorithms_to_run = self.build_comparison_schedule(
+            algorithms, settings.get_warmup_count(), self.comparison_runs, settings.is_interleaved(),
+            settings.is_verify_enabled(), input_path, decoded_path)
 
         self.control_buttons.comparison_button.setEnabled(False)
         self.control_buttons.comparison_button.setText("Running...")
@@ -139,8 +201,51 @@ class CompressionApp(QMainWindow):
         # Start comparison
         self.run_next_algorithm()
 
+    @staticmethod
+    def build_comparison_schedule(algorithms, warmup_runs, measured_runs, interleave, verify, input_path,
+                                  decoded_path):
+        """Flattens the comparison into a list of jobs.
+
+        Warmup runs come first and are not recorded. With interleaving the
+        algorithms alternate run by run (A B A B ...) so thermal or background
+        drift hits all of them alike; otherwise each runs back to back. The
+        round-trip check follows the first measured run of each algorithm,
+        while its output file is still intact.
+        """
+        def rounds(count):
+            if interleave:
+                return [algorithm for _ in range(count) for algorithm in algorithms]
+            return [algorithm for algorithm in algorithms for _ in range(count)]
+
+        schedule = []
+        for name, command, _ in rounds(warmup_runs):
+            schedule.append({"name": name, "command": command, "measure": False})
+
+        verified = set()
+        for name, command, decompress_command in rounds(measured_runs):
+            schedule.append({"name": name, "command": command, "measure": True})
+            if verify and name not in verified:
+                verified.add(name)
+                schedule.append({"name": name, "command": decompress_command, "measure": False,
+                                 "verify_paths": (input_path, decoded_path)})
+        return schedule
+
+    def prepare_cache(self, job):
+        if not job["measure"] or self.cache_mode == "warm":
+            return
+
+        if self.cache_mode == "drop_caches" and drop_page_cache():
+            return
+        if self.cache_mode == "drop_caches" and not getattr(self, "drop_cache_warned", False):
+            print("[WARN] Dropping the page cache needs root, evicting only the input file instead")
+            self.drop_cache_warned = True
+
+        if not evict_file_cache(self.comparison_input_path):
+            print("[WARN] posix_fadvise is not available, input stays cached")
+
     def run_next_algorithm(self):
         if not self.algorithms_to_run:
+            self.print_comparison_summary()
             self.popup = ExecutionTimeChartPopup(self.execution_data)
             self.popup.show()
 
@@ -150,30 +255,38 @@ class CompressionApp(QMainWindow):
             self.control_buttons.algorithm_button.setText("Run algorithm")
             return
 
-        name, command, remaining_runs = self.algorithms_to_run.pop(0)
-        self.current_algorithm_name = name
+        job = self.algorithms_to_run.pop(0)
+        self.current_job = job
+        self.current_algorithm_name = job["name"]
+        self.prepare_cache(job)
 
         thread = QThread()
-        worker = AlgorithmWorker(command)
+        worker = AlgorithmWorker(job["command"], job.get("verify_paths"))
 
         self.running_jobs.append((thread, worker))
 
         def cleanup():
+            self.record_run(job)
             self.running_jobs.remove((thread, worker))
             worker.deleteLater()
             thread.deleteLater()
 
-            if remaining_runs > 1:
-                self.algorithms_to_run.insert(0, (name, command, remaining_runs - 1))
-
             QTimer.singleShot(1000, lambda: self.run_next_algorithm())
 
         worker.execution_time.connect(self.handle_execution_time)
+        worker.verified.connect(self.handle_verification)
+        worker.started.connect(lambda pid: self.process_jobs.__setitem__(pid, job), Qt.DirectConnection)
+        # The stats loop never returns to its event loop; track_process is mutex-protected instead
+        worker.started.connect(self.stats_worker.track_process, Qt.DirectConnection)
         worker.output_line.connect(self.system_monitor.terminal_output.append_text, Qt.QueuedConnection)
+        worker.progress.connect(self.system_monitor.throughput_graph.add_event, Qt.QueuedConnection)
+        worker.progress.connect(self.handle_progress)
+        self.system_monitor.throughput_graph.start_run(job["name"] if job["measure"] else f"{job['name']} (untimed)")
         worker.error.connect(lambda msg: self.system_monitor.terminal_output.append_text(f"[ERROR] {msg}"),
                              Qt.QueuedConnection)
 
         worker.finished.connect(thread.quit)
+        worker.error.connect(thread.quit)
         thread.finished.connect(cleanup)
 
         worker.moveToThread(thread)
@@ -189,16 +302,104 @@ class CompressionApp(QMainWindow):
 
     def closeEvent(self, event):
         self.system_monitor.resource_monitor.close()
+        if self.history:
+            self.history.close()
         super().closeEvent(event)
 
     def handle_execution_time(self, time_ms):
         time_sec = round(time_ms / 1000, 3)
-        print(f"[INFO] Algorithm execution time: {time_sec} ms")
-        name = self.current_algorithm_name
-        if name not in self.execution_data:
-            self.execution_data[name] = []
-        self.execution_data[name].append(time_sec)
+        job = self.current_job
+        if not job["measure"]:
+            print(f"[INFO] Untimed run ({job['name']}): {time_sec} s")
+            return
+
+        print(f"[INFO] Algorithm execution time: {time_sec} s")
+        self.execution_data[job["name"]]["times"].append(time_sec)
+        job["seconds"] = time_sec
+
+    def handle_progress(self, event):
+        self.current_job.setdefault("events", []).append(event)
+
+    def record_run(self, job):
+        """Stores one measured run with its stage times and output size for the charts and exports."""
+        if not job["measure"] or "seconds" not in job:
+            return
+
+        run = {
+            "input_bytes": self.comparison_input_bytes,
+            "seconds": job["seconds"],
+            "stages": stage_durations(job.get("events", [])),
+        }
+        if os.path.isfile(self.comparison_output_path):
+            run["compressed_bytes"] = os.path.getsize(self.comparison_output_path)
+        results = self.execution_data[job["name"]]
+        results["runs"].append(run)
+        self.save_history(job["name"], job["command"][0], self.comparison_input_path, run, results["backend"],
+                          results["threads"], self.cache_mode)
+
+    def record_single_run(self):
+        job = self.single_job
+        if "seconds" not in job:
+            return
+
+        run = {
+            "input_bytes": os.path.getsize(job["input_path"]),
+            "seconds": job["seconds"],
+            "stages": stage_durations(job.get("events", [])),
+        }
+        if job["output_path"] and os.path.isfile(job["output_path"]):
+            run["compressed_bytes"] = os.path.getsize(job["output_path"])
+        self.save_history(job["name"], job["command"][0], job["input_path"], run, job["backend"])
+
+    def save_history(self, algorithm, binary, input_path, run, backend=None, threads=None, cache_mode=None):
+        if not self.history:
+            return
+        try:
+            self.history.record(algorithm, binary, input_path, run, backend, threads, cache_mode)
+        except (OSError, sqlite3.Error) as e:
+            print(f"[WARN] Run not saved to history: {e}")
+
+    def show_history(self):
+        if not self.history:
+            print("[WARN] Run history is not available")
+            return
+        self.history_popup = RunHistoryDialog(self.history)
+        self.history_popup.show()
+
+    def handle_verification(self, identical):
+        name = self.current_job["name"]
+        self.execution_data[name]["verified"] = identical
+        if identical:
+            print(f"[INFO] {name}: round trip reproduces the input")
+        else:
+            print(f"[ERROR] {name}: decompressed output differs from the input!")
+
+    def handle_process_summary(self, summary):
+        job = self.process_jobs.pop(summary["pid"], None)
+        if not job or not job["measure"]:
+            return
+
+        self.execution_data[job["name"]].setdefault("resources", []).append(summary)
+        busiest = summary["thread_cpu_seconds"][:1]
+        print(f"[INFO] {job['name']}: CPU {summary['cpu_percent']:.0f}% over {summary['threads']} threads"
+              f"{f' (busiest {busiest[0]:.2f} s)' if busiest else ''}, "
+              f"peak RSS {summary['peak_rss'] / (1024 ** 2):.1f} MB, "
+              f"read {summary['read_bytes'] / 1e6:.1f} MB, written {summary['write_bytes'] / 1e6:.1f} MB, "
+              f"{summary['voluntary_switches']}/{summary['involuntary_switches']} vol/invol switches")
+
+    def print_comparison_summary(self):
+        for name, results in self.execution_data.items():
+            summary = summarize(results["times"], results.get("input_bytes", 0))
+            print(f"[INFO] {name}: median {summary['median']:.3f} s, p95 {summary['p95']:.3f} s, "
+                  f"stddev {summary['stddev']:.3f} s, {summary['mbps_median']:.1f} MB/s "
+                  f"over {summary['runs']} runs")
+
+            resources = results.get("resources", [])
+            if resources:
+                peak_rss = max(entry["peak_rss"] for entry in resources)
+                cpu_percent = sum(entry["cpu_percent"] for entry in resources) / len(resources)
+                print(f"[INFO] {name}: mean CPU {cpu_percent:.0f}%, peak RSS {peak_rss / (1024 ** 2):.1f} MB")
 
     def clear_comparison_data(self):
         self.execution_data.clear()
-        print("Comparison data was deleted!")
+        print("Comparison data was deleted! (runs stay in the run history)")
@@ -0,0 +1,195 @@
+import csv
+import json
+import math
+import os
+
+
+# Page-cache handling before every timed run
+CACHE_MODES = {
+    "warm": "Warm cache",
+    "cold_file": "Cold input file (fadvise)",
+    "drop_caches": "Drop page cache (root)",
+}
+
+
+def percentile(values, fraction):
+    """Linear-interpolated percentile of a list, fraction in [0, 1]."""
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    position = (len(ordered) - 1) * fraction
+    lower = math.floor(position)
+    upper = math.ceil(position)
+    if lower == upper:
+        return ordered[lower]
+    return ordered[lower] + (ordered[upper] - ordered[lower]) * (position - lower)
+
+
+def summarize(times, input_bytes):
+    """Median, p95, stddev and throughput of a list of run times in seconds."""
+    if not times:
+        return {"runs": 0, "median": 0.0, "p95": 0.0, "min": 0.0, "max": 0.0, "stddev": 0.0,
+                "mbps_median": 0.0, "mbps_p95": 0.0}
+
+    mean = sum(times) / len(times)
+    variance = sum((t - mean) ** 2 for t in times) / (len(times) - 1) if len(times) > 1 else 0.0
+    median = percentile(times, 0.5)
+    p95 = percentile(times, 0.95)
+
+    def mbps(seconds):
+        return input_bytes / seconds / 1e6 if seconds > 0 else 0.0
+
+    return {
+        "runs": len(times),
+        "median": median,
+        "p95": p95,
+        "min": min(times),
+        "max": max(times),
+        "stddev": math.sqrt(variance),
+        "mbps_median": mbps(median),
+        # The p95 time is the slow tail, i.e. the low end of the throughput range
+        "mbps_p95": mbps(p95),
+    }
+
+
+def _incomplete_beta_fraction(a, b, x):
+    """Continued fraction of the regularized incomplete beta function (modified Lentz)."""
+    tiny = 1e-300
+    c, d = 1.0, 1.0 - (a + b) * x / (a + 1)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    result = d
+    for m in range(1, 200):
+        for numerator in (m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m)),
+                          -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))):
+            d = 1.0 + numerator * d
+            d = 1.0 / (d if abs(d) > tiny else tiny)
+            c = 1.0 + numerator / c
+            c = c if abs(c) > tiny else tiny
+            result *= c * d
+        if abs(c * d - 1.0) < 1e-12:
+            break
+    return result
+
+
+def regularized_incomplete_beta(a, b, x):
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    front = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) + a * math.log(x) + b * math.log(1 - x))
+    # The fraction converges quickly only on one side of the mean
+    if x < (a + 1) / (a + b + 2):
+        return front * _incomplete_beta_fraction(a, b, x) / a
+    return 1.0 - front * _incomplete_beta_fraction(b, a, 1 - x) / b
+
+
+def welch_t_test(first, second):
+    """Two-sided Welch's t-test; returns (t, p). p is 1.0 when either sample has fewer than two values."""
+    if len(first) < 2 or len(second) < 2:
+        return 0.0, 1.0
+
+    def mean_and_variance(values):
+        mean = sum(values) / len(values)
+        return mean, sum((value - mean) ** 2 for value in values) / (len(values) - 1)
+
+    first_mean, first_variance = mean_and_variance(first)
+    second_mean, second_variance = mean_and_variance(second)
+    first_error, second_error = first_variance / len(first), second_variance / len(second)
+    if first_error + second_error == 0:
+        return 0.0, 1.0 if first_mean == second_mean else 0.0
+
+    t = (first_mean - second_mean) / math.sqrt(first_error + second_error)
+    degrees = (first_error + second_error) ** 2 / (first_error ** 2 / (len(first) - 1) +
+                                                  second_error ** 2 / (len(second) - 1))
+    p = regularized_incomplete_beta(degrees / 2, 0.5, degrees / (degrees + t * t))
+    return t, p
+
+
+def evict_file_cache(path):
+    """Drops a single file from the page cache; works without root."""
+    if not hasattr(os, "posix_fadvise"):
+        return False
+    with open(path, "rb") as file:
+        os.posix_fadvise(file.fileno(), 0, 0, os.POSIX_FADV_DONTNEED)
+    return True
+
+
+def drop_page_cache():
+    """Drops the whole page cache (needs root). Returns False if not permitted."""
+    try:
+        os.sync()
+        with open("/proc/sys/vm/drop_caches", "w") as control:
+            control.write("3\n")
+        return True
+    except OSError:
+        return False
+
+
+def files_identical(first_path, second_path, chunk_size=1 << 20):
+    """Byte-wise comparison used for the round-trip check."""
+    if os.path.getsize(first_path) != os.path.getsize(second_path):
+        return False
+    with open(first_path, "rb") as first, open(second_path, "rb") as second:
+        while True:
+            first_chunk = first.read(chunk_size)
+            if first_chunk != second.read(chunk_size):
+                return False
+            if not first_chunk:
+                return True
+
+
+def stage_durations(events):
+    """Seconds per stage from an engine's --progress events (stage start to the next stage or "done")."""
+    durations = {}
+    current, started = None, 0.0
+    for event in events:
+        if event.get("event") not in ("stage", "done"):
+            continue
+        if current is not None:
+            durations[current] = durations.get(current, 0.0) + event["elapsed"] - started
+        current, started = (event.get("stage"), event["elapsed"]) if event["event"] == "stage" else (None, 0.0)
+    return durations
+
+
+# Columns of the per-run CSV export; stage times follow as stage_<name>
+RUN_COLUMNS = ["algorithm", "backend", "threads", "input_bytes", "seconds", "mbps", "compressed_bytes", "ratio"]
+
+
+def run_rows(execution_data):
+    """Flattens the comparison results into one dict per measured run."""
+    rows = []
+    for name, results in execution_data.items():
+        for run in results.get("runs", []):
+            row = {
+                "algorithm": name,
+                "backend": results.get("backend", ""),
+                "threads": results.get("threads") or "",
+                "input_bytes": run["input_bytes"],
+                "seconds": run["seconds"],
+                "mbps": run["input_bytes"] / run["seconds"] / 1e6 if run["seconds"] > 0 else 0.0,
+                "compressed_bytes": run.get("compressed_bytes", ""),
+                "ratio": run["compressed_bytes"] / run["input_bytes"]
+                if run.get("compressed_bytes") and run["input_bytes"] else "",
+            }
+            for stage, seconds in run.get("stages", {}).items():
+                row[f"stage_{stage}"] = seconds
+            rows.append(row)
+    return rows
+
+
+def export_results(execution_data, path):
+    """Writes the comparison as CSV (one row per run) or, for *.json, the full results with summaries."""
+    if path.lower().endswith(".json"):
+        document = {}
+        for name, results in execution_data.items():
+            document[name] = dict(results, summary=summarize(results["times"], results.get("input_bytes", 0)))
+        with open(path, "w") as output:
+            json.dump(document, output, indent=2)
+        return
+
+    rows = run_rows(execution_data)
+    stage_columns = sorted({key for row in rows for key in row if key.startswith("stage_")})
+    with open(path, "w", newline="") as output:
+        writer = csv.DictWriter(output, fieldnames=RUN_COLUMNS + stage_columns)
+        writer.writeheader()
+        writer.writerows(rows)
@@ -9,13 +9,14 @@ class ControlButtonsWidget(QWidget):
 
         self.algorithm_button = QPushButton("Run algorithm")
         self.comparison_button = QPushButton("Start comparison")
+        self.history_button = QPushButton("Run history")
         self.clear_button = QPushButton("Clear terminal")
 
         self.init_button_icons()
 
         layout = QHBoxLayout()
 
-        for button in [self.algorithm_button, self.comparison_button, self.clear_button]:
+        for button in [self.algorithm_button, self.comparison_button, self.history_button, self.clear_button]:
             button.setMinimumHeight(45)
             button.setMinimumWidth(150)
             button.setIconSize(QSize(24, 24))
@@ -23,6 +24,7 @@ class ControlButtonsWidget(QWidget):
 
         layout.addWidget(self.algorithm_button)
         layout.addWidget(self.comparison_button)
+        layout.addWidget(self.history_button)
         layout.addItem(QSpacerItem(5, 20, QSizePolicy.Expanding))
         layout.addWidget(self.clear_button)
 
@@ -41,5 +43,8 @@ class ControlButtonsWidget(QWidget):
         icon = QIcon("./assets/icons/comparison.svg")
         self.comparison_button.setIcon(icon)
 
+        icon = QIcon("./assets/icons/resource_monitor.svg")
+        self.history_button.setIcon(icon)
+
         icon = QIcon("./assets/icons/clear.svg")
         self.clear_button.setIcon(icon)
@@ -5,9 +5,12 @@ from PySide6.QtWidgets import (
 from matplotlib.backends.backend_qtagg import FigureCanvasQTAgg as FigureCanvas
 from matplotlib.figure import Figure
 
+from benchmark_stats import summarize, percentile, export_results
+
 
 class ExecutionTimeChartPopup(QDialog):
     def __init__(self, execution_times: dict, parent=None):
+        """execution_times maps algorithm names to their results ("times", "runs", ...; see CompressionApp)."""
         super().__init__(parent)
         self.setWindowTitle("Execution Time Comparison")
         self.setMinimumSize(1200, 800)
@@ -34,39 +37,169 @@ class ExecutionTimeChartPopup(QDialog):
         save_button.clicked.connect(self.save_chart)
         button_layout.addWidget(save_button)
 
+        export_button = QPushButton("Export Data")
+        export_button.setFixedWidth(150)
+        export_button.clicked.connect(self.export_data)
+        button_layout.addWidget(export_button)
+
         button_layout.addSpacerItem(QSpacerItem(0, 0, QSizePolicy.Expanding, QSizePolicy.Minimum))
 
         layout.addLayout(button_layout)
 
-        # Plotting
-        ax = self.figure.add_subplot(111)
-        ax.set_title("Execution Time per Run")
-        ax.set_xlabel("Benchmark Run")
-        ax.set_ylabel("Time (s)")
-
-        # Determine number of runs (x-axis ticks) and algorithms
-        all_algos = list(self.execution_times.keys())
-        num_algos = len(all_algos)
-        max_runs = max(len(times) for times in self.execution_times.values())
-        x = list(range(max_runs))
-
-        bar_width = 0.8 / num_algos  # To fit all bars within 1 unit per run
-
-        for i, (algo_name, times) in enumerate(self.execution_times.items()):
-            offset = [xi + i * bar_width for xi in x]
-            ax.bar(offset, times, width=bar_width, label=algo_name)
-
-        # Set x-ticks to the center of each group
-        group_centers = [xi + bar_width * (num_algos - 1) / 2 for xi in x]
-        ax.set_xticks(group_centers)
-        ax.set_xticklabels([f"{i}" for i in x])
-
-        ax.legend()
-        ax.grid(True)
+        self.plot_results()
 
         self.setLayout(layout)
         self.show()
 
+    def plot_results(self):
+        names = [name for name, results in self.execution_times.items() if results["times"]]
+        summaries = [summarize(self.execution_times[name]["times"], self.execution_times[name].get("input_bytes", 0))
+                     for name in names]
+
+        def label(name):
+            verified = self.execution_times[name].get("verified")
+            if verified is None:
+                return name
+            return f"{name}\n({'round trip OK' if verified else 'ROUND TRIP FAILED'})"
+
+        labels = [label(name) for name in names]
+        colors = [f"C{index}" for index in range(len(names))]
+
+        # Median run time; whiskers span the fastest run to the p95 run
+        time_axis = self.figure.add_subplot(231)
+        time_axis.set_title("Execution Time (median, min to p95)")
+        time_axis.set_ylabel("Time (s)")
+        medians = [summary["median"] for summary in summaries]
+        time_errors = [[summary["median"] - summary["min"] for summary in summaries],
+                       [summary["p95"] - summary["median"] for summary in summaries]]
+        time_axis.bar(labels, medians, yerr=time_errors, capsize=8, color=colors)
+        for index, summary in enumerate(summaries):
+            time_axis.annotate(f"σ {summary['stddev']:.3f} s\nn = {summary['runs']}", (index, summary["p95"]),
+                               textcoords="offset points", xytext=(0, 8), ha="center")
+        time_axis.grid(True, axis="y")
+
+        # Throughput at the median; whiskers span the p95 (slow) run to the fastest run
+        throughput_axis = self.figure.add_subplot(232)
+        throughput_axis.set_title("Throughput (MB/s)")
+        throughput_axis.set_ylabel("MB/s")
+        throughputs = [summary["mbps_median"] for summary in summaries]
+        fastest = [self.execution_times[name].get("input_bytes", 0) / summary["min"] / 1e6 if summary["min"] > 0
+                   else 0.0 for name, summary in zip(names, summaries)]
+        throughput_errors = [[summary["mbps_median"] - summary["mbps_p95"] for summary in summaries],
+                             [best - summary["mbps_median"] for best, summary in zip(fastest, summaries)]]
+        throughput_axis.bar(labels, throughputs, yerr=throughput_errors, capsize=8, color=colors)
+        throughput_axis.grid(True, axis="y")
+
+        self.plot_stage_breakdown(self.figure.add_subplot(233), names)
+        self.plot_compression_ratio(self.figure.add_subplot(234), names, colors)
+        self.plot_throughput_by_size(self.figure.add_subplot(235), names, colors)
+        self.plot_thread_scaling(self.figure.add_subplot(236))
+
+        self.figure.tight_layout()
+
+    def runs_of(self, name, input_bytes=None):
+        runs = self.execution_times[name].get("runs", [])
+        return [run for run in runs if input_bytes is None or run["input_bytes"] == input_bytes]
+
+    @staticmethod
+    def show_empty(axis, message):
+        axis.text(0.5, 0.5, message, ha="center", va="center", transform=axis.transAxes, color="gray")
+        axis.set_xticks([])
+        axis.set_yticks([])
+
+    def plot_stage_breakdown(self, axis, names):
+        """Mean seconds per stage (from the --progress events) of the runs on the latest input, stacked."""
+        axis.set_title("Stage Breakdown (mean, latest input)")
+        stage_times = {}
+        for name in names:
+            runs = [run for run in self.runs_of(name, self.execution_times[name].get("input_bytes")) if run["stages"]]
+            for run in runs:
+                for stage, seconds in run["stages"].items():
+                    stage_times.setdefault(stage, {}).setdefault(name, []).append(seconds)
+        if not stage_times:
+            self.show_empty(axis, "No stage data")
+            return
+
+        bottoms = [0.0] * len(names)
+        for stage, per_name in stage_times.items():
+            heights = [sum(per_name.get(name, [])) / len(per_name[name]) if per_name.get(name) else 0.0
+                       for name in names]
+            axis.bar(names, heights, bottom=bottoms, label=stage)
+            bottoms = [bottom + height for bottom, height in zip(bottoms, heights)]
+        axis.set_ylabel("Time (s)")
+        axis.legend(fontsize=8)
+        axis.grid(True, axis="y")
+
+    def plot_compression_ratio(self, axis, names, colors):
+        """Median compressed size as a share of the input, over all recorded runs."""
+        axis.set_title("Compressed Size (% of input)")
+        ratios = []
+        for name in names:
+            values = [run["compressed_bytes"] / run["input_bytes"] * 100 for run in self.runs_of(name)
+                      if run.get("compressed_bytes") and run["input_bytes"]]
+            ratios.append(percentile(values, 0.5) if values else 0.0)
+        if not any(ratios):
+            self.show_empty(axis, "No output sizes")
+            return
+
+        axis.bar(names, ratios, color=colors)
+        for index, ratio in enumerate(ratios):
+            axis.annotate(f"{ratio:.1f}%", (index, ratio), textcoords="offset points", xytext=(0, 4), ha="center")
+        axis.set_ylabel("%")
+        axis.grid(True, axis="y")
+
+    def plot_throughput_by_size(self, axis, names, colors):
+        """Median MB/s per input size; every comparison on another file adds a point."""
+        axis.set_title("Throughput vs Input Size")
+        plotted = False
+        for name, color in zip(names, colors):
+            by_size = {}
+            for run in self.runs_of(name):
+                if run["seconds"] > 0:
+                    by_size.setdefault(run["input_bytes"], []).append(run["input_bytes"] / run["seconds"] / 1e6)
+            if not by_size:
+                continue
+            sizes = sorted(by_size)
+            axis.plot([size / 1e6 for size in sizes], [percentile(by_size[size], 0.5) for size in sizes],
+                      marker="o", color=color, label=name)
+            plotted = True
+        if not plotted:
+            self.show_empty(axis, "No runs")
+            return
+
+        axis.set_xscale("log")
+        axis.set_xlabel("Input size (MB)")
+        axis.set_ylabel("MB/s")
+        axis.legend(fontsize=8)
+        axis.grid(True)
+
+    def plot_thread_scaling(self, axis):
+        """Median MB/s per thread count of a thread sweep, against linear scaling from the smallest count."""
+        axis.set_title("Thread Scaling (latest input)")
+        points = []
+        for name, results in self.execution_times.items():
+            runs = self.runs_of(name, results.get("input_bytes"))
+            if results.get("threads") and runs:
+                throughputs = [run["input_bytes"] / run["seconds"] / 1e6 for run in runs if run["seconds"] > 0]
+                points.append((results["threads"], percentile(throughputs, 0.5)))
+        if len(points) < 2:
+            self.show_empty(axis, "Set CPU Threads (e.g. 1,2,4,8)\nto compare thread counts")
+            return
+
+        points.sort()
+        threads = [point[0] for point in points]
+        throughputs = [point[1] for point in points]
+        axis.plot(threads, throughputs, marker="o", label="measured")
+        axis.plot(threads, [throughputs[0] * count / threads[0] for count in threads], linestyle="--",
+                  color="gray", label="linear")
+        axis.set_xscale("log", base=2)
+        axis.set_xticks(threads)
+        axis.set_xticklabels([str(count) for count in threads])
+        axis.set_xlabel("Threads")
+        axis.set_ylabel("MB/s")
+        axis.legend(fontsize=8)
+        axis.grid(True)
+
     def save_chart(self):
         file_path, _ = QFileDialog.getSaveFileName(
             self, "Save Chart As Image", "execution_times.png",
@@ -79,3 +212,16 @@ class ExecutionTimeChartPopup(QDialog):
                 QMessageBox.information(self, "Saved", f"Chart saved to:\n{file_path}")
             except Exception as e:
                 QMessageBox.critical(self, "Error", f"Failed to save chart:\n{e}")
+
+    def export_data(self):
+        file_path, _ = QFileDialog.getSaveFileName(
+            self, "Export Results", "comparison_results.csv",
+            "CSV, one row per run (*.csv);;JSON, results and summaries (*.json);;All Files (*)"
+        )
+
+        if file_path:
+            try:
+                export_results(self.execution_times, file_path)
+                QMessageBox.information(self, "Saved", f"Results exported to:\n{file_path}")
+            except Exception as e:
+                QMessageBox.critical(self, "Error", f"Failed to export results:\n{e}")
@@ -0,0 +1,95 @@
+from datetime import datetime
+
+from PySide6.QtWidgets import (
+    QDialog, QVBoxLayout, QHBoxLayout, QSizePolicy, QComboBox, QLabel, QTextEdit
+)
+from matplotlib.backends.backend_qtagg import FigureCanvasQTAgg as FigureCanvas
+from matplotlib.figure import Figure
+
+from run_history import REGRESSION_P_VALUE, REGRESSION_MIN_SLOWDOWN
+
+
+class RunHistoryDialog(QDialog):
+    def __init__(self, history, parent=None):
+        """Throughput per build for one input, machine and setup, regressions marked (see RunHistory.builds)."""
+        super().__init__(parent)
+        self.setWindowTitle("Run History")
+        self.setMinimumSize(1100, 750)
+
+        self.history = history
+        self.figure = Figure()
+        self._init_ui()
+
+    def _init_ui(self):
+        layout = QVBoxLayout(self)
+
+        # One series per input, machine, cache mode and thread count; throughput is only comparable within it
+        selector_layout = QHBoxLayout()
+        self.series_combo_box = QComboBox()
+        for fingerprint, input_path, machine, cache_mode, threads in self.history.series_keys():
+            setup = f"{cache_mode}, {threads or 'default'} threads" if cache_mode else "single runs"
+            self.series_combo_box.addItem(f"{input_path}  [{fingerprint}]  on {machine}  ({setup})",
+                                          (fingerprint, machine, cache_mode, threads))
+        self.series_combo_box.currentIndexChanged.connect(self.plot_history)
+        selector_layout.addWidget(QLabel("Input / machine / setup"))
+        selector_layout.addWidget(self.series_combo_box, 1)
+        layout.addLayout(selector_layout)
+
+        self.canvas = FigureCanvas(self.figure)
+        self.canvas.setSizePolicy(QSizePolicy.Expanding, QSizePolicy.Expanding)
+        layout.addWidget(self.canvas)
+
+        self.regression_text = QTextEdit()
+        self.regression_text.setReadOnly(True)
+        self.regression_text.setMaximumHeight(140)
+        layout.addWidget(self.regression_text)
+
+        self.setLayout(layout)
+        self.plot_history()
+
+    def plot_history(self):
+        self.figure.clear()
+        axis = self.figure.add_subplot(111)
+        series_key = self.series_combo_box.currentData()
+        if not series_key:
+            axis.text(0.5, 0.5, "No runs recorded yet", ha="center", va="center", transform=axis.transAxes)
+            self.regression_text.setPlainText("Comparison runs are recorded automatically.")
+            self.canvas.draw()
+            return
+
+        series = self.history.builds(*series_key)
+        notes = []
+        for index, (algorithm, builds) in enumerate(series.items()):
+            color = f"C{index}"
+            positions = [datetime.fromtimestamp(build["first_run"]) for build in builds]
+            medians = [build["median"] for build in builds]
+            errors = [[build["median"] - min(build["mbps"]) for build in builds],
+                      [max(build["mbps"]) - build["median"] for build in builds]]
+            axis.errorbar(positions, medians, yerr=errors, marker="o", capsize=4, color=color, label=algorithm)
+
+            for position_index, (position, build) in enumerate(zip(positions, builds)):
+                axis.annotate(build["build_hash"][:7], (position, build["median"]), textcoords="offset points",
+                              xytext=(0, -14), ha="center", fontsize=7, color=color)
+                if build["regression"]:
+                    axis.scatter([position], [build["median"]], s=180, facecolors="none", edgecolors="red",
+                                 linewidths=2, zorder=3)
+                    notes.append(f"{algorithm}: build {build['build_hash']} is {build['slowdown'] * 100:.1f}% slower "
+                                 f"than {builds[position_index - 1]['build_hash']} (p = {build['p_value']:.4f}, "
+                                 f"n = {len(builds[position_index - 1]['mbps'])}/{len(build['mbps'])})")
+
+        # Each algorithm is its own binary, so builds are placed by when they were first measured
+        self.figure.autofmt_xdate()
+        axis.set_xlabel("Build (first measured)")
+        axis.set_ylabel("Throughput (MB/s)")
+        axis.set_title("Throughput over builds (median, min to max; red = significant slowdown)")
+        axis.grid(True)
+        axis.legend()
+        self.figure.tight_layout()
+        self.canvas.draw()
+
+        if notes:
+            self.regression_text.setPlainText("\n".join(notes))
+        else:
+            self.regression_text.setPlainText(
+                f"No build is significantly slower than its predecessor (Welch's t-test, p < {REGRESSION_P_VALUE}, "
+                f"slowdown of at least {REGRESSION_MIN_SLOWDOWN * 100:.0f}%).")
@@ -1,8 +1,11 @@
 from PySide6.QtWidgets import (
-    QWidget, QPushButton, QLabel, QSpinBox,
+    QWidget, QPushButton, QLabel, QSpinBox, QComboBox, QCheckBox, QLineEdit,
     QVBoxLayout, QHBoxLayout, QGroupBox
 )
 
+from benchmark_stats import CACHE_MODES
+
+
 class ComparisonRunSettingsWidget(QWidget):
     def __init__(self, parent=None):
         super().__init__(parent)
@@ -13,6 +16,10 @@ class ComparisonRunSettingsWidget(QWidget):
         # Layouts
         group_layout = QVBoxLayout()
         top_row_layout = QHBoxLayout()
+        warmup_row_layout = QHBoxLayout()
+        cache_row_layout = QHBoxLayout()
+        threads_row_layout = QHBoxLayout()
+        checkbox_row_layout = QHBoxLayout()
 
         # Label and spin box
         self.label = QLabel("Number of Runs")
@@ -24,11 +31,51 @@ class ComparisonRunSettingsWidget(QWidget):
         top_row_layout.addWidget(self.label)
         top_row_layout.addWidget(self.run_spin_box)
 
+        # Untimed runs per algorithm before measuring (page cache, GPU context, CPU clocks)
+        self.warmup_label = QLabel("Warmup Runs")
+        self.warmup_spin_box = QSpinBox()
+        self.warmup_spin_box.setMinimum(0)
+        self.warmup_spin_box.setMaximum(100)
+        self.warmup_spin_box.setValue(1)
+
+        warmup_row_layout.addWidget(self.warmup_label)
+        warmup_row_layout.addWidget(self.warmup_spin_box)
+
+        # Page-cache state before every timed run
+        self.cache_label = QLabel("Cache")
+        self.cache_combo_box = QComboBox()
+        for key, title in CACHE_MODES.items():
+            self.cache_combo_box.addItem(title, key)
+
+        cache_row_layout.addWidget(self.cache_label)
+        cache_row_layout.addWidget(self.cache_combo_box)
+
+        # CPU thread counts to sweep, e.g. "1,2,4,8"; each count is compared as its own entry
+        self.threads_label = QLabel("CPU Threads")
+        self.threads_line_edit = QLineEdit()
+        self.threads_line_edit.setPlaceholderText("default, or e.g. 1,2,4,8")
+
+        threads_row_layout.addWidget(self.threads_label)
+        threads_row_layout.addWidget(self.threads_line_edit)
+
+        # Interleaving alternates algorithms run by run so drift affects all of them equally
+        self.interleave_check_box = QCheckBox("Interleave")
+        self.interleave_check_box.setChecked(True)
+        self.verify_check_box = QCheckBox("Verify round trip")
+        self.verify_check_box.setChecked(True)
+
+        checkbox_row_layout.addWidget(self.interleave_check_box)
+        checkbox_row_layout.addWidget(self.verify_check_box)
+
         # Button
         self.clear_data_button = QPushButton("Clear data")
 
         # Assemble group box
         group_layout.addLayout(top_row_layout)
+        group_layout.addLayout(warmup_row_layout)
+        group_layout.addLayout(cache_row_layout)
+        group_layout.addLayout(threads_row_layout)
+        group_layout.addLayout(checkbox_row_layout)
         group_layout.addWidget(self.clear_data_button)
         group_box.setLayout(group_layout)
 
@@ -39,3 +86,23 @@ class ComparisonRunSettingsWidget(QWidget):
 
     def get_run_count(self) -> int:
         return self.run_spin_box.value()
+
+    def get_warmup_count(self) -> int:
+        return self.warmup_spin_box.value()
+
+    def get_cache_mode(self) -> str:
+        return self.cache_combo_box.currentData()
+
+    def get_thread_counts(self) -> list:
+        """Positive thread counts from the sweep field, in order and without duplicates; empty = default."""
+        counts = []
+        for entry in self.threads_line_edit.text().replace(" ", "").split(","):
+            if entry.isdigit() and int(entry) > 0 and int(entry) not in counts:
+                counts.append(int(entry))
+        return counts
+
+    def is_interleaved(self) -> bool:
+        return self.interleave_check_box.isChecked()
+
+    def is_verify_enabled(self) -> bool:
+        return self.verify_check_box.isChecked()
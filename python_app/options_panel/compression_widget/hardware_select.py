@@ -1,5 +1,7 @@
 from PySide6 import QtWidgets
 
+from tuning_profile import profile_backend
+
 
 class HardwareSelectorWidget(QtWidgets.QWidget):
     def __init__(self):
@@ -22,8 +24,11 @@ class HardwareSelectorWidget(QtWidgets.QWidget):
         self.cpu_radio = QtWidgets.QRadioButton("CPU")
         self.gpu_radio = QtWidgets.QRadioButton("GPU")
 
-        # Set CPU as default selected
-        self.gpu_radio.setChecked(True)
+        # Preselect the backend the autotune profile found faster, GPU without a profile
+        if profile_backend() == "CPU":
+            self.cpu_radio.setChecked(True)
+        else:
+            self.gpu_radio.setChecked(True)
 
         # Group the radio buttons
         self.button_group = QtWidgets.QButtonGroup(self)
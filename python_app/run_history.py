@@ -0,0 +1,160 @@
+import hashlib
+import json
+import os
+import platform
+import sqlite3
+import time
+
+from benchmark_stats import percentile, welch_t_test
+
+
+# Significance level and minimum slowdown for flagging a build as a regression
+REGRESSION_P_VALUE = 0.05
+REGRESSION_MIN_SLOWDOWN = 0.02
+
+# Bytes hashed from the start, middle and end of an input for its fingerprint
+FINGERPRINT_SAMPLE_BYTES = 1 << 20
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS runs (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    recorded_at REAL NOT NULL,
+    algorithm TEXT NOT NULL,
+    backend TEXT,
+    threads INTEGER,
+    binary TEXT NOT NULL,
+    build_hash TEXT NOT NULL,
+    build_time REAL,
+    input_path TEXT,
+    input_bytes INTEGER NOT NULL,
+    input_fingerprint TEXT NOT NULL,
+    machine TEXT NOT NULL,
+    cache_mode TEXT,
+    seconds REAL NOT NULL,
+    compressed_bytes INTEGER,
+    stages TEXT
+);
+CREATE INDEX IF NOT EXISTS runs_series ON runs (algorithm, input_fingerprint, machine);
+"""
+
+
+def default_history_path():
+    """Same lookup as the engines' profile, under the data directory: $XDG_DATA_HOME or ~/.local/share."""
+    if os.environ.get("HUFFMAN_HISTORY"):
+        return os.environ["HUFFMAN_HISTORY"]
+    data_home = os.environ.get("XDG_DATA_HOME") or os.path.join(os.path.expanduser("~"), ".local", "share")
+    return os.path.join(data_home, "cuda_compression", "history.sqlite")
+
+
+def machine_description():
+    """Host name, CPU model and thread count; read from /proc/cpuinfo, which is much faster than cpuinfo."""
+    cpu = platform.processor() or platform.machine()
+    try:
+        with open("/proc/cpuinfo") as cpu_info:
+            for line in cpu_info:
+                if line.startswith("model name"):
+                    cpu = line.split(":", 1)[1].strip()
+                    break
+    except OSError:
+        pass
+    return f"{platform.node()} / {cpu} / {os.cpu_count()} threads"
+
+
+def input_fingerprint(path):
+    """Size plus a hash of the first, middle and last MiB; identifies an input without reading all of it."""
+    size = os.path.getsize(path)
+    digest = hashlib.sha256(str(size).encode())
+    with open(path, "rb") as file:
+        for offset in sorted({0, max(0, size // 2 - FINGERPRINT_SAMPLE_BYTES // 2),
+                              max(0, size - FINGERPRINT_SAMPLE_BYTES)}):
+            file.seek(offset)
+            digest.update(file.read(FINGERPRINT_SAMPLE_BYTES))
+    return f"{size}:{digest.hexdigest()[:16]}"
+
+
+class RunHistory:
+    """SQLite store of every measured comparison run; survives restarts and "Clear data"."""
+
+    def __init__(self, path=None):
+        self.path = path or default_history_path()
+        os.makedirs(os.path.dirname(self.path) or ".", exist_ok=True)
+        self.connection = sqlite3.connect(self.path)
+        self.connection.executescript(SCHEMA)
+        self._build_cache = {}
+        self._fingerprint_cache = {}
+        self.machine = machine_description()
+
+    def build_hash(self, binary):
+        """Content hash of an engine binary, cached by modification time; every rebuild is a new build."""
+        binary = os.path.abspath(binary)
+        status = os.stat(binary)
+        key = (binary, status.st_mtime_ns, status.st_size)
+        if key not in self._build_cache:
+            digest = hashlib.sha256()
+            with open(binary, "rb") as file:
+                for chunk in iter(lambda: file.read(1 << 20), b""):
+                    digest.update(chunk)
+            self._build_cache[key] = (digest.hexdigest()[:12], status.st_mtime)
+        return self._build_cache[key]
+
+    def fingerprint(self, path):
+        status = os.stat(path)
+        key = (os.path.abspath(path), status.st_mtime_ns, status.st_size)
+        if key not in self._fingerprint_cache:
+            self._fingerprint_cache[key] = input_fingerprint(path)
+        return self._fingerprint_cache[key]
+
+    def record(self, algorithm, binary, input_path, run, backend=None, threads=None, cache_mode=None):
+        """Stores one run dict ({"input_bytes", "seconds", "compressed_bytes", "stages"}, see CompressionApp)."""
+        build_hash, build_time = self.build_hash(binary)
+        self.connection.execute(
+            "INSERT INTO runs (recorded_at, algorithm, backend, threads, binary, build_hash, build_time, input_path,"
+            " input_bytes, input_fingerprint, machine, cache_mode, seconds, compressed_bytes, stages)"
+            " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
+            (time.time(), algorithm, backend, threads, os.path.abspath(binary), build_hash, build_time,
+             os.path.abspath(input_path), run["input_bytes"], self.fingerprint(input_path), self.machine, cache_mode,
+             run["seconds"], run.get("compressed_bytes"), json.dumps(run.get("stages", {}))))
+        self.connection.commit()
+
+    def series_keys(self):
+        """(input fingerprint, input path, machine, cache mode, threads) combinations, most recent first.
+
+        Runs with a cold page cache or another thread count are not comparable with each other, so each
+        combination is its own series; single runs have no cache mode and are a series of their own.
+        """
+        return self.connection.execute(
+            "SELECT input_fingerprint, MAX(input_path), machine, cache_mode, threads FROM runs"
+            " GROUP BY input_fingerprint, machine, cache_mode, threads ORDER BY MAX(recorded_at) DESC").fetchall()
+
+    def builds(self, input_fingerprint, machine, cache_mode=None, threads=None):
+        """Throughput per algorithm and build within one series, builds in the order they were first measured.
+
+        Returns {algorithm: [{"build_hash", "build_time", "first_run", "mbps": [...], "median",
+        "p_value", "slowdown", "regression"}, ...]}. Each build is compared with the previous one of the
+        same algorithm: a regression is a median slowdown of at least REGRESSION_MIN_SLOWDOWN that a
+        Welch's t-test finds significant at REGRESSION_P_VALUE.
+        """
+        rows = self.connection.execute(
+            "SELECT algorithm, build_hash, MAX(build_time), MIN(recorded_at), GROUP_CONCAT(input_bytes / seconds)"
+            " FROM runs WHERE input_fingerprint = ? AND machine = ? AND cache_mode IS ? AND threads IS ?"
+            " AND seconds > 0 GROUP BY algorithm, build_hash ORDER BY MIN(recorded_at)",
+            (input_fingerprint, machine, cache_mode, threads)).fetchall()
+
+        series = {}
+        for algorithm, build_hash, build_time, first_run, rates in rows:
+            mbps = [float(rate) / 1e6 for rate in rates.split(",")]
+            builds = series.setdefault(algorithm, [])
+            entry = {"build_hash": build_hash, "build_time": build_time, "first_run": first_run, "mbps": mbps,
+                     "median": percentile(mbps, 0.5), "p_value": 1.0, "slowdown": 0.0, "regression": False}
+            if builds:
+                previous = builds[-1]
+                _, entry["p_value"] = welch_t_test(previous["mbps"], mbps)
+                if previous["median"] > 0:
+                    entry["slowdown"] = 1.0 - entry["median"] / previous["median"]
+                entry["regression"] = (entry["slowdown"] >= REGRESSION_MIN_SLOWDOWN and
+                                       entry["p_value"] < REGRESSION_P_VALUE)
+            builds.append(entry)
+        return series
+
+    def close(self):
+        self.connection.close()
@@ -0,0 +1,97 @@
+import time
+
+import psutil
+
+
+class ProcessTreeSampler:
+    """Samples one process and its children; kept free of Qt so it stays cheap to call.
+
+    Every sample() reads each process once inside psutil's oneshot() cache:
+    per-thread CPU times, RSS, I/O counters and context switches. Counters
+    that only grow (CPU, I/O, context switches) are remembered per process so
+    they survive children exiting between samples.
+    """
+
+    def __init__(self, pid):
+        self.pid = pid
+        self.root = psutil.Process(pid)
+        self.start_time = time.monotonic()
+        self.samples = 0
+        self.peak_rss = 0
+        self.last_rss = 0
+        self.last_cpu_percent = 0.0
+        self.last_thread_count = 0
+        self._last_cpu_seconds = 0.0
+        self._last_sample_time = self.start_time
+        # Per process: (cpu seconds, read bytes, write bytes, voluntary, involuntary), per thread id: cpu seconds
+        self._process_totals = {}
+        self._thread_cpu = {}
+
+    def sample(self):
+        """Takes one sample; returns False once the root process is gone."""
+        try:
+            processes = [self.root] + self.root.children(recursive=True)
+        except psutil.NoSuchProcess:
+            return False
+
+        rss = 0
+        thread_count = 0
+        for process in processes:
+            try:
+                with process.oneshot():
+                    cpu = process.cpu_times()
+                    rss += process.memory_info().rss
+                    switches = process.num_ctx_switches()
+                    try:
+                        io = process.io_counters()
+                        read_bytes, write_bytes = io.read_bytes, io.write_bytes
+                    except (psutil.AccessDenied, AttributeError):
+                        read_bytes = write_bytes = 0
+                    threads = process.threads()
+            except (psutil.NoSuchProcess, psutil.ZombieProcess, psutil.AccessDenied):
+                continue
+
+            self._process_totals[process.pid] = (cpu.user + cpu.system, read_bytes, write_bytes,
+                                                 switches.voluntary, switches.involuntary)
+            for thread in threads:
+                self._thread_cpu[(process.pid, thread.id)] = thread.user_time + thread.system_time
+            thread_count += len(threads)
+
+        now = time.monotonic()
+        cpu_seconds = sum(totals[0] for totals in self._process_totals.values())
+        elapsed = now - self._last_sample_time
+        if elapsed > 0:
+            self.last_cpu_percent = (cpu_seconds - self._last_cpu_seconds) / elapsed * 100
+        self._last_cpu_seconds = cpu_seconds
+        self._last_sample_time = now
+
+        self.last_rss = rss
+        self.peak_rss = max(self.peak_rss, rss)
+        self.last_thread_count = thread_count
+        self.samples += 1
+        try:
+            return self.root.status() != psutil.STATUS_ZOMBIE
+        except psutil.NoSuchProcess:
+            return False
+
+    def summary(self):
+        """Totals over the whole lifetime of the tracked tree."""
+        totals = list(self._process_totals.values())
+        wall = time.monotonic() - self.start_time
+        cpu_seconds = sum(entry[0] for entry in totals)
+        thread_cpu = sorted(self._thread_cpu.values(), reverse=True)
+        return {
+            "pid": self.pid,
+            "samples": self.samples,
+            "wall_seconds": wall,
+            "cpu_seconds": cpu_seconds,
+            "cpu_percent": cpu_seconds / wall * 100 if wall > 0 else 0.0,
+            "peak_rss": self.peak_rss,
+            "read_bytes": sum(entry[1] for entry in totals),
+            "write_bytes": sum(entry[2] for entry in totals),
+            "voluntary_switches": sum(entry[3] for entry in totals),
+            "involuntary_switches": sum(entry[4] for entry in totals),
+            "threads": len(thread_cpu),
+            # Busiest threads first; shows whether one thread dominates
+            "thread_cpu_seconds": thread_cpu,
+        }
@@ -1,7 +1,11 @@
-from PySide6.QtCore import QObject, Signal, QMutex, QWaitCondition
+from PySide6.QtCore import QObject, Signal, Slot, QMutex, QWaitCondition
+import time
+
 import psutil
 import cpuinfo
 
+from .process_sampler import ProcessTreeSampler
+
 from pynvml import (
     nvmlInit,
     nvmlShutdown,
@@ -13,24 +17,80 @@ from pynvml import (
 )
 
 class StatsWorker(QObject):
+    """System-wide stats every `interval` seconds, plus a tracked process tree every `process_interval` seconds.
+
+    Static information (CPU and GPU names) is read once: cpuinfo.get_cpu_info()
+    alone takes around a second and would otherwise disturb the benchmarks on
+    every refresh.
+    """
     stats_ready = Signal(dict)
+    process_stats_ready = Signal(dict)
+    process_summary_ready = Signal(dict)
 
-    def __init__(self, interval=1):
+    def __init__(self, interval=1, process_interval=0.05):
         super().__init__()
         self.interval = interval
+        self.process_interval = process_interval
         self._running = True
         self._mutex = QMutex()
         self._wait_condition = QWaitCondition()
         self.nvml_available = False
+        self.cpu_name = cpuinfo.get_cpu_info().get("brand_raw", "Unknown CPU")
+        self.gpu_name = None
+        self._pending_pid = None
+        self._sampler = None
 
         try:
             nvmlInit()
             self.nvml_available = True
+            self.gpu_name = nvmlDeviceGetName(nvmlDeviceGetHandleByIndex(0))
+            if isinstance(self.gpu_name, bytes):
+                self.gpu_name = self.gpu_name.decode("utf-8")
         except NVMLError as e:
             print(f"[StatsWorker] NVIDIA NVML initialization failed: {e}")
             print(f"GPU resources will not be displayed")
             self.nvml_available = False
 
+    @Slot(int)
+    def track_process(self, pid):
+        """Starts sampling a compressor process tree (called from the GUI thread)."""
+        self._mutex.lock()
+        self._pending_pid = pid
+        self._wait_condition.wakeAll()
+        self._mutex.unlock()
+
+    def set_process_interval(self, seconds):
+        self._mutex.lock()
+        self.process_interval = seconds
+        self._mutex.unlock()
+
+    def sample_process(self):
+        self._mutex.lock()
+        pending_pid, self._pending_pid = self._pending_pid, None
+        self._mutex.unlock()
+
+        if pending_pid is not None:
+            if self._sampler:
+                self.process_summary_ready.emit(self._sampler.summary())
+            try:
+                self._sampler = ProcessTreeSampler(pending_pid)
+            except psutil.NoSuchProcess:
+                self._sampler = None
+
+        if not self._sampler:
+            return
+
+        alive = self._sampler.sample()
+        self.process_stats_ready.emit({
+            "pid": self._sampler.pid,
+            "cpu_percent": self._sampler.last_cpu_percent,
+            "rss": self._sampler.last_rss,
+            "threads": self._sampler.last_thread_count,
+        })
+        if not alive:
+            self.process_summary_ready.emit(self._sampler.summary())
+            self._sampler = None
+
     def stop(self):
         self._mutex.lock()
         self._running = False
@@ -40,6 +100,7 @@ class StatsWorker(QObject):
             nvmlShutdown()
 
     def run(self):
+        next_system_sample = 0.0
         while True:
             self._mutex.lock()
             if not self._running:
@@ -47,40 +108,49 @@ class StatsWorker(QObject):
                 break
             self._mutex.unlock()
 
-            stats = {
-                "cpu_name": cpuinfo.get_cpu_info().get("brand_raw", "Unknown CPU"),
-                "cpu_usage": psutil.cpu_percent(),
-            }
-
-            mem = psutil.virtual_memory()
-            stats.update({
-                "ram_used": mem.used / (1024 ** 3),
-                "ram_total": mem.total / (1024 ** 3),
-                "ram_percent": mem.percent
-            })
-
-            if self.nvml_available:
-                try:
-                    handle = nvmlDeviceGetHandleByIndex(0)
-                    name = nvmlDeviceGetName(handle).decode("utf-8")
-                    util = nvmlDeviceGetUtilizationRates(handle)
-                    mem_info = nvmlDeviceGetMemoryInfo(handle)
-
-                    stats.update({
-                        "gpu_name": name,
-                        "gpu_usage": util.gpu,
-                        "vram_used": mem_info.used / (1024 ** 2),
-                        "vram_total": mem_info.total / (1024 ** 2),
-                        "vram_percent": (mem_info.used / mem_info.total) * 100 if mem_info.total else 0
-                    })
-                except NVMLError as e:
-                    stats["gpu_error"] = f"NVMLError: {e}"
-            else:
-                stats["gpu_info"] = "No NVIDIA GPU or driver detected."
-
-            self.stats_ready.emit(stats)
+            self.sample_process()
+
+            now = time.monotonic()
+            if now >= next_system_sample:
+                next_system_sample = now + self.interval
+                self.sample_system()
 
+            # Short waits only while a process is tracked
             self._mutex.lock()
             if self._running:
-                self._wait_condition.wait(self._mutex, int(self.interval * 1000))
+                wait = self.process_interval if self._sampler or self._pending_pid else next_system_sample - now
+                self._wait_condition.wait(self._mutex, max(1, int(wait * 1000)))
             self._mutex.unlock()
+
+    def sample_system(self):
+        stats = {
+            "cpu_name": self.cpu_name,
+            "cpu_usage": psutil.cpu_percent(),
+        }
+
+        mem = psutil.virtual_memory()
+        stats.update({
+            "ram_used": mem.used / (1024 ** 3),
+            "ram_total": mem.total / (1024 ** 3),
+            "ram_percent": mem.percent
+        })
+
+        if self.nvml_available:
+            try:
+                handle = nvmlDeviceGetHandleByIndex(0)
+                util = nvmlDeviceGetUtilizationRates(handle)
+                mem_info = nvmlDeviceGetMemoryInfo(handle)
+
+                stats.update({
+                    "gpu_name": self.gpu_name,
+                    "gpu_usage": util.gpu,
+                    "vram_used": mem_info.used / (1024 ** 2),
+                    "vram_total": mem_info.total / (1024 ** 2),
+                    "vram_percent": (mem_info.used / mem_info.total) * 100 if mem_info.total else 0
+                })
+            except NVMLError as e:
+                stats["gpu_error"] = f"NVMLError: {e}"
+        else:
+            stats["gpu_info"] = "No NVIDIA GPU or driver detected."
+
+        self.stats_ready.emit(stats)
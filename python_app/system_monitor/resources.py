@@ -14,6 +14,17 @@ class ResourceMonitor(QtWidgets.QWidget):
         self.gpu_name_label = QtWidgets.QLabel()
         self.gpu_usage_label = QtWidgets.QLabel("GPU: ")
         self.vram_label = QtWidgets.QLabel("VRAM: ")
+        self.process_label = QtWidgets.QLabel("Process: -")
+
+        # Sampling rate of the running compressor (system stats stay at 1 s)
+        self.process_interval_spin = QtWidgets.QSpinBox()
+        self.process_interval_spin.setRange(10, 1000)
+        self.process_interval_spin.setSingleStep(10)
+        self.process_interval_spin.setSuffix(" ms")
+        self.process_interval_spin.setValue(50)
+        interval_layout = QtWidgets.QHBoxLayout()
+        interval_layout.addWidget(QtWidgets.QLabel("Process sampling:"))
+        interval_layout.addWidget(self.process_interval_spin)
 
         # Inner layout for resource stats
         stats_layout = QtWidgets.QVBoxLayout()
@@ -23,6 +34,8 @@ class ResourceMonitor(QtWidgets.QWidget):
         stats_layout.addWidget(self.gpu_name_label)
         stats_layout.addWidget(self.gpu_usage_label)
         stats_layout.addWidget(self.vram_label)
+        stats_layout.addWidget(self.process_label)
+        stats_layout.addLayout(interval_layout)
 
         # Group box
         group_box = QtWidgets.QGroupBox("System Resource Usage")
@@ -38,6 +51,9 @@ class ResourceMonitor(QtWidgets.QWidget):
         self.worker = StatsWorker()
         self.worker.moveToThread(self.thread)
         self.worker.stats_ready.connect(self.update_stats)
+        self.worker.process_stats_ready.connect(self.update_process_stats)
+        self.worker.process_summary_ready.connect(self.update_process_summary)
+        self.process_interval_spin.valueChanged.connect(lambda ms: self.worker.set_process_interval(ms / 1000))
         self.thread.started.connect(self.worker.run)
         self.thread.start()
 
@@ -67,6 +83,17 @@ class ResourceMonitor(QtWidgets.QWidget):
         else:
             self.vram_label.setText("VRAM: -")
 
+    def update_process_stats(self, stats):
+        self.process_label.setText(
+            f"Process {stats['pid']}: CPU {stats['cpu_percent']:.0f}%, "
+            f"RSS {stats['rss'] / (1024 ** 2):.0f} MB, {stats['threads']} threads"
+        )
+
+    def update_process_summary(self, summary):
+        self.process_label.setText(
+            f"Process {summary['pid']} done: CPU {summary['cpu_percent']:.0f}%, "
+            f"peak RSS {summary['peak_rss'] / (1024 ** 2):.0f} MB"
+        )
 
     def closeEvent(self, event):
         self.worker.stop()
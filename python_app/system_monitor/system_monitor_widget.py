@@ -1,6 +1,7 @@
 from PySide6.QtWidgets import QWidget, QHBoxLayout
 from .terminal_output_widget import TerminalOutputWidget
 from .resources import ResourceMonitor
+from .throughput_graph import ThroughputGraph
 from .emitting_stream import EmittingStream
 
 import sys
@@ -14,10 +15,12 @@ class SystemMonitorWidget(QWidget):
         self.init_output() # Move output to app terminal right after initialization for debugging
 
         self.resource_monitor = ResourceMonitor()
+        self.throughput_graph = ThroughputGraph()
 
         layout = QHBoxLayout()
 
         layout.addWidget(self.terminal_output)
+        layout.addWidget(self.throughput_graph)
         layout.addWidget(self.resource_monitor)
 
         self.setLayout(layout)
@@ -0,0 +1,91 @@
+from PySide6 import QtWidgets
+from PySide6.QtCore import QTimer
+from matplotlib.backends.backend_qtagg import FigureCanvasQTAgg as FigureCanvas
+from matplotlib.figure import Figure
+
+
+class ThroughputGraph(QtWidgets.QWidget):
+    """Live MB/s of the running engine, fed with its --progress events.
+
+    Every "progress" event adds a point at its elapsed time; "stage" events
+    draw a labelled vertical line, so stalls show up as dips and stage
+    transitions as markers. Redraws are batched on a timer instead of one per
+    event, keeping the GUI thread cheap while an engine reports every 100 ms.
+    """
+
+    REDRAW_INTERVAL_MS = 250
+
+    def __init__(self):
+        super().__init__()
+
+        self.figure = Figure(figsize=(4, 3))
+        self.figure.set_tight_layout(True)
+        self.canvas = FigureCanvas(self.figure)
+        self.axes = self.figure.add_subplot(111)
+
+        self.title = ""
+        self.times = []
+        self.rates = []
+        self.stages = []  # (elapsed, name)
+        self.status_label = QtWidgets.QLabel("No run yet")
+
+        stats_layout = QtWidgets.QVBoxLayout()
+        stats_layout.addWidget(self.canvas)
+        stats_layout.addWidget(self.status_label)
+
+        group_box = QtWidgets.QGroupBox("Live Throughput")
+        group_box.setLayout(stats_layout)
+
+        main_layout = QtWidgets.QVBoxLayout()
+        main_layout.addWidget(group_box)
+        self.setLayout(main_layout)
+
+        self.dirty = True
+        self.redraw_timer = QTimer(self)
+        self.redraw_timer.timeout.connect(self.redraw)
+        self.redraw_timer.start(self.REDRAW_INTERVAL_MS)
+
+    def start_run(self, title):
+        self.title = title
+        self.times.clear()
+        self.rates.clear()
+        self.stages.clear()
+        self.status_label.setText(f"{title}: starting")
+        self.dirty = True
+
+    def add_event(self, event):
+        stage = event.get("stage", "")
+        elapsed = event.get("elapsed", 0.0)
+
+        if event.get("event") == "stage":
+            self.stages.append((elapsed, stage))
+        elif event.get("event") == "progress":
+            self.times.append(elapsed)
+            self.rates.append(event.get("mbps", 0.0))
+
+        total = event.get("total", 0)
+        of_total = f" of {total / 1e6:.1f}" if total else ""
+        state = "done" if event.get("event") == "done" else stage
+        self.status_label.setText(f"{self.title}: {state}, {event.get('bytes', 0) / 1e6:.1f}{of_total} MB, "
+                                  f"{event.get('mbps', 0.0):.1f} MB/s, {elapsed:.1f} s")
+        self.dirty = True
+
+    def redraw(self):
+        if not self.dirty:
+            return
+        self.dirty = False
+
+        self.axes.clear()
+        self.axes.set_title(self.title or "Throughput", fontsize=9)
+        self.axes.set_xlabel("Elapsed (s)", fontsize=8)
+        self.axes.set_ylabel("MB/s", fontsize=8)
+        self.axes.tick_params(labelsize=7)
+        self.axes.plot(self.times, self.rates, color="#4C72B0", linewidth=1.2)
+
+        for elapsed, stage in self.stages:
+            self.axes.axvline(elapsed, color="gray", linestyle="--", linewidth=0.8)
+            self.axes.annotate(stage, (elapsed, 1), xycoords=("data", "axes fraction"), rotation=90,
+                               fontsize=7, va="top", ha="right", color="gray")
+
+        self.axes.set_ylim(bottom=0)
+        self.canvas.draw_idle()
@@ -0,0 +1,30 @@
+import os
+
+
+def default_profile_path():
+    """Same lookup as the engines (tuning_profile.h): $HUFFMAN_PROFILE, then $XDG_CONFIG_HOME or ~/.config."""
+    if os.environ.get("HUFFMAN_PROFILE"):
+        return os.environ["HUFFMAN_PROFILE"]
+    config_home = os.environ.get("XDG_CONFIG_HOME") or os.path.join(os.path.expanduser("~"), ".config")
+    return os.path.join(config_home, "cuda_compression", "profile")
+
+
+def load_tuning_profile(path=None):
+    """key=value pairs of the autotune profile as strings; empty when there is none or it cannot be read."""
+    profile = {}
+    try:
+        with open(path or default_profile_path()) as file:
+            for line in file:
+                line = line.strip()
+                if line and not line.startswith("#") and "=" in line:
+                    key, value = line.split("=", 1)
+                    profile[key] = value
+    except OSError:
+        pass
+    return profile
+
+
+def profile_backend():
+    """"CPU" or "GPU" when huffman_autotune measured which one compresses faster, else None."""
+    backend = load_tuning_profile().get("backend", "")
+    return backend.upper() if backend in ("cpu", "gpu") else None
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+
+#include "adaptive_stream.h"
+#include "data_statistics.h"
+#include "format_utilities.h"
+
+/**
+ * @file adaptive_stream.cpp
+ * @brief Lockstep model updates, frame coding and poll-driven stream I/O
+ */
+
+using namespace std;
+using namespace chrono;
+
+/*=============================================================================
+ * MODEL
+ *=============================================================================*/
+
+/**
+ * @brief Rebuilds code lengths, encoder and decoder from the current counts
+ */
+static void rebuild_model(adaptive_model &model) {
+    build_code_lengths(model.counts, HUFFMAN_BYTE_ALPHABET, HUFFMAN_MAX_CODE_LENGTH, model.lengths);
+    assign_canonical_codes(model.lengths, HUFFMAN_BYTE_ALPHABET, model.code);
+    build_canonical_decoder(model.lengths, HUFFMAN_BYTE_ALPHABET, model.decoder);
+    model.rebuilds++;
+}
+
+void adaptive_model::reset(const unsigned shift) {
+    decay_shift = shift;
+    rebuilds = 0;
+    fill(begin(counts), end(counts), 1);
+    rebuild_model(*this);
+}
+
+void adaptive_model::update(const uint8_t *data, const size_t length) {
+    uint64_t histogram[HUFFMAN_BYTE_ALPHABET] = {};
+    accumulate_byte_histogram(data, length, histogram);
+    for (size_t symbol = 0; symbol < HUFFMAN_BYTE_ALPHABET; symbol++) {
+        counts[symbol] = max<uint64_t>(1, (counts[symbol] >> decay_shift) + histogram[symbol]);
+    }
+    rebuild_model(*this);
+}
+
+/*=============================================================================
+ * FRAMES
+ *=============================================================================*/
+
+void adaptive_write_header(vector<uint8_t> &out, const uint32_t frame_size, const unsigned decay_shift) {
+    out.insert(out.end(), ADAPTIVE_STREAM_MAGIC, ADAPTIVE_STREAM_MAGIC + 8);
+    append_u16(out, ADAPTIVE_STREAM_VERSION);
+    append_u8(out, static_cast<uint8_t>(decay_shift));
+    append_u8(out, 0);
+    append_u32(out, frame_size);
+}
+
+bool adaptive_encode_frame(adaptive_model &model, const uint8_t *data, const size_t length, vector<uint8_t> &out) {
+    const size_t header_position = out.size();
+    out.resize(header_position + ADAPTIVE_FRAME_HEADER_SIZE + (length * HUFFMAN_MAX_CODE_LENGTH + 7) / 8);
+    size_t payload_size = huffman_encode_bytes(data, length, model.code,
+                                               &out[header_position + ADAPTIVE_FRAME_HEADER_SIZE]);
+
+    // Incompressible frame: store it (the model still learns from it)
+    const bool stored = payload_size >= length;
+    if (stored) {
+        payload_size = length;
+        memcpy(&out[header_position + ADAPTIVE_FRAME_HEADER_SIZE], data, length);
+    }
+    out.resize(header_position + ADAPTIVE_FRAME_HEADER_SIZE + payload_size);
+
+    vector<uint8_t> header;
+    append_u8(header, stored ? ADAPTIVE_FRAME_STORED : ADAPTIVE_FRAME_CODED);
+    append_u32(header, static_cast<uint32_t>(length));
+    append_u32(header, static_cast<uint32_t>(payload_size));
+    append_u64(header, data_checksum(data, length));
+    copy(header.begin(), header.end(), out.begin() + static_cast<ptrdiff_t>(header_position));
+
+    model.update(data, length);
+    return stored;
+}
+
+bool adaptive_decode_frame(adaptive_model &model, const uint8_t *header, const uint8_t *payload,
+                           vector<uint8_t> &output, string &error) {
+    const uint8_t mode = header[0];
+    const uint32_t raw_size = read_u32(header + 1);
+    const uint32_t payload_size = read_u32(header + 5);
+    output.resize(raw_size);
+
+    if (mode == ADAPTIVE_FRAME_STORED) {
+        if (payload_size != raw_size) {
+            error = "Stored frame has an invalid size";
+            return false;
+        }
+        memcpy(output.data(), payload, raw_size);
+    } else if (mode == ADAPTIVE_FRAME_CODED) {
+        if (!huffman_decode_bytes(payload, payload_size, model.decoder, output.data(), raw_size)) {
+            error = "Corrupted adaptive frame";
+            return false;
+        }
+    } else {
+        error = "Unknown frame mode " + to_string(mode);
+        return false;
+    }
+
+    if (data_checksum(output.data(), raw_size) != read_u64(header + 9)) {
+        error = "Frame checksum mismatch";
+        return false;
+    }
+    model.update(output.data(), raw_size);
+    return true;
+}
+
+bool is_adaptive_stream(const uint8_t *data, const size_t size) {
+    return size >= 8 && memcmp(data, ADAPTIVE_STREAM_MAGIC, 8) == 0;
+}
+
+/*=============================================================================
+ * STREAM I/O
+ *=============================================================================*/
+
+/**
+ * @brief write() until everything is written
+ */
+static bool write_all(const int output, const uint8_t *data, size_t size, string &error) {
+    while (size > 0) {
+        const ssize_t count = write(output, data, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) {
+            error = string("Write failed: ") + strerror(errno);
+            return false;
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+/**
+ * @brief read() exactly size bytes; false at end of input or on errors
+ */
+static bool read_all(const int input, uint8_t *data, size_t size) {
+    while (size > 0) {
+        const ssize_t count = read(input, data, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+bool adaptive_compress_stream(const int input, const int output, const uint32_t frame_size,
+                              adaptive_statistics &stats, string &error) {
+    adaptive_model model;
+    model.reset(ADAPTIVE_DECAY_SHIFT);
+
+    vector<uint8_t> out;
+    adaptive_write_header(out, frame_size, ADAPTIVE_DECAY_SHIFT);
+    if (!write_all(output, out.data(), out.size(), error)) return false;
+    stats.stream_bytes += out.size();
+
+    vector<uint8_t> frame(frame_size);
+    size_t pending = 0;
+    steady_clock::time_point first_byte;
+
+    auto flush = [&] {
+        out.clear();
+        if (adaptive_encode_frame(model, frame.data(), pending, out)) stats.stored_frames++;
+        if (!write_all(output, out.data(), out.size(), error)) return false;
+
+        stats.raw_bytes += pending;
+        stats.stream_bytes += out.size();
+        stats.frames++;
+        stats.max_flush_latency_ms = max(stats.max_flush_latency_ms,
+                                         duration<double, milli>(steady_clock::now() - first_byte).count());
+        pending = 0;
+        return true;
+    };
+
+    while (true) {
+        if (pending == frame_size && !flush()) return false;
+
+        // Wait for input, but never longer than the flush deadline of a partial frame
+        int timeout = -1;
+        if (pending > 0) {
+            const auto waited = duration_cast<milliseconds>(steady_clock::now() - first_byte).count();
+            timeout = static_cast<int>(max<int64_t>(0, ADAPTIVE_FLUSH_MS - waited));
+        }
+        pollfd source{input, POLLIN, 0};
+        const int ready = poll(&source, 1, timeout);
+        if (ready < 0 && errno != EINTR) {
+            error = string("Cannot wait for input: ") + strerror(errno);
+            return false;
+        }
+        if (ready == 0) {
+            if (!flush()) return false;
+            continue;
+        }
+        if (ready < 0) continue;
+
+        const ssize_t count = read(input, frame.data() + pending, frame_size - pending);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            error = string("Read failed: ") + strerror(errno);
+            return false;
+        }
+        if (count == 0) break;
+        if (pending == 0) first_byte = steady_clock::now();
+        pending += static_cast<size_t>(count);
+    }
+
+    if (pending > 0 && !flush()) return false;
+    out.assign(ADAPTIVE_FRAME_HEADER_SIZE, 0); // ADAPTIVE_FRAME_END
+    stats.stream_bytes += out.size();
+    return write_all(output, out.data(), out.size(), error);
+}
+
+bool adaptive_decompress_stream(const int input, const int output, adaptive_statistics &stats, string &error) {
+    uint8_t header[ADAPTIVE_HEADER_SIZE];
+    if (!read_all(input, header, sizeof(header)) || !is_adaptive_stream(header, sizeof(header))) {
+        error = "Not an adaptive stream";
+        return false;
+    }
+    if (read_u16(header + 8) != ADAPTIVE_STREAM_VERSION) {
+        error = "Unsupported adaptive stream version " + to_string(read_u16(header + 8));
+        return false;
+    }
+    const uint32_t frame_size = read_u32(header + 12);
+    stats.stream_bytes += sizeof(header);
+
+    adaptive_model model;
+    model.reset(header[10]);
+
+    uint8_t frame_header[ADAPTIVE_FRAME_HEADER_SIZE];
+    vector<uint8_t> payload;
+    vector<uint8_t> decoded;
+    while (true) {
+        if (!read_all(input, frame_header, sizeof(frame_header))) {
+            error = "Stream is truncated (no end frame)";
+            return false;
+        }
+        stats.stream_bytes += sizeof(frame_header);
+        if (frame_header[0] == ADAPTIVE_FRAME_END) return true;
+
+        const uint32_t raw_size = read_u32(frame_header + 1);
+        const uint32_t payload_size = read_u32(frame_header + 5);
+        if (raw_size > frame_size || payload_size > (static_cast<uint64_t>(raw_size) * HUFFMAN_MAX_CODE_LENGTH + 7) / 8) {
+            error = "Frame exceeds the stream's frame size";
+            return false;
+        }
+        payload.resize(payload_size);
+        if (!read_all(input, payload.data(), payload_size)) {
+            error = "Stream is truncated inside a frame";
+            return false;
+        }
+        if (!adaptive_decode_frame(model, frame_header, payload.data(), decoded, error) ||
+            !write_all(output, decoded.data(), decoded.size(), error)) {
+            return false;
+        }
+
+        stats.raw_bytes += raw_size;
+        stats.stream_bytes += payload_size;
+        stats.frames++;
+        if (frame_header[0] == ADAPTIVE_FRAME_STORED) stats.stored_frames++;
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "canonical_huffman.h"
+
+/**
+ * @file adaptive_stream.h
+ * @brief One-pass adaptive Huffman format for unbounded streams
+ *
+ * The static formats need the whole histogram before the first bit can be
+ * written. Here the code is predicted instead: both sides keep decayed running
+ * byte counts, and after every frame they fold the frame's histogram into the
+ * counts and rebuild the same length-limited canonical code. Frame N is coded
+ * with the code built from frames 0..N-1, so no table is ever transmitted and
+ * the decoder rebuilds in lockstep from the data it has just decoded.
+ *
+ * Frames are cut when ADAPTIVE frame_size bytes are pending or when the source
+ * has been idle for ADAPTIVE_FLUSH_MS with bytes pending, so the latency from
+ * a byte arriving to it being written compressed stays bounded for slow
+ * sources (pipes, sockets, follow-mode logs).
+ *
+ * Stream layout (all integers little-endian):
+ * 1. Header (16 bytes): magic "\x89HUFADP\n" (8), version (2), decay shift (1),
+ *    reserved (1), maximum frame size (4)
+ * 2. Frames: mode (1), raw size (4), payload size (4), data_checksum of the
+ *    raw bytes (8), payload. Mode ADAPTIVE_FRAME_CODED is a bit stream under
+ *    the current code, ADAPTIVE_FRAME_STORED the raw bytes (used when coding
+ *    would not save anything); both update the model.
+ * 3. A frame with mode ADAPTIVE_FRAME_END and zero sizes
+ */
+
+#define ADAPTIVE_STREAM_MAGIC "\x89HUFADP\n"
+#define ADAPTIVE_STREAM_VERSION 1
+#define ADAPTIVE_HEADER_SIZE 16
+#define ADAPTIVE_FRAME_HEADER_SIZE 17
+
+// Default frame size: small enough for low latency, large enough that rebuilding the code is noise
+#define ADAPTIVE_DEFAULT_FRAME_SIZE (64 * 1024)
+
+// Old counts are shifted right by this much before each frame is added (1 = halve)
+#define ADAPTIVE_DECAY_SHIFT 1
+
+// A partial frame is flushed after the source has been idle this long
+#define ADAPTIVE_FLUSH_MS 100
+
+enum adaptive_frame_mode : uint8_t {
+    ADAPTIVE_FRAME_END = 0,
+    ADAPTIVE_FRAME_STORED = 1,
+    ADAPTIVE_FRAME_CODED = 2,
+};
+
+/**
+ * @struct adaptive_model
+ * @brief Decayed byte counts and the code derived from them
+ *
+ * Every count stays at least 1, so every byte value always has a code and
+ * any frame can be coded without escapes. The initial model is flat (all
+ * codes 8 bits long).
+ */
+struct adaptive_model {
+    uint64_t counts[HUFFMAN_BYTE_ALPHABET];
+    uint8_t lengths[HUFFMAN_BYTE_ALPHABET];
+    canonical_code code;
+    canonical_decoder decoder;
+    unsigned decay_shift = ADAPTIVE_DECAY_SHIFT;
+    uint64_t rebuilds = 0;
+
+    void reset(unsigned shift);
+
+    // Decays the counts, adds the frame's histogram and rebuilds code and decoder
+    void update(const uint8_t *data, size_t length);
+};
+
+/**
+ * @struct adaptive_statistics
+ * @brief Totals of one compression or decompression run
+ */
+struct adaptive_statistics {
+    uint64_t raw_bytes = 0;
+    uint64_t stream_bytes = 0;
+    uint64_t frames = 0;
+    uint64_t stored_frames = 0;
+    double max_flush_latency_ms = 0.0; // Longest wait from a frame's first byte to its write
+};
+
+/**
+ * @brief Writes the stream header
+ */
+void adaptive_write_header(std::vector<uint8_t> &out, uint32_t frame_size, unsigned decay_shift);
+
+/**
+ * @brief Codes one frame with the model's current code, then updates the model
+ * @param model Encoder model (advanced past this frame)
+ * @param data Frame data (at most the stream's frame size)
+ * @param length Frame length
+ * @param out Frame header and payload are appended here
+ * @return Whether the frame was stored raw
+ */
+bool adaptive_encode_frame(adaptive_model &model, const uint8_t *data, size_t length, std::vector<uint8_t> &out);
+
+/**
+ * @brief Decodes one frame and updates the model the same way the encoder did
+ * @param model Decoder model
+ * @param header ADAPTIVE_FRAME_HEADER_SIZE bytes of frame header
+ * @param payload Frame payload
+ * @param output Receives the frame's raw bytes (resized)
+ * @param error Set on corrupt data or checksum mismatch
+ */
+bool adaptive_decode_frame(adaptive_model &model, const uint8_t *header, const uint8_t *payload,
+                           std::vector<uint8_t> &output, std::string &error);
+
+/**
+ * @brief Compresses a file descriptor into a stream until end of input
+ * @param input Source (file, pipe, socket); polled so idle sources flush partial frames
+ * @param output Destination; every frame is written as soon as it is coded
+ * @param frame_size Maximum frame size
+ * @param stats Output totals
+ * @param error Set on read/write failures
+ */
+bool adaptive_compress_stream(int input, int output, uint32_t frame_size, adaptive_statistics &stats,
+                              std::string &error);
+
+/**
+ * @brief Decompresses a stream from a file descriptor, writing each frame as it is decoded
+ */
+bool adaptive_decompress_stream(int input, int output, adaptive_statistics &stats, std::string &error);
+
+/**
+ * @brief Checks whether a buffer starts with the adaptive stream magic
+ */
+bool is_adaptive_stream(const uint8_t *data, size_t size);
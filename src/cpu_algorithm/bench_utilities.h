@@ -0,0 +1,23 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+/**
+ * @file bench_utilities.h
+ * @brief Timing helpers shared by the benchmark tools
+ */
+
+/**
+ * @brief Runs fn `repeat` times and returns the fastest run in seconds
+ */
+inline double best_of(const int repeat, const std::function<void()> &fn) {
+    double best = 0.0;
+    for (int run = 0; run < repeat; run++) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (run == 0 || seconds < best) best = seconds;
+    }
+    return best;
+}
@@ -0,0 +1,476 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+
+#include "block_engines.h"
+#include "data_statistics.h"
+#include "format_utilities.h"
+
+/**
+ * @file block_engines.cpp
+ * @brief RLE and byte-shuffle engines and the sampling engine selector
+ */
+
+using namespace std;
+
+// Runs shorter than this stay inside literals (a run token costs at least 2 bytes)
+#define RLE_MIN_RUN 4
+
+// The trial sample: this many slices of this many bytes spread over the block
+#define ENGINE_SAMPLE_SLICES 4
+#define ENGINE_SAMPLE_SLICE_SIZE 512
+
+// A later engine in block_engine order must beat the best so far by this fraction (sample noise)
+#define ENGINE_SELECTION_MARGIN 0.01
+
+// Sample order-0 entropy (bits/byte) from which a block is taken as random and stored without further trials
+#define ENGINE_STORED_ENTROPY 7.8
+
+// Widest shuffle element (flags of a shuffle block)
+#define SHUFFLE_MAX_WIDTH 8
+
+/*=============================================================================
+ * OPTIONS
+ *=============================================================================*/
+
+unsigned parse_engine_list(const string &list) {
+    if (list == "all") return BLOCK_ENGINE_ALL;
+
+    unsigned engines = 0;
+    size_t start = 0;
+    while (start <= list.size()) {
+        const size_t end = min(list.find(',', start), list.size());
+        const string name = list.substr(start, end - start);
+        if (name == "stored") engines |= BLOCK_ENGINE_STORED;
+        else if (name == "rle") engines |= BLOCK_ENGINE_RLE;
+        else if (name == "huffman") engines |= BLOCK_ENGINE_HUFFMAN;
+        else if (name == "shuffle") engines |= BLOCK_ENGINE_SHUFFLE;
+        else return 0;
+        start = end + 1;
+    }
+    return engines;
+}
+
+bool parse_objective(const string &text, double &mbps) {
+    if (text == "ratio") {
+        mbps = 0;
+        return true;
+    }
+    if (text == "balanced") {
+        mbps = OBJECTIVE_BALANCED_MBPS;
+        return true;
+    }
+    if (text == "speed") {
+        mbps = OBJECTIVE_SPEED_MBPS;
+        return true;
+    }
+    try {
+        size_t parsed;
+        mbps = stod(text, &parsed);
+        return parsed == text.size() && mbps > 0;
+    } catch (const exception &) {
+        return false;
+    }
+}
+
+/*=============================================================================
+ * RLE
+ *=============================================================================*/
+
+/**
+ * @brief Length of the run of equal bytes starting at data[position], compared a word at a time
+ */
+static size_t run_length(const uint8_t *data, const size_t position, const size_t length) {
+    const uint8_t value = data[position];
+    const uint64_t pattern = value * 0x0101010101010101ULL;
+    size_t end = position + 1;
+    while (end + 8 <= length) {
+        uint64_t word;
+        memcpy(&word, data + end, 8);
+        // Little-endian: the lowest differing byte is the first one in memory
+        if (const uint64_t difference = word ^ pattern; difference != 0) {
+            return end + countr_zero(difference) / 8 - position;
+        }
+        end += 8;
+    }
+    while (end < length && data[end] == value) end++;
+    return end - position;
+}
+
+void rle_encode(const uint8_t *data, const size_t length, vector<uint8_t> &out) {
+    size_t literal_start = 0;
+    const auto flush_literals = [&](const size_t end) {
+        if (end == literal_start) return;
+        append_varint(out, (end - literal_start - 1) << 1);
+        out.insert(out.end(), data + literal_start, data + end);
+    };
+
+    size_t position = 0;
+    while (position < length) {
+        // Skip 7 bytes at a time while no two neighbours are equal (no run can start there)
+        while (position + 8 <= length) {
+            uint64_t word;
+            memcpy(&word, data + position, 8);
+            const uint64_t neighbours = (word ^ word >> 8) | 0xFFULL << 56;
+            if (((neighbours - 0x0101010101010101ULL) & ~neighbours & 0x8080808080808080ULL) != 0) break;
+            position += 7;
+        }
+        if (position >= length) break;
+        const size_t run = run_length(data, position, length);
+        if (run >= RLE_MIN_RUN) {
+            flush_literals(position);
+            append_varint(out, (run - 1) << 1 | 1);
+            append_u8(out, data[position]);
+            literal_start = position + run;
+        }
+        position += run;
+    }
+    flush_literals(length);
+}
+
+bool rle_decode(const uint8_t *payload, const size_t size, uint8_t *output, const size_t length) {
+    size_t position = 0;
+    size_t produced = 0;
+    while (produced < length) {
+        uint64_t token;
+        if (!read_varint(payload, size, position, token)) return false;
+        const uint64_t count = (token >> 1) + 1;
+        if (count > length - produced) return false;
+
+        if (token & 1) {
+            if (position >= size) return false;
+            memset(output + produced, payload[position++], count);
+        } else {
+            if (size - position < count) return false;
+            memcpy(output + produced, payload + position, count);
+            position += count;
+        }
+        produced += count;
+    }
+    return position == size;
+}
+
+/*=============================================================================
+ * SHUFFLE
+ *=============================================================================*/
+
+size_t shuffle_table_bytes(const unsigned width) {
+    return width * (HUFFMAN_BYTE_ALPHABET / 2 + sizeof(uint32_t));
+}
+
+/**
+ * @struct plane_code
+ * @brief How one byte plane of a shuffle block is coded
+ */
+struct plane_code {
+    uint8_t lengths[HUFFMAN_BYTE_ALPHABET];
+    uint64_t stream_size; // Bytes of the plane's stream
+    bool coded; // Huffman stream (false: raw plane or a single repeated symbol)
+};
+
+/**
+ * @brief Splits `count` elements of Width bytes into contiguous byte planes
+ */
+template<unsigned Width>
+static void split_planes(const uint8_t *data, const size_t count, uint8_t *planes) {
+    for (size_t element = 0; element < count; element++) {
+        for (unsigned plane = 0; plane < Width; plane++) {
+            planes[plane * count + element] = data[element * Width + plane];
+        }
+    }
+}
+
+/**
+ * @brief split_planes() for a run-time width, dispatched to a compile-time one so the inner loop unrolls
+ */
+static void split_planes(const uint8_t *data, const size_t count, const unsigned width, uint8_t *planes) {
+    switch (width) {
+        case 2: return split_planes<2>(data, count, planes);
+        case 4: return split_planes<4>(data, count, planes);
+        default: return split_planes<8>(data, count, planes);
+    }
+}
+
+/**
+ * @brief Chooses the code of one plane from its histogram
+ */
+static void plan_plane(const uint64_t *frequency, const size_t count, plane_code &plane) {
+    build_code_lengths(frequency, HUFFMAN_BYTE_ALPHABET, HUFFMAN_MAX_CODE_LENGTH, plane.lengths);
+    const size_t used = count_if(frequency, frequency + HUFFMAN_BYTE_ALPHABET, [](const uint64_t value) {
+        return value != 0;
+    });
+    const uint64_t coded_size = (predicted_code_bits(frequency, plane.lengths, HUFFMAN_BYTE_ALPHABET) + 7) / 8;
+
+    plane.coded = false;
+    if (used <= 1) {
+        plane.stream_size = 0;
+    } else if (coded_size >= count) {
+        memset(plane.lengths, 0, sizeof(plane.lengths));
+        plane.stream_size = count;
+    } else {
+        plane.stream_size = coded_size;
+        plane.coded = true;
+    }
+}
+
+// Byte planes of the data last passed to split_shuffle(), read back by emit_shuffle()
+static thread_local vector<uint8_t> shuffle_planes;
+
+/**
+ * @brief Splits data into byte planes and counts the histogram of each
+ */
+static void split_shuffle(const uint8_t *data, const size_t length, const unsigned width,
+                          uint64_t (*frequency)[HUFFMAN_BYTE_ALPHABET]) {
+    const size_t count = length / width;
+    shuffle_planes.resize(count * width);
+    split_planes(data, count, width, shuffle_planes.data());
+    for (unsigned plane = 0; plane < width; plane++) {
+        fill(frequency[plane], frequency[plane] + HUFFMAN_BYTE_ALPHABET, 0);
+        accumulate_byte_histogram(&shuffle_planes[plane * count], count, frequency[plane]);
+    }
+}
+
+/**
+ * @brief Chooses the code of each plane counted by split_shuffle()
+ * @return The size of the shuffle payload these codes give
+ */
+static uint64_t plan_shuffle(const uint64_t (*frequency)[HUFFMAN_BYTE_ALPHABET], const size_t length,
+                             const unsigned width, plane_code *codes) {
+    const size_t count = length / width;
+    uint64_t size = shuffle_table_bytes(width) + (length - count * width);
+    for (unsigned plane = 0; plane < width; plane++) {
+        plan_plane(frequency[plane], count, codes[plane]);
+        size += codes[plane].stream_size;
+    }
+    return size;
+}
+
+/**
+ * @brief Appends the shuffle payload of the data just split by split_shuffle() to out
+ */
+static void emit_shuffle(const uint8_t *data, const size_t length, const unsigned width, const plane_code *codes,
+                         vector<uint8_t> &out) {
+    const size_t count = length / width;
+    for (unsigned plane = 0; plane < width; plane++) append_packed_lengths(out, codes[plane].lengths);
+    for (unsigned plane = 0; plane < width; plane++) append_u32(out, static_cast<uint32_t>(codes[plane].stream_size));
+
+    for (unsigned plane = 0; plane < width; plane++) {
+        const uint8_t *source = &shuffle_planes[plane * count];
+        if (!codes[plane].coded) {
+            if (codes[plane].stream_size != 0) out.insert(out.end(), source, source + count);
+            continue;
+        }
+        canonical_code code;
+        assign_canonical_codes(codes[plane].lengths, HUFFMAN_BYTE_ALPHABET, code);
+        const size_t stream_offset = out.size();
+        out.resize(stream_offset + codes[plane].stream_size);
+        huffman_encode_bytes(source, count, code, &out[stream_offset]);
+    }
+    out.insert(out.end(), data + count * width, data + length);
+}
+
+void shuffle_encode(const uint8_t *data, const size_t length, const unsigned width, vector<uint8_t> &out) {
+    uint64_t frequency[SHUFFLE_MAX_WIDTH][HUFFMAN_BYTE_ALPHABET];
+    plane_code codes[SHUFFLE_MAX_WIDTH];
+    split_shuffle(data, length, width, frequency);
+    plan_shuffle(frequency, length, width, codes);
+    emit_shuffle(data, length, width, codes, out);
+}
+
+bool shuffle_decode(const uint8_t *payload, const size_t size, const unsigned width, uint8_t *output,
+                    const size_t length, const decoder_engine engine) {
+    if (width < 2 || width > SHUFFLE_MAX_WIDTH || size < shuffle_table_bytes(width)) return false;
+    const size_t count = length / width;
+    const size_t tail = length - count * width;
+
+    thread_local vector<uint8_t> planes;
+    planes.resize(count);
+    size_t position = shuffle_table_bytes(width);
+    for (unsigned plane = 0; plane < width; plane++) {
+        uint8_t lengths[HUFFMAN_BYTE_ALPHABET];
+        unpack_lengths(payload + plane * (HUFFMAN_BYTE_ALPHABET / 2), lengths);
+        const uint32_t stream_size = read_u32(payload + width * (HUFFMAN_BYTE_ALPHABET / 2) + plane * 4);
+        if (size - position < stream_size) return false;
+        const uint8_t *stream = payload + position;
+        position += stream_size;
+
+        const size_t used = count_if(lengths, lengths + HUFFMAN_BYTE_ALPHABET, [](const uint8_t value) {
+            return value != 0;
+        });
+        if (used == 0) {
+            if (stream_size != count) return false;
+            memcpy(planes.data(), stream, count);
+        } else if (used == 1 && stream_size == 0) {
+            const uint8_t *symbol = find_if(lengths, lengths + HUFFMAN_BYTE_ALPHABET, [](const uint8_t value) {
+                return value != 0;
+            });
+            memset(planes.data(), static_cast<int>(symbol - lengths), count);
+        } else {
+            bool decoded;
+            const bool limits = engine == DECODER_ENGINE_AUTO
+                                    ? prefer_limit_decoder((size_t{1} << HUFFMAN_LOOKUP_BITS) * sizeof(uint32_t),
+                                                           false, count)
+                                    : engine == DECODER_ENGINE_LIMITS;
+            if (limits) {
+                limit_decoder decoder;
+                decoded = build_limit_decoder(lengths, HUFFMAN_BYTE_ALPHABET, nullptr, decoder) &&
+                          huffman_decode_bytes_limits(stream, stream_size, decoder, planes.data(), count);
+            } else {
+                canonical_decoder decoder;
+                decoded = build_canonical_decoder(lengths, HUFFMAN_BYTE_ALPHABET, decoder) &&
+                          huffman_decode_bytes(stream, stream_size, decoder, planes.data(), count);
+            }
+            if (!decoded) return false;
+        }
+
+        for (size_t element = 0; element < count; element++) output[element * width + plane] = planes[element];
+    }
+
+    if (size - position != tail) return false;
+    memcpy(output + count * width, payload + position, tail);
+    return true;
+}
+
+/*=============================================================================
+ * ENGINE SELECTION
+ *=============================================================================*/
+
+/**
+ * @brief Copies the trial sample of a block: evenly spaced 8-byte aligned slices, or the whole block if small
+ */
+static const uint8_t *gather_sample(const uint8_t *data, const uint32_t length, size_t &sample_length) {
+    if (length <= ENGINE_SAMPLE_SLICES * ENGINE_SAMPLE_SLICE_SIZE) {
+        sample_length = length;
+        return data;
+    }
+    thread_local vector<uint8_t> sample(ENGINE_SAMPLE_SLICES * ENGINE_SAMPLE_SLICE_SIZE);
+    const size_t span = length - ENGINE_SAMPLE_SLICE_SIZE;
+    for (size_t slice = 0; slice < ENGINE_SAMPLE_SLICES; slice++) {
+        const size_t offset = span * slice / (ENGINE_SAMPLE_SLICES - 1) & ~size_t{7};
+        memcpy(&sample[slice * ENGINE_SAMPLE_SLICE_SIZE], data + offset, ENGINE_SAMPLE_SLICE_SIZE);
+    }
+    sample_length = sample.size();
+    return sample.data();
+}
+
+block_engine select_block_engine(const uint8_t *data, const uint32_t length, const unsigned engines,
+                                 const unsigned shuffle_width, const double objective_mbps,
+                                 engine_estimate *estimates) {
+    size_t sample_length;
+    const uint8_t *sample = gather_sample(data, length, sample_length);
+    const double scale = static_cast<double>(length) / static_cast<double>(sample_length);
+    const auto elapsed = [](const chrono::steady_clock::time_point start) {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    };
+
+    // Lowest cost wins; near-ties go to the earlier (simpler, cheaper to decode) engine, so the trials run in
+    // block_engine order and a later engine must beat the best so far by the margin
+    engine_estimate trial[ENGINE_COUNT];
+    block_engine best = ENGINE_STORED;
+    double best_cost = 0;
+    bool found = false;
+    const auto cost_of = [objective_mbps](const uint64_t bytes, const double seconds) {
+        return objective_mbps > 0 ? seconds + static_cast<double>(bytes) / (objective_mbps * 1e6)
+                                  : static_cast<double>(bytes);
+    };
+    const auto can_win = [&](const uint64_t bytes, const double seconds) {
+        return !found || cost_of(bytes, seconds) < best_cost * (1 - ENGINE_SELECTION_MARGIN);
+    };
+    const auto record = [&](const block_engine engine, const engine_estimate estimate) {
+        trial[engine] = estimate;
+        if (can_win(estimate.bytes, estimate.seconds)) {
+            best = engine;
+            best_cost = cost_of(estimate.bytes, estimate.seconds);
+            found = true;
+        }
+    };
+    const auto finish = [&] {
+        if (estimates) copy(trial, trial + ENGINE_COUNT, estimates);
+        return best;
+    };
+
+    // One sample histogram serves the random-data early-out and the Huffman trial
+    uint64_t frequency[HUFFMAN_BYTE_ALPHABET] = {};
+    double histogram_seconds = 0;
+    if (engines & (BLOCK_ENGINE_STORED | BLOCK_ENGINE_HUFFMAN)) {
+        const auto start = chrono::steady_clock::now();
+        accumulate_byte_histogram(sample, sample_length, frequency);
+        histogram_seconds = elapsed(start);
+    }
+
+    // Per-byte work is timed on the sample and scaled; code construction is a fixed cost per block
+    thread_local vector<uint8_t> scratch;
+    if (engines & BLOCK_ENGINE_STORED) {
+        scratch.resize(sample_length);
+        const auto start = chrono::steady_clock::now();
+        memcpy(scratch.data(), sample, sample_length);
+        record(ENGINE_STORED, {length, elapsed(start) * scale});
+        if (histogram_entropy(frequency, HUFFMAN_BYTE_ALPHABET) >= ENGINE_STORED_ENTROPY) return finish();
+    }
+    if (engines & BLOCK_ENGINE_RLE) {
+        scratch.clear();
+        const auto start = chrono::steady_clock::now();
+        rle_encode(sample, sample_length, scratch);
+        record(ENGINE_RLE, {
+                   static_cast<uint64_t>(static_cast<double>(scratch.size()) * scale), elapsed(start) * scale
+               });
+    }
+
+    // The Huffman and shuffle sizes follow exactly from the code lengths, so an engine is only encoded when it can
+    // still win, and under the ratio objective (where the time does not count) never
+    if (engines & BLOCK_ENGINE_HUFFMAN) {
+        uint8_t lengths[HUFFMAN_BYTE_ALPHABET];
+        const auto build_start = chrono::steady_clock::now();
+        build_code_lengths(frequency, HUFFMAN_BYTE_ALPHABET, HUFFMAN_MAX_CODE_LENGTH, lengths);
+        const uint64_t bits = predicted_code_bits(frequency, lengths, HUFFMAN_BYTE_ALPHABET);
+        const uint64_t bytes = HUFFMAN_BYTE_ALPHABET / 2 + static_cast<uint64_t>(static_cast<double>(bits) * scale / 8);
+        double seconds = elapsed(build_start) + histogram_seconds * scale;
+
+        if (can_win(bytes, seconds)) {
+            if (objective_mbps > 0) {
+                canonical_code code;
+                assign_canonical_codes(lengths, HUFFMAN_BYTE_ALPHABET, code);
+                scratch.resize((sample_length * HUFFMAN_MAX_CODE_LENGTH + 7) / 8);
+                const auto encode_start = chrono::steady_clock::now();
+                huffman_encode_bytes(sample, sample_length, code, scratch.data());
+                seconds += elapsed(encode_start) * scale;
+            }
+            record(ENGINE_HUFFMAN, {bytes, seconds});
+        }
+    }
+    if (engines & BLOCK_ENGINE_SHUFFLE) {
+        uint64_t frequency[SHUFFLE_MAX_WIDTH][HUFFMAN_BYTE_ALPHABET];
+        const auto split_start = chrono::steady_clock::now();
+        split_shuffle(sample, sample_length, shuffle_width, frequency);
+        double seconds = elapsed(split_start) * scale;
+
+        // No code beats the entropy, so the planes' entropies bound the size before any code is built
+        const size_t count = sample_length / shuffle_width;
+        const size_t table_bytes = shuffle_table_bytes(shuffle_width);
+        double entropy_bits = 0;
+        for (unsigned plane = 0; plane < shuffle_width; plane++) {
+            entropy_bits += histogram_entropy(frequency[plane], HUFFMAN_BYTE_ALPHABET) * static_cast<double>(count);
+        }
+        const auto bound = table_bytes + static_cast<uint64_t>(entropy_bits * scale / 8);
+
+        if (can_win(bound, seconds)) {
+            plane_code codes[SHUFFLE_MAX_WIDTH];
+            const auto build_start = chrono::steady_clock::now();
+            const uint64_t sample_size = plan_shuffle(frequency, sample_length, shuffle_width, codes);
+            seconds += elapsed(build_start);
+            const auto bytes = table_bytes + static_cast<uint64_t>(static_cast<double>(sample_size - table_bytes) *
+                                                                   scale);
+            if (can_win(bytes, seconds)) {
+                if (objective_mbps > 0) {
+                    scratch.clear();
+                    const auto encode_start = chrono::steady_clock::now();
+                    emit_shuffle(sample, sample_length, shuffle_width, codes, scratch);
+                    seconds += elapsed(encode_start) * scale;
+                }
+                record(ENGINE_SHUFFLE, {bytes, seconds});
+            }
+        }
+    }
+    return finish();
+}
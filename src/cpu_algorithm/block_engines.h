@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "canonical_huffman.h"
+
+/**
+ * @file block_engines.h
+ * @brief Alternative block engines and per-block engine selection by trial encoding
+ *
+ * Different regions of one input want different coders: padding and sparse
+ * tables are runs, already-compressed media should be stored, text wants a
+ * byte Huffman code, and arrays of integers or floats compress far better
+ * when their byte planes are coded separately (the high bytes of small
+ * numbers are nearly constant, which a single byte histogram cannot see).
+ *
+ * select_block_engine() encodes a small sample of each block - a few slices
+ * spread over it - with every enabled engine, extrapolates size and time to
+ * the whole block and picks the engine with the lowest cost under the
+ * objective. A near-random sample is stored without further trials, and an
+ * engine whose exact size already loses is not encoded. The selection is
+ * recorded as the block's mode, so decoding needs no extra information.
+ *
+ * RLE payload: tokens of varint (count - 1) << 1 | is_run; a run token is
+ * followed by its byte value, a literal token by `count` raw bytes.
+ *
+ * Shuffle payload (block header flags = element width w): w packed byte
+ * code tables (128 bytes each, one per byte plane), w u32 plane stream
+ * sizes, the w plane streams, then the raw_size % w trailing bytes. A plane
+ * with all code lengths zero is stored raw; one with a single used symbol
+ * has an empty stream and is that symbol repeated.
+ */
+
+// Engine bits of block_encoder_settings::engines
+#define BLOCK_ENGINE_STORED 0x1
+#define BLOCK_ENGINE_RLE 0x2
+#define BLOCK_ENGINE_HUFFMAN 0x4
+#define BLOCK_ENGINE_SHUFFLE 0x8
+#define BLOCK_ENGINE_ALL 0xF
+
+// --objective presets: rate (MB/s) at which output bytes are weighed against encode time
+#define OBJECTIVE_BALANCED_MBPS 100.0
+#define OBJECTIVE_SPEED_MBPS 1000.0
+
+// Default element width of the shuffle engine (int32 / float arrays)
+#define DEFAULT_SHUFFLE_WIDTH 4
+
+/**
+ * @enum block_engine
+ * @brief Engines a block can be coded with, in tie-breaking order
+ */
+enum block_engine {
+    ENGINE_STORED = 0,
+    ENGINE_RLE,
+    ENGINE_HUFFMAN,
+    ENGINE_SHUFFLE,
+    ENGINE_COUNT
+};
+
+/**
+ * @struct engine_estimate
+ * @brief Extrapolated whole-block outcome of one engine's trial
+ */
+struct engine_estimate {
+    uint64_t bytes = UINT64_MAX; // Predicted payload size; UINT64_MAX when the engine was not tried or cannot win
+    double seconds = 0; // Predicted encode time (under the ratio objective without the Huffman and shuffle encodes)
+};
+
+/**
+ * @brief Parses an --engines list ("stored,rle,huffman,shuffle" or "all")
+ * @return The engine bit mask, or 0 on an unknown name
+ */
+unsigned parse_engine_list(const std::string &list);
+
+/**
+ * @brief Parses an --objective value: "ratio" (0), "balanced", "speed" or a rate in MB/s
+ * @return false on an unknown or non-positive value
+ */
+bool parse_objective(const std::string &text, double &mbps);
+
+/**
+ * @brief Picks the cheapest enabled engine for a block from trial encodings of a sample
+ * @param data Block data
+ * @param length Block length
+ * @param engines Enabled engines (BLOCK_ENGINE_* bits)
+ * @param shuffle_width Element width of the shuffle engine (2, 4 or 8)
+ * @param objective_mbps 0 minimizes size; otherwise cost = seconds + bytes / (objective_mbps * 1e6)
+ * @param estimates Optional, ENGINE_COUNT elements: the per-engine predictions
+ */
+block_engine select_block_engine(const uint8_t *data, uint32_t length, unsigned engines, unsigned shuffle_width,
+                                 double objective_mbps, engine_estimate *estimates = nullptr);
+
+/**
+ * @brief Appends the RLE payload of data to out
+ */
+void rle_encode(const uint8_t *data, size_t length, std::vector<uint8_t> &out);
+
+/**
+ * @brief Decodes an RLE payload of exactly `length` bytes; false when corrupted
+ */
+bool rle_decode(const uint8_t *payload, size_t size, uint8_t *output, size_t length);
+
+/**
+ * @brief Appends the shuffle payload of data (element width `width`) to out
+ */
+void shuffle_encode(const uint8_t *data, size_t length, unsigned width, std::vector<uint8_t> &out);
+
+/**
+ * @brief Decodes a shuffle payload of exactly `length` bytes; false when corrupted
+ */
+bool shuffle_decode(const uint8_t *payload, size_t size, unsigned width, uint8_t *output, size_t length,
+                    decoder_engine engine = DECODER_ENGINE_AUTO);
+
+/**
+ * @brief Table bytes of a shuffle payload (packed tables and stream sizes), for --explain
+ */
+size_t shuffle_table_bytes(unsigned width);
@@ -0,0 +1,653 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "block_format.h"
+#include "data_statistics.h"
+#include "format_utilities.h"
+#include "worker_pool.h"
+
+/**
+ * @file block_format.cpp
+ * @brief Block coding and container serialization for the CPU tools
+ */
+
+using namespace std;
+
+/*=============================================================================
+ * BLOCK CODING
+ *=============================================================================*/
+
+/**
+ * @brief Appends a block header to a byte vector
+ */
+static void append_block_header(vector<uint8_t> &out, const block_header &header) {
+    append_u8(out, header.mode);
+    append_u8(out, header.table_id);
+    append_u16(out, header.flags);
+    append_u32(out, header.raw_size);
+    append_u32(out, header.payload_size);
+}
+
+block_header read_block_header(const uint8_t *data) {
+    block_header header{};
+    header.mode = data[0];
+    header.table_id = data[1];
+    header.flags = read_u16(data + 2);
+    header.raw_size = read_u32(data + 4);
+    header.payload_size = read_u32(data + 8);
+    return header;
+}
+
+/**
+ * @brief Writes a block as header + raw data
+ */
+static void store_block(const uint8_t *data, const uint32_t length, encoded_block &block) {
+    block.bytes.clear();
+    append_block_header(block.bytes, {BLOCK_MODE_STORED, 0, 0, length, length});
+    block.bytes.insert(block.bytes.end(), data, data + length);
+}
+
+uint64_t zero_block_checksum(const uint32_t length) {
+    thread_local uint32_t cached_length = UINT32_MAX;
+    thread_local uint64_t cached_checksum = 0;
+    if (length != cached_length) {
+        const vector<uint8_t> zeros(length, 0);
+        cached_checksum = data_checksum(zeros.data(), length);
+        cached_length = length;
+    }
+    return cached_checksum;
+}
+
+/**
+ * @brief Writes a zero block (header only) and its --explain record
+ */
+static void zero_block(const uint32_t length, encoded_block &block, block_report *report) {
+    block.raw_size = length;
+    block.checksum = zero_block_checksum(length);
+    block.bytes.clear();
+    append_block_header(block.bytes, {BLOCK_MODE_ZERO, 0, 0, length, 0});
+    if (!report) return;
+
+    uint64_t frequency[HUFFMAN_BYTE_ALPHABET] = {};
+    frequency[0] = length;
+    report->raw_bytes = length;
+    report->stored_bytes = block.bytes.size();
+    report->mode = "zero";
+    report->table_id = -1;
+    report->table_bytes = 0;
+    report->payload_bytes = 0;
+    describe_block_code(frequency, nullptr, HUFFMAN_BYTE_ALPHABET, HUFFMAN_LOOKUP_BITS, *report);
+}
+
+/**
+ * @brief Fills the --explain record of a finished block (no-op without a report)
+ */
+static void report_block(const encoded_block &block, const uint64_t *frequency, const uint8_t *lengths,
+                         const uint64_t table_bytes, block_report *report,
+                         const size_t alphabet_size = HUFFMAN_BYTE_ALPHABET) {
+    if (!report) return;
+    const block_header header = read_block_header(block.bytes.data());
+
+    report->raw_bytes = header.raw_size;
+    report->stored_bytes = block.bytes.size();
+    report->mode = header.mode == BLOCK_MODE_STORED ? "stored"
+                   : header.mode == BLOCK_MODE_HUFFMAN ? "huffman"
+                   : header.mode == BLOCK_MODE_HUFFMAN16 ? "huffman16"
+                   : header.mode == BLOCK_MODE_RLE ? "rle"
+                   : header.mode == BLOCK_MODE_SHUFFLE ? "shuffle"
+                   : "shared";
+    report->table_id = header.mode == BLOCK_MODE_SHARED_TABLE ? header.table_id : -1;
+    report->table_bytes = table_bytes;
+    report->payload_bytes = header.payload_size - table_bytes;
+    describe_block_code(frequency, header.mode == BLOCK_MODE_STORED ? nullptr : lengths, alphabet_size,
+                        HUFFMAN_LOOKUP_BITS, *report);
+}
+
+/**
+ * @brief Codes a block with the RLE or shuffle engine, falling back to stored mode if it does not shrink
+ */
+static void encode_engine_block(const uint8_t *data, const uint32_t length, const block_engine engine,
+                                const block_encoder_settings &settings, encoded_block &block, block_report *report) {
+    const uint8_t mode = engine == ENGINE_RLE ? BLOCK_MODE_RLE : BLOCK_MODE_SHUFFLE;
+    const uint16_t flags = engine == ENGINE_RLE ? 0 : static_cast<uint16_t>(settings.shuffle_width);
+
+    thread_local vector<uint8_t> payload;
+    payload.clear();
+    if (engine == ENGINE_RLE) rle_encode(data, length, payload);
+    else shuffle_encode(data, length, settings.shuffle_width, payload);
+
+    uint64_t frequency[HUFFMAN_BYTE_ALPHABET] = {};
+    if (report) accumulate_byte_histogram(data, length, frequency);
+    if (payload.size() >= length) {
+        store_block(data, length, block);
+        report_block(block, frequency, nullptr, 0, report);
+        return;
+    }
+    block.bytes.clear();
+    append_block_header(block.bytes, {mode, 0, flags, length, static_cast<uint32_t>(payload.size())});
+    block.bytes.insert(block.bytes.end(), payload.begin(), payload.end());
+    report_block(block, frequency, nullptr, engine == ENGINE_RLE ? 0 : shuffle_table_bytes(settings.shuffle_width),
+                 report);
+}
+
+/*=============================================================================
+ * 16-BIT BLOCKS
+ *=============================================================================*/
+
+/**
+ * @brief Serializes a wide code's sparse symbol list and 5-bit lengths (layout in block_format.h)
+ */
+static void append_wide_table(vector<uint8_t> &out, const wide_code &code) {
+    const size_t count = code.symbols.size();
+    vector<pair<uint32_t, uint32_t> > runs;
+    for (size_t index = 0; index < count; index++) {
+        if (!runs.empty() && runs.back().first + runs.back().second == code.symbols[index]) {
+            runs.back().second++;
+        } else {
+            runs.emplace_back(code.symbols[index], 1);
+        }
+    }
+
+    append_varint(out, runs.size());
+    uint32_t previous_end = 0;
+    for (const auto &[start, run_length]: runs) {
+        append_varint(out, start - previous_end);
+        append_varint(out, run_length - 1);
+        previous_end = start + run_length;
+    }
+
+    uint32_t accumulator = 0;
+    unsigned bit_count = 0;
+    for (const uint8_t length: code.lengths) {
+        accumulator = accumulator << 5 | length;
+        bit_count += 5;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            append_u8(out, static_cast<uint8_t>(accumulator >> bit_count));
+        }
+    }
+    if (bit_count > 0) append_u8(out, static_cast<uint8_t>(accumulator << (8 - bit_count)));
+}
+
+/**
+ * @brief Parses a table written by append_wide_table(); position ends after the lengths
+ */
+static bool read_wide_table(const uint8_t *payload, const size_t size, size_t &position, vector<uint16_t> &symbols,
+                            vector<uint8_t> &lengths) {
+    uint64_t run_count;
+    if (!read_varint(payload, size, position, run_count) || run_count > HUFFMAN_WIDE_ALPHABET) return false;
+
+    symbols.clear();
+    uint64_t next = 0;
+    for (uint64_t run = 0; run < run_count; run++) {
+        uint64_t gap, run_length;
+        if (!read_varint(payload, size, position, gap) || !read_varint(payload, size, position, run_length)) {
+            return false;
+        }
+        if (gap >= HUFFMAN_WIDE_ALPHABET || run_length >= HUFFMAN_WIDE_ALPHABET) return false;
+        next += gap;
+        if (next + run_length >= HUFFMAN_WIDE_ALPHABET) return false;
+        for (uint64_t value = next; value <= next + run_length; value++) symbols.push_back(static_cast<uint16_t>(value));
+        next += run_length + 1;
+    }
+
+    const size_t length_bytes = (symbols.size() * 5 + 7) / 8;
+    if (size - position < length_bytes) return false;
+    lengths.resize(symbols.size());
+    for (size_t index = 0; index < symbols.size(); index++) {
+        const size_t bit = index * 5;
+        const unsigned window = payload[position + bit / 8] << 8 |
+                                (bit / 8 + 1 < length_bytes ? payload[position + bit / 8 + 1] : 0);
+        lengths[index] = static_cast<uint8_t>(window >> (11 - bit % 8) & 0x1F);
+    }
+    position += length_bytes;
+    return true;
+}
+
+/**
+ * @brief Builds the 16-bit candidate of a block
+ * @param table Receives the serialized code table
+ * @param present_frequency Receives the counts of the present values (for --explain)
+ * @return Payload size of the candidate (table, odd tail byte and bit stream)
+ */
+static uint64_t plan_wide_block(const uint8_t *data, const uint32_t length, wide_code &code, vector<uint8_t> &table,
+                                vector<uint64_t> &present_frequency) {
+    thread_local vector<uint64_t> frequency(HUFFMAN_WIDE_ALPHABET, 0);
+    accumulate_u16_histogram(data, length / 2, frequency.data());
+    build_wide_code(frequency.data(), code);
+    assign_wide_codes(code);
+
+    // Only the present counters were touched, so only they need clearing
+    uint64_t bits = 0;
+    present_frequency.resize(code.symbols.size());
+    for (size_t index = 0; index < code.symbols.size(); index++) {
+        present_frequency[index] = frequency[code.symbols[index]];
+        bits += present_frequency[index] * code.lengths[index];
+        frequency[code.symbols[index]] = 0;
+    }
+
+    table.clear();
+    append_wide_table(table, code);
+    return table.size() + (length & 1) + (bits + 7) / 8;
+}
+
+void encode_block(const uint8_t *data, const uint32_t length, const block_encoder_settings &settings,
+                  encoded_block &block, block_report *report) {
+    block.selection_seconds = 0;
+    if (is_zero_block(data, length)) {
+        zero_block(length, block, report);
+        return;
+    }
+    block.raw_size = length;
+    block.checksum = data_checksum(data, length);
+
+    if (settings.engines != 0) {
+        const auto start = chrono::steady_clock::now();
+        const block_engine engine = select_block_engine(data, length, settings.engines, settings.shuffle_width,
+                                                        settings.objective_mbps);
+        block.selection_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (engine == ENGINE_STORED) {
+            store_block(data, length, block);
+            uint64_t frequency[HUFFMAN_BYTE_ALPHABET] = {};
+            if (report) accumulate_byte_histogram(data, length, frequency);
+            report_block(block, frequency, nullptr, 0, report);
+            return;
+        }
+        if (engine != ENGINE_HUFFMAN) {
+            encode_engine_block(data, length, engine, settings, block, report);
+            return;
+        }
+    }
+
+    const code_table_set *tables = settings.tables;
+    uint64_t frequency[HUFFMAN_BYTE_ALPHABET] = {};
+
+    // Forced table: no histogram pass at all (unless explaining), just encode and
+    // keep the result unless the block turned out incompressible
+    if (tables && settings.table_id >= 0) {
+        const code_table &table = tables->tables[settings.table_id];
+        if (report) accumulate_byte_histogram(data, length, frequency);
+
+        vector<uint8_t> payload((static_cast<size_t>(length) * HUFFMAN_MAX_CODE_LENGTH + 7) / 8);
+        const size_t payload_size = huffman_encode_bytes(data, length, table.code, payload.data());
+        if (payload_size >= length) {
+            store_block(data, length, block);
+        } else {
+            block.bytes.clear();
+            append_block_header(block.bytes, {
+                                    BLOCK_MODE_SHARED_TABLE, static_cast<uint8_t>(settings.table_id), 0, length,
+                                    static_cast<uint32_t>(payload_size)
+                                });
+            block.bytes.insert(block.bytes.end(), payload.begin(), payload.begin() + static_cast<long>(payload_size));
+        }
+        report_block(block, frequency, table.lengths.data(), 0, report);
+        return;
+    }
+
+    accumulate_byte_histogram(data, length, frequency);
+
+    // Candidate 1: a code built for this block, stored inline
+    uint8_t lengths[HUFFMAN_BYTE_ALPHABET];
+    build_code_lengths(frequency, HUFFMAN_BYTE_ALPHABET, HUFFMAN_MAX_CODE_LENGTH, lengths);
+    const uint64_t inline_bits = predicted_code_bits(frequency, lengths, HUFFMAN_BYTE_ALPHABET);
+    const uint64_t inline_size = BLOCK_INLINE_TABLE_SIZE + (inline_bits + 7) / 8;
+
+    // Candidate 2: the best trained table, referenced by id only
+    uint64_t shared_size = UINT64_MAX;
+    unsigned shared_table = 0;
+    if (tables) {
+        uint64_t shared_bits;
+        shared_table = select_code_table(*tables, frequency, shared_bits);
+        shared_size = (shared_bits + 7) / 8;
+    }
+
+    // Candidate 3: a code over 16-bit samples (--symbol-width 16)
+    uint64_t wide_size = UINT64_MAX;
+    wide_code wide;
+    vector<uint8_t> wide_table;
+    vector<uint64_t> wide_frequency;
+    if (settings.symbol_width == 16 && length >= 2) {
+        wide_size = plan_wide_block(data, length, wide, wide_table, wide_frequency);
+    }
+
+    // Candidate 4: stored - wins whenever coding would not save anything
+    if (length <= inline_size && length <= shared_size && length <= wide_size) {
+        store_block(data, length, block);
+        report_block(block, frequency, nullptr, 0, report);
+        return;
+    }
+
+    block.bytes.clear();
+    if (wide_size < inline_size && wide_size < shared_size) {
+        append_block_header(block.bytes, {
+                                BLOCK_MODE_HUFFMAN16, 0, 0, length, static_cast<uint32_t>(wide_size)
+                            });
+        block.bytes.insert(block.bytes.end(), wide_table.begin(), wide_table.end());
+        if (length & 1) append_u8(block.bytes, data[length - 1]);
+        const size_t stream_offset = block.bytes.size();
+        block.bytes.resize(BLOCK_HEADER_SIZE + wide_size);
+        huffman_encode_wide(data, length / 2, wide, &block.bytes[stream_offset]);
+        report_block(block, wide_frequency.data(), wide.lengths.data(), wide_table.size(), report,
+                     wide.symbols.size());
+        return;
+    }
+
+    if (shared_size <= inline_size) {
+        append_block_header(block.bytes, {
+                                BLOCK_MODE_SHARED_TABLE, static_cast<uint8_t>(shared_table), 0, length,
+                                static_cast<uint32_t>(shared_size)
+                            });
+        block.bytes.resize(BLOCK_HEADER_SIZE + shared_size);
+        huffman_encode_bytes(data, length, tables->tables[shared_table].code, &block.bytes[BLOCK_HEADER_SIZE]);
+        report_block(block, frequency, tables->tables[shared_table].lengths.data(), 0, report);
+        return;
+    }
+
+    canonical_code code;
+    assign_canonical_codes(lengths, HUFFMAN_BYTE_ALPHABET, code);
+
+    append_block_header(block.bytes, {BLOCK_MODE_HUFFMAN, 0, 0, length, static_cast<uint32_t>(inline_size)});
+    append_packed_lengths(block.bytes, lengths);
+    block.bytes.resize(BLOCK_HEADER_SIZE + inline_size);
+    huffman_encode_bytes(data, length, code, &block.bytes[BLOCK_HEADER_SIZE + BLOCK_INLINE_TABLE_SIZE]);
+    report_block(block, frequency, lengths, BLOCK_INLINE_TABLE_SIZE, report);
+}
+
+void encode_block_batch(const uint8_t *data, const size_t size, const block_encoder_settings &settings,
+                        const size_t first, const size_t count, encoded_block *blocks, block_report *reports) {
+    run_parallel(count, max(1u, settings.thread_count), [&](const size_t slot, unsigned) {
+        const size_t offset = (first + slot) * settings.block_size;
+        const auto length = static_cast<uint32_t>(min<size_t>(settings.block_size, size - offset));
+        if (settings.governor) settings.governor->begin_task(length);
+
+        // Blocks entirely inside a hole are never read
+        const auto start = chrono::steady_clock::now();
+        if (settings.data_extents && !range_has_data(*settings.data_extents, offset, length)) {
+            zero_block(length, blocks[slot], reports ? &reports[slot] : nullptr);
+        } else {
+            encode_block(data + offset, length, settings, blocks[slot], reports ? &reports[slot] : nullptr);
+        }
+        const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        blocks[slot].encode_seconds = seconds;
+
+        if (settings.governor) settings.governor->end_task(length, seconds);
+        if (reports) {
+            reports[slot].encode_microseconds = seconds * 1e6;
+            reports[slot].index = first + slot;
+            reports[slot].offset = offset;
+        }
+    });
+}
+
+void encode_blocks(const uint8_t *data, const size_t size, const block_encoder_settings &settings, const bool explain,
+                   const function<void(const encoded_block &block, const block_report *report)> &emit) {
+    const size_t block_count = (size + settings.block_size - 1) / settings.block_size;
+    const size_t batch_size = static_cast<size_t>(max(1u, settings.thread_count)) * 4;
+
+    vector<encoded_block> blocks(min(batch_size, block_count));
+    vector<block_report> reports(explain ? blocks.size() : 0);
+
+    for (size_t first = 0; first < block_count; first += batch_size) {
+        const size_t count = min(batch_size, block_count - first);
+        encode_block_batch(data, size, settings, first, count, blocks.data(), explain ? reports.data() : nullptr);
+
+        for (size_t slot = 0; slot < count; slot++) {
+            emit(blocks[slot], explain ? &reports[slot] : nullptr);
+        }
+    }
+}
+
+/**
+ * @brief Resolves DECODER_ENGINE_AUTO for one block
+ */
+static bool use_limit_decoder(const decoder_engine engine, const size_t table_bytes, const bool table_built,
+                              const size_t symbol_count) {
+    if (engine != DECODER_ENGINE_AUTO) return engine == DECODER_ENGINE_LIMITS;
+    return prefer_limit_decoder(table_bytes, table_built, symbol_count);
+}
+
+bool decode_block(const block_container &container, const uint8_t *data, const block_index_entry &entry,
+                  const code_table_set *tables, uint8_t *output, string &error, const decoder_engine engine) {
+    const uint8_t *block = data + entry.offset;
+    const block_header header = read_block_header(block);
+    const uint8_t *payload = block + BLOCK_HEADER_SIZE;
+
+    if (header.raw_size != entry.raw_size ||
+        static_cast<uint64_t>(BLOCK_HEADER_SIZE) + header.payload_size != entry.stored_size) {
+        error = "Block header does not match the index";
+        return false;
+    }
+
+    switch (header.mode) {
+        case BLOCK_MODE_STORED:
+            if (header.payload_size != header.raw_size) {
+                error = "Stored block has an invalid size";
+                return false;
+            }
+            memcpy(output, payload, header.raw_size);
+            break;
+
+        case BLOCK_MODE_HUFFMAN: {
+            if (header.payload_size < BLOCK_INLINE_TABLE_SIZE) {
+                error = "Huffman block is truncated";
+                return false;
+            }
+            uint8_t lengths[HUFFMAN_BYTE_ALPHABET];
+            unpack_lengths(payload, lengths);
+            const uint8_t *stream = payload + BLOCK_INLINE_TABLE_SIZE;
+            const size_t stream_size = header.payload_size - BLOCK_INLINE_TABLE_SIZE;
+            bool decoded;
+            if (use_limit_decoder(engine, (size_t{1} << HUFFMAN_LOOKUP_BITS) * sizeof(uint32_t), false,
+                                  header.raw_size)) {
+                limit_decoder decoder;
+                decoded = build_limit_decoder(lengths, HUFFMAN_BYTE_ALPHABET, nullptr, decoder) &&
+                          huffman_decode_bytes_limits(stream, stream_size, decoder, output, header.raw_size);
+            } else {
+                canonical_decoder decoder;
+                decoded = build_canonical_decoder(lengths, HUFFMAN_BYTE_ALPHABET, decoder) &&
+                          huffman_decode_bytes(stream, stream_size, decoder, output, header.raw_size);
+            }
+            if (!decoded) {
+                error = "Corrupted Huffman block";
+                return false;
+            }
+            break;
+        }
+
+        case BLOCK_MODE_HUFFMAN16: {
+            vector<uint16_t> symbols;
+            vector<uint8_t> lengths;
+            size_t position = 0;
+            if (!read_wide_table(payload, header.payload_size, position, symbols, lengths) ||
+                header.payload_size - position < (header.raw_size & 1)) {
+                error = "16-bit Huffman block table is corrupted";
+                return false;
+            }
+            if (header.raw_size & 1) output[header.raw_size - 1] = payload[position++];
+            const uint8_t *stream = payload + position;
+            const size_t stream_size = header.payload_size - position;
+            bool decoded;
+            if (use_limit_decoder(engine, wide_decoder_table_bytes(lengths.data(), lengths.size()), false,
+                                  header.raw_size / 2)) {
+                limit_decoder decoder;
+                decoded = build_limit_decoder(lengths.data(), lengths.size(), symbols.data(), decoder) &&
+                          huffman_decode_wide_limits(stream, stream_size, decoder, output, header.raw_size / 2);
+            } else {
+                wide_decoder decoder;
+                decoded = build_wide_decoder(symbols.data(), lengths.data(), symbols.size(), decoder) &&
+                          huffman_decode_wide(stream, stream_size, decoder, output, header.raw_size / 2);
+            }
+            if (!decoded) {
+                error = "Corrupted 16-bit Huffman block";
+                return false;
+            }
+            break;
+        }
+
+        case BLOCK_MODE_SHARED_TABLE: {
+            if (!tables) {
+                error = "File was compressed with trained tables; pass them with --tables";
+                return false;
+            }
+            if (tables->set_id != container.table_set_id || header.table_id >= tables->tables.size()) {
+                error = "Table file does not match the one used for compression";
+                return false;
+            }
+            const code_table &table = tables->tables[header.table_id];
+            bool decoded;
+            if (use_limit_decoder(engine, table.decoder.lookup.size() * sizeof(uint32_t), true, header.raw_size)) {
+                limit_decoder decoder;
+                decoded = build_limit_decoder(table.lengths.data(), HUFFMAN_BYTE_ALPHABET, nullptr, decoder) &&
+                          huffman_decode_bytes_limits(payload, header.payload_size, decoder, output, header.raw_size);
+            } else {
+                decoded = huffman_decode_bytes(payload, header.payload_size, table.decoder, output, header.raw_size);
+            }
+            if (!decoded) {
+                error = "Corrupted shared-table block";
+                return false;
+            }
+            break;
+        }
+
+        case BLOCK_MODE_RLE:
+            if (!rle_decode(payload, header.payload_size, output, header.raw_size)) {
+                error = "Corrupted RLE block";
+                return false;
+            }
+            break;
+
+        case BLOCK_MODE_SHUFFLE:
+            if (!shuffle_decode(payload, header.payload_size, header.flags, output, header.raw_size, engine)) {
+                error = "Corrupted shuffle block";
+                return false;
+            }
+            break;
+
+        case BLOCK_MODE_ZERO:
+            if (header.payload_size != 0 || entry.checksum != zero_block_checksum(header.raw_size)) {
+                error = "Corrupted zero block";
+                return false;
+            }
+            memset(output, 0, header.raw_size);
+            return true;
+
+        default:
+            error = "Unknown block mode " + to_string(header.mode);
+            return false;
+    }
+
+    if (data_checksum(output, header.raw_size) != entry.checksum) {
+        error = "Block checksum mismatch";
+        return false;
+    }
+    return true;
+}
+
+/*=============================================================================
+ * CONTAINER I/O
+ *=============================================================================*/
+
+bool is_block_container(const uint8_t *data, const size_t size) {
+    return size >= 8 && memcmp(data, BLOCK_FORMAT_MAGIC, 8) == 0;
+}
+
+bool parse_block_container(const uint8_t *data, const size_t size, block_container &container, string &error) {
+    if (size < BLOCK_FILE_HEADER_SIZE + BLOCK_HEADER_SIZE + BLOCK_TRAILER_SIZE || !is_block_container(data, size)) {
+        error = "Not a block container";
+        return false;
+    }
+
+    container.version = read_u16(data + 8);
+    container.flags = read_u16(data + 10);
+    container.block_size = read_u32(data + 12);
+    container.table_set_id = read_u32(data + 16);
+    if (container.version != BLOCK_FORMAT_VERSION) {
+        error = "Unsupported container version " + to_string(container.version);
+        return false;
+    }
+
+    // Trailer: original size, block count, reserved, index offset, magic
+    const uint8_t *trailer = data + size - BLOCK_TRAILER_SIZE;
+    if (memcmp(trailer + 24, BLOCK_INDEX_MAGIC, 8) != 0) {
+        error = "Container index is missing (truncated file?)";
+        return false;
+    }
+    container.original_size = read_u64(trailer);
+    const uint32_t block_count = read_u32(trailer + 8);
+    const uint64_t index_offset = read_u64(trailer + 16);
+
+    if (index_offset < BLOCK_FILE_HEADER_SIZE + BLOCK_HEADER_SIZE ||
+        index_offset + static_cast<uint64_t>(block_count) * BLOCK_INDEX_ENTRY_SIZE + BLOCK_TRAILER_SIZE != size) {
+        error = "Container index is corrupted";
+        return false;
+    }
+
+    // Every block must lie between the file header and the end marker
+    const uint64_t blocks_end = index_offset - BLOCK_HEADER_SIZE;
+    uint64_t total_size = 0;
+    container.blocks.resize(block_count);
+    for (uint32_t index = 0; index < block_count; index++) {
+        const uint8_t *entry_data = data + index_offset + static_cast<uint64_t>(index) * BLOCK_INDEX_ENTRY_SIZE;
+        block_index_entry &entry = container.blocks[index];
+        entry.offset = read_u64(entry_data);
+        entry.raw_size = read_u32(entry_data + 8);
+        entry.stored_size = read_u32(entry_data + 12);
+        entry.checksum = read_u64(entry_data + 16);
+
+        if (entry.offset < BLOCK_FILE_HEADER_SIZE || entry.stored_size < BLOCK_HEADER_SIZE ||
+            entry.offset + entry.stored_size > blocks_end) {
+            error = "Container index entry " + to_string(index) + " is out of range";
+            return false;
+        }
+        total_size += entry.raw_size;
+    }
+
+    if (total_size != container.original_size) {
+        error = "Container index does not add up to the original size";
+        return false;
+    }
+    return true;
+}
+
+void block_container_writer::begin(const uint32_t block_size, const uint32_t table_set_id) {
+    vector<uint8_t> header(BLOCK_FORMAT_MAGIC, BLOCK_FORMAT_MAGIC + 8);
+    append_u16(header, BLOCK_FORMAT_VERSION);
+    append_u16(header, table_set_id != 0 ? BLOCK_FLAG_SHARED_TABLES : 0);
+    append_u32(header, block_size);
+    append_u32(header, table_set_id);
+
+    output.write(reinterpret_cast<const char *>(header.data()), static_cast<streamsize>(header.size()));
+    position = header.size();
+}
+
+void block_container_writer::append(const encoded_block &block) {
+    index.push_back({position, block.raw_size, static_cast<uint32_t>(block.bytes.size()), block.checksum});
+    output.write(reinterpret_cast<const char *>(block.bytes.data()), static_cast<streamsize>(block.bytes.size()));
+    position += block.bytes.size();
+    original_size += block.raw_size;
+}
+
+bool block_container_writer::finish() {
+    vector<uint8_t> footer;
+    append_block_header(footer, {BLOCK_MODE_END, 0, 0, 0, 0});
+
+    const uint64_t index_offset = position + footer.size();
+    for (const block_index_entry &entry: index) {
+        append_u64(footer, entry.offset);
+        append_u32(footer, entry.raw_size);
+        append_u32(footer, entry.stored_size);
+        append_u64(footer, entry.checksum);
+    }
+
+    append_u64(footer, original_size);
+    append_u32(footer, static_cast<uint32_t>(index.size()));
+    append_u32(footer, 0);
+    append_u64(footer, index_offset);
+    footer.insert(footer.end(), BLOCK_INDEX_MAGIC, BLOCK_INDEX_MAGIC + 8);
+
+    output.write(reinterpret_cast<const char *>(footer.data()), static_cast<streamsize>(footer.size()));
+    position += footer.size();
+    output.flush();
+    return static_cast<bool>(output);
+}
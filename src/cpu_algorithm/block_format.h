@@ -0,0 +1,278 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "block_engines.h"
+#include "block_report.h"
+#include "code_tables.h"
+#include "resource_governor.h"
+#include "sparse_file.h"
+
+/**
+ * @file block_format.h
+ * @brief Indexed block container used by the CPU tools
+ *
+ * The input is cut into fixed-size blocks that are coded independently, each
+ * with its own mode. Independent blocks are what later allow per-block
+ * tuning, parallel coding and random access; the index at the end of the
+ * file lets a reader find any block without decoding the ones before it.
+ *
+ * Container layout (all integers little-endian):
+ * 1. File header (20 bytes)
+ *    - Magic "\x89HUFBLK\n" (8 bytes). Read as the legacy CPU format's 8-byte
+ *      size field this is ~7e17, so the two formats cannot be confused.
+ *    - Version (2), flags (2), block size (4), table set id (4, 0 = none)
+ * 2. Blocks, each a 12-byte block header followed by payload_size bytes
+ * 3. End marker: a block header with mode BLOCK_MODE_END
+ * 4. Index: one 24-byte entry per block (offset, raw size, stored size, checksum)
+ * 5. Trailer (32 bytes): original size (8), block count (4), reserved (4),
+ *    index offset (8), magic "HUFINDEX" (8)
+ *
+ * All-zero blocks (holes of sparse inputs) are recorded as BLOCK_MODE_ZERO
+ * with an empty payload; decompressors can skip them and leave a hole.
+ *
+ * BLOCK_MODE_HUFFMAN16 blocks code little-endian uint16 samples. Their
+ * payload starts with the present values as runs - varint run count, then
+ * per run a varint gap from the previous run's end and a varint length - 1 -
+ * followed by one 5-bit code length per present value (MSB-first, padded to
+ * a byte). An odd raw_size leaves one trailing byte, stored next; the bit
+ * stream of raw_size / 2 samples follows.
+ *
+ * BLOCK_MODE_RLE and BLOCK_MODE_SHUFFLE blocks are written only when engine
+ * selection is enabled; their payloads are described in block_engines.h.
+ */
+
+#define BLOCK_FORMAT_MAGIC "\x89HUFBLK\n"
+#define BLOCK_INDEX_MAGIC "HUFINDEX"
+#define BLOCK_FORMAT_VERSION 1
+
+#define BLOCK_FILE_HEADER_SIZE 20
+#define BLOCK_HEADER_SIZE 12
+#define BLOCK_INDEX_ENTRY_SIZE 24
+#define BLOCK_TRAILER_SIZE 32
+
+// Inline code lengths are packed two per byte (lengths never exceed 15)
+#define BLOCK_INLINE_TABLE_SIZE (HUFFMAN_BYTE_ALPHABET / 2)
+
+// Default amount of input coded per block
+#define DEFAULT_BLOCK_SIZE (256 * 1024)
+
+// File header flag: blocks reference a trained table set
+#define BLOCK_FLAG_SHARED_TABLES 0x0001
+
+/*=============================================================================
+ * BLOCK STRUCTURES
+ *=============================================================================*/
+
+/**
+ * @enum block_mode
+ * @brief How a block's payload is coded
+ */
+enum block_mode : uint8_t {
+    BLOCK_MODE_END = 0, // Terminates the block sequence
+    BLOCK_MODE_STORED = 1, // Payload is the raw data
+    BLOCK_MODE_HUFFMAN = 2, // Inline packed code lengths, then the bit stream
+    BLOCK_MODE_SHARED_TABLE = 3, // Bit stream coded with trained table `table_id`
+    BLOCK_MODE_ZERO = 4, // raw_size zero bytes, no payload
+    BLOCK_MODE_HUFFMAN16 = 5, // Sparse 16-bit code table, odd tail byte, then the bit stream
+    BLOCK_MODE_RLE = 6, // Run and literal tokens
+    BLOCK_MODE_SHUFFLE = 7, // Byte planes of flags-byte elements, each with its own code
+};
+
+/**
+ * @struct block_header
+ * @brief Per-block header preceding every payload
+ */
+struct block_header {
+    uint8_t mode;
+    uint8_t table_id;
+    uint16_t flags;
+    uint32_t raw_size;
+    uint32_t payload_size;
+};
+
+/**
+ * @struct block_index_entry
+ * @brief Location and integrity data of one block
+ *
+ * offset points at the block header; stored_size covers header + payload;
+ * checksum is data_checksum() of the original (decoded) block data.
+ */
+struct block_index_entry {
+    uint64_t offset;
+    uint32_t raw_size;
+    uint32_t stored_size;
+    uint64_t checksum;
+};
+
+/**
+ * @struct block_encoder_settings
+ * @brief Options controlling how blocks are coded
+ *
+ * - tables: trained table set, or null to always use inline codes
+ * - table_id: force one table for every block (skips the per-block histogram),
+ *   or -1 to pick the cheapest table / inline code per block
+ * - thread_count: workers used by encode_blocks()
+ * - governor: optional rate / CPU budget enforced per block by encode_blocks()
+ * - data_extents: data ranges of a sparse input (read_sparse_input); blocks
+ *   outside all of them are recorded as zero blocks without being read
+ * - symbol_width: 16 also tries a code over uint16 samples for every block
+ * - engines: BLOCK_ENGINE_* bits; when set, every block is coded by the engine
+ *   select_block_engine() picks from a sampled trial (0 keeps the Huffman
+ *   candidates only)
+ * - objective_mbps: selection objective, 0 for ratio (see select_block_engine)
+ * - shuffle_width: element width of the shuffle engine
+ */
+struct block_encoder_settings {
+    uint32_t block_size = DEFAULT_BLOCK_SIZE;
+    const code_table_set *tables = nullptr;
+    int table_id = -1;
+    unsigned thread_count = 1;
+    resource_governor *governor = nullptr;
+    const std::vector<data_extent> *data_extents = nullptr;
+    unsigned symbol_width = 8;
+    unsigned engines = 0;
+    double objective_mbps = 0;
+    unsigned shuffle_width = DEFAULT_SHUFFLE_WIDTH;
+};
+
+/**
+ * @struct encoded_block
+ * @brief One coded block ready to be appended to a container
+ */
+struct encoded_block {
+    std::vector<uint8_t> bytes; // Block header + payload
+    uint32_t raw_size = 0;
+    uint64_t checksum = 0;
+    double encode_seconds = 0; // Set by encode_block_batch()
+    double selection_seconds = 0; // Engine selection share of encode_seconds
+};
+
+/**
+ * @struct block_container
+ * @brief Parsed header and index of a container held in memory
+ */
+struct block_container {
+    uint16_t version = 0;
+    uint16_t flags = 0;
+    uint32_t block_size = 0;
+    uint32_t table_set_id = 0;
+    uint64_t original_size = 0;
+    std::vector<block_index_entry> blocks;
+};
+
+/*=============================================================================
+ * BLOCK CODING
+ *=============================================================================*/
+
+/**
+ * @brief data_checksum() of `length` zero bytes, cached per thread for the last length
+ */
+uint64_t zero_block_checksum(uint32_t length);
+
+/**
+ * @brief Codes one block with the cheapest available mode
+ * @param data Block data
+ * @param length Block length (at most settings.block_size)
+ * @param settings Encoder options
+ * @param block Output coded block
+ * @param report Optional --explain record; offset, index and timing are left to the caller
+ *
+ * All-zero blocks become zero blocks. Otherwise the candidates are the inline
+ * Huffman code, the trained tables (when loaded), the 16-bit code (symbol_width
+ * 16) and stored mode; the smallest result wins, so a block never expands by more than its 12-byte header.
+ * With settings.engines the block is first assigned an engine by trial
+ * encoding; RLE and shuffle results that would not be smaller than the data
+ * are stored instead, and the Huffman engine keeps the candidates above.
+ */
+void encode_block(const uint8_t *data, uint32_t length, const block_encoder_settings &settings,
+                  encoded_block &block, block_report *report = nullptr);
+
+/**
+ * @brief Codes blocks [first, first + count) of a buffer on settings.thread_count workers
+ * @param data Input data
+ * @param size Input length
+ * @param settings Encoder options (the governor, if any, is consulted per block)
+ * @param first Index of the first block
+ * @param count Number of blocks
+ * @param blocks Output, at least count elements; blocks[i] holds block first + i
+ * @param reports Optional --explain records (count elements) with index, offset and timing set
+ */
+void encode_block_batch(const uint8_t *data, size_t size, const block_encoder_settings &settings, size_t first,
+                        size_t count, encoded_block *blocks, block_report *reports);
+
+/**
+ * @brief Codes a whole buffer block by block on settings.thread_count workers
+ * @param data Input data
+ * @param size Input length
+ * @param settings Encoder options
+ * @param explain Fill a block_report (including index, offset and timing) per block
+ * @param emit Called once per block, in input order; report is null unless explaining
+ *
+ * Blocks are coded in batches of a few blocks per worker, so memory stays
+ * bounded while emit() receives them in the order they must be written.
+ */
+void encode_blocks(const uint8_t *data, size_t size, const block_encoder_settings &settings, bool explain,
+                   const std::function<void(const encoded_block &block, const block_report *report)> &emit);
+
+/**
+ * @brief Parses a block header from memory
+ */
+block_header read_block_header(const uint8_t *data);
+
+/**
+ * @brief Decodes one block and verifies it against its index entry
+ * @param container Parsed container (for the table set id)
+ * @param data Start of the container in memory
+ * @param entry Index entry of the block to decode
+ * @param tables Loaded table set, required for shared-table blocks
+ * @param output Destination with room for entry.raw_size bytes
+ * @param error Set when decoding fails
+ * @param engine Lookup tables, the table-less limit decoder, or automatic per block (prefer_limit_decoder)
+ * @return false on corrupt data, missing tables or checksum mismatch
+ */
+bool decode_block(const block_container &container, const uint8_t *data, const block_index_entry &entry,
+                  const code_table_set *tables, uint8_t *output, std::string &error,
+                  decoder_engine engine = DECODER_ENGINE_AUTO);
+
+/*=============================================================================
+ * CONTAINER I/O
+ *=============================================================================*/
+
+/**
+ * @brief Checks whether a buffer starts with the block container magic
+ */
+bool is_block_container(const uint8_t *data, size_t size);
+
+/**
+ * @brief Parses the file header, trailer and index of an in-memory container
+ * @return false and sets error when the container is truncated or inconsistent
+ */
+bool parse_block_container(const uint8_t *data, size_t size, block_container &container, std::string &error);
+
+/**
+ * @struct block_container_writer
+ * @brief Streams blocks into a container and appends the index on finish
+ */
+struct block_container_writer {
+    std::ostream &output;
+    uint64_t position = 0;
+    uint64_t original_size = 0;
+    std::vector<block_index_entry> index;
+
+    explicit block_container_writer(std::ostream &output) : output(output) {}
+
+    // Writes the file header
+    void begin(uint32_t block_size, uint32_t table_set_id);
+
+    // Appends one coded block and records its index entry
+    void append(const encoded_block &block);
+
+    // Writes the end marker, index and trailer; returns false on a stream error
+    bool finish();
+};
@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+
+#include "block_reader.h"
+
+/**
+ * @file block_reader.cpp
+ * @brief Range reads of a block container, decoding through the shared block cache
+ */
+
+using namespace std;
+
+bool block_reader::open(const char *path, const code_table_set *tables, string &error) {
+    this->tables = tables;
+    if (!file_identity(path, file_id, error) || !file.open(path, false, error)) return false;
+    if (!parse_block_container(file.data, file.size, container, error)) return false;
+    if (file.data) madvise(const_cast<uint8_t *>(file.data), file.size, MADV_RANDOM);
+
+    block_starts.resize(container.blocks.size());
+    uint64_t offset = 0;
+    for (size_t index = 0; index < container.blocks.size(); index++) {
+        block_starts[index] = offset;
+        offset += container.blocks[index].raw_size;
+    }
+    return true;
+}
+
+bool block_reader::read_block(const size_t index, uint8_t *output, string &error) {
+    const block_index_entry &entry = container.blocks[index];
+    const block_header header = read_block_header(file.data + entry.offset);
+    const bool cacheable = cache && header.mode != BLOCK_MODE_STORED && header.mode != BLOCK_MODE_ZERO;
+
+    const shared_cache_key key{file_id, index, entry.checksum};
+    size_t length = 0;
+    if (cacheable && cache->lookup(key, output, entry.raw_size, length) && length == entry.raw_size) return true;
+
+    if (!decode_block(container, file.data, entry, tables, output, error, engine)) {
+        error += " (block " + to_string(index) + ")";
+        return false;
+    }
+    decoded_blocks.fetch_add(1, memory_order_relaxed);
+    if (cacheable) cache->insert(key, output, entry.raw_size);
+    return true;
+}
+
+bool block_reader::read(const uint64_t offset, const size_t length, uint8_t *output, string &error) {
+    if (offset > container.original_size || length > container.original_size - offset) {
+        error = "Range " + to_string(offset) + "+" + to_string(length) + " is beyond the original size " +
+                to_string(container.original_size);
+        return false;
+    }
+
+    // Blocks only partly inside the range are decoded into a per-thread scratch block
+    thread_local vector<uint8_t> scratch;
+    size_t index = upper_bound(block_starts.begin(), block_starts.end(), offset) - block_starts.begin() - 1;
+    for (size_t copied = 0; copied < length; index++) {
+        const uint32_t raw_size = container.blocks[index].raw_size;
+        const uint64_t within = offset + copied - block_starts[index];
+        const size_t take = min<uint64_t>(raw_size - within, length - copied);
+        if (within == 0 && take == raw_size) {
+            if (!read_block(index, output + copied, error)) return false;
+        } else {
+            scratch.resize(raw_size);
+            if (!read_block(index, scratch.data(), error)) return false;
+            memcpy(output + copied, scratch.data() + within, take);
+        }
+        copied += take;
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "block_format.h"
+#include "mapped_file.h"
+#include "shared_block_cache.h"
+
+/**
+ * @file block_reader.h
+ * @brief Random access to the original bytes of a block container
+ *
+ * The container is mapped with MADV_RANDOM and only the blocks that overlap
+ * a requested range are decoded. With a shared_block_cache attached, every
+ * decoded block is published to the host-wide cache and looked up there
+ * first, so a hot block is decoded once per host instead of once per
+ * process. Stored and zero blocks cost no more than a copy and bypass the
+ * cache. read() may be called from several threads at once.
+ */
+
+/**
+ * @struct block_reader
+ * @brief An open container plus the output offset of every block
+ */
+struct block_reader {
+    mapped_file file;
+    block_container container;
+    std::vector<uint64_t> block_starts; // Original offset of every block
+    const code_table_set *tables = nullptr;
+    decoder_engine engine = DECODER_ENGINE_AUTO;
+    shared_block_cache *cache = nullptr; // Optional
+    uint64_t file_id = 0; // file_identity() for cache keys
+
+    std::atomic<uint64_t> decoded_blocks{0}; // Blocks this process had to decode
+
+    /**
+     * @brief Maps and parses a container
+     * @param tables Loaded table set, required for shared-table blocks
+     * @param error Set when the file cannot be mapped or is not a valid container
+     */
+    bool open(const char *path, const code_table_set *tables, std::string &error);
+
+    /**
+     * @brief Copies original bytes [offset, offset + length) into output
+     * @param error Set when the range is out of bounds or a block fails to decode
+     */
+    bool read(uint64_t offset, size_t length, uint8_t *output, std::string &error);
+
+    /**
+     * @brief Decodes one whole block into output (raw_size bytes), through the shared cache when attached
+     */
+    bool read_block(size_t index, uint8_t *output, std::string &error);
+};
@@ -0,0 +1,87 @@
+#include <iomanip>
+
+#include "block_report.h"
+#include "data_statistics.h"
+
+/**
+ * @file block_report.cpp
+ * @brief CSV / JSON serialization of per-block diagnostics
+ */
+
+using namespace std;
+
+void describe_block_code(const uint64_t *frequency, const uint8_t *lengths, const size_t alphabet_size,
+                         const unsigned slow_path_length, block_report &report) {
+    report.entropy = histogram_entropy(frequency, alphabet_size);
+    report.max_code_length = 0;
+    report.code_length_histogram.clear();
+    if (!lengths) return;
+
+    for (size_t symbol = 0; symbol < alphabet_size; symbol++) {
+        const unsigned length = lengths[symbol];
+        if (length == 0) continue;
+        if (length >= report.code_length_histogram.size()) report.code_length_histogram.resize(length + 1, 0);
+        report.code_length_histogram[length]++;
+        if (length > report.max_code_length) report.max_code_length = length;
+    }
+    report.slow_path = report.max_code_length > slow_path_length;
+}
+
+bool block_report_writer::open(const char *path, string &error) {
+    const string name = path;
+    json = name.size() >= 5 && name.compare(name.size() - 5, 5, ".json") == 0;
+
+    output.open(path);
+    if (!output) {
+        error = "Cannot create report file " + name;
+        return false;
+    }
+
+    if (json) {
+        output << "[";
+    } else {
+        output << "block,offset,raw_bytes,stored_bytes,mode,table_id,entropy,max_code_length,code_lengths,"
+                "table_bytes,payload_bytes,encode_us,slow_path\n";
+    }
+    return true;
+}
+
+void block_report_writer::write(const block_report &report) {
+    output << fixed;
+
+    if (json) {
+        output << (records ? ",\n " : "\n ") << "{\"block\": " << report.index << ", \"offset\": " << report.offset
+                << ", \"raw_bytes\": " << report.raw_bytes << ", \"stored_bytes\": " << report.stored_bytes
+                << ", \"mode\": \"" << report.mode << "\", \"table_id\": " << report.table_id
+                << ", \"entropy\": " << setprecision(4) << report.entropy
+                << ", \"max_code_length\": " << report.max_code_length << ", \"code_lengths\": {";
+        bool first = true;
+        for (size_t length = 1; length < report.code_length_histogram.size(); length++) {
+            if (report.code_length_histogram[length] == 0) continue;
+            output << (first ? "" : ", ") << "\"" << length << "\": " << report.code_length_histogram[length];
+            first = false;
+        }
+        output << "}, \"table_bytes\": " << report.table_bytes << ", \"payload_bytes\": " << report.payload_bytes
+                << ", \"encode_us\": " << setprecision(1) << report.encode_microseconds
+                << ", \"slow_path\": " << (report.slow_path ? "true" : "false") << "}";
+    } else {
+        output << report.index << ',' << report.offset << ',' << report.raw_bytes << ',' << report.stored_bytes
+                << ',' << report.mode << ',' << report.table_id << ',' << setprecision(4) << report.entropy << ','
+                << report.max_code_length << ',';
+        bool first = true;
+        for (size_t length = 1; length < report.code_length_histogram.size(); length++) {
+            if (report.code_length_histogram[length] == 0) continue;
+            output << (first ? "" : " ") << length << ':' << report.code_length_histogram[length];
+            first = false;
+        }
+        output << ',' << report.table_bytes << ',' << report.payload_bytes << ',' << setprecision(1)
+                << report.encode_microseconds << ',' << (report.slow_path ? 1 : 0) << '\n';
+    }
+    records++;
+}
+
+bool block_report_writer::finish() {
+    if (json) output << (records ? "\n]\n" : "]\n");
+    output.flush();
+    return static_cast<bool>(output);
+}
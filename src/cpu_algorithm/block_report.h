@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @file block_report.h
+ * @brief Per-block diagnostics written by the compressors' `--explain` option
+ *
+ * One record is emitted per coded block (the legacy and GPU formats code the
+ * whole file as a single block). Reports ending in ".json" are written as a
+ * JSON array of objects, anything else as CSV with a header row. In CSV the
+ * code-length histogram is a space-separated list of `length:symbols` pairs.
+ */
+
+/**
+ * @struct block_report
+ * @brief Diagnostics of one coded block
+ *
+ * - stored_bytes: everything the block occupies in the output (headers included)
+ * - table_bytes / payload_bytes: code description and bit stream within it
+ * - code_length_histogram[n]: number of symbols with an n-bit code
+ * - slow_path: codes too long for the fast path were needed (CPU: longer than
+ *   the decoder's primary lookup, GPU: const_memory_flag)
+ */
+struct block_report {
+    uint64_t index = 0;
+    uint64_t offset = 0;
+    uint64_t raw_bytes = 0;
+    uint64_t stored_bytes = 0;
+    std::string mode;
+    int table_id = -1;
+    double entropy = 0.0;
+    unsigned max_code_length = 0;
+    std::vector<uint64_t> code_length_histogram;
+    uint64_t table_bytes = 0;
+    uint64_t payload_bytes = 0;
+    double encode_microseconds = 0.0;
+    bool slow_path = false;
+};
+
+/**
+ * @brief Fills entropy, code-length histogram, max code length and slow_path
+ * @param frequency Symbol counts of the block
+ * @param lengths Code length per symbol (0 = no code), or null for stored blocks
+ * @param alphabet_size Number of symbols
+ * @param slow_path_length Codes longer than this count as slow path
+ * @param report Record to update
+ */
+void describe_block_code(const uint64_t *frequency, const uint8_t *lengths, size_t alphabet_size,
+                         unsigned slow_path_length, block_report &report);
+
+/**
+ * @struct block_report_writer
+ * @brief Streams block_report records to a CSV or JSON file
+ */
+struct block_report_writer {
+    std::ofstream output;
+    bool json = false;
+    uint64_t records = 0;
+
+    // Creates the report file and writes the CSV header / opening bracket
+    bool open(const char *path, std::string &error);
+
+    void write(const block_report &report);
+
+    // Closes the JSON array; returns false on a stream error
+    bool finish();
+};
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "block_scheduler.h"
+#include "worker_pool.h"
+
+/**
+ * @file block_scheduler.cpp
+ * @brief Throughput-proportional batching and in-order reassembly across backends
+ */
+
+using namespace std;
+using namespace chrono;
+
+block_backend cpu_block_backend(const string &name, unsigned threads) {
+    threads = max(1u, threads);
+
+    block_backend backend;
+    backend.name = name;
+    backend.thread_count = threads;
+    backend.max_batch_blocks = threads * 4; // Same batch depth as encode_blocks()
+    backend.encode = [threads](const uint8_t *data, const size_t size, const block_encoder_settings &settings,
+                               const size_t first, const size_t count, encoded_block *blocks, block_report *reports,
+                               string &) {
+        block_encoder_settings own = settings;
+        own.thread_count = threads;
+        encode_block_batch(data, size, own, first, count, blocks, reports);
+        return true;
+    };
+    return backend;
+}
+
+vector<block_backend> numa_block_backends(const vector<numa_node> &nodes) {
+    vector<block_backend> backends;
+    for (const numa_node &node: nodes) {
+        block_backend backend = cpu_block_backend("node" + to_string(node.id),
+                                                  static_cast<unsigned>(node.cpus.size()));
+        backend.node = node.id;
+
+        // The feeder thread pins itself once; run_parallel's workers inherit its mask
+        auto encode = move(backend.encode);
+        backend.encode = [node, encode](const uint8_t *data, const size_t size,
+                                        const block_encoder_settings &settings, const size_t first, const size_t count,
+                                        encoded_block *blocks, block_report *reports, string &error) {
+            thread_local int pinned_node = -1;
+            if (pinned_node != node.id) {
+                if (!pin_thread_to_node(node)) {
+                    error = "Cannot pin workers to NUMA node " + to_string(node.id);
+                    return false;
+                }
+                pinned_node = node.id;
+            }
+            return encode(data, size, settings, first, count, blocks, reports, error);
+        };
+        backends.push_back(move(backend));
+    }
+    return backends;
+}
+
+bool parse_backend_list(const string &spec, vector<block_backend> &backends, string &error) {
+    size_t start = 0;
+    while (start <= spec.size()) {
+        const size_t end = min(spec.find(',', start), spec.size());
+        const string item = spec.substr(start, end - start);
+        const size_t colon = item.find(':');
+        const string kind = item.substr(0, colon);
+        const string name = kind + to_string(backends.size());
+
+        if (kind != "cpu") {
+            error = "Unknown backend '" + kind + "' in --backends (available: cpu)";
+            return false;
+        }
+        unsigned threads = default_thread_count();
+        if (colon != string::npos) {
+            try {
+                threads = static_cast<unsigned>(stoul(item.substr(colon + 1)));
+            } catch (const exception &) {
+                threads = 0;
+            }
+            if (threads == 0) {
+                error = "Invalid thread count in backend '" + item + "'";
+                return false;
+            }
+        }
+        backends.push_back(cpu_block_backend(name, threads));
+        start = end + 1;
+    }
+    return true;
+}
+
+bool schedule_blocks(const uint8_t *data, const size_t size, const block_encoder_settings &settings,
+                     const vector<block_backend> &backends, const vector<int> &block_nodes, const bool explain,
+                     const function<void(const encoded_block &block, const block_report *report)> &emit,
+                     vector<backend_statistics> &statistics, string &error) {
+    statistics.assign(backends.size(), {});
+    for (size_t index = 0; index < backends.size(); index++) statistics[index].name = backends[index].name;
+    if (backends.empty()) {
+        error = "No coding backend";
+        return false;
+    }
+
+    const size_t block_count = (size + settings.block_size - 1) / settings.block_size;
+    const size_t window = SCHEDULER_WINDOW_BLOCKS;
+
+    // Shared state, all guarded by mutex; slots are a ring indexed by block % window
+    mutex state_mutex;
+    condition_variable changed;
+    size_t next_block = 0; // Lowest unclaimed block
+    size_t claimed_count = 0;
+    size_t next_emit = 0;
+    bool failed = false;
+    vector<char> claimed(block_nodes.size() == block_count ? block_count : 0, 0); // Only with placement
+    vector<size_t> node_cursors(backends.size(), 0); // Lowest block that may still be unclaimed and local
+    vector<encoded_block> slots(min(window, block_count));
+    vector<block_report> slot_reports(explain ? slots.size() : 0);
+    vector<char> ready(slots.size(), 0);
+    vector<double> rates(backends.size(), 0.0); // Bytes/s, 0 until the first batch completes
+
+    // Next claim for one backend; called with the lock held and work remaining
+    auto batch_size = [&](const size_t backend) {
+        const size_t remaining = block_count - claimed_count;
+        const block_backend &owner = backends[backend];
+        size_t count = max<size_t>(1, owner.thread_count); // Probe: one block per thread
+
+        if (rates[backend] > 0) {
+            double known = 0.0;
+            for (const double rate : rates) known += rate;
+            const double target = rates[backend] * SCHEDULER_BATCH_SECONDS / settings.block_size;
+            const double share = static_cast<double>(remaining) * rates[backend] / known;
+            count = static_cast<size_t>(max(1.0, min(target, share + 1.0)));
+        }
+        return min(count, static_cast<size_t>(max(1u, owner.max_batch_blocks)));
+    };
+
+    auto is_claimed = [&](const size_t block) {
+        return block < next_block || (!claimed.empty() && claimed[block]);
+    };
+
+    // Claims up to batch_size() consecutive blocks, preferring the backend's own node; returns the count
+    auto claim = [&](const size_t backend, size_t &first) -> size_t {
+        const size_t limit = min(block_count, next_emit + window);
+        const int node = backends[backend].node;
+        first = next_block;
+
+        if (!claimed.empty() && node >= 0) {
+            size_t &cursor = node_cursors[backend];
+            cursor = max(cursor, next_block);
+            while (cursor < block_count && (claimed[cursor] || block_nodes[cursor] != node)) cursor++;
+            if (cursor < limit) first = cursor;
+        }
+        if (first >= limit) return 0;
+
+        // Extend over unclaimed blocks on the same node as the first one
+        const size_t wanted = batch_size(backend);
+        size_t count = 1;
+        while (count < wanted && first + count < limit && !is_claimed(first + count) &&
+               (claimed.empty() || block_nodes[first + count] == block_nodes[first])) {
+            count++;
+        }
+
+        if (!claimed.empty()) {
+            fill(claimed.begin() + static_cast<ptrdiff_t>(first),
+                 claimed.begin() + static_cast<ptrdiff_t>(first + count), 1);
+            while (next_block < block_count && claimed[next_block]) next_block++;
+            if (node >= 0 && block_nodes[first] >= 0 && block_nodes[first] != node) {
+                statistics[backend].remote_blocks += count;
+            }
+        } else {
+            next_block += count;
+        }
+        claimed_count += count;
+        return count;
+    };
+
+    auto feed = [&](const size_t backend) {
+        const block_backend &owner = backends[backend];
+        vector<encoded_block> blocks;
+        vector<block_report> reports;
+
+        unique_lock lock(state_mutex);
+        while (true) {
+            changed.wait(lock, [&] {
+                return failed || next_block >= block_count || next_block < next_emit + window;
+            });
+            if (failed || next_block >= block_count) return;
+
+            size_t first = 0;
+            const size_t count = claim(backend, first);
+            lock.unlock();
+
+            blocks.assign(count, {});
+            reports.assign(explain ? count : 0, {});
+            string backend_error;
+            const auto start = steady_clock::now();
+            const bool coded = owner.encode(data, size, settings, first, count, blocks.data(),
+                                            explain ? reports.data() : nullptr, backend_error);
+            const double seconds = duration<double>(steady_clock::now() - start).count();
+
+            lock.lock();
+            if (!coded) {
+                if (!failed) error = owner.name + ": " + backend_error;
+                failed = true;
+                changed.notify_all();
+                return;
+            }
+
+            uint64_t bytes = 0;
+            for (size_t slot = 0; slot < count; slot++) {
+                const size_t ring = (first + slot) % slots.size();
+                bytes += blocks[slot].raw_size;
+                slots[ring] = move(blocks[slot]);
+                if (explain) slot_reports[ring] = reports[slot];
+                ready[ring] = 1;
+            }
+
+            backend_statistics &stats = statistics[backend];
+            stats.blocks += count;
+            stats.bytes += bytes;
+            stats.batches++;
+            stats.busy_seconds += seconds;
+            if (seconds > 0) {
+                const double rate = static_cast<double>(bytes) / seconds;
+                rates[backend] = rates[backend] > 0 ? 0.5 * rates[backend] + 0.5 * rate : rate;
+            }
+            changed.notify_all();
+        }
+    };
+
+    vector<thread> feeders;
+    feeders.reserve(backends.size());
+    for (size_t backend = 0; backend < backends.size(); backend++) feeders.emplace_back(feed, backend);
+
+    // In-order writer: the calling thread emits each block as soon as it and all before it are coded
+    encoded_block block;
+    block_report report;
+    while (true) {
+        unique_lock lock(state_mutex);
+        if (next_emit >= block_count) break;
+        const size_t ring = next_emit % slots.size();
+        changed.wait(lock, [&] { return failed || ready[ring]; });
+        if (!ready[ring]) break;
+
+        block = move(slots[ring]);
+        if (explain) report = slot_reports[ring];
+        ready[ring] = 0;
+        lock.unlock();
+
+        emit(block, explain ? &report : nullptr);
+
+        lock.lock();
+        next_emit++;
+        changed.notify_all();
+    }
+
+    for (thread &feeder : feeders) feeder.join();
+    return !failed;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "block_format.h"
+#include "numa_topology.h"
+
+/**
+ * @file block_scheduler.h
+ * @brief Splits the blocks of one input across several coding backends
+ *
+ * A backend is anything that can code a batch of consecutive blocks into
+ * block container payloads: a CPU worker group, or an accelerator behind the
+ * same interface. Every backend gets its own feeder thread that claims the
+ * next batch from a shared cursor, so a faster backend simply claims more.
+ *
+ * Batch sizes follow each backend's observed throughput: the first batch is a
+ * small probe, later ones aim at SCHEDULER_BATCH_SECONDS of work, and near
+ * the end a backend never claims more than its throughput share of what is
+ * left, so slow backends do not hold up the tail. Blocks are independent, so
+ * the output is byte-identical to encode_blocks() whatever the split; coded
+ * blocks are passed to emit() in input order by the calling thread, and at
+ * most SCHEDULER_WINDOW_BLOCKS blocks may be coded ahead of the writer.
+ *
+ * On NUMA hosts every block can carry the node its input pages reside on
+ * (see numa_topology.h). A backend bound to a node then claims the lowest
+ * unclaimed blocks of its own node first and only takes other nodes' blocks
+ * when it would otherwise idle; such blocks are counted as remote. Backends
+ * built with a node pin their workers to it, so the coded output, allocated
+ * by those workers, is first touched and placed on the same node.
+ */
+
+// Work per batch once a backend's throughput is known, in seconds
+#define SCHEDULER_BATCH_SECONDS 0.05
+
+// Coded blocks allowed to wait for the in-order writer
+#define SCHEDULER_WINDOW_BLOCKS 1024
+
+/**
+ * @struct block_backend
+ * @brief One execution resource and the way it codes a batch
+ *
+ * encode(data, size, settings, first, count, blocks, reports, error) codes
+ * blocks [first, first + count) exactly like encode_block_batch(): blocks[i]
+ * and, when non-null, reports[i] describe block first + i. It returns false
+ * and sets error on failure, which stops the whole run.
+ */
+struct block_backend {
+    using encode_function = std::function<bool(const uint8_t *data, size_t size,
+                                               const block_encoder_settings &settings, size_t first, size_t count,
+                                               encoded_block *blocks, block_report *reports, std::string &error)>;
+
+    std::string name;
+    unsigned max_batch_blocks = 64; // Upper bound on one claim (device buffer size, ...)
+    unsigned thread_count = 1; // CPU threads the backend keeps busy (for the governor)
+    int node = -1; // NUMA node whose blocks it prefers, -1 for none
+    encode_function encode;
+};
+
+/**
+ * @struct backend_statistics
+ * @brief What one backend did during a scheduled run
+ */
+struct backend_statistics {
+    std::string name;
+    uint64_t blocks = 0;
+    uint64_t bytes = 0;
+    uint64_t batches = 0;
+    uint64_t remote_blocks = 0; // Blocks whose input lives on another NUMA node
+    double busy_seconds = 0.0;
+
+    [[nodiscard]] double mbps() const {
+        return busy_seconds > 0 ? static_cast<double>(bytes) / busy_seconds / 1e6 : 0.0;
+    }
+};
+
+/**
+ * @brief CPU backend coding each batch on its own group of worker threads
+ * @param name Name shown in the statistics
+ * @param threads Workers of this backend
+ */
+block_backend cpu_block_backend(const std::string &name, unsigned threads);
+
+/**
+ * @brief One CPU backend per NUMA node, pinned to the node's CPUs
+ * @param nodes Topology from load_numa_topology()
+ * @return Backends named `node<id>`, each with one worker per usable CPU of its node
+ */
+std::vector<block_backend> numa_block_backends(const std::vector<numa_node> &nodes);
+
+/**
+ * @brief Builds backends from a list such as "cpu:4,cpu:2"
+ * @param spec Comma-separated `<kind>[:<threads>]`; `cpu` without a count uses default_thread_count()
+ * @param backends Output backends, named `<kind><n>` in order
+ * @param error Set when a kind is unknown or a count is invalid
+ *
+ * Only `cpu` is available in this build: the GPU compressor still codes the
+ * legacy whole-file format and has no block payload encoder to wrap.
+ */
+bool parse_backend_list(const std::string &spec, std::vector<block_backend> &backends, std::string &error);
+
+/**
+ * @brief Codes a whole buffer with several backends and emits the blocks in order
+ * @param data Input data
+ * @param size Input length
+ * @param settings Encoder options; settings.thread_count is ignored (each backend has its own)
+ * @param backends Backends to share the blocks between (at least one)
+ * @param block_nodes NUMA node of each block's input (-1 unknown), or empty to ignore placement
+ * @param explain Fill a block_report per block
+ * @param emit Called once per block, in input order, on the calling thread
+ * @param statistics Output, one entry per backend
+ * @param error Set when a backend fails
+ * @return false when a backend failed; blocks emitted before the failure are valid
+ */
+bool schedule_blocks(const uint8_t *data, size_t size, const block_encoder_settings &settings,
+                     const std::vector<block_backend> &backends, const std::vector<int> &block_nodes, bool explain,
+                     const std::function<void(const encoded_block &block, const block_report *report)> &emit,
+                     std::vector<backend_statistics> &statistics, std::string &error);
@@ -0,0 +1,656 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <unistd.h>
+
+#include "canonical_huffman.h"
+
+/**
+ * @file canonical_huffman.cpp
+ * @brief Construction, encoding and table-driven decoding of canonical Huffman codes
+ */
+
+using namespace std;
+
+/*=============================================================================
+ * CODE LENGTH CONSTRUCTION
+ *=============================================================================*/
+
+// Leaf index bits of the packed (weight, index) sort keys; covers the 16-bit alphabet
+#define HUFFMAN_SORT_INDEX_BITS 17
+
+/**
+ * @brief Builds a Huffman tree over the given weights and returns each leaf's depth
+ * @param weights Weight of every leaf (all non-zero)
+ * @param depths Output depth per leaf
+ * @return Depth of the deepest leaf
+ *
+ * Nodes always merge in (weight, node index) order, so equal weights merge
+ * the same way every time and the resulting lengths are reproducible across
+ * runs and machines. Leaves are sorted once; merged nodes are created in
+ * non-decreasing weight order, so a second FIFO queue stays sorted and the
+ * two lightest nodes are always at the front of one of the two queues
+ * (a leaf wins a tie, having the lower index). That keeps the merge linear,
+ * which matters for the 16-bit alphabet with thousands of present values.
+ */
+static unsigned compute_tree_depths(const vector<uint64_t> &weights, vector<unsigned> &depths) {
+    const size_t leaf_count = weights.size();
+    vector<uint32_t> parent(2 * leaf_count - 1, 0);
+    vector<uint64_t> merged_weight(leaf_count);
+
+    vector<uint32_t> leaves(leaf_count);
+    const uint64_t heaviest = *max_element(weights.begin(), weights.end());
+    if (heaviest < uint64_t{1} << (64 - HUFFMAN_SORT_INDEX_BITS) &&
+        leaf_count <= uint64_t{1} << HUFFMAN_SORT_INDEX_BITS) {
+        // Same (weight, index) order as plain integer keys, cheaper to sort than through a comparator
+        vector<uint64_t> keys(leaf_count);
+        for (uint32_t index = 0; index < leaf_count; index++) {
+            keys[index] = weights[index] << HUFFMAN_SORT_INDEX_BITS | index;
+        }
+        sort(keys.begin(), keys.end());
+        for (size_t index = 0; index < leaf_count; index++) {
+            leaves[index] = static_cast<uint32_t>(keys[index] & ((uint64_t{1} << HUFFMAN_SORT_INDEX_BITS) - 1));
+        }
+    } else {
+        for (uint32_t index = 0; index < leaf_count; index++) leaves[index] = index;
+        sort(leaves.begin(), leaves.end(), [&](const uint32_t a, const uint32_t b) {
+            return weights[a] != weights[b] ? weights[a] < weights[b] : a < b;
+        });
+    }
+
+    size_t next_leaf = 0;
+    size_t next_merged = 0;
+    uint32_t next_node = static_cast<uint32_t>(leaf_count);
+    const auto take_lightest = [&](uint64_t &weight) {
+        if (next_leaf < leaf_count &&
+            (next_merged == next_node - leaf_count || weights[leaves[next_leaf]] <= merged_weight[next_merged])) {
+            weight = weights[leaves[next_leaf]];
+            return leaves[next_leaf++];
+        }
+        weight = merged_weight[next_merged];
+        return static_cast<uint32_t>(leaf_count + next_merged++);
+    };
+
+    // Classic Huffman merging: combine the two lightest nodes until one remains
+    while (next_node < 2 * leaf_count - 1) {
+        uint64_t left_weight, right_weight;
+        const uint32_t left = take_lightest(left_weight);
+        const uint32_t right = take_lightest(right_weight);
+
+        parent[left] = next_node;
+        parent[right] = next_node;
+        merged_weight[next_node - leaf_count] = left_weight + right_weight;
+        next_node++;
+    }
+
+    // Parents are always created after their children, so a reverse sweep
+    // visits every parent before its children (the root sits at depth 0)
+    vector<unsigned> node_depth(next_node, 0);
+    for (int64_t node = static_cast<int64_t>(next_node) - 2; node >= 0; node--) {
+        node_depth[node] = node_depth[parent[node]] + 1;
+    }
+
+    depths.assign(node_depth.begin(), node_depth.begin() + static_cast<long>(leaf_count));
+    return *max_element(depths.begin(), depths.end());
+}
+
+void build_code_lengths(const uint64_t *frequency, const size_t alphabet_size, const unsigned max_length,
+                        uint8_t *lengths) {
+    memset(lengths, 0, alphabet_size);
+
+    // Collect the symbols that actually occur
+    vector<uint32_t> symbols;
+    vector<uint64_t> weights;
+    for (uint32_t symbol = 0; symbol < alphabet_size; symbol++) {
+        if (frequency[symbol] > 0) {
+            symbols.push_back(symbol);
+            weights.push_back(frequency[symbol]);
+        }
+    }
+
+    if (symbols.empty()) return;
+
+    // A single symbol still needs a 1-bit code so the decoder can count it
+    if (symbols.size() == 1) {
+        lengths[symbols[0]] = 1;
+        return;
+    }
+
+    // Flatten the distribution until the tree fits into max_length bits.
+    // Every halving keeps present symbols at weight >= 1, so the loop ends at
+    // the latest when all weights are equal and the tree is balanced.
+    vector<unsigned> depths;
+    while (compute_tree_depths(weights, depths) > max_length) {
+        for (uint64_t &weight: weights) {
+            weight = (weight >> 1) | 1;
+        }
+    }
+
+    for (size_t index = 0; index < symbols.size(); index++) {
+        lengths[symbols[index]] = static_cast<uint8_t>(depths[index]);
+    }
+}
+
+/*=============================================================================
+ * CANONICAL CODE ASSIGNMENT
+ *=============================================================================*/
+
+/**
+ * @brief Counts codes per length and checks the Kraft inequality
+ * @return false if a length exceeds HUFFMAN_LENGTH_LIMIT or the code space is over-subscribed
+ */
+static bool count_code_lengths(const uint8_t *lengths, const size_t alphabet_size,
+                               uint32_t (&length_count)[HUFFMAN_LENGTH_LIMIT + 1]) {
+    memset(length_count, 0, sizeof(length_count));
+    for (size_t symbol = 0; symbol < alphabet_size; symbol++) {
+        if (lengths[symbol] > HUFFMAN_LENGTH_LIMIT) return false;
+        length_count[lengths[symbol]]++;
+    }
+    length_count[0] = 0;
+
+    uint64_t kraft_sum = 0;
+    for (unsigned length = 1; length <= HUFFMAN_LENGTH_LIMIT; length++) {
+        kraft_sum += static_cast<uint64_t>(length_count[length]) << (HUFFMAN_LENGTH_LIMIT - length);
+    }
+    return kraft_sum <= (1ull << HUFFMAN_LENGTH_LIMIT);
+}
+
+bool assign_canonical_codes(const uint8_t *lengths, const size_t alphabet_size, canonical_code &code) {
+    uint32_t length_count[HUFFMAN_LENGTH_LIMIT + 1];
+    if (!count_code_lengths(lengths, alphabet_size, length_count)) return false;
+
+    // First code of each length: codes of one length are consecutive and the
+    // next length continues from the doubled end of the previous range
+    uint32_t next_code[HUFFMAN_LENGTH_LIMIT + 1] = {};
+    uint32_t running_code = 0;
+    for (unsigned length = 1; length <= HUFFMAN_LENGTH_LIMIT; length++) {
+        running_code = (running_code + length_count[length - 1]) << 1;
+        next_code[length] = running_code;
+    }
+
+    code.lengths.assign(lengths, lengths + alphabet_size);
+    code.codes.assign(alphabet_size, 0);
+    for (size_t symbol = 0; symbol < alphabet_size; symbol++) {
+        if (lengths[symbol] != 0) {
+            code.codes[symbol] = next_code[lengths[symbol]]++;
+        }
+    }
+    return true;
+}
+
+bool build_canonical_decoder(const uint8_t *lengths, const size_t alphabet_size, canonical_decoder &decoder) {
+    uint32_t length_count[HUFFMAN_LENGTH_LIMIT + 1];
+    if (!count_code_lengths(lengths, alphabet_size, length_count)) return false;
+
+    // Per-length ranges used by the long-code path
+    uint32_t running_code = 0;
+    uint32_t running_offset = 0;
+    decoder.max_length = 0;
+    decoder.first_code[0] = decoder.limit[0] = decoder.offset[0] = 0;
+    for (unsigned length = 1; length <= HUFFMAN_LENGTH_LIMIT; length++) {
+        running_code = (running_code + length_count[length - 1]) << 1;
+        decoder.first_code[length] = running_code;
+        decoder.limit[length] = running_code + length_count[length];
+        decoder.offset[length] = running_offset;
+        running_offset += length_count[length];
+        if (length_count[length] != 0) decoder.max_length = length;
+    }
+
+    // Symbols ordered by (length, symbol) - the canonical code order
+    uint32_t next_slot[HUFFMAN_LENGTH_LIMIT + 1];
+    memcpy(next_slot, decoder.offset, sizeof(next_slot));
+    decoder.sorted_symbols.assign(running_offset, 0);
+    for (uint32_t symbol = 0; symbol < alphabet_size; symbol++) {
+        if (lengths[symbol] != 0) decoder.sorted_symbols[next_slot[lengths[symbol]]++] = symbol;
+    }
+
+    // Primary lookup: every short code owns 2^(LOOKUP_BITS - length) slots
+    decoder.lookup.assign(1u << HUFFMAN_LOOKUP_BITS, 0);
+    for (unsigned length = 1; length <= HUFFMAN_LOOKUP_BITS && length <= decoder.max_length; length++) {
+        for (uint32_t index = 0; index < length_count[length]; index++) {
+            const uint32_t symbol = decoder.sorted_symbols[decoder.offset[length] + index];
+            const uint32_t code = decoder.first_code[length] + index;
+            const unsigned spare_bits = HUFFMAN_LOOKUP_BITS - length;
+            const uint32_t entry = symbol << 8 | length;
+            for (uint32_t fill = 0; fill < (1u << spare_bits); fill++) {
+                decoder.lookup[(code << spare_bits) | fill] = entry;
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t predicted_code_bits(const uint64_t *frequency, const uint8_t *lengths, const size_t alphabet_size) {
+    uint64_t bits = 0;
+    for (size_t symbol = 0; symbol < alphabet_size; symbol++) {
+        if (frequency[symbol] == 0) continue;
+        if (lengths[symbol] == 0) return UINT64_MAX;
+        bits += frequency[symbol] * lengths[symbol];
+    }
+    return bits;
+}
+
+void append_packed_lengths(vector<uint8_t> &out, const uint8_t *lengths) {
+    for (size_t symbol = 0; symbol < HUFFMAN_BYTE_ALPHABET; symbol += 2) {
+        out.push_back(static_cast<uint8_t>(lengths[symbol] << 4 | lengths[symbol + 1]));
+    }
+}
+
+void unpack_lengths(const uint8_t *packed, uint8_t *lengths) {
+    for (size_t index = 0; index < HUFFMAN_BYTE_ALPHABET / 2; index++) {
+        lengths[2 * index] = packed[index] >> 4;
+        lengths[2 * index + 1] = packed[index] & 0x0F;
+    }
+}
+
+/*=============================================================================
+ * ENCODING
+ *=============================================================================*/
+
+size_t huffman_encode_bytes(const uint8_t *input, const size_t input_length, const canonical_code &code,
+                            uint8_t *output) {
+    const uint8_t *lengths = code.lengths.data();
+    const uint32_t *codes = code.codes.data();
+
+    // Bits accumulate at the bottom of a 64-bit register and leave it
+    // MSB-first, 32 bits at a time (bits stays below 32 + max length)
+    uint64_t accumulator = 0;
+    unsigned bit_count = 0;
+    size_t position = 0;
+
+    for (size_t index = 0; index < input_length; index++) {
+        const uint8_t symbol = input[index];
+        accumulator = (accumulator << lengths[symbol]) | codes[symbol];
+        bit_count += lengths[symbol];
+
+        if (bit_count >= 32) {
+            bit_count -= 32;
+            const auto word = static_cast<uint32_t>(accumulator >> bit_count);
+            output[position] = static_cast<uint8_t>(word >> 24);
+            output[position + 1] = static_cast<uint8_t>(word >> 16);
+            output[position + 2] = static_cast<uint8_t>(word >> 8);
+            output[position + 3] = static_cast<uint8_t>(word);
+            position += 4;
+        }
+    }
+
+    // Drain remaining whole bytes, then the zero-padded final byte
+    while (bit_count >= 8) {
+        bit_count -= 8;
+        output[position++] = static_cast<uint8_t>(accumulator >> bit_count);
+    }
+    if (bit_count > 0) {
+        output[position++] = static_cast<uint8_t>(accumulator << (8 - bit_count));
+    }
+    return position;
+}
+
+/*=============================================================================
+ * DECODING
+ *=============================================================================*/
+
+/**
+ * @brief Tops up an MSB-aligned bit buffer to at least 57 valid bits
+ * @param position Next unread payload byte; may run past input_size at the tail
+ */
+static inline void refill_bits(const uint8_t *input, const size_t input_size, size_t &position, uint64_t &buffer,
+                               unsigned &available) {
+    if (position + 8 <= input_size) {
+        // Fast refill: load 8 bytes big-endian and keep whole bytes only.
+        // Bits below `available` repeat what the next load would supply.
+        uint64_t word = 0;
+        for (int byte = 0; byte < 8; byte++) {
+            word = (word << 8) | input[position + byte];
+        }
+        buffer |= word >> available;
+        const unsigned bytes = (63 - available) >> 3;
+        position += bytes;
+        available += bytes * 8;
+    } else {
+        // Tail refill: past the end of the payload the stream reads as zeros
+        while (available <= 56) {
+            const uint64_t byte = position < input_size ? input[position] : 0;
+            buffer |= byte << (56 - available);
+            position++;
+            available += 8;
+        }
+    }
+}
+
+bool huffman_decode_bytes(const uint8_t *input, const size_t input_size, const canonical_decoder &decoder,
+                          uint8_t *output, const size_t output_length) {
+    const uint32_t *lookup = decoder.lookup.data();
+
+    // MSB-aligned bit buffer; the top `available` bits are valid stream bits
+    uint64_t buffer = 0;
+    unsigned available = 0;
+    size_t position = 0;
+
+    for (size_t index = 0; index < output_length; index++) {
+        if (available < HUFFMAN_LENGTH_LIMIT) refill_bits(input, input_size, position, buffer, available);
+
+        const uint32_t entry = lookup[buffer >> (64 - HUFFMAN_LOOKUP_BITS)];
+        unsigned length = entry & 0xFF;
+        uint32_t symbol = entry >> 8;
+
+        if (length == 0) {
+            // Long code: find the length whose canonical range contains the prefix
+            for (length = HUFFMAN_LOOKUP_BITS + 1; length <= decoder.max_length; length++) {
+                const auto code = static_cast<uint32_t>(buffer >> (64 - length));
+                if (code < decoder.limit[length]) {
+                    symbol = decoder.sorted_symbols[decoder.offset[length] + code - decoder.first_code[length]];
+                    break;
+                }
+            }
+            if (length > decoder.max_length) return false;
+        }
+
+        output[index] = static_cast<uint8_t>(symbol);
+        buffer <<= length;
+        available -= length;
+    }
+
+    // Reject streams that needed bits beyond the stored payload
+    return position * 8 - available <= input_size * 8;
+}
+
+/*=============================================================================
+ * 16-BIT SYMBOLS
+ *=============================================================================*/
+
+void build_wide_code(const uint64_t *frequency, wide_code &code) {
+    // Code construction runs over the present values only, not all 65536
+    vector<uint64_t> present_frequency;
+    code.symbols.clear();
+    for (uint32_t value = 0; value < HUFFMAN_WIDE_ALPHABET; value++) {
+        if (frequency[value] == 0) continue;
+        code.symbols.push_back(static_cast<uint16_t>(value));
+        present_frequency.push_back(frequency[value]);
+    }
+    code.lengths.assign(code.symbols.size(), 0);
+    build_code_lengths(present_frequency.data(), present_frequency.size(), HUFFMAN_WIDE_MAX_CODE_LENGTH,
+                       code.lengths.data());
+}
+
+/**
+ * @brief Whether a sparse symbol list is strictly ascending with every length in 1..HUFFMAN_WIDE_MAX_CODE_LENGTH
+ */
+static bool valid_wide_symbols(const uint16_t *symbols, const uint8_t *lengths, const size_t count) {
+    for (size_t index = 0; index < count; index++) {
+        if (lengths[index] == 0 || lengths[index] > HUFFMAN_WIDE_MAX_CODE_LENGTH) return false;
+        if (index > 0 && symbols[index] <= symbols[index - 1]) return false;
+    }
+    return true;
+}
+
+bool assign_wide_codes(wide_code &code) {
+    const size_t count = code.symbols.size();
+    canonical_code dense;
+    if (code.lengths.size() != count || !valid_wide_symbols(code.symbols.data(), code.lengths.data(), count) ||
+        !assign_canonical_codes(code.lengths.data(), count, dense)) {
+        return false;
+    }
+
+    // Dense indexes are ascending values, so dense canonical order is (length, value) order
+    code.packed.assign(HUFFMAN_WIDE_ALPHABET, 0);
+    for (size_t index = 0; index < count; index++) {
+        code.packed[code.symbols[index]] = dense.codes[index] << 5 | code.lengths[index];
+    }
+    return true;
+}
+
+bool build_wide_decoder(const uint16_t *symbols, const uint8_t *lengths, const size_t count, wide_decoder &decoder) {
+    uint32_t length_count[HUFFMAN_LENGTH_LIMIT + 1];
+    if (!valid_wide_symbols(symbols, lengths, count) || !count_code_lengths(lengths, count, length_count)) return false;
+
+    // Canonical order: by length, then value (the list is already sorted by value)
+    vector<uint32_t> order(count);
+    for (uint32_t index = 0; index < count; index++) order[index] = index;
+    stable_sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) {
+        return lengths[a] < lengths[b];
+    });
+
+    decoder.table.assign(1u << HUFFMAN_LOOKUP_BITS, 0);
+    decoder.max_length = count ? lengths[order.back()] : 0;
+
+    uint32_t code = 0;
+    unsigned previous_length = count ? lengths[order[0]] : 0;
+    uint32_t subtable_prefix = UINT32_MAX;
+    size_t subtable_offset = 0;
+    unsigned subtable_bits = 0;
+
+    for (size_t rank = 0; rank < count; rank++) {
+        const uint32_t index = order[rank];
+        const unsigned length = lengths[index];
+        code <<= length - previous_length;
+        previous_length = length;
+        const uint32_t entry = static_cast<uint32_t>(symbols[index]) << 8 | length;
+
+        if (length <= HUFFMAN_LOOKUP_BITS) {
+            const unsigned spare_bits = HUFFMAN_LOOKUP_BITS - length;
+            for (uint32_t fill = 0; fill < (1u << spare_bits); fill++) {
+                decoder.table[(code << spare_bits) | fill] = entry;
+            }
+        } else {
+            // Codes sharing a primary prefix are consecutive in canonical order and
+            // the longest comes last, so a new subtable is sized by scanning ahead
+            const unsigned extra_bits = length - HUFFMAN_LOOKUP_BITS;
+            const uint32_t prefix = code >> extra_bits;
+            if (prefix != subtable_prefix) {
+                uint32_t scan_code = code;
+                unsigned scan_length = length;
+                unsigned longest = length;
+                for (size_t next = rank + 1; next < count; next++) {
+                    const unsigned next_length = lengths[order[next]];
+                    scan_code = (scan_code + 1) << (next_length - scan_length);
+                    scan_length = next_length;
+                    if (scan_code >> (next_length - HUFFMAN_LOOKUP_BITS) != prefix) break;
+                    longest = next_length;
+                }
+                subtable_prefix = prefix;
+                subtable_bits = longest - HUFFMAN_LOOKUP_BITS;
+                subtable_offset = decoder.table.size();
+                decoder.table.resize(subtable_offset + (size_t{1} << subtable_bits), 0);
+                decoder.table[prefix] = static_cast<uint32_t>(subtable_offset) << 8 | HUFFMAN_WIDE_SUBTABLE |
+                                        subtable_bits;
+            }
+            const unsigned spare_bits = subtable_bits - extra_bits;
+            const uint32_t low_bits = code & ((1u << extra_bits) - 1);
+            for (uint32_t fill = 0; fill < (1u << spare_bits); fill++) {
+                decoder.table[subtable_offset + ((low_bits << spare_bits) | fill)] = entry;
+            }
+        }
+        code++;
+    }
+    return true;
+}
+
+size_t huffman_encode_wide(const uint8_t *input, const size_t symbol_count, const wide_code &code,
+                           uint8_t *output) {
+    const uint32_t *packed = code.packed.data();
+
+    // Same accumulator scheme as huffman_encode_bytes(); codes are at most 20 bits
+    uint64_t accumulator = 0;
+    unsigned bit_count = 0;
+    size_t position = 0;
+
+    for (size_t index = 0; index < symbol_count; index++) {
+        const uint32_t entry = packed[input[2 * index] | input[2 * index + 1] << 8];
+        const unsigned length = entry & 0x1F;
+        accumulator = (accumulator << length) | (entry >> 5);
+        bit_count += length;
+
+        if (bit_count >= 32) {
+            bit_count -= 32;
+            const auto word = static_cast<uint32_t>(accumulator >> bit_count);
+            output[position] = static_cast<uint8_t>(word >> 24);
+            output[position + 1] = static_cast<uint8_t>(word >> 16);
+            output[position + 2] = static_cast<uint8_t>(word >> 8);
+            output[position + 3] = static_cast<uint8_t>(word);
+            position += 4;
+        }
+    }
+
+    while (bit_count >= 8) {
+        bit_count -= 8;
+        output[position++] = static_cast<uint8_t>(accumulator >> bit_count);
+    }
+    if (bit_count > 0) {
+        output[position++] = static_cast<uint8_t>(accumulator << (8 - bit_count));
+    }
+    return position;
+}
+
+bool huffman_decode_wide(const uint8_t *input, const size_t input_size, const wide_decoder &decoder,
+                         uint8_t *output, const size_t symbol_count) {
+    const uint32_t *table = decoder.table.data();
+
+    uint64_t buffer = 0;
+    unsigned available = 0;
+    size_t position = 0;
+
+    for (size_t index = 0; index < symbol_count; index++) {
+        if (available < HUFFMAN_LENGTH_LIMIT) refill_bits(input, input_size, position, buffer, available);
+
+        uint32_t entry = table[buffer >> (64 - HUFFMAN_LOOKUP_BITS)];
+        if (entry & HUFFMAN_WIDE_SUBTABLE) {
+            const unsigned subtable_bits = entry & 0x1F;
+            entry = table[(entry >> 8) + ((buffer << HUFFMAN_LOOKUP_BITS) >> (64 - subtable_bits))];
+        }
+        const unsigned length = entry & 0xFF;
+        if (length == 0) return false;
+
+        output[2 * index] = static_cast<uint8_t>(entry >> 8);
+        output[2 * index + 1] = static_cast<uint8_t>(entry >> 16);
+        buffer <<= length;
+        available -= length;
+    }
+
+    return position * 8 - available <= input_size * 8;
+}
+
+/*=============================================================================
+ * TABLE-LESS DECODING
+ *=============================================================================*/
+
+bool build_limit_decoder(const uint8_t *lengths, const size_t count, const uint16_t *symbols,
+                         limit_decoder &decoder) {
+    uint32_t length_count[HUFFMAN_LENGTH_LIMIT + 1];
+    if (count > HUFFMAN_WIDE_ALPHABET || !count_code_lengths(lengths, count, length_count)) return false;
+
+    uint32_t running_code = 0;
+    uint32_t running_offset = 0;
+    uint32_t offset[HUFFMAN_LENGTH_LIMIT + 1] = {};
+    decoder.max_length = 0;
+    decoder.bound[0] = 0;
+    decoder.base[0] = 0;
+    for (unsigned length = 1; length <= HUFFMAN_LENGTH_LIMIT; length++) {
+        running_code = (running_code + length_count[length - 1]) << 1;
+        decoder.bound[length] = static_cast<uint64_t>(running_code + length_count[length]) << (63 - length);
+        decoder.base[length] = running_offset - running_code;
+        offset[length] = running_offset;
+        running_offset += length_count[length];
+        if (length_count[length] != 0) decoder.max_length = length;
+    }
+    decoder.bound[decoder.max_length + 1] = UINT64_MAX;
+
+    decoder.sorted_symbols.assign(running_offset, 0);
+    for (uint32_t index = 0; index < count; index++) {
+        if (lengths[index] != 0) {
+            decoder.sorted_symbols[offset[lengths[index]]++] = symbols ? symbols[index] : static_cast<uint16_t>(index);
+        }
+    }
+
+    // Smallest window with k leading ones: k ones, then zeros
+    for (unsigned ones = 0; ones <= HUFFMAN_LENGTH_LIMIT; ones++) {
+        const uint64_t window = ones == 0 ? 0 : ~uint64_t{0} << (64 - ones);
+        unsigned length = 1;
+        while (length <= decoder.max_length && window >> 1 >= decoder.bound[length]) length++;
+        decoder.start_length[ones] = static_cast<uint8_t>(length);
+    }
+    return true;
+}
+
+/**
+ * @brief Shared loop of the limit decoders; store(index, symbol) writes one decoded symbol
+ */
+template<typename Store>
+static bool decode_with_limits(const uint8_t *input, const size_t input_size, const limit_decoder &decoder,
+                               const size_t symbol_count, Store store) {
+    const uint64_t *bound = decoder.bound;
+    const uint16_t *sorted_symbols = decoder.sorted_symbols.data();
+    const unsigned max_length = decoder.max_length;
+
+    uint64_t buffer = 0;
+    unsigned available = 0;
+    size_t position = 0;
+
+    for (size_t index = 0; index < symbol_count; index++) {
+        if (available < HUFFMAN_LENGTH_LIMIT) refill_bits(input, input_size, position, buffer, available);
+
+        const auto ones = static_cast<unsigned>(countl_one(buffer));
+        unsigned length = decoder.start_length[ones < max_length ? ones : max_length];
+        while (buffer >> 1 >= bound[length]) length++;
+        if (length > max_length) return false;
+
+        store(index, sorted_symbols[decoder.base[length] + static_cast<uint32_t>(buffer >> (64 - length))]);
+        buffer <<= length;
+        available -= length;
+    }
+
+    return position * 8 - available <= input_size * 8;
+}
+
+bool huffman_decode_bytes_limits(const uint8_t *input, const size_t input_size, const limit_decoder &decoder,
+                                 uint8_t *output, const size_t output_length) {
+    return decode_with_limits(input, input_size, decoder, output_length, [&](const size_t index, const uint16_t symbol) {
+        output[index] = static_cast<uint8_t>(symbol);
+    });
+}
+
+bool huffman_decode_wide_limits(const uint8_t *input, const size_t input_size, const limit_decoder &decoder,
+                                uint8_t *output, const size_t symbol_count) {
+    return decode_with_limits(input, input_size, decoder, symbol_count, [&](const size_t index, const uint16_t symbol) {
+        output[2 * index] = static_cast<uint8_t>(symbol);
+        output[2 * index + 1] = static_cast<uint8_t>(symbol >> 8);
+    });
+}
+
+size_t wide_decoder_table_bytes(const uint8_t *lengths, const size_t count) {
+    uint32_t length_count[HUFFMAN_LENGTH_LIMIT + 1];
+    if (!count_code_lengths(lengths, count, length_count)) return 0;
+
+    // Walks the long codes in canonical order exactly like build_wide_decoder(),
+    // adding one subtable per primary prefix, sized by its longest code
+    size_t entries = size_t{1} << HUFFMAN_LOOKUP_BITS;
+    uint32_t code = 0;
+    uint32_t current_prefix = UINT32_MAX;
+    unsigned current_bits = 0;
+    for (unsigned length = 1; length <= HUFFMAN_LENGTH_LIMIT; length++) {
+        code = (code + length_count[length - 1]) << 1;
+        if (length <= HUFFMAN_LOOKUP_BITS) continue;
+        for (uint32_t rank = 0; rank < length_count[length]; rank++) {
+            const uint32_t prefix = (code + rank) >> (length - HUFFMAN_LOOKUP_BITS);
+            if (prefix != current_prefix) {
+                if (current_prefix != UINT32_MAX) entries += size_t{1} << current_bits;
+                current_prefix = prefix;
+            }
+            current_bits = length - HUFFMAN_LOOKUP_BITS;
+        }
+    }
+    if (current_prefix != UINT32_MAX) entries += size_t{1} << current_bits;
+    return entries * sizeof(uint32_t);
+}
+
+size_t decoder_cache_budget() {
+    static const size_t budget = [] {
+        const long l1_bytes = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+        return static_cast<size_t>(l1_bytes > 0 ? l1_bytes : HUFFMAN_DEFAULT_L1_BYTES) / 2;
+    }();
+    return budget;
+}
+
+bool prefer_limit_decoder(const size_t table_bytes, const bool table_built, const size_t symbol_count) {
+    if (table_bytes > decoder_cache_budget()) return true;
+    return !table_built && symbol_count * HUFFMAN_TABLE_FILL_RATIO < table_bytes / sizeof(uint32_t);
+}
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file canonical_huffman.h
+ * @brief Length-limited canonical Huffman codes for the block-based CPU tools
+ *
+ * The legacy CPU format serializes the whole tree and the GPU format stores the
+ * complete frequency table, so neither can point at a code that lives somewhere
+ * else. A canonical code is fully described by one code length per symbol:
+ * - It can be stored inline in a few bytes (4 bits per symbol)
+ * - It can be shared between many files through a trained table set
+ * - It can be decoded with flat lookup tables instead of pointer chasing
+ *
+ * Bit order matches the existing formats: codes are emitted MSB-first and packed
+ * into bytes starting from the most significant bit.
+ */
+
+/*=============================================================================
+ * LIMITS
+ *=============================================================================*/
+
+// Number of symbols in the byte-oriented alphabet
+#define HUFFMAN_BYTE_ALPHABET 256
+
+// Longest code allowed in byte mode (keeps inline tables at 4 bits per symbol)
+#define HUFFMAN_MAX_CODE_LENGTH 15
+
+// Hard upper bound for any alphabet; sizes the per-length decoder arrays
+#define HUFFMAN_LENGTH_LIMIT 24
+
+// Number of bits resolved by a single lookup in the primary decode table
+#define HUFFMAN_LOOKUP_BITS 11
+
+/*=============================================================================
+ * CODE STRUCTURES
+ *=============================================================================*/
+
+/**
+ * @struct canonical_code
+ * @brief Encoder view of a canonical code
+ *
+ * - lengths: Code length per symbol, 0 when the symbol has no code
+ * - codes: Right-aligned code bits per symbol (valid where length > 0)
+ */
+struct canonical_code {
+    std::vector<uint8_t> lengths;
+    std::vector<uint32_t> codes;
+};
+
+/**
+ * @struct canonical_decoder
+ * @brief Decoder view of a canonical code
+ *
+ * Codes up to HUFFMAN_LOOKUP_BITS long are resolved with a single lookup in
+ * `lookup`, whose entries pack (symbol << 8) | length (length 0 = not a short
+ * code). Longer codes fall back to the canonical per-length ranges:
+ * a code of length L is valid when code < limit[L], and its symbol is
+ * sorted_symbols[offset[L] + code - first_code[L]].
+ */
+struct canonical_decoder {
+    std::vector<uint32_t> lookup;
+    std::vector<uint32_t> sorted_symbols;
+    uint32_t first_code[HUFFMAN_LENGTH_LIMIT + 1];
+    uint32_t limit[HUFFMAN_LENGTH_LIMIT + 1];
+    uint32_t offset[HUFFMAN_LENGTH_LIMIT + 1];
+    unsigned max_length;
+};
+
+/*=============================================================================
+ * CODE CONSTRUCTION
+ *=============================================================================*/
+
+/**
+ * @brief Computes length-limited Huffman code lengths from symbol frequencies
+ * @param frequency Occurrence count per symbol
+ * @param alphabet_size Number of symbols in the alphabet
+ * @param max_length Longest code allowed
+ * @param lengths Output code length per symbol (0 for absent symbols)
+ *
+ * Builds a regular Huffman tree and, if it is deeper than max_length, halves
+ * the frequencies (keeping every present symbol at least 1) and rebuilds until
+ * it fits. A single present symbol receives a 1-bit code.
+ */
+void build_code_lengths(const uint64_t *frequency, size_t alphabet_size, unsigned max_length, uint8_t *lengths);
+
+/**
+ * @brief Assigns canonical code bits from code lengths
+ * @param lengths Code length per symbol
+ * @param alphabet_size Number of symbols
+ * @param code Output encoder structure
+ * @return false if the lengths over-subscribe the code space
+ */
+bool assign_canonical_codes(const uint8_t *lengths, size_t alphabet_size, canonical_code &code);
+
+/**
+ * @brief Builds lookup and per-length decode structures from code lengths
+ * @param lengths Code length per symbol
+ * @param alphabet_size Number of symbols
+ * @param decoder Output decoder structure
+ * @return false if the lengths do not describe a valid prefix code
+ */
+bool build_canonical_decoder(const uint8_t *lengths, size_t alphabet_size, canonical_decoder &decoder);
+
+/**
+ * @brief Predicts the encoded size in bits for a histogram under a given code
+ * @return Σ frequency × length; symbols without a code make the result UINT64_MAX
+ */
+uint64_t predicted_code_bits(const uint64_t *frequency, const uint8_t *lengths, size_t alphabet_size);
+
+/**
+ * @brief Appends byte-alphabet code lengths packed two per byte (high nibble first, 128 bytes)
+ */
+void append_packed_lengths(std::vector<uint8_t> &out, const uint8_t *lengths);
+
+/**
+ * @brief Unpacks 128 bytes written by append_packed_lengths() into 256 code lengths
+ */
+void unpack_lengths(const uint8_t *packed, uint8_t *lengths);
+
+/*=============================================================================
+ * BYTE ENCODING / DECODING
+ *=============================================================================*/
+
+/**
+ * @brief Encodes bytes with a canonical code
+ * @param input Data to encode
+ * @param input_length Number of input bytes
+ * @param code Code covering every byte value present in the input
+ * @param output Destination buffer, at least ceil(predicted bits / 8) bytes
+ * @return Number of payload bytes produced (final byte zero-padded)
+ */
+size_t huffman_encode_bytes(const uint8_t *input, size_t input_length, const canonical_code &code, uint8_t *output);
+
+/**
+ * @brief Decodes exactly output_length bytes from a canonical bit stream
+ * @param input Encoded payload
+ * @param input_size Payload size in bytes
+ * @param decoder Decoder built from the same code lengths as the encoder
+ * @param output Destination for the decoded bytes
+ * @param output_length Number of symbols to decode
+ * @return false on an invalid code or when the payload is exhausted early
+ */
+bool huffman_decode_bytes(const uint8_t *input, size_t input_size, const canonical_decoder &decoder,
+                          uint8_t *output, size_t output_length);
+
+/*=============================================================================
+ * 16-BIT SYMBOLS
+ *=============================================================================*/
+
+// Number of symbols when the data is read as little-endian uint16 samples
+#define HUFFMAN_WIDE_ALPHABET 65536
+
+// Longest code allowed in 16-bit mode (lengths are stored in 5 bits)
+#define HUFFMAN_WIDE_MAX_CODE_LENGTH 20
+
+// Second-level decode tables are tagged with this bit in the entry's length byte
+#define HUFFMAN_WIDE_SUBTABLE 0x80
+
+/**
+ * @struct wide_code
+ * @brief Canonical code over the 16-bit values present in a block
+ *
+ * Sample data uses a small, mostly contiguous part of the 65536 values, so
+ * only the present values are listed (ascending) with their code lengths;
+ * canonical order is (length, value) just as in byte mode. `packed` is the
+ * encoder's per-value lookup: code << 5 | length, 0 for absent values.
+ */
+struct wide_code {
+    std::vector<uint16_t> symbols;
+    std::vector<uint8_t> lengths;
+    std::vector<uint32_t> packed;
+};
+
+/**
+ * @struct wide_decoder
+ * @brief Two-level decode table for a wide_code
+ *
+ * The first 1 << HUFFMAN_LOOKUP_BITS entries are indexed by the next
+ * HUFFMAN_LOOKUP_BITS stream bits. A short code's entry is (value << 8) |
+ * length. A prefix shared by longer codes instead holds
+ * (subtable offset << 8) | HUFFMAN_WIDE_SUBTABLE | subtable bits, and the
+ * following bits index that subtable, whose entries are (value << 8) | length
+ * again. Subtables are only as wide as the longest code below their prefix,
+ * so a block with thousands of distinct samples still decodes every symbol in
+ * at most two lookups from a table that stays cache-sized.
+ */
+struct wide_decoder {
+    std::vector<uint32_t> table;
+    unsigned max_length = 0;
+};
+
+/**
+ * @brief Builds a length-limited code over the values present in a 16-bit histogram
+ * @param frequency Occurrence count per value (HUFFMAN_WIDE_ALPHABET entries)
+ * @param code Output code; symbols and lengths cover exactly the present values
+ */
+void build_wide_code(const uint64_t *frequency, wide_code &code);
+
+/**
+ * @brief Assigns canonical codes and fills code.packed from code.symbols / code.lengths
+ * @return false if the symbols are not strictly ascending or the lengths are invalid
+ */
+bool assign_wide_codes(wide_code &code);
+
+/**
+ * @brief Builds the two-level decode table from a sparse symbol / length list
+ * @return false if the lengths do not describe a valid prefix code
+ */
+bool build_wide_decoder(const uint16_t *symbols, const uint8_t *lengths, size_t count, wide_decoder &decoder);
+
+/**
+ * @brief Encodes little-endian uint16 samples with a wide code
+ * @param input Sample data (2 * symbol_count bytes)
+ * @param symbol_count Number of samples
+ * @param code Code covering every value present in the input
+ * @param output Destination, at least ceil(symbol_count * HUFFMAN_WIDE_MAX_CODE_LENGTH / 8) bytes
+ * @return Number of payload bytes produced (final byte zero-padded)
+ */
+size_t huffman_encode_wide(const uint8_t *input, size_t symbol_count, const wide_code &code, uint8_t *output);
+
+/**
+ * @brief Decodes exactly symbol_count little-endian uint16 samples
+ * @return false on an invalid code or when the payload is exhausted early
+ */
+bool huffman_decode_wide(const uint8_t *input, size_t input_size, const wide_decoder &decoder, uint8_t *output,
+                         size_t symbol_count);
+
+/*=============================================================================
+ * TABLE-LESS DECODING
+ *=============================================================================*/
+
+// Assumed L1 data cache size when the system does not report one
+#define HUFFMAN_DEFAULT_L1_BYTES (32 * 1024)
+
+// A per-block table costs about as much to fill as decoding 1 symbol per this many entries saves
+#define HUFFMAN_TABLE_FILL_RATIO 8
+
+/**
+ * @enum decoder_engine
+ * @brief Which decoder a block is decoded with
+ */
+enum decoder_engine : uint8_t {
+    DECODER_ENGINE_AUTO = 0, // Limits when the lookup table would not pay off (prefer_limit_decoder)
+    DECODER_ENGINE_TABLE = 1, // canonical_decoder / wide_decoder lookup tables
+    DECODER_ENGINE_LIMITS = 2, // limit_decoder
+};
+
+/**
+ * @struct limit_decoder
+ * @brief Canonical decoder without lookup tables, for any alphabet up to 16 bits
+ *
+ * A canonical code of length L is valid when its L bits, read as a number,
+ * are below limit[L]. Left-aligned in a 64-bit window (shifted to 63 bits so
+ * a complete code's 2^L still fits), all limits compare against the same
+ * window, and the code length is the first L with window >> 1 < bound[L];
+ * bound[max_length + 1] is a sentinel that catches invalid codes.
+ *
+ * Short codes take the numerically smallest values, so long codes start with
+ * runs of one bits. A window with k leading ones (countl_one, an lzcnt of the
+ * inverted window) is at least k ones followed by zeros, which rules out every
+ * length whose bound is not above that; start_length[k] is the first length
+ * left, so the scan usually ends after one or two compares. The symbol is
+ * sorted_symbols[base[L] + code]. Everything fits in a few hundred bytes plus
+ * the sorted symbols, so the decoder stays in L1 where a lookup table for a
+ * large or sparse alphabet would not, and it costs almost nothing to build.
+ */
+struct limit_decoder {
+    uint64_t bound[HUFFMAN_LENGTH_LIMIT + 2];
+    uint32_t base[HUFFMAN_LENGTH_LIMIT + 1];
+    uint8_t start_length[HUFFMAN_LENGTH_LIMIT + 1];
+    std::vector<uint16_t> sorted_symbols;
+    unsigned max_length = 0;
+};
+
+/**
+ * @brief Builds a limit decoder from code lengths
+ * @param lengths Code length per symbol
+ * @param count Number of entries in lengths
+ * @param symbols Symbol value of every entry (ascending), or null when the entry index is the symbol
+ * @param decoder Output decoder
+ * @return false if the lengths do not describe a valid prefix code
+ */
+bool build_limit_decoder(const uint8_t *lengths, size_t count, const uint16_t *symbols, limit_decoder &decoder);
+
+/**
+ * @brief huffman_decode_bytes() with a limit decoder
+ */
+bool huffman_decode_bytes_limits(const uint8_t *input, size_t input_size, const limit_decoder &decoder,
+                                 uint8_t *output, size_t output_length);
+
+/**
+ * @brief huffman_decode_wide() with a limit decoder
+ */
+bool huffman_decode_wide_limits(const uint8_t *input, size_t input_size, const limit_decoder &decoder,
+                                uint8_t *output, size_t symbol_count);
+
+/**
+ * @brief Size in bytes of the wide_decoder table build_wide_decoder() would create for these lengths
+ */
+size_t wide_decoder_table_bytes(const uint8_t *lengths, size_t count);
+
+/**
+ * @brief Half the L1 data cache (sysconf, else HUFFMAN_DEFAULT_L1_BYTES), queried once
+ */
+size_t decoder_cache_budget();
+
+/**
+ * @brief Whether DECODER_ENGINE_AUTO picks the limit decoder
+ * @param table_bytes Size of the lookup table the table engine would need
+ * @param table_built Whether that table already exists (trained tables) or would be built for this block
+ * @param symbol_count Number of symbols to decode with it
+ *
+ * The limit decoder wins when the table exceeds decoder_cache_budget(), and
+ * also when a table built for a single block has more than
+ * HUFFMAN_TABLE_FILL_RATIO entries per symbol to decode, since filling it
+ * would cost more than the faster lookups save.
+ */
+bool prefer_limit_decoder(size_t table_bytes, bool table_built, size_t symbol_count);
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
+
+#include "code_tables.h"
+#include "format_utilities.h"
+
+/**
+ * @file code_tables.cpp
+ * @brief Table set persistence, selection and k-means based training
+ */
+
+using namespace std;
+
+/*=============================================================================
+ * TABLE SET I/O
+ *=============================================================================*/
+
+bool finalize_code_tables(code_table_set &set) {
+    vector<uint8_t> identity;
+    append_u16(identity, static_cast<uint16_t>(set.tables.size()));
+
+    for (code_table &table: set.tables) {
+        // Trained tables must be able to encode any byte value
+        for (const uint8_t length: table.lengths) {
+            if (length == 0 || length > HUFFMAN_MAX_CODE_LENGTH) return false;
+        }
+        if (!assign_canonical_codes(table.lengths.data(), HUFFMAN_BYTE_ALPHABET, table.code)) return false;
+        if (!build_canonical_decoder(table.lengths.data(), HUFFMAN_BYTE_ALPHABET, table.decoder)) return false;
+        identity.insert(identity.end(), table.lengths.begin(), table.lengths.end());
+    }
+
+    set.set_id = static_cast<uint32_t>(data_checksum(identity.data(), identity.size()));
+    return true;
+}
+
+bool save_code_tables(const char *path, const code_table_set &set, string &error) {
+    vector<uint8_t> bytes(CODE_TABLES_MAGIC, CODE_TABLES_MAGIC + 8);
+    append_u16(bytes, CODE_TABLES_VERSION);
+    append_u16(bytes, static_cast<uint16_t>(set.tables.size()));
+    append_u32(bytes, set.set_id);
+    for (const code_table &table: set.tables) {
+        bytes.insert(bytes.end(), table.lengths.begin(), table.lengths.end());
+    }
+
+    ofstream out_file(path, ios::binary);
+    if (!out_file) {
+        error = string("Cannot create table file ") + path;
+        return false;
+    }
+    out_file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<streamsize>(bytes.size()));
+    if (!out_file) {
+        error = string("Failed to write table file ") + path;
+        return false;
+    }
+    return true;
+}
+
+bool load_code_tables(const char *path, code_table_set &set, string &error) {
+    ifstream in_file(path, ios::binary);
+    if (!in_file) {
+        error = string("Cannot open table file ") + path;
+        return false;
+    }
+    const vector<uint8_t> bytes((istreambuf_iterator(in_file)), istreambuf_iterator<char>());
+
+    // Fixed header: magic (8) + version (2) + count (2) + set id (4)
+    if (bytes.size() < 16 || memcmp(bytes.data(), CODE_TABLES_MAGIC, 8) != 0) {
+        error = string("Not a Huffman table file: ") + path;
+        return false;
+    }
+    if (const uint16_t version = read_u16(&bytes[8]); version != CODE_TABLES_VERSION) {
+        error = "Unsupported table file version " + to_string(version);
+        return false;
+    }
+
+    const uint16_t table_count = read_u16(&bytes[10]);
+    const uint32_t stored_set_id = read_u32(&bytes[12]);
+    if (table_count == 0 || table_count > MAX_CODE_TABLES ||
+        bytes.size() != 16 + static_cast<size_t>(table_count) * HUFFMAN_BYTE_ALPHABET) {
+        error = string("Corrupted table file ") + path;
+        return false;
+    }
+
+    set.tables.assign(table_count, code_table());
+    for (size_t index = 0; index < table_count; index++) {
+        memcpy(set.tables[index].lengths.data(), &bytes[16 + index * HUFFMAN_BYTE_ALPHABET], HUFFMAN_BYTE_ALPHABET);
+    }
+
+    // The id is recomputed rather than trusted so edited tables are caught
+    if (!finalize_code_tables(set) || set.set_id != stored_set_id) {
+        error = string("Corrupted table file ") + path;
+        return false;
+    }
+    return true;
+}
+
+unsigned select_code_table(const code_table_set &set, const uint64_t *histogram, uint64_t &best_bits) {
+    unsigned best_table = 0;
+    best_bits = UINT64_MAX;
+    for (unsigned index = 0; index < set.tables.size(); index++) {
+        const uint64_t bits = predicted_code_bits(histogram, set.tables[index].lengths.data(), HUFFMAN_BYTE_ALPHABET);
+        if (bits < best_bits) {
+            best_bits = bits;
+            best_table = index;
+        }
+    }
+    return best_table;
+}
+
+/*=============================================================================
+ * TRAINING
+ *=============================================================================*/
+
+using histogram = array<uint64_t, HUFFMAN_BYTE_ALPHABET>;
+using feature = array<double, HUFFMAN_BYTE_ALPHABET>;
+
+static double squared_distance(const feature &left, const feature &right) {
+    double distance = 0.0;
+    for (size_t symbol = 0; symbol < HUFFMAN_BYTE_ALPHABET; symbol++) {
+        const double delta = left[symbol] - right[symbol];
+        distance += delta * delta;
+    }
+    return distance;
+}
+
+/**
+ * @brief Builds one table from the summed histograms of its member samples
+ *
+ * Every symbol gets +1 so the table covers bytes the samples never contained.
+ */
+static code_table build_table_from_members(const vector<histogram> &histograms, const vector<unsigned> &assignment,
+                                           const unsigned cluster) {
+    uint64_t counts[HUFFMAN_BYTE_ALPHABET];
+    fill(begin(counts), end(counts), 1);
+    for (size_t sample = 0; sample < histograms.size(); sample++) {
+        if (assignment[sample] != cluster) continue;
+        for (size_t symbol = 0; symbol < HUFFMAN_BYTE_ALPHABET; symbol++) {
+            counts[symbol] += histograms[sample][symbol];
+        }
+    }
+
+    code_table table;
+    build_code_lengths(counts, HUFFMAN_BYTE_ALPHABET, HUFFMAN_MAX_CODE_LENGTH, table.lengths.data());
+    return table;
+}
+
+/**
+ * @brief Clusters normalized histograms with k-means (k-means++ seeding)
+ * @return Cluster index per sample
+ */
+static vector<unsigned> cluster_histograms(const vector<feature> &points, const unsigned cluster_count) {
+    mt19937_64 generator(0x48554654ull); // Fixed seed: identical samples give identical tables
+    vector<feature> centers;
+
+    // k-means++: first center at random, then proportional to squared distance
+    centers.push_back(points[uniform_int_distribution<size_t>(0, points.size() - 1)(generator)]);
+    vector<double> nearest(points.size(), numeric_limits<double>::max());
+    while (centers.size() < cluster_count) {
+        double total = 0.0;
+        for (size_t sample = 0; sample < points.size(); sample++) {
+            nearest[sample] = min(nearest[sample], squared_distance(points[sample], centers.back()));
+            total += nearest[sample];
+        }
+        if (total == 0.0) break; // Fewer distinct samples than clusters
+
+        double target = uniform_real_distribution<double>(0.0, total)(generator);
+        size_t chosen = 0;
+        for (; chosen + 1 < points.size(); chosen++) {
+            target -= nearest[chosen];
+            if (target <= 0.0) break;
+        }
+        centers.push_back(points[chosen]);
+    }
+
+    // Lloyd iterations until assignments stop changing
+    vector<unsigned> assignment(points.size(), 0);
+    for (int iteration = 0; iteration < 100; iteration++) {
+        bool changed = false;
+        for (size_t sample = 0; sample < points.size(); sample++) {
+            unsigned best = 0;
+            double best_distance = numeric_limits<double>::max();
+            for (unsigned cluster = 0; cluster < centers.size(); cluster++) {
+                if (const double distance = squared_distance(points[sample], centers[cluster]);
+                    distance < best_distance) {
+                    best_distance = distance;
+                    best = cluster;
+                }
+            }
+            if (iteration == 0 || assignment[sample] != best) changed = true;
+            assignment[sample] = best;
+        }
+        if (!changed) break;
+
+        // Move every center to the mean of its members
+        vector<feature> sums(centers.size(), feature{});
+        vector<size_t> members(centers.size(), 0);
+        for (size_t sample = 0; sample < points.size(); sample++) {
+            members[assignment[sample]]++;
+            for (size_t symbol = 0; symbol < HUFFMAN_BYTE_ALPHABET; symbol++) {
+                sums[assignment[sample]][symbol] += points[sample][symbol];
+            }
+        }
+        for (size_t cluster = 0; cluster < centers.size(); cluster++) {
+            if (members[cluster] == 0) continue; // Keep an empty cluster's previous center
+            for (size_t symbol = 0; symbol < HUFFMAN_BYTE_ALPHABET; symbol++) {
+                centers[cluster][symbol] = sums[cluster][symbol] / static_cast<double>(members[cluster]);
+            }
+        }
+    }
+    return assignment;
+}
+
+void train_code_tables(const vector<histogram> &histograms, const unsigned cluster_count, code_table_set &set,
+                       vector<unsigned> &assignment) {
+    const unsigned clusters = max(1u, min(cluster_count, static_cast<unsigned>(histograms.size())));
+    assignment.assign(histograms.size(), 0);
+
+    if (clusters > 1) {
+        // Cluster on byte probabilities so file size does not dominate the distance
+        vector<feature> points(histograms.size());
+        for (size_t sample = 0; sample < histograms.size(); sample++) {
+            uint64_t total = 0;
+            for (const uint64_t count: histograms[sample]) total += count;
+            for (size_t symbol = 0; symbol < HUFFMAN_BYTE_ALPHABET; symbol++) {
+                points[sample][symbol] = total ? static_cast<double>(histograms[sample][symbol]) / total : 0.0;
+            }
+        }
+        assignment = cluster_histograms(points, clusters);
+    }
+
+    // Two rounds of: build tables from members, then move every sample to the
+    // table that really codes it best (Euclidean clusters are only a proxy)
+    for (int round = 0; round < 2; round++) {
+        // Drop clusters that ended up empty and renumber the rest densely
+        vector<int> remap(clusters, -1);
+        int used = 0;
+        for (const unsigned cluster: assignment) {
+            if (remap[cluster] < 0) remap[cluster] = used++;
+        }
+        for (unsigned &cluster: assignment) cluster = remap[cluster];
+
+        set.tables.clear();
+        for (int cluster = 0; cluster < used; cluster++) {
+            set.tables.push_back(build_table_from_members(histograms, assignment, cluster));
+        }
+
+        for (size_t sample = 0; sample < histograms.size(); sample++) {
+            uint64_t bits;
+            assignment[sample] = select_code_table(set, histograms[sample].data(), bits);
+        }
+    }
+
+    finalize_code_tables(set);
+}
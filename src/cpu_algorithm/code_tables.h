@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "canonical_huffman.h"
+
+/**
+ * @file code_tables.h
+ * @brief Trained, shareable Huffman code tables
+ *
+ * A table set holds one or more canonical codes trained offline on sample
+ * files (see huffman_train). Block-container files compressed with
+ * `--tables` reference a table by its index instead of carrying their own
+ * code, which removes both the per-file tree construction and most header
+ * bytes for fleets of small, similar files.
+ *
+ * Table set file format (little-endian):
+ * 1. Magic "\x89HUFTAB\n" (8 bytes)
+ * 2. Format version (2 bytes)
+ * 3. Table count (2 bytes)
+ * 4. Set identifier (4 bytes) - stored in every file that references the set
+ * 5. Per table: 256 code lengths (1 byte each)
+ */
+
+#define CODE_TABLES_MAGIC "\x89HUFTAB\n"
+#define CODE_TABLES_VERSION 1
+
+// Table ids are stored in a single byte inside each block header
+#define MAX_CODE_TABLES 255
+
+/*=============================================================================
+ * TABLE STRUCTURES
+ *=============================================================================*/
+
+/**
+ * @struct code_table
+ * @brief One trained code, kept in both encoder and decoder form
+ *
+ * Every trained table assigns a code to all 256 byte values so any input can
+ * be encoded with it, even bytes that never appeared in the samples.
+ */
+struct code_table {
+    std::array<uint8_t, HUFFMAN_BYTE_ALPHABET> lengths{};
+    canonical_code code;
+    canonical_decoder decoder;
+};
+
+/**
+ * @struct code_table_set
+ * @brief A versioned collection of trained tables
+ *
+ * set_id is derived from the table contents; the compressor records it in the
+ * container header so the decompressor can refuse a mismatching table file.
+ */
+struct code_table_set {
+    uint32_t set_id = 0;
+    std::vector<code_table> tables;
+};
+
+/*=============================================================================
+ * TABLE SET I/O
+ *=============================================================================*/
+
+/**
+ * @brief Derives encoder/decoder structures for every table and computes the set id
+ * @return false if any table holds an invalid set of code lengths
+ */
+bool finalize_code_tables(code_table_set &set);
+
+/**
+ * @brief Writes a table set to disk
+ * @return false and sets error when the file cannot be written
+ */
+bool save_code_tables(const char *path, const code_table_set &set, std::string &error);
+
+/**
+ * @brief Loads and validates a table set from disk
+ * @return false and sets error on I/O failure, bad magic/version or invalid tables
+ */
+bool load_code_tables(const char *path, code_table_set &set, std::string &error);
+
+/**
+ * @brief Picks the table that encodes a histogram in the fewest bits
+ * @param set Loaded table set
+ * @param histogram Byte histogram of the data to encode
+ * @param best_bits Output predicted size in bits with the chosen table
+ * @return Index of the cheapest table
+ */
+unsigned select_code_table(const code_table_set &set, const uint64_t *histogram, uint64_t &best_bits);
+
+/*=============================================================================
+ * TRAINING
+ *=============================================================================*/
+
+/**
+ * @brief Trains cluster_count tables from per-file byte histograms
+ * @param histograms One 256-bin histogram per sample file
+ * @param cluster_count Number of tables to produce (clamped to the sample count)
+ * @param set Output table set (finalized)
+ * @param assignment Output table index chosen for every sample
+ *
+ * With one cluster the samples are simply summed. With more, files are grouped
+ * by k-means over their normalized histograms (k-means++ seeding with a fixed
+ * seed, so training is reproducible), then each sample is re-assigned to the
+ * table that actually codes it in the fewest bits.
+ */
+void train_code_tables(const std::vector<std::array<uint64_t, HUFFMAN_BYTE_ALPHABET> > &histograms,
+                       unsigned cluster_count, code_table_set &set, std::vector<unsigned> &assignment);
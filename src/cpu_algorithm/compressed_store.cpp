@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+
+#include "compressed_store.h"
+
+/**
+ * @file compressed_store.cpp
+ * @brief Compressed key-value store: block coding per value, shared-lock lookups, LRU hot cache
+ */
+
+using namespace std;
+
+/*=============================================================================
+ * LATENCY HISTOGRAM
+ *=============================================================================*/
+
+/**
+ * @brief Bucket of a latency: exact below 2^STORE_LATENCY_SUB_BITS ns, then 2^STORE_LATENCY_SUB_BITS per power of two
+ */
+static size_t latency_bucket(const uint64_t nanoseconds) {
+    constexpr uint64_t sub_buckets = uint64_t{1} << STORE_LATENCY_SUB_BITS;
+    if (nanoseconds < sub_buckets) return nanoseconds;
+    const auto octave = static_cast<unsigned>(bit_width(nanoseconds)) - 1 - STORE_LATENCY_SUB_BITS;
+    const uint64_t sub_bucket = (nanoseconds >> octave) - sub_buckets;
+    return min<size_t>((octave + 1) * sub_buckets + sub_bucket, STORE_LATENCY_BUCKETS - 1);
+}
+
+/**
+ * @brief Lowest latency of a bucket, in nanoseconds
+ */
+static uint64_t latency_bucket_start(const size_t bucket) {
+    constexpr uint64_t sub_buckets = uint64_t{1} << STORE_LATENCY_SUB_BITS;
+    if (bucket < sub_buckets) return bucket;
+    const size_t octave = bucket / sub_buckets - 1;
+    return (sub_buckets + bucket % sub_buckets) << octave;
+}
+
+void latency_histogram::record(const uint64_t nanoseconds) {
+    buckets[latency_bucket(nanoseconds)].fetch_add(1, memory_order_relaxed);
+    count.fetch_add(1, memory_order_relaxed);
+    total_nanoseconds.fetch_add(nanoseconds, memory_order_relaxed);
+}
+
+double latency_histogram::mean_microseconds() const {
+    const uint64_t operations = count.load(memory_order_relaxed);
+    return operations == 0 ? 0.0 : static_cast<double>(total_nanoseconds.load(memory_order_relaxed)) / 1e3 /
+                                   static_cast<double>(operations);
+}
+
+double latency_histogram::quantile_microseconds(const double quantile) const {
+    const uint64_t operations = count.load(memory_order_relaxed);
+    if (operations == 0) return 0.0;
+
+    // Rank of the quantile among the operations, placed evenly within the bucket that holds it
+    const double target = quantile * static_cast<double>(operations);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < STORE_LATENCY_BUCKETS; bucket++) {
+        const uint64_t in_bucket = buckets[bucket].load(memory_order_relaxed);
+        if (in_bucket == 0 || static_cast<double>(seen + in_bucket) < target) {
+            seen += in_bucket;
+            continue;
+        }
+        const auto start = static_cast<double>(latency_bucket_start(bucket));
+        const auto width = static_cast<double>(latency_bucket_start(bucket + 1)) - start;
+        const double fraction = (target - static_cast<double>(seen)) / static_cast<double>(in_bucket);
+        return (start + width * fraction) / 1e3;
+    }
+    return static_cast<double>(latency_bucket_start(STORE_LATENCY_BUCKETS)) / 1e3;
+}
+
+/*=============================================================================
+ * STORE
+ *=============================================================================*/
+
+/**
+ * @brief Nanoseconds since start
+ */
+static uint64_t elapsed_nanoseconds(const chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start)
+        .count());
+}
+
+compressed_store::compressed_store(const block_encoder_settings &settings, const size_t cache_bytes)
+    : settings(settings), cache_capacity(cache_bytes) {
+    // Values are in memory: no sparse extents, and no background throttling of put()
+    this->settings.data_extents = nullptr;
+    this->settings.governor = nullptr;
+    container.block_size = settings.block_size;
+    container.table_set_id = settings.tables ? settings.tables->set_id : 0;
+}
+
+void compressed_store::put(const string &key, const uint8_t *data, const size_t size) {
+    const auto start = chrono::steady_clock::now();
+
+    auto value = make_shared<stored_value>();
+    value->size = size;
+    const size_t block_count = (size + settings.block_size - 1) / settings.block_size;
+    vector<encoded_block> blocks(block_count);
+    if (block_count > 0) encode_block_batch(data, size, settings, 0, block_count, blocks.data(), nullptr);
+
+    size_t coded_size = 0;
+    for (const encoded_block &block: blocks) coded_size += block.bytes.size();
+    value->bytes.reserve(coded_size);
+    value->blocks.reserve(block_count);
+    for (const encoded_block &block: blocks) {
+        value->blocks.push_back({value->bytes.size(), block.raw_size, static_cast<uint32_t>(block.bytes.size()),
+                                 block.checksum});
+        value->bytes.insert(value->bytes.end(), block.bytes.begin(), block.bytes.end());
+    }
+    const uint64_t resident = value->bytes.size() + value->blocks.size() * sizeof(block_index_entry) + key.size() +
+                              sizeof(stored_value);
+
+    {
+        unique_lock lock(map_mutex);
+        auto [slot, inserted] = values.try_emplace(key);
+        if (!inserted) {
+            raw_bytes -= slot->second->size;
+            resident_bytes -= slot->second->bytes.size() + slot->second->blocks.size() * sizeof(block_index_entry) +
+                    key.size() + sizeof(stored_value);
+        }
+        slot->second = std::move(value);
+        raw_bytes += size;
+        resident_bytes += resident;
+    }
+    cache_remove(key);
+    put_latency.record(elapsed_nanoseconds(start));
+}
+
+bool compressed_store::get(const string &key, uint8_t *output, const size_t capacity, size_t &size, string &error) {
+    const auto start = chrono::steady_clock::now();
+
+    value_pointer value;
+    {
+        shared_lock lock(map_mutex);
+        const auto found = values.find(key);
+        if (found != values.end()) value = found->second;
+    }
+    if (!value) {
+        error = "No value stored under key \"" + key + "\"";
+        return false;
+    }
+    size = value->size;
+    if (capacity < size) {
+        error = "Buffer of " + to_string(capacity) + " B is too small for a " + to_string(size) + " B value";
+        return false;
+    }
+
+    if (cache_capacity == 0 || !cache_lookup(key, value, output)) {
+        uint64_t offset = 0;
+        for (const block_index_entry &entry: value->blocks) {
+            if (!decode_block(container, value->bytes.data(), entry, settings.tables, output + offset, error)) {
+                return false;
+            }
+            offset += entry.raw_size;
+        }
+        if (cache_capacity != 0 && size <= cache_capacity) cache_insert(key, value, output);
+    }
+    get_latency.record(elapsed_nanoseconds(start));
+    return true;
+}
+
+bool compressed_store::value_size(const string &key, size_t &size) const {
+    shared_lock lock(map_mutex);
+    const auto found = values.find(key);
+    if (found == values.end()) return false;
+    size = found->second->size;
+    return true;
+}
+
+bool compressed_store::erase(const string &key) {
+    {
+        unique_lock lock(map_mutex);
+        const auto found = values.find(key);
+        if (found == values.end()) return false;
+        raw_bytes -= found->second->size;
+        resident_bytes -= found->second->bytes.size() + found->second->blocks.size() * sizeof(block_index_entry) +
+                key.size() + sizeof(stored_value);
+        values.erase(found);
+    }
+    cache_remove(key);
+    return true;
+}
+
+store_statistics compressed_store::statistics() const {
+    store_statistics stats;
+    {
+        shared_lock lock(map_mutex);
+        stats.values = values.size();
+        stats.raw_bytes = raw_bytes;
+        stats.resident_bytes = resident_bytes;
+    }
+    {
+        lock_guard lock(cache_mutex);
+        stats.cache_bytes = cache_used;
+    }
+    stats.cache_hits = cache_hits.load(memory_order_relaxed);
+    stats.cache_misses = cache_misses.load(memory_order_relaxed);
+    return stats;
+}
+
+/*=============================================================================
+ * HOT CACHE
+ *=============================================================================*/
+
+bool compressed_store::cache_lookup(const string &key, const value_pointer &value, uint8_t *output) {
+    data_pointer data;
+    {
+        lock_guard lock(cache_mutex);
+        const auto cached = cache_index.find(key);
+        if (cached != cache_index.end() && cached->second->value == value) {
+            cache.splice(cache.begin(), cache, cached->second);
+            data = cached->second->data;
+        }
+    }
+    if (!data) {
+        cache_misses.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    cache_hits.fetch_add(1, memory_order_relaxed);
+    memcpy(output, data->data(), data->size());
+    return true;
+}
+
+void compressed_store::cache_remove(const string &key) {
+    lock_guard lock(cache_mutex);
+    if (const auto cached = cache_index.find(key); cached != cache_index.end()) {
+        cache_used -= cached->second->data->size();
+        cache.erase(cached->second);
+        cache_index.erase(cached);
+    }
+}
+
+void compressed_store::cache_insert(const string &key, const value_pointer &value, const uint8_t *data) {
+    // The copy is made before taking the lock; other readers only wait for the list update
+    auto copy = make_shared<const vector<uint8_t> >(data, data + value->size);
+
+    lock_guard lock(cache_mutex);
+    if (const auto cached = cache_index.find(key); cached != cache_index.end()) {
+        cache_used -= cached->second->data->size();
+        cache.erase(cached->second);
+        cache_index.erase(cached);
+    }
+    cache.push_front({key, value, std::move(copy)});
+    cache_index[key] = cache.begin();
+    cache_used += value->size;
+
+    while (cache_used > cache_capacity) {
+        const cache_entry &oldest = cache.back();
+        cache_used -= oldest.data->size();
+        cache_index.erase(oldest.key);
+        cache.pop_back();
+    }
+}
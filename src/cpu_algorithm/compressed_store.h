@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "block_format.h"
+
+/**
+ * @file compressed_store.h
+ * @brief In-memory key-value store that keeps its values compressed
+ *
+ * Values are cut into blocks and coded with encode_block(), exactly as in
+ * the block container: an inline Huffman code per block, a trained table
+ * from block_encoder_settings::tables, or stored/zero mode, and optionally
+ * the other block engines. Each value keeps its coded blocks in one byte
+ * vector with a small index. get() decodes into the caller's buffer with
+ * decode_block(), which also verifies every block's checksum.
+ *
+ * Concurrency: any number of get() calls run in parallel with each other
+ * and with put() / erase(). The key map is guarded by a shared mutex that is
+ * only held to look a value up. Values are immutable and reference counted,
+ * so a reader keeps decoding a value that a writer has just replaced.
+ *
+ * Hot cache: the decoded copies of recently read values are kept up to
+ * cache_bytes in total and evicted least recently used first. A hit is a
+ * memcpy instead of a decode. Entries belong to a particular stored value,
+ * so a replaced value is never served from the cache.
+ */
+
+// Decoded bytes kept in the hot cache by default
+#define STORE_DEFAULT_CACHE_BYTES (16u << 20)
+
+// Latency histogram resolution: every power of two of nanoseconds is split into 2^this equal sub-buckets
+#define STORE_LATENCY_SUB_BITS 3
+
+// Latency histogram buckets: 40 ranges of 8 sub-buckets, covering up to 2^42 ns (about 73 minutes)
+#define STORE_LATENCY_BUCKETS (40 << STORE_LATENCY_SUB_BITS)
+
+/**
+ * @struct latency_histogram
+ * @brief Lock-free log-linear histogram of operation latencies (bucket width 1/8 of its lower edge)
+ */
+struct latency_histogram {
+    std::atomic<uint64_t> buckets[STORE_LATENCY_BUCKETS] = {};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_nanoseconds{0};
+
+    void record(uint64_t nanoseconds);
+
+    // Mean latency in microseconds
+    [[nodiscard]] double mean_microseconds() const;
+
+    // Latency at the given quantile (0..1) in microseconds, interpolated linearly within its bucket
+    [[nodiscard]] double quantile_microseconds(double quantile) const;
+};
+
+/**
+ * @struct store_statistics
+ * @brief Snapshot of a store's size and cache counters
+ *
+ * resident_bytes counts coded blocks, block indexes and keys; the hot cache
+ * is reported separately because its size is a choice, not a cost of
+ * compression.
+ */
+struct store_statistics {
+    uint64_t values = 0;
+    uint64_t raw_bytes = 0;
+    uint64_t resident_bytes = 0;
+    uint64_t cache_bytes = 0;
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+
+    // Fraction of the raw size saved, e.g. 0.45 for 45%
+    [[nodiscard]] double savings() const {
+        return raw_bytes == 0 ? 0.0 : 1.0 - static_cast<double>(resident_bytes) / static_cast<double>(raw_bytes);
+    }
+};
+
+/**
+ * @struct stored_value
+ * @brief One value's coded blocks; immutable once built
+ */
+struct stored_value {
+    std::vector<uint8_t> bytes; // Block headers and payloads, back to back
+    std::vector<block_index_entry> blocks; // Offsets into bytes
+    uint64_t size = 0; // Decoded size
+};
+
+/**
+ * @struct compressed_store
+ * @brief Thread-safe key-value store holding Huffman-coded values
+ */
+struct compressed_store {
+    block_encoder_settings settings; // thread_count parallelizes put() of multi-block values
+    block_container container; // Table set id for decode_block()
+    size_t cache_capacity;
+
+    /**
+     * @param settings Block size, trained tables and engines used for every value
+     * @param cache_bytes Hot cache size (0 disables it)
+     */
+    explicit compressed_store(const block_encoder_settings &settings, size_t cache_bytes = STORE_DEFAULT_CACHE_BYTES);
+
+    compressed_store(const compressed_store &) = delete;
+    compressed_store &operator=(const compressed_store &) = delete;
+
+    // Compresses and inserts or replaces a value
+    void put(const std::string &key, const uint8_t *data, size_t size);
+
+    /**
+     * @brief Decodes a value into the caller's buffer
+     * @param output Destination
+     * @param capacity Size of output
+     * @param size Receives the value size (also when the buffer is too small)
+     * @param error Set when the key is missing, the buffer too small or a block fails to decode
+     */
+    bool get(const std::string &key, uint8_t *output, size_t capacity, size_t &size, std::string &error);
+
+    // Decoded size of a value, or false if the key is missing
+    bool value_size(const std::string &key, size_t &size) const;
+
+    // Removes a value; false if the key was missing
+    bool erase(const std::string &key);
+
+    [[nodiscard]] store_statistics statistics() const;
+
+    latency_histogram put_latency;
+    latency_histogram get_latency;
+
+    // Internal state below: the key map, the hot cache and their counters
+
+    using value_pointer = std::shared_ptr<const stored_value>;
+    using data_pointer = std::shared_ptr<const std::vector<uint8_t> >;
+
+    struct cache_entry {
+        std::string key;
+        value_pointer value; // The stored value this copy was decoded from
+        data_pointer data; // Shared, so hits copy it out after releasing cache_mutex
+    };
+
+    // Copies a cached decode of `value` into output; false on a miss
+    bool cache_lookup(const std::string &key, const value_pointer &value, uint8_t *output);
+
+    // Drops the decoded copy of a replaced or erased value
+    void cache_remove(const std::string &key);
+
+    // Inserts a decoded copy and evicts the least recently used entries beyond the capacity
+    void cache_insert(const std::string &key, const value_pointer &value, const uint8_t *data);
+
+    mutable std::shared_mutex map_mutex;
+    std::unordered_map<std::string, value_pointer> values;
+    uint64_t raw_bytes = 0;
+    uint64_t resident_bytes = 0;
+
+    mutable std::mutex cache_mutex;
+    std::list<cache_entry> cache; // Most recently used first
+    std::unordered_map<std::string, std::list<cache_entry>::iterator> cache_index;
+    uint64_t cache_used = 0;
+    std::atomic<uint64_t> cache_hits{0};
+    std::atomic<uint64_t> cache_misses{0};
+};
@@ -0,0 +1,57 @@
+#include <cmath>
+#include <cstring>
+
+#include "data_statistics.h"
+
+/**
+ * @file data_statistics.cpp
+ * @brief Fast byte histograms and entropy computation
+ */
+
+void accumulate_byte_histogram(const uint8_t *data, const size_t length, uint64_t *histogram) {
+    // 32-bit partial counters: flushed every 2^30 bytes so they never overflow
+    static constexpr size_t FLUSH_INTERVAL = 1u << 30;
+    uint32_t partial[4][256];
+
+    for (size_t start = 0; start < length; start += FLUSH_INTERVAL) {
+        const size_t end = length - start < FLUSH_INTERVAL ? length : start + FLUSH_INTERVAL;
+        memset(partial, 0, sizeof(partial));
+
+        size_t index = start;
+        for (; index + 4 <= end; index += 4) {
+            partial[0][data[index]]++;
+            partial[1][data[index + 1]]++;
+            partial[2][data[index + 2]]++;
+            partial[3][data[index + 3]]++;
+        }
+        for (; index < end; index++) {
+            partial[0][data[index]]++;
+        }
+
+        for (int symbol = 0; symbol < 256; symbol++) {
+            histogram[symbol] += static_cast<uint64_t>(partial[0][symbol]) + partial[1][symbol] +
+                    partial[2][symbol] + partial[3][symbol];
+        }
+    }
+}
+
+void accumulate_u16_histogram(const uint8_t *data, const size_t count, uint64_t *histogram) {
+    // 65536 counters are too many to replicate per lane; they are touched directly
+    for (size_t index = 0; index < count; index++) {
+        histogram[data[2 * index] | data[2 * index + 1] << 8]++;
+    }
+}
+
+double histogram_entropy(const uint64_t *histogram, const size_t alphabet_size) {
+    uint64_t total = 0;
+    for (size_t symbol = 0; symbol < alphabet_size; symbol++) total += histogram[symbol];
+    if (total == 0) return 0.0;
+
+    double entropy = 0.0;
+    for (size_t symbol = 0; symbol < alphabet_size; symbol++) {
+        if (histogram[symbol] == 0) continue;
+        const double probability = static_cast<double>(histogram[symbol]) / static_cast<double>(total);
+        entropy -= probability * std::log2(probability);
+    }
+    return entropy;
+}
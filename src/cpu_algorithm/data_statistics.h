@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file data_statistics.h
+ * @brief Histogram and entropy helpers shared by the encoders and the analyzer
+ */
+
+/**
+ * @brief Adds the byte histogram of a buffer to `histogram`
+ * @param data Bytes to count
+ * @param length Number of bytes
+ * @param histogram 256 counters, accumulated (not cleared)
+ *
+ * Counts into four interleaved tables and merges them at the end. Runs of
+ * equal bytes would otherwise make every increment wait for the previous
+ * store to the same counter, which caps a naive loop well below memory speed.
+ */
+void accumulate_byte_histogram(const uint8_t *data, size_t length, uint64_t *histogram);
+
+/**
+ * @brief Adds the histogram of little-endian uint16 samples to `histogram`
+ * @param data Sample bytes (2 * count)
+ * @param count Number of samples
+ * @param histogram 65536 counters, accumulated (not cleared)
+ */
+void accumulate_u16_histogram(const uint8_t *data, size_t count, uint64_t *histogram);
+
+/**
+ * @brief Shannon entropy of a histogram
+ * @param histogram Symbol counts
+ * @param alphabet_size Number of counters
+ * @return Entropy in bits per symbol (0 for an empty histogram)
+ */
+double histogram_entropy(const uint64_t *histogram, size_t alphabet_size);
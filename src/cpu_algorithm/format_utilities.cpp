@@ -0,0 +1,90 @@
+#include "format_utilities.h"
+
+/**
+ * @file format_utilities.cpp
+ * @brief Checksum implementation for the CPU file formats
+ */
+
+/*=============================================================================
+ * XXH64-STYLE CHECKSUM
+ *=============================================================================*/
+
+static constexpr uint64_t PRIME_1 = 11400714785074694791ull;
+static constexpr uint64_t PRIME_2 = 14029467366897019727ull;
+static constexpr uint64_t PRIME_3 = 1609587929392839161ull;
+static constexpr uint64_t PRIME_4 = 9650029242287828579ull;
+static constexpr uint64_t PRIME_5 = 2870177450012600261ull;
+
+static uint64_t rotate_left(const uint64_t value, const int bits) {
+    return value << bits | value >> (64 - bits);
+}
+
+// Mixes one 8-byte lane into an accumulator
+static uint64_t checksum_round(uint64_t accumulator, const uint64_t lane) {
+    accumulator += lane * PRIME_2;
+    accumulator = rotate_left(accumulator, 31);
+    return accumulator * PRIME_1;
+}
+
+// Folds a finished lane accumulator into the combined hash
+static uint64_t checksum_merge(uint64_t hash, const uint64_t accumulator) {
+    hash ^= checksum_round(0, accumulator);
+    return hash * PRIME_1 + PRIME_4;
+}
+
+uint64_t data_checksum(const uint8_t *data, const size_t length, const uint64_t seed) {
+    const uint8_t *position = data;
+    const uint8_t *end = data + length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        // Four independent lanes keep several multiplies in flight per cycle
+        uint64_t lane_1 = seed + PRIME_1 + PRIME_2;
+        uint64_t lane_2 = seed + PRIME_2;
+        uint64_t lane_3 = seed;
+        uint64_t lane_4 = seed - PRIME_1;
+
+        while (position + 32 <= end) {
+            lane_1 = checksum_round(lane_1, read_u64(position));
+            lane_2 = checksum_round(lane_2, read_u64(position + 8));
+            lane_3 = checksum_round(lane_3, read_u64(position + 16));
+            lane_4 = checksum_round(lane_4, read_u64(position + 24));
+            position += 32;
+        }
+
+        hash = rotate_left(lane_1, 1) + rotate_left(lane_2, 7) + rotate_left(lane_3, 12) + rotate_left(lane_4, 18);
+        hash = checksum_merge(hash, lane_1);
+        hash = checksum_merge(hash, lane_2);
+        hash = checksum_merge(hash, lane_3);
+        hash = checksum_merge(hash, lane_4);
+    } else {
+        hash = seed + PRIME_5;
+    }
+
+    hash += length;
+
+    // Tail: remaining 8-byte words, one 4-byte word, then single bytes
+    while (position + 8 <= end) {
+        hash ^= checksum_round(0, read_u64(position));
+        hash = rotate_left(hash, 27) * PRIME_1 + PRIME_4;
+        position += 8;
+    }
+    if (position + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read_u32(position)) * PRIME_1;
+        hash = rotate_left(hash, 23) * PRIME_2 + PRIME_3;
+        position += 4;
+    }
+    while (position < end) {
+        hash ^= *position * PRIME_5;
+        hash = rotate_left(hash, 11) * PRIME_1;
+        position++;
+    }
+
+    // Avalanche so that every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
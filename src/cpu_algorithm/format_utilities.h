@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file format_utilities.h
+ * @brief Byte-order helpers and checksums shared by the CPU file formats
+ *
+ * The legacy tools write native structs directly (`size_t`, `unsigned int`),
+ * which ties the files to the producing machine. The block container and the
+ * trained table files are always little-endian and written field by field, so
+ * struct padding and host byte order never leak into the output.
+ */
+
+/*=============================================================================
+ * LITTLE-ENDIAN SERIALIZATION
+ *=============================================================================*/
+
+inline void append_u8(std::vector<uint8_t> &out, const uint8_t value) {
+    out.push_back(value);
+}
+
+inline void append_u16(std::vector<uint8_t> &out, const uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+inline void append_u32(std::vector<uint8_t> &out, const uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) out.push_back(static_cast<uint8_t>(value >> shift));
+}
+
+inline void append_u64(std::vector<uint8_t> &out, const uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) out.push_back(static_cast<uint8_t>(value >> shift));
+}
+
+inline uint16_t read_u16(const uint8_t *data) {
+    return static_cast<uint16_t>(data[0] | data[1] << 8);
+}
+
+inline uint32_t read_u32(const uint8_t *data) {
+    return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+           static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+}
+
+inline uint64_t read_u64(const uint8_t *data) {
+    return static_cast<uint64_t>(read_u32(data)) | static_cast<uint64_t>(read_u32(data + 4)) << 32;
+}
+
+// LEB128 varint: 7 bits per byte, low groups first, high bit set on all but the last byte
+inline void append_varint(std::vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Reads a varint at data[position]; false if it runs past size or exceeds 64 bits
+inline bool read_varint(const uint8_t *data, const size_t size, size_t &position, uint64_t &value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && position < size; shift += 7) {
+        const uint8_t byte = data[position++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+/*=============================================================================
+ * CHECKSUMS
+ *=============================================================================*/
+
+/**
+ * @brief Computes a 64-bit checksum of a byte range
+ * @param data Bytes to hash
+ * @param length Number of bytes
+ * @param seed Starting value (lets callers chain or namespace checksums)
+ * @return 64-bit checksum
+ *
+ * Follows the XXH64 construction (four independent 8-byte lanes plus an
+ * avalanche step), which runs at several GB/s per core and is therefore cheap
+ * enough to verify every decoded block.
+ */
+uint64_t data_checksum(const uint8_t *data, size_t length, uint64_t seed = 0);
@@ -0,0 +1,222 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <iomanip>
+
+#include "adaptive_stream.h"
+#include "bench_utilities.h"
+#include "block_format.h"
+#include "canonical_huffman.h"
+#include "data_statistics.h"
+#include "format_utilities.h"
+
+/**
+ * @file huffman_adaptive_bench.cpp
+ * @brief Compares the one-pass adaptive stream with the static (two-pass) modes
+ *
+ * Usage: huffman_adaptive_bench [--frame-size <bytes>] [--repeat <n>] <input_file>
+ *
+ * Every mode codes the whole input on one thread, is decoded back and
+ * compared with the input; the best of --repeat runs is reported:
+ * - static: one canonical code from the histogram of the whole input (the
+ *   ratio bound of a single table; needs the data twice, so cannot stream)
+ * - blocks: the block container, one code per --frame-size block
+ * - adaptive: the adaptive stream with --frame-size frames
+ */
+
+using namespace std;
+
+/**
+ * @struct bench_result
+ * @brief Size and best timings of one mode
+ */
+struct bench_result {
+    const char *name;
+    uint64_t compressed_size = 0;
+    double encode_seconds = 0.0;
+    double decode_seconds = 0.0;
+    bool verified = true;
+};
+
+/**
+ * @brief Whole-input canonical code; the size includes the 256 code lengths a file would carry
+ */
+bench_result bench_static(const vector<uint8_t> &data, const int repeat) {
+    bench_result result{"static"};
+    vector<uint8_t> payload;
+    canonical_decoder decoder;
+    result.encode_seconds = best_of(repeat, [&] {
+        uint64_t histogram[HUFFMAN_BYTE_ALPHABET] = {};
+        accumulate_byte_histogram(data.data(), data.size(), histogram);
+        uint8_t lengths[HUFFMAN_BYTE_ALPHABET];
+        build_code_lengths(histogram, HUFFMAN_BYTE_ALPHABET, HUFFMAN_MAX_CODE_LENGTH, lengths);
+        canonical_code code;
+        assign_canonical_codes(lengths, HUFFMAN_BYTE_ALPHABET, code);
+        build_canonical_decoder(lengths, HUFFMAN_BYTE_ALPHABET, decoder);
+
+        payload.resize((data.size() * HUFFMAN_MAX_CODE_LENGTH + 7) / 8 + 8);
+        payload.resize(huffman_encode_bytes(data.data(), data.size(), code, payload.data()));
+    });
+    result.compressed_size = payload.size() + HUFFMAN_BYTE_ALPHABET;
+
+    vector<uint8_t> output(data.size());
+    result.decode_seconds = best_of(repeat, [&] {
+        result.verified = huffman_decode_bytes(payload.data(), payload.size(), decoder, output.data(), output.size());
+    });
+    result.verified = result.verified && output == data;
+    return result;
+}
+
+/**
+ * @brief Block container with one inline code per block
+ */
+bench_result bench_blocks(const vector<uint8_t> &data, const uint32_t block_size, const int repeat) {
+    bench_result result{"blocks"};
+    block_encoder_settings settings;
+    settings.block_size = block_size;
+    settings.thread_count = 1;
+
+    string container_bytes;
+    result.encode_seconds = best_of(repeat, [&] {
+        ostringstream stream;
+        block_container_writer writer(stream);
+        writer.begin(block_size, 0);
+        encode_blocks(data.data(), data.size(), settings, false, [&](const encoded_block &block,
+                                                                     const block_report *) {
+            writer.append(block);
+        });
+        writer.finish();
+        container_bytes = stream.str();
+    });
+    result.compressed_size = container_bytes.size();
+
+    const auto *bytes = reinterpret_cast<const uint8_t *>(container_bytes.data());
+    block_container container;
+    string error;
+    if (!parse_block_container(bytes, container_bytes.size(), container, error)) {
+        result.verified = false;
+        return result;
+    }
+    vector<uint8_t> output(data.size());
+    result.decode_seconds = best_of(repeat, [&] {
+        uint64_t offset = 0;
+        for (const block_index_entry &entry: container.blocks) {
+            result.verified = result.verified && decode_block(container, bytes, entry, nullptr,
+                                                              output.data() + offset, error);
+            offset += entry.raw_size;
+        }
+    });
+    result.verified = result.verified && output == data;
+    return result;
+}
+
+/**
+ * @brief Adaptive stream coded frame by frame from memory
+ */
+bench_result bench_adaptive(const vector<uint8_t> &data, const uint32_t frame_size, const int repeat) {
+    bench_result result{"adaptive"};
+    vector<uint8_t> stream;
+    result.encode_seconds = best_of(repeat, [&] {
+        stream.clear();
+        adaptive_write_header(stream, frame_size, ADAPTIVE_DECAY_SHIFT);
+        adaptive_model model;
+        model.reset(ADAPTIVE_DECAY_SHIFT);
+        for (size_t offset = 0; offset < data.size(); offset += frame_size) {
+            adaptive_encode_frame(model, data.data() + offset, min<size_t>(frame_size, data.size() - offset), stream);
+        }
+        stream.resize(stream.size() + ADAPTIVE_FRAME_HEADER_SIZE, 0); // ADAPTIVE_FRAME_END
+    });
+    result.compressed_size = stream.size();
+
+    vector<uint8_t> output;
+    result.decode_seconds = best_of(repeat, [&] {
+        output.clear();
+        output.reserve(data.size());
+        adaptive_model model;
+        model.reset(stream[10]);
+        vector<uint8_t> frame;
+        string error;
+        size_t position = ADAPTIVE_HEADER_SIZE;
+        while (stream[position] != ADAPTIVE_FRAME_END) {
+            const uint8_t *header = &stream[position];
+            const uint32_t payload_size = read_u32(header + 5);
+            if (!adaptive_decode_frame(model, header, header + ADAPTIVE_FRAME_HEADER_SIZE, frame, error)) {
+                result.verified = false;
+                return;
+            }
+            output.insert(output.end(), frame.begin(), frame.end());
+            position += ADAPTIVE_FRAME_HEADER_SIZE + payload_size;
+        }
+    });
+    result.verified = result.verified && output == data;
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t frame_size = ADAPTIVE_DEFAULT_FRAME_SIZE;
+    int repeat = 3;
+    const char *input_path = nullptr;
+    for (int index = 1; index < argc; index++) {
+        const string argument = argv[index];
+        try {
+            if (argument == "--frame-size" && index + 1 < argc) {
+                frame_size = static_cast<uint32_t>(stoul(argv[++index]));
+                continue;
+            }
+            if (argument == "--repeat" && index + 1 < argc) {
+                repeat = stoi(argv[++index]);
+                continue;
+            }
+        } catch (const exception &) {
+            input_path = nullptr;
+            break;
+        }
+        if (argument.rfind("--", 0) == 0 || input_path) {
+            input_path = nullptr;
+            break;
+        }
+        input_path = argv[index];
+    }
+    if (!input_path || frame_size == 0 || repeat < 1) {
+        cerr << "Usage: " << argv[0] << " [--frame-size <bytes>] [--repeat <n>] <input_file>" << endl;
+        return EXIT_FAILURE;
+    }
+
+    ifstream input(input_path, ios::binary);
+    if (!input) {
+        cerr << "Error: Cannot open input file " << input_path << endl;
+        return EXIT_FAILURE;
+    }
+    const vector<uint8_t> data{istreambuf_iterator(input), istreambuf_iterator<char>()};
+    if (data.empty()) {
+        cerr << "Error: Input file is empty" << endl;
+        return EXIT_FAILURE;
+    }
+
+    const bench_result results[] = {
+        bench_static(data, repeat),
+        bench_blocks(data, frame_size, repeat),
+        bench_adaptive(data, frame_size, repeat),
+    };
+
+    cout << left << setw(25) << "Input size: " << right << setw(20) << data.size() << " bytes" << endl;
+    cout << left << setw(25) << "Frame / block size: " << right << setw(20) << frame_size << " bytes" << endl;
+    cout << endl << left << setw(12) << "Mode" << right << setw(16) << "Compressed" << setw(10) << "Ratio"
+            << setw(14) << "Encode MB/s" << setw(14) << "Decode MB/s" << setw(10) << "Verified" << endl;
+
+    bool all_verified = true;
+    for (const bench_result &result: results) {
+        const auto mbps = [&](const double seconds) {
+            return seconds > 0 ? static_cast<double>(data.size()) / seconds / 1e6 : 0.0;
+        };
+        cout << left << setw(12) << result.name << right << setw(16) << result.compressed_size << setw(10) << fixed
+                << setprecision(4) << static_cast<double>(result.compressed_size) / data.size() << setw(14)
+                << setprecision(1) << mbps(result.encode_seconds) << setw(14) << mbps(result.decode_seconds)
+                << setw(10) << (result.verified ? "yes" : "NO") << endl;
+        all_verified = all_verified && result.verified;
+    }
+    return all_verified ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,339 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+
+#include "block_format.h"
+#include "canonical_huffman.h"
+#include "data_statistics.h"
+#include "worker_pool.h"
+
+/**
+ * @file huffman_analyze.cpp
+ * @brief Predicts how well a file will compress without compressing it
+ *
+ * Usage: huffman_analyze [--sample <fraction>] [--threads <n>] [--block-size <bytes>] <input_file>
+ *
+ * Reported figures:
+ * - Order-0 entropy and the order-1 (previous byte as context) conditional entropy
+ * - Predicted Huffman payload, computed like compress.cu's mem_offset
+ *   (Σ frequency × bit_sequence_length), plus the resulting GPU, legacy CPU
+ *   and block container file sizes
+ * - Run-length share: fraction of bytes inside runs of RUN_MIN_LENGTH or more
+ * - Stored-block fraction: blocks whose inline Huffman coding would not beat
+ *   storing them raw
+ *
+ * The histogram pass is split into blocks processed by all cores. With
+ * `--sample <fraction>` only part of the file is read from disk and the size
+ * predictions are scaled up to the full file: round(blocks x fraction) whole
+ * blocks spread evenly over the file, or, when that would be fewer than
+ * SAMPLE_MIN_BLOCKS, a slice of every block (at least SAMPLE_MIN_SLICE bytes),
+ * so that a small file with regions of different content is still covered.
+ */
+
+using namespace std;
+using namespace chrono;
+
+// Shortest run of identical bytes counted towards the run-length share
+#define RUN_MIN_LENGTH 4
+
+// Fewest whole blocks a sample consists of; below this every block contributes a slice
+#define SAMPLE_MIN_BLOCKS 16
+
+// Shortest slice read from a block in sliced sampling
+#define SAMPLE_MIN_SLICE 16384
+
+/*=============================================================================
+ * ANALYSIS STRUCTURES
+ *=============================================================================*/
+
+/**
+ * @struct analysis_segment
+ * @brief One analyzed block inside the loaded buffer
+ *
+ * has_context is false when the preceding byte in the buffer is not the
+ * preceding byte of the file (first block, or any block in sampled mode).
+ * block_length is the length of the file block the segment stands for; it
+ * exceeds length when only a slice of the block was read.
+ */
+struct analysis_segment {
+    size_t offset;
+    size_t length;
+    bool has_context;
+    size_t block_length;
+};
+
+/**
+ * @struct worker_statistics
+ * @brief Per-thread accumulators merged after the parallel pass
+ */
+struct worker_statistics {
+    vector<uint64_t> order0 = vector<uint64_t>(256, 0);
+    vector<uint64_t> order1 = vector<uint64_t>(256 * 256, 0); // [previous byte][byte]
+    uint64_t run_bytes = 0;
+};
+
+/**
+ * @brief Conditional entropy H(X | previous byte) in bits per byte
+ */
+double conditional_entropy(const vector<uint64_t> &order1) {
+    uint64_t total = 0;
+    double bits = 0.0;
+    for (size_t context = 0; context < 256; context++) {
+        const uint64_t *row = &order1[context * 256];
+        uint64_t context_total = 0;
+        for (size_t symbol = 0; symbol < 256; symbol++) context_total += row[symbol];
+        if (context_total == 0) continue;
+
+        total += context_total;
+        bits += histogram_entropy(row, 256) * static_cast<double>(context_total);
+    }
+    return total ? bits / static_cast<double>(total) : 0.0;
+}
+
+/**
+ * @brief Accumulates order-1 counts and run statistics for one segment
+ */
+void analyze_segment(const uint8_t *data, const analysis_segment &segment, worker_statistics &statistics) {
+    if (segment.length == 0) return;
+    const uint8_t *block = data + segment.offset;
+    size_t index = segment.has_context ? 0 : 1; // Without context the first byte has no known predecessor
+
+    uint64_t *order1 = statistics.order1.data();
+    size_t run_length = 1;
+    for (; index < segment.length; index++) {
+        const uint8_t previous = index ? block[index - 1] : block[-1];
+        order1[previous * 256 + block[index]]++;
+
+        if (index > 0 && block[index] == previous) {
+            run_length++;
+        } else {
+            if (run_length >= RUN_MIN_LENGTH) statistics.run_bytes += run_length;
+            run_length = 1;
+        }
+    }
+    if (run_length >= RUN_MIN_LENGTH) statistics.run_bytes += run_length;
+}
+
+/*=============================================================================
+ * MAIN ANALYSIS PROGRAM
+ *=============================================================================*/
+
+int main(int argc, char *argv[]) {
+    /*=========================================================================
+     * ARGUMENT PARSING
+     *=========================================================================*/
+
+    double sample_fraction = 1.0;
+    unsigned thread_count = default_thread_count();
+    size_t block_size = DEFAULT_BLOCK_SIZE;
+    const char *input_path = nullptr;
+
+    bool valid = true;
+    for (int index = 1; index < argc && valid; index++) {
+        const string argument = argv[index];
+        try {
+            if (argument == "--sample" && index + 1 < argc) {
+                sample_fraction = stod(argv[++index]);
+                valid = sample_fraction > 0.0 && sample_fraction <= 1.0;
+            } else if (argument == "--threads" && index + 1 < argc) {
+                thread_count = static_cast<unsigned>(stoul(argv[++index]));
+                valid = thread_count > 0;
+            } else if (argument == "--block-size" && index + 1 < argc) {
+                block_size = stoul(argv[++index]);
+                valid = block_size > 0;
+            } else if (argument.rfind("--", 0) != 0 && !input_path) {
+                input_path = argv[index];
+            } else {
+                valid = false;
+            }
+        } catch (const exception &) {
+            valid = false;
+        }
+    }
+
+    if (!valid || !input_path) {
+        cerr << "Usage: " << argv[0] << " [--sample <fraction>] [--threads <n>] [--block-size <bytes>]"
+                << " <input_file>" << endl;
+        return EXIT_FAILURE;
+    }
+
+    /*=========================================================================
+     * INPUT LOADING (FULL OR SAMPLED)
+     *=========================================================================*/
+
+    ifstream input_file(input_path, ios::binary);
+    if (!input_file) {
+        cerr << "Error: Cannot open input file " << input_path << endl;
+        return EXIT_FAILURE;
+    }
+    input_file.seekg(0, ios::end);
+    const auto file_size = static_cast<size_t>(input_file.tellg());
+    input_file.seekg(0, ios::beg);
+
+    const auto start = high_resolution_clock::now();
+
+    const size_t block_count = (file_size + block_size - 1) / block_size;
+    const size_t sampled_blocks = max<size_t>(1, static_cast<size_t>(llround(static_cast<double>(block_count) *
+                                                                             sample_fraction)));
+
+    vector<uint8_t> data;
+    vector<analysis_segment> segments;
+    const auto read_segment = [&](const size_t offset, const size_t length, const size_t block_length) {
+        segments.push_back({data.size(), length, false, block_length});
+        data.resize(data.size() + length);
+        input_file.seekg(static_cast<streamoff>(offset));
+        input_file.read(reinterpret_cast<char *>(&data[data.size() - length]), static_cast<streamsize>(length));
+    };
+    if (sampled_blocks >= block_count) {
+        data.resize(file_size);
+        input_file.read(reinterpret_cast<char *>(data.data()), static_cast<streamsize>(file_size));
+        for (size_t block = 0; block < block_count; block++) {
+            const size_t offset = block * block_size;
+            const size_t length = min(block_size, file_size - offset);
+            segments.push_back({offset, length, offset > 0, length});
+        }
+    } else if (sampled_blocks >= SAMPLE_MIN_BLOCKS) {
+        // Whole blocks, each from the middle of an equal share of the file
+        for (size_t sample = 0; sample < sampled_blocks; sample++) {
+            const size_t offset = (2 * sample + 1) * block_count / (2 * sampled_blocks) * block_size;
+            const size_t length = min(block_size, file_size - offset);
+            read_segment(offset, length, length);
+        }
+    } else {
+        // Too few blocks to spread a sample over: the start of every block instead
+        for (size_t block = 0; block < block_count; block++) {
+            const size_t offset = block * block_size;
+            const size_t block_length = min(block_size, file_size - offset);
+            const auto slice = static_cast<size_t>(ceil(static_cast<double>(block_length) * sample_fraction));
+            read_segment(offset, min(block_length, max<size_t>(slice, SAMPLE_MIN_SLICE)), block_length);
+        }
+    }
+    input_file.close();
+
+    const auto loaded = high_resolution_clock::now();
+
+    /*=========================================================================
+     * PARALLEL HISTOGRAM PASS
+     *=========================================================================*/
+
+    const unsigned workers = max(1u, min<unsigned>(thread_count, static_cast<unsigned>(segments.size())));
+    vector<worker_statistics> statistics(workers);
+    vector<uint64_t> inline_block_size(segments.size(), 0);
+
+    run_parallel(segments.size(), workers, [&](const size_t index, const unsigned worker) {
+        const analysis_segment &segment = segments[index];
+        uint64_t histogram[256] = {};
+        accumulate_byte_histogram(&data[segment.offset], segment.length, histogram);
+        for (int symbol = 0; symbol < 256; symbol++) statistics[worker].order0[symbol] += histogram[symbol];
+
+        analyze_segment(data.data(), segment, statistics[worker]);
+
+        // What this block would cost with its own inline code (block container), a slice's payload scaled up
+        uint8_t lengths[256];
+        build_code_lengths(histogram, 256, HUFFMAN_MAX_CODE_LENGTH, lengths);
+        const double payload_bits = static_cast<double>(predicted_code_bits(histogram, lengths, 256)) *
+                                    static_cast<double>(segment.block_length) / static_cast<double>(segment.length);
+        inline_block_size[index] = BLOCK_INLINE_TABLE_SIZE + static_cast<uint64_t>(ceil(payload_bits / 8.0));
+    });
+
+    worker_statistics total;
+    for (const worker_statistics &worker: statistics) {
+        for (size_t symbol = 0; symbol < 256; symbol++) total.order0[symbol] += worker.order0[symbol];
+        for (size_t pair = 0; pair < 256 * 256; pair++) total.order1[pair] += worker.order1[pair];
+        total.run_bytes += worker.run_bytes;
+    }
+
+    /*=========================================================================
+     * SIZE PREDICTIONS
+     *=========================================================================*/
+
+    const size_t analyzed_bytes = data.size();
+    const double scale = analyzed_bytes ? static_cast<double>(file_size) / static_cast<double>(analyzed_bytes) : 0.0;
+
+    // Whole-file Huffman code, as built by the GPU and legacy CPU compressors
+    uint8_t lengths[256];
+    build_code_lengths(total.order0.data(), 256, HUFFMAN_LENGTH_LIMIT, lengths);
+    const uint64_t huffman_bits = predicted_code_bits(total.order0.data(), lengths, 256);
+    const auto payload_bytes = static_cast<uint64_t>(ceil(static_cast<double>(huffman_bits) * scale / 8.0));
+
+    size_t distinct_symbols = 0;
+    for (const uint64_t count: total.order0) distinct_symbols += count != 0;
+
+    // GPU: 4-byte length + 1024-byte frequency table
+    const uint64_t gpu_size = 1028 + payload_bytes;
+    // Legacy CPU: 8-byte size, tree (1 byte per internal node, 2 per leaf), '*', padding byte
+    const uint64_t legacy_cpu_size = 8 + (distinct_symbols ? 3 * distinct_symbols - 1 : 0) + 2 + payload_bytes;
+
+    // Block container: fixed header/trailer plus per block header, index entry and cheaper mode
+    size_t stored_blocks = 0;
+    uint64_t stored_bytes = 0;
+    uint64_t represented_bytes = 0;
+    double container_blocks = 0.0;
+    for (size_t index = 0; index < segments.size(); index++) {
+        const uint64_t raw = segments[index].block_length;
+        represented_bytes += raw;
+        if (raw <= inline_block_size[index]) {
+            stored_blocks++;
+            stored_bytes += raw;
+        }
+        container_blocks += static_cast<double>(BLOCK_HEADER_SIZE + BLOCK_INDEX_ENTRY_SIZE +
+                                                min(raw, inline_block_size[index]));
+    }
+    const double block_scale = represented_bytes ? static_cast<double>(file_size) /
+                                                   static_cast<double>(represented_bytes) : 0.0;
+    const auto container_size = static_cast<uint64_t>(BLOCK_FILE_HEADER_SIZE + BLOCK_HEADER_SIZE +
+                                                      BLOCK_TRAILER_SIZE + container_blocks * block_scale);
+
+    const double order0 = histogram_entropy(total.order0.data(), 256);
+    const double order1 = conditional_entropy(total.order1);
+
+    const auto end = high_resolution_clock::now();
+
+    /*=========================================================================
+     * REPORT
+     *=========================================================================*/
+
+    auto percent = [](const double part, const double whole) { return whole > 0 ? 100.0 * part / whole : 0.0; };
+    auto ratio = [&](const uint64_t size) { return file_size ? static_cast<double>(size) / file_size : 0.0; };
+
+    cout << fixed << setprecision(3);
+    cout << left << setw(32) << "Input file size: " << right << setw(20) << file_size << "  B" << endl;
+    cout << left << setw(32) << "Analyzed bytes: " << right << setw(20) << analyzed_bytes << "  B ("
+            << setprecision(1) << percent(static_cast<double>(analyzed_bytes), static_cast<double>(file_size))
+            << "%)" << setprecision(3) << endl;
+    cout << left << setw(32) << "Distinct byte values: " << right << setw(20) << distinct_symbols << endl;
+    cout << left << setw(32) << "Order-0 entropy: " << right << setw(20) << order0 << "  bits/byte" << endl;
+    cout << left << setw(32) << "Order-1 entropy: " << right << setw(20) << order1 << "  bits/byte" << endl;
+    cout << left << setw(32) << "Predicted order-1 gain: " << right << setw(20)
+            << percent(order0 - order1, order0) << "  %" << endl;
+    cout << left << setw(32) << "Huffman payload: " << right << setw(20) << payload_bytes << "  B" << endl;
+    cout << left << setw(32) << "Predicted GPU file: " << right << setw(20) << gpu_size << "  B (ratio "
+            << ratio(gpu_size) << ")" << endl;
+    cout << left << setw(32) << "Predicted CPU legacy file: " << right << setw(20) << legacy_cpu_size
+            << "  B (ratio " << ratio(legacy_cpu_size) << ")" << endl;
+    cout << left << setw(32) << "Predicted block container: " << right << setw(20) << container_size
+            << "  B (ratio " << ratio(container_size) << ")" << endl;
+    cout << left << setw(32) << "Run-length share: " << right << setw(20)
+            << percent(static_cast<double>(total.run_bytes), static_cast<double>(analyzed_bytes)) << "  %" << endl;
+    cout << left << setw(32) << "Stored-block fraction: " << right << setw(20)
+            << percent(static_cast<double>(stored_bytes), static_cast<double>(represented_bytes)) << "  % ("
+            << stored_blocks << " of " << segments.size() << " blocks)" << endl;
+
+    const double analysis_seconds = duration<double>(end - loaded).count();
+    cout << left << setw(32) << "Analysis throughput: " << right << setw(20) << setprecision(1)
+            << (analysis_seconds > 0 ? static_cast<double>(analyzed_bytes) / analysis_seconds / 1e6 : 0.0)
+            << "  MB/s (" << workers << " threads)" << endl;
+
+    const auto total_duration = duration<double>(end - start);
+    const int seconds = static_cast<int>(total_duration.count());
+    const int milliseconds = static_cast<int>((total_duration.count() - seconds) * 1000);
+    cout << left << setw(25) << "Execution time: " << right << setw(15) << seconds << "s" << setw(5)
+            << milliseconds << "ms" << endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,313 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <algorithm>
+#include <regex>
+#include <unistd.h>
+
+#include "block_format.h"
+#include "tuning_profile.h"
+#include "worker_pool.h"
+
+/**
+ * @file huffman_autotune.cpp
+ * @brief Benchmarks the local machine and writes the profile the tools load by default
+ *
+ * Usage: huffman_autotune [--profile <path>] [--sample-bytes <n>] [--repeat <n>] [--gpu <huffman_compression>]
+ *                         <sample_file_or_directory>...
+ *
+ * Search:
+ * 1. Up to --sample-bytes (default 64 MiB) of the sample files are loaded
+ * 2. Every block size in BLOCK_SIZE_CANDIDATES is combined with thread counts
+ *    1, 2, 4, ... up to the core count, and the sample is block-encoded
+ *    --repeat times (best run counts)
+ * 3. Block sizes whose output is more than RATIO_TOLERANCE larger than the
+ *    best result are discarded; the fastest remaining setting wins
+ * 4. With --gpu, the GPU compressor is run on the sample once per candidate
+ *    kernel chunk size (passed through a temporary profile) and the backend
+ *    with the higher throughput is recorded
+ *
+ * The measurements behind every choice are written as comments into the
+ * profile, and the compressors print which settings came from it.
+ */
+
+using namespace std;
+using namespace chrono;
+namespace fs = std::filesystem;
+
+// Tolerated compressed-size loss when trading ratio for speed (1%)
+#define RATIO_TOLERANCE 0.01
+
+static const uint32_t BLOCK_SIZE_CANDIDATES[] = {
+    64 * 1024, 128 * 1024, 256 * 1024, 512 * 1024, 1024 * 1024, 4 * 1024 * 1024
+};
+
+// GPU kernel chunk caps tried with --gpu (0 = all free memory, the built-in behavior)
+static const uint64_t GPU_CHUNK_CANDIDATES[] = {0, 256ull << 20, 64ull << 20, 16ull << 20};
+
+/**
+ * @struct tuning_result
+ * @brief One measured CPU configuration
+ */
+struct tuning_result {
+    uint32_t block_size;
+    unsigned threads;
+    uint64_t compressed_size;
+    double mbps;
+};
+
+/**
+ * @brief Reads sample files (directories recursively) until `limit` bytes are loaded
+ */
+void load_samples(const fs::path &path, const size_t limit, vector<uint8_t> &data) {
+    if (data.size() >= limit) return;
+    if (fs::is_directory(path)) {
+        for (const auto &entry: fs::recursive_directory_iterator(path)) {
+            if (entry.is_regular_file()) load_samples(entry.path(), limit, data);
+        }
+        return;
+    }
+
+    ifstream input(path, ios::binary);
+    if (!input) return;
+    input.seekg(0, ios::end);
+    const auto size = min(static_cast<size_t>(input.tellg()), limit - data.size());
+    input.seekg(0, ios::beg);
+
+    data.resize(data.size() + size);
+    input.read(reinterpret_cast<char *>(data.data() + data.size() - size), static_cast<streamsize>(size));
+}
+
+/**
+ * @brief L2 cache size of cpu0 from sysfs, for the report (0 if unknown)
+ */
+size_t l2_cache_size() {
+    ifstream input("/sys/devices/system/cpu/cpu0/cache/index2/size");
+    size_t size = 0;
+    char unit = 0;
+    if (!(input >> size)) return 0;
+    input >> unit;
+    if (unit == 'K') size *= 1024;
+    if (unit == 'M') size *= 1024 * 1024;
+    return size;
+}
+
+/**
+ * @brief Encodes the sample `repeat` times and keeps the fastest run
+ */
+tuning_result measure_cpu(const vector<uint8_t> &data, const uint32_t block_size, const unsigned threads,
+                          const int repeat) {
+    block_encoder_settings settings;
+    settings.block_size = block_size;
+    settings.thread_count = threads;
+
+    tuning_result result{block_size, threads, 0, 0.0};
+    double best_seconds = 0.0;
+    for (int run = 0; run < repeat; run++) {
+        uint64_t compressed_size = 0;
+        const auto start = steady_clock::now();
+        encode_blocks(data.data(), data.size(), settings, false,
+                      [&](const encoded_block &block, const block_report *) {
+                          compressed_size += block.bytes.size();
+                      });
+        const double seconds = duration<double>(steady_clock::now() - start).count();
+
+        result.compressed_size = compressed_size;
+        if (run == 0 || seconds < best_seconds) best_seconds = seconds;
+    }
+    result.mbps = best_seconds > 0 ? static_cast<double>(data.size()) / best_seconds / 1e6 : 0.0;
+    return result;
+}
+
+/**
+ * @brief Runs the GPU compressor once and returns its reported execution time
+ * @return Seconds, or a negative value if the run failed
+ */
+double run_gpu_compressor(const string &binary, const string &input, const string &output) {
+    const string command = "'" + binary + "' '" + input + "' '" + output + "' 2>&1";
+    FILE *pipe = popen(command.c_str(), "r");
+    if (!pipe) return -1.0;
+
+    string text;
+    char buffer[512];
+    while (fgets(buffer, sizeof(buffer), pipe)) text += buffer;
+    if (pclose(pipe) != 0) return -1.0;
+
+    // Same pattern the GUI uses to scrape timings
+    smatch match;
+    if (!regex_search(text, match, regex(R"(Execution time:\s+(\d+)s\s+(\d+)ms)"))) return -1.0;
+    return stoi(match[1]) + stoi(match[2]) / 1000.0;
+}
+
+int main(int argc, char *argv[]) {
+    /*=========================================================================
+     * ARGUMENT PARSING
+     *=========================================================================*/
+
+    string profile_path = default_profile_path();
+    size_t sample_bytes = 64 << 20;
+    int repeat = 3;
+    string gpu_binary;
+    vector<string> sample_paths;
+
+    bool valid = true;
+    for (int index = 1; index < argc && valid; index++) {
+        const string argument = argv[index];
+        const bool has_value = index + 1 < argc;
+        try {
+            if (argument == "--profile" && has_value) profile_path = argv[++index];
+            else if (argument == "--sample-bytes" && has_value) sample_bytes = stoull(argv[++index]);
+            else if (argument == "--repeat" && has_value) repeat = stoi(argv[++index]);
+            else if (argument == "--gpu" && has_value) gpu_binary = argv[++index];
+            else if (argument.rfind("--", 0) != 0) sample_paths.push_back(argument);
+            else valid = false;
+        } catch (const exception &) {
+            valid = false;
+        }
+    }
+
+    if (!valid || sample_paths.empty() || sample_bytes == 0 || repeat < 1 || profile_path.empty()) {
+        cerr << "Usage: " << argv[0] << " [--profile <path>] [--sample-bytes <n>] [--repeat <n>]"
+                << " [--gpu <huffman_compression>] <sample_file_or_directory>..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<uint8_t> data;
+    for (const string &path: sample_paths) {
+        if (!fs::exists(path)) {
+            cerr << "Error: Sample " << path << " does not exist" << endl;
+            return EXIT_FAILURE;
+        }
+        load_samples(path, sample_bytes, data);
+    }
+    if (data.empty()) {
+        cerr << "Error: No sample data" << endl;
+        return EXIT_FAILURE;
+    }
+
+    const unsigned cores = default_thread_count();
+    cout << left << setw(25) << "Sample size: " << right << setw(20) << data.size() << "  B" << endl;
+    cout << left << setw(25) << "Hardware threads: " << right << setw(20) << cores << endl;
+    if (const size_t l2 = l2_cache_size()) {
+        cout << left << setw(25) << "L2 cache: " << right << setw(20) << l2 / 1024 << "  KiB" << endl;
+    }
+
+    /*=========================================================================
+     * CPU SEARCH
+     *=========================================================================*/
+
+    vector<unsigned> thread_candidates;
+    for (unsigned threads = 1; threads < cores; threads *= 2) thread_candidates.push_back(threads);
+    thread_candidates.push_back(cores);
+
+    vector<tuning_result> results;
+    cout << endl << setw(12) << "Block size" << setw(10) << "Threads" << setw(16) << "Compressed" << setw(12)
+            << "MB/s" << endl;
+    for (const uint32_t block_size: BLOCK_SIZE_CANDIDATES) {
+        // Blocks far larger than the sample would all measure the same single block
+        if (block_size > data.size() && block_size != BLOCK_SIZE_CANDIDATES[0]) break;
+
+        for (const unsigned threads: thread_candidates) {
+            const tuning_result result = measure_cpu(data, block_size, threads, repeat);
+            results.push_back(result);
+            cout << setw(12) << result.block_size << setw(10) << result.threads << setw(16)
+                    << result.compressed_size << setw(12) << fixed << setprecision(1) << result.mbps << endl;
+        }
+    }
+
+    uint64_t best_size = UINT64_MAX;
+    for (const tuning_result &result: results) best_size = min(best_size, result.compressed_size);
+
+    const tuning_result *best = nullptr;
+    for (const tuning_result &result: results) {
+        if (static_cast<double>(result.compressed_size) > static_cast<double>(best_size) * (1.0 + RATIO_TOLERANCE)) {
+            continue;
+        }
+        if (!best || result.mbps > best->mbps) best = &result;
+    }
+
+    tuning_profile profile;
+    profile.block_size = best->block_size;
+    profile.threads = best->threads;
+    profile.backend = "cpu";
+    profile.cpu_mbps = best->mbps;
+
+    ostringstream reasons;
+    reasons << fixed << setprecision(1);
+    reasons << "Written by huffman_autotune on " << data.size() << " sample bytes, " << cores << " hardware threads"
+            << endl;
+    reasons << "block_size/threads: fastest setting (" << best->mbps << " MB/s) whose output is within "
+            << RATIO_TOLERANCE * 100 << "% of the smallest (" << best_size << " B)" << endl;
+
+    /*=========================================================================
+     * GPU SEARCH (OPTIONAL)
+     *=========================================================================*/
+
+    if (!gpu_binary.empty()) {
+        const fs::path scratch = fs::temp_directory_path() / ("huffman_autotune_" + to_string(getpid()));
+        fs::create_directories(scratch);
+        const string sample_file = (scratch / "sample").string();
+        const string output_file = (scratch / "output").string();
+        const string chunk_profile = (scratch / "profile").string();
+        ofstream(sample_file, ios::binary).write(reinterpret_cast<const char *>(data.data()),
+                                                 static_cast<streamsize>(data.size()));
+
+        // The child reads its chunk cap from the temporary profile
+        setenv("HUFFMAN_PROFILE", chunk_profile.c_str(), 1);
+
+        double best_gpu_seconds = -1.0;
+        for (const uint64_t chunk: GPU_CHUNK_CANDIDATES) {
+            tuning_profile candidate;
+            candidate.gpu_chunk_bytes = chunk;
+            if (string error; !save_tuning_profile(chunk_profile, candidate, "", error)) {
+                cerr << "Error: " << error << endl;
+                return EXIT_FAILURE;
+            }
+
+            const double seconds = run_gpu_compressor(gpu_binary, sample_file, output_file);
+            cout << left << setw(25) << ("GPU chunk " + (chunk ? to_string(chunk >> 20) + " MB: " : "free VRAM: "))
+                    << right << setw(20);
+            if (seconds < 0) {
+                cout << "failed" << endl;
+                continue;
+            }
+            cout << fixed << setprecision(3) << seconds << "  s" << endl;
+
+            if (best_gpu_seconds < 0 || seconds < best_gpu_seconds) {
+                best_gpu_seconds = seconds;
+                profile.gpu_chunk_bytes = chunk;
+            }
+        }
+        fs::remove_all(scratch);
+
+        if (best_gpu_seconds >= 0) {
+            // Millisecond resolution: treat a 0 ms run as 1 ms
+            profile.gpu_mbps = static_cast<double>(data.size()) / max(best_gpu_seconds, 0.001) / 1e6;
+            if (profile.gpu_mbps > profile.cpu_mbps) profile.backend = "gpu";
+            reasons << "gpu_chunk_bytes: fastest GPU run (" << profile.gpu_mbps << " MB/s)" << endl;
+        } else {
+            reasons << "GPU compressor failed on every run; backend left at cpu" << endl;
+        }
+        reasons << "backend: " << profile.backend << " had the higher compression throughput" << endl;
+    }
+
+    /*=========================================================================
+     * PROFILE OUTPUT
+     *=========================================================================*/
+
+    if (string error; !save_tuning_profile(profile_path, profile, reasons.str(), error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    cout << endl << reasons.str();
+    cout << left << setw(25) << "Profile written: " << profile_path << endl;
+    return EXIT_SUCCESS;
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <unordered_map>
@@ -8,6 +9,21 @@
 #include <cstring>
 #include <functional>
 #include <iomanip>
+#include <string>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "adaptive_stream.h"
+#include "block_format.h"
+#include "block_scheduler.h"
+#include "incremental_update.h"
+#include "numa_topology.h"
+#include "sparse_file.h"
+#include "striped_container.h"
+#include "progress_reporter.h"
+#include "tuning_profile.h"
+#include "worker_pool.h"
 
 
 /**
@@ -31,6 +47,52 @@
  * 5. Compressed data (variable length)
  *
  * This format enables decompression without external metadata files.
+ *
+ * Passing `--block-size`, `--tables` or `--threads` switches to the indexed
+ * block container described in block_format.h instead, coded in parallel;
+ * so does an autotune profile with a block size or thread count, unless
+ * `--no-profile` is given (see tuning_profile.h).
+ * With `--tables` the blocks reference codes trained by huffman_train rather
+ * than carrying their own, and the same table file must be given to the
+ * decompressor. `--max-threads`, `--max-rate` and `--cpu-budget` throttle the
+ * block coding for background runs on shared hosts (see resource_governor.h).
+ * `--backends cpu:4,cpu:2` shares the blocks between several coding backends,
+ * balanced by their measured throughput (see block_scheduler.h). `--numa`
+ * places the input on the NUMA nodes stripe by stripe and codes each block
+ * with workers pinned to the node holding it (see numa_topology.h).
+ *
+ * `--previous <archive>` re-compresses incrementally: blocks whose checksum
+ * matches a block of the previous container are copied from it instead of
+ * being coded again, also after insertions that shift the data by any number
+ * of bytes (see incremental_update.h).
+ *
+ * The block container path reads sparse inputs hole-aware (SEEK_DATA /
+ * SEEK_HOLE, see sparse_file.h): holes are never read and, like any other
+ * all-zero block, are recorded as header-only zero blocks.
+ *
+ * `--symbol-width 16` reads the input as little-endian uint16 samples: every
+ * block also tries a code over the 16-bit values it contains (sparse table,
+ * two-level decode tables; see canonical_huffman.h) and keeps it when smaller.
+ *
+ * `--engines stored,rle,huffman,shuffle` (or `all`) assigns every block the
+ * engine that does best on a trial encoding of a sample of it, under the
+ * `--objective ratio|balanced|speed|<MB/s>` trade-off (see block_engines.h);
+ * `--shuffle-width 2|4|8` sets the element size of the byte-shuffle engine.
+ *
+ * `--stripes a.hbk,b.hbk` splits the container over several stripe files,
+ * each written by its own thread (e.g. one per NVMe drive), and writes a
+ * manifest to the output path; `--stripe-policy round-robin|queue-depth`
+ * picks how blocks are dealt out (see striped_container.h).
+ *
+ * `--explain <report>` writes per-block diagnostics (see block_report.h) in
+ * either format; the tree format is reported as a single block.
+ *
+ * `--progress <path>` streams JSON-lines progress events (stage, bytes,
+ * instantaneous MB/s; see progress_reporter.h) while the file is coded.
+ *
+ * `--adaptive` codes the input in one pass as it arrives instead (see
+ * adaptive_stream.h); "-" reads stdin or writes stdout, so the compressor can
+ * sit in a pipe. `--block-size` sets the frame size.
  */
 
 using namespace std;
@@ -166,14 +228,531 @@ void serialize_tree(const node *root, ofstream &output) {
     }
 }
 
+/*=============================================================================
+ * COMMAND LINE OPTIONS
+ *=============================================================================*/
+
+/**
+ * @struct compression_options
+ * @brief Parsed command line of the CPU compressor
+ *
+ * - tables_path: trained table set (huffman_train output), enables shared codes
+ * - table_id: force one table from the set instead of choosing per block
+ * - block_size: block size of the container; 0 (and no tables/threads) keeps the legacy tree format
+ * - explain_path: per-block diagnostics report (CSV, or JSON for *.json)
+ * - progress_path: progress event stream ("-" for stderr)
+ * - threads: block coding workers; 0 uses the profile or all cores
+ * - backends: --backends list for the heterogeneous scheduler; null codes with one worker group
+ * - numa: one pinned backend per NUMA node and node-local input placement
+ * - adaptive: one-pass adaptive stream (block_size is the frame size)
+ * - symbol_width: 16 adds the uint16 sample code as a per-block candidate
+ * - engines / objective_mbps / shuffle_width: per-block engine selection (0 engines: Huffman candidates only)
+ * - stripe_paths / stripe_assignment: --stripes output; the output path receives the stripe manifest
+ * - previous_path: previous container of the same input for an incremental run
+ * - use_profile: false with --no-profile (ignore the autotune profile)
+ * - profile: the autotune profile, loaded by main(); a block size or thread count in it selects the container
+ * - limits: --max-threads / --max-rate / --cpu-budget for background runs
+ */
+struct compression_options {
+    const char *input_path = nullptr;
+    const char *output_path = nullptr;
+    const char *tables_path = nullptr;
+    const char *explain_path = nullptr;
+    const char *progress_path = nullptr;
+    const char *backends = nullptr;
+    const char *previous_path = nullptr;
+    int table_id = -1;
+    uint32_t block_size = 0;
+    unsigned threads = 0;
+    bool use_profile = true;
+    bool numa = false;
+    bool adaptive = false;
+    unsigned symbol_width = 8;
+    unsigned engines = 0;
+    double objective_mbps = 0;
+    unsigned shuffle_width = DEFAULT_SHUFFLE_WIDTH;
+    vector<string> stripe_paths;
+    stripe_policy stripe_assignment = STRIPE_ROUND_ROBIN;
+    resource_limits limits;
+    tuning_profile profile;
+
+    [[nodiscard]] bool use_block_container() const {
+        return block_size != 0 || tables_path != nullptr || threads != 0 || backends != nullptr || numa ||
+               previous_path != nullptr || symbol_width != 8 || engines != 0 || !stripe_paths.empty() ||
+               profile.block_size != 0 || profile.threads != 0 || limits.max_threads != 0 ||
+               limits.max_rate_mbps > 0 || limits.cpu_budget > 0;
+    }
+};
+
+/**
+ * @brief Parses `[options] <input_file> <output_file>`
+ * @return false on unknown options, missing values or a wrong positional count
+ */
+bool parse_arguments(const int argc, char *argv[], compression_options &options) {
+    int positional = 0;
+    for (int index = 1; index < argc; index++) {
+        const string argument = argv[index];
+        const bool has_value = index + 1 < argc;
+
+        try {
+            if (argument == "--tables" && has_value) {
+                options.tables_path = argv[++index];
+                continue;
+            }
+            if (argument == "--explain" && has_value) {
+                options.explain_path = argv[++index];
+                continue;
+            }
+            if (argument == "--progress" && has_value) {
+                options.progress_path = argv[++index];
+                continue;
+            }
+            if (argument == "--previous" && has_value) {
+                options.previous_path = argv[++index];
+                continue;
+            }
+            if (argument == "--backends" && has_value) {
+                options.backends = argv[++index];
+                continue;
+            }
+            if (argument == "--table-id" && has_value) {
+                options.table_id = stoi(argv[++index]);
+                continue;
+            }
+            if (argument == "--threads" && has_value) {
+                options.threads = static_cast<unsigned>(stoul(argv[++index]));
+                if (options.threads == 0) return false;
+                continue;
+            }
+            if (argument == "--numa") {
+                options.numa = true;
+                continue;
+            }
+            if (argument == "--adaptive") {
+                options.adaptive = true;
+                continue;
+            }
+            if (argument == "--no-profile") {
+                options.use_profile = false;
+                continue;
+            }
+            if (argument == "--max-threads" && has_value) {
+                options.limits.max_threads = static_cast<unsigned>(stoul(argv[++index]));
+                if (options.limits.max_threads == 0) return false;
+                continue;
+            }
+            if (argument == "--max-rate" && has_value) {
+                options.limits.max_rate_mbps = stod(argv[++index]);
+                if (options.limits.max_rate_mbps <= 0) return false;
+                continue;
+            }
+            if (argument == "--cpu-budget" && has_value) {
+                options.limits.cpu_budget = stod(argv[++index]);
+                if (options.limits.cpu_budget <= 0) return false;
+                continue;
+            }
+            if (argument == "--block-size" && has_value) {
+                options.block_size = static_cast<uint32_t>(stoul(argv[++index]));
+                if (options.block_size == 0) return false;
+                continue;
+            }
+            if (argument == "--symbol-width" && has_value) {
+                options.symbol_width = static_cast<unsigned>(stoul(argv[++index]));
+                if (options.symbol_width != 8 && options.symbol_width != 16) return false;
+                continue;
+            }
+            if (argument == "--engines" && has_value) {
+                options.engines = parse_engine_list(argv[++index]);
+                if (options.engines == 0) return false;
+                continue;
+            }
+            if (argument == "--objective" && has_value) {
+                if (!parse_objective(argv[++index], options.objective_mbps)) return false;
+                continue;
+            }
+            if (argument == "--stripes" && has_value) {
+                // Comma-separated stripe files, typically one per device
+                const string list = argv[++index];
+                for (size_t begin = 0; begin <= list.size();) {
+                    const size_t comma = min(list.find(',', begin), list.size());
+                    if (comma == begin) return false;
+                    options.stripe_paths.push_back(list.substr(begin, comma - begin));
+                    begin = comma + 1;
+                }
+                continue;
+            }
+            if (argument == "--stripe-policy" && has_value) {
+                if (!parse_stripe_policy(argv[++index], options.stripe_assignment)) return false;
+                continue;
+            }
+            if (argument == "--shuffle-width" && has_value) {
+                options.shuffle_width = static_cast<unsigned>(stoul(argv[++index]));
+                const unsigned width = options.shuffle_width;
+                if (width != 2 && width != 4 && width != 8) return false;
+                continue;
+            }
+        } catch (const exception &) {
+            return false; // Non-numeric value
+        }
+
+        if (argument.rfind("--", 0) == 0) {
+            return false;
+        } else if (positional == 0) {
+            options.input_path = argv[index];
+            positional++;
+        } else if (positional == 1) {
+            options.output_path = argv[index];
+            positional++;
+        } else {
+            return false;
+        }
+    }
+    if (options.adaptive && (options.tables_path || options.threads || options.backends || options.numa ||
+                             options.previous_path || options.symbol_width != 8 || options.engines ||
+                             !options.stripe_paths.empty())) {
+        return false; // The adaptive stream is sequential by construction
+    }
+    if (options.previous_path && (options.backends || options.numa)) {
+        return false; // Incremental runs use a single worker group
+    }
+    return positional == 2 && !(options.numa && options.backends); // --numa builds its own backends
+}
+
+/*=============================================================================
+ * ADAPTIVE STREAM COMPRESSION
+ *=============================================================================*/
+
+/**
+ * @brief Compresses input to output as an adaptive stream, frame by frame as data arrives
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ *
+ * Statistics go to stderr when the stream itself is written to stdout.
+ */
+int compress_adaptive(const compression_options &options) {
+    const auto start = high_resolution_clock::now();
+    const bool from_stdin = strcmp(options.input_path, "-") == 0;
+    const bool to_stdout = strcmp(options.output_path, "-") == 0;
+
+    const int input = from_stdin ? STDIN_FILENO : open(options.input_path, O_RDONLY);
+    if (input < 0) {
+        cerr << "Error: Cannot open input file " << options.input_path << endl;
+        return EXIT_FAILURE;
+    }
+    const int output = to_stdout ? STDOUT_FILENO : open(options.output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (output < 0) {
+        cerr << "Error: Cannot create output file " << options.output_path << endl;
+        if (!from_stdin) close(input);
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t frame_size = options.block_size ? options.block_size : ADAPTIVE_DEFAULT_FRAME_SIZE;
+    adaptive_statistics stats;
+    string error;
+    const bool success = adaptive_compress_stream(input, output, frame_size, stats, error);
+    if (!from_stdin) close(input);
+    if (!to_stdout && close(output) != 0 && success) {
+        error = string("Cannot close output file: ") + strerror(errno);
+    }
+    if (!success || !error.empty()) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto duration = std::chrono::duration<double>(high_resolution_clock::now() - start);
+    const int seconds = static_cast<int>(duration.count());
+    const int milliseconds = static_cast<int>((duration.count() - seconds) * 1000);
+    const double ratio = stats.raw_bytes ? static_cast<double>(stats.stream_bytes) / stats.raw_bytes : 0.0;
+
+    ostream &report = to_stdout ? cerr : cout;
+    report << "CPU Compression completed successfully!" << endl;
+    report << left << setw(25) << "Frames: " << right << setw(20) << stats.frames
+            << " (" << stats.stored_frames << " stored)" << endl;
+    report << left << setw(25) << "Compression ratio: " << right << setw(20) << fixed << setprecision(3)
+            << ratio << endl;
+    report << left << setw(25) << "Max flush latency: " << right << setw(18) << setprecision(1)
+            << stats.max_flush_latency_ms << "ms" << endl;
+    report << left << setw(25) << "Execution time: " << right << setw(15) << seconds << "s" << setw(5)
+            << milliseconds << "ms" << endl;
+    return EXIT_SUCCESS;
+}
+
+/*=============================================================================
+ * BLOCK CONTAINER COMPRESSION
+ *=============================================================================*/
+
+/**
+ * @brief Compresses the loaded input into the indexed block container
+ * @param data Complete input data
+ * @param size Input length
+ * @param extents Data ranges of a sparse input, or null when every byte was read
+ * @param options Parsed command line (block size, trained tables)
+ * @param nodes NUMA topology the input was placed on (--numa), else empty
+ * @param progress Progress stream (may be disabled)
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ *
+ * Each block is coded independently with the cheapest of: its own inline
+ * code, a trained table referenced by id, or stored as-is. With `--explain`
+ * every block's choice and statistics are written to the report as well.
+ *
+ * Block size and thread count come from the command line, else from the
+ * autotune profile (options.profile), else from the built-in defaults; the
+ * stats output names the source of each.
+ *
+ * With `--stripes` the blocks go to stripe files written by one thread each
+ * and the output path receives the stripe manifest (striped_container.h).
+ */
+int compress_block_container(const uint8_t *data, const size_t size, const vector<data_extent> *extents,
+                             const compression_options &options, const vector<numa_node> &nodes,
+                             progress_reporter &progress) {
+    const tuning_profile &profile = options.profile;
+
+    // Loaded before the output is created, which may replace it
+    previous_archive previous;
+    if (string error; options.previous_path && !load_previous_archive(options.previous_path, previous, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    block_encoder_settings settings;
+    settings.table_id = options.table_id;
+    settings.data_extents = extents;
+    settings.symbol_width = options.symbol_width;
+    settings.engines = options.engines;
+    settings.objective_mbps = options.objective_mbps;
+    settings.shuffle_width = options.shuffle_width;
+
+    string block_size_source = "default";
+    settings.block_size = DEFAULT_BLOCK_SIZE;
+    if (options.block_size != 0) {
+        settings.block_size = options.block_size;
+        block_size_source = "--block-size";
+    } else if (profile.block_size != 0) {
+        settings.block_size = profile.block_size;
+        block_size_source = "profile";
+    }
+    if (options.previous_path) {
+        // Blocks can only be copied on the previous archive's block grid
+        if (options.block_size != 0 && options.block_size != previous.container.block_size) {
+            cerr << "Error: --block-size " << options.block_size << " differs from the previous archive's block size "
+                    << previous.container.block_size << endl;
+            return EXIT_FAILURE;
+        }
+        settings.block_size = previous.container.block_size;
+        block_size_source = "previous archive";
+    }
+
+    string threads_source = "all cores";
+    settings.thread_count = default_thread_count();
+    if (options.threads != 0) {
+        settings.thread_count = options.threads;
+        threads_source = "--threads";
+    } else if (profile.threads != 0) {
+        settings.thread_count = profile.threads;
+        threads_source = "profile";
+    }
+    if (options.limits.max_threads != 0 && settings.thread_count > options.limits.max_threads) {
+        settings.thread_count = options.limits.max_threads;
+        threads_source = "--max-threads";
+    }
+
+    // With --backends or --numa every backend brings its own workers; the governor sees all of them
+    vector<block_backend> backends;
+    vector<int> block_nodes;
+    if (options.numa) {
+        backends = numa_block_backends(nodes);
+        settings.thread_count = 0;
+        for (const block_backend &backend : backends) settings.thread_count += backend.thread_count;
+        threads_source = "--numa, " + to_string(nodes.size()) + " nodes";
+
+        // Where the kernel actually put each block's first page
+        memory_nodes(data, settings.block_size, (size + settings.block_size - 1) / settings.block_size,
+                     block_nodes);
+        if (all_of(block_nodes.begin(), block_nodes.end(), [](const int node) { return node < 0; })) {
+            block_nodes.clear();
+        }
+    } else if (options.backends) {
+        if (string error; !parse_backend_list(options.backends, backends, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+        settings.thread_count = 0;
+        for (const block_backend &backend : backends) settings.thread_count += backend.thread_count;
+        threads_source = "--backends";
+    }
+
+    // Rate and CPU budgets are enforced per block by the governor
+    resource_governor governor(options.limits, settings.thread_count);
+    if (options.limits.max_rate_mbps > 0 || options.limits.cpu_budget > 0) settings.governor = &governor;
+
+    code_table_set tables;
+    if (options.tables_path) {
+        if (string error; !load_code_tables(options.tables_path, tables, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+        if (options.table_id >= static_cast<int>(tables.tables.size())) {
+            cerr << "Error: Table id " << options.table_id << " not in " << options.tables_path << " ("
+                    << tables.tables.size() << " tables)" << endl;
+            return EXIT_FAILURE;
+        }
+        settings.tables = &tables;
+    } else if (options.table_id >= 0) {
+        cerr << "Error: --table-id requires --tables" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Either one container at the output path or stripes plus a manifest there
+    const bool striped = !options.stripe_paths.empty();
+    ofstream out_file;
+    striped_container_writer stripes;
+    if (striped) {
+        if (string error; !stripes.open(options.output_path, options.stripe_paths, options.stripe_assignment, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+    } else {
+        out_file.open(options.output_path, ios::binary);
+        if (!out_file) {
+            cerr << "Error: Cannot create output file " << options.output_path << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    block_report_writer explain;
+    if (string error; options.explain_path && !explain.open(options.explain_path, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    block_container_writer writer(out_file);
+    if (striped) stripes.begin(settings.block_size, settings.tables ? tables.set_id : 0);
+    else writer.begin(settings.block_size, settings.tables ? tables.set_id : 0);
+    const auto encode_start = high_resolution_clock::now();
+
+    uint64_t zero_blocks = 0;
+    uint64_t wide_blocks = 0;
+    uint64_t mode_blocks[BLOCK_MODE_SHUFFLE + 1] = {};
+    double encode_seconds = 0;
+    double selection_seconds = 0;
+    const auto write_block = [&](const encoded_block &block, const block_report *report) {
+        if (block.bytes[0] == BLOCK_MODE_ZERO) zero_blocks++;
+        if (block.bytes[0] == BLOCK_MODE_HUFFMAN16) wide_blocks++;
+        if (block.bytes[0] <= BLOCK_MODE_SHUFFLE) mode_blocks[block.bytes[0]]++;
+        encode_seconds += block.encode_seconds;
+        selection_seconds += block.selection_seconds;
+        if (report) explain.write(*report);
+        if (striped) stripes.append(block);
+        else writer.append(block);
+        progress.advance(block.raw_size);
+    };
+
+    progress.begin_stage("encode", size);
+    vector<backend_statistics> backend_stats;
+    incremental_statistics incremental;
+    if (options.previous_path) {
+        encode_blocks_incremental(data, size, settings, previous, options.explain_path != nullptr, write_block,
+                                  incremental);
+    } else if (backends.empty()) {
+        encode_blocks(data, size, settings, options.explain_path != nullptr, write_block);
+    } else if (string error; !schedule_blocks(data, size, settings, backends, block_nodes,
+                                              options.explain_path != nullptr, write_block, backend_stats, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (string error; striped && !stripes.finish(error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+    if (!striped && !writer.finish()) {
+        cerr << "Error: Failed to write output file " << options.output_path << endl;
+        return EXIT_FAILURE;
+    }
+    if (options.explain_path && !explain.finish()) {
+        cerr << "Error: Failed to write report file " << options.explain_path << endl;
+        return EXIT_FAILURE;
+    }
+
+    cout << left << setw(25) << "Input file size: " << right << setw(20) << size << "  B" << endl;
+    cout << left << setw(25) << "Compressed file size: " << right << setw(20)
+            << (striped ? stripes.stored_size() : writer.position) << "  B" << endl;
+    cout << left << setw(25) << "Blocks: " << right << setw(20)
+            << (striped ? stripes.block_stripes.size() : writer.index.size()) << endl;
+    for (size_t stripe = 0; striped && stripe < stripes.stripes.size(); stripe++) {
+        const stripe_output &output = *stripes.stripes[stripe];
+        cout << left << setw(25) << ("Stripe " + to_string(stripe) + ": ") << right << setw(20) << output.blocks
+                << "  blocks, " << output.writer.position << " B, " << fixed << setprecision(1)
+                << (output.write_seconds > 0 ? static_cast<double>(output.writer.position) / output.write_seconds / 1e6
+                                             : 0.0) << " MB/s (" << output.path << ")" << endl;
+    }
+    if (zero_blocks != 0 || extents) {
+        uint64_t data_bytes = size;
+        if (extents) {
+            data_bytes = 0;
+            for (const data_extent &extent: *extents) data_bytes += extent.length;
+        }
+        cout << left << setw(25) << "Zero blocks: " << right << setw(20) << zero_blocks << "    (" << data_bytes
+                << " B of data read)" << endl;
+    }
+    if (settings.symbol_width == 16) {
+        cout << left << setw(25) << "16-bit blocks: " << right << setw(20) << wide_blocks << endl;
+    }
+    if (settings.engines != 0) {
+        cout << left << setw(25) << "Engine blocks: " << right << setw(20)
+                << mode_blocks[BLOCK_MODE_HUFFMAN] + mode_blocks[BLOCK_MODE_SHARED_TABLE] +
+                   mode_blocks[BLOCK_MODE_HUFFMAN16] << "  huffman, " << mode_blocks[BLOCK_MODE_SHUFFLE]
+                << " shuffle, " << mode_blocks[BLOCK_MODE_RLE] << " rle, " << mode_blocks[BLOCK_MODE_STORED]
+                << " stored" << endl;
+        cout << left << setw(25) << "Engine selection: " << right << setw(20) << fixed << setprecision(1)
+                << selection_seconds * 1e3 << "  ms ("
+                << (encode_seconds > 0 ? 100 * selection_seconds / encode_seconds : 0.0) << "% of block coding)"
+                << endl;
+    }
+    if (options.previous_path) {
+        cout << left << setw(25) << "Reused blocks: " << right << setw(20) << incremental.reused_blocks << "    ("
+                << incremental.reused_bytes << " B unchanged, " << incremental.moved_blocks << " moved, "
+                << incremental.shifted_blocks << " shifted)" << endl;
+        cout << left << setw(25) << "Re-encoded blocks: " << right << setw(20) << incremental.encoded_blocks
+                << "    (" << incremental.encoded_bytes << " B changed)" << endl;
+    }
+    cout << left << setw(25) << "Block size: " << right << setw(20) << settings.block_size << "  B ("
+            << block_size_source << ")" << endl;
+    cout << left << setw(25) << "Threads: " << right << setw(20) << settings.thread_count << "    ("
+            << threads_source << ")" << endl;
+    for (const backend_statistics &stats : backend_stats) {
+        cout << left << setw(25) << ("Backend " + stats.name + ": ") << right << setw(20) << stats.blocks
+                << "  blocks, " << fixed << setprecision(1) << stats.mbps() << " MB/s, " << stats.batches
+                << " batches";
+        if (options.numa) cout << ", " << stats.remote_blocks << " remote";
+        cout << endl;
+    }
+    if (settings.governor) {
+        const double seconds = duration<double>(high_resolution_clock::now() - encode_start).count();
+        cout << left << setw(25) << "Throttled rate: " << right << setw(20) << fixed << setprecision(1)
+                << (seconds > 0 ? static_cast<double>(size) / seconds / 1e6 : 0.0) << "  MB/s (limit ";
+        if (options.limits.max_rate_mbps > 0) cout << options.limits.max_rate_mbps << " MB/s";
+        else cout << "none";
+        cout << ", CPU budget ";
+        if (options.limits.cpu_budget > 0) cout << options.limits.cpu_budget << " cores";
+        else cout << "none";
+        cout << ")" << endl;
+    }
+    if (profile.loaded) {
+        cout << left << setw(25) << "Profile: " << profile.path;
+        if (profile.cpu_mbps > 0) cout << " (tuned at " << fixed << setprecision(1) << profile.cpu_mbps << " MB/s)";
+        cout << endl;
+    }
+    return EXIT_SUCCESS;
+}
+
 /*=============================================================================
  * MAIN COMPRESSION PROGRAM
  *=============================================================================*/
 
 /**
  * @brief Main compression program implementing complete Huffman compression
- * @param argc Number of command line arguments (should be 3)
- * @param argv Array of arguments [program, input_file, output_file]
+ * @param argc Number of command line arguments
+ * @param argv Array of arguments [program, options..., input_file, output_file]
  * @return EXIT_SUCCESS on successful compression, EXIT_FAILURE on error
  *
  * Complete compression pipeline:
@@ -193,8 +772,27 @@ int main(int argc, char *argv[]) {
      * ARGUMENT VALIDATION
      *=========================================================================*/
 
-    if (argc != 3) {
-        cerr << "Usage: " << argv[0] << " <input_file> <output_file>" << endl;
+    compression_options options;
+    if (!parse_arguments(argc, argv, options)) {
+        cerr << "Usage: " << argv[0] << " [--block-size <bytes>] [--tables <table_file> [--table-id <id>]]"
+                << " [--threads <n>] [--backends <cpu[:n],...> | --numa] [--previous <archive>] [--symbol-width 8|16]"
+                << " [--engines <stored,rle,huffman,shuffle|all> [--objective ratio|balanced|speed|<MB/s>]"
+                << " [--shuffle-width 2|4|8]] [--stripes <path,...> [--stripe-policy round-robin|queue-depth]]"
+                << " [--no-profile]"
+                << " [--explain <report.csv|report.json>] [--progress <path|->] [--max-threads <n>]"
+                << " [--max-rate <MB/s>] [--cpu-budget <cores>] <input_file> <output_file>" << endl;
+        cerr << "       " << argv[0] << " --adaptive [--block-size <frame bytes>] <input_file|-> <output_file|->"
+                << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (options.adaptive) {
+        return compress_adaptive(options);
+    }
+
+    // A tuned block size or thread count only applies to the block container, so the profile selects it
+    if (string error; options.use_profile && !load_tuning_profile(default_profile_path(), options.profile, error)) {
+        cerr << "Error: " << error << " (use --no-profile to ignore it)" << endl;
         return EXIT_FAILURE;
     }
 
@@ -204,20 +802,71 @@ int main(int argc, char *argv[]) {
 
     auto start = high_resolution_clock::now();
 
+    progress_reporter progress;
+    if (string error; options.progress_path && !progress.open(options.progress_path, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
     /*=========================================================================
      * FILE INPUT AND VALIDATION
      *=========================================================================*/
 
-    // Read entire input file into memory using iterators
-    ifstream input_file(argv[1], ios::binary);
-    if (!input_file) {
-        cerr << "Error: Cannot open input file " << argv[1] << endl;
-        return EXIT_FAILURE;
+    // --numa reads into node-placed memory, the block container hole-aware, the tree format into a string
+    string content;
+    numa_input numa_content;
+    sparse_input sparse_content;
+    vector<numa_node> nodes;
+    progress.begin_stage("read", 0);
+    if (options.numa) {
+        nodes = load_numa_topology();
+        if (string error; !load_input_numa(options.input_path, nodes, numa_content, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+        progress.advance(numa_content.size);
+    } else if (options.use_block_container()) {
+        if (string error; !read_sparse_input(options.input_path, sparse_content, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+        progress.advance(sparse_content.size);
+    } else {
+        // Read entire input file into memory using iterators
+        ifstream input_file(options.input_path, ios::binary);
+        if (!input_file) {
+            cerr << "Error: Cannot open input file " << options.input_path << endl;
+            return EXIT_FAILURE;
+        }
+
+        // Load complete file content into string for processing
+        content.assign(istreambuf_iterator(input_file), istreambuf_iterator<char>());
+        input_file.close();
+        progress.advance(content.size());
     }
 
-    // Load complete file content into string for processing
-    string content((istreambuf_iterator(input_file)), istreambuf_iterator<char>());
-    input_file.close();
+    /*=========================================================================
+     * BLOCK CONTAINER PATH
+     *=========================================================================*/
+
+    if (options.use_block_container()) {
+        const auto *data = options.numa ? numa_content.data : sparse_content.data;
+        const size_t size = options.numa ? numa_content.size : sparse_content.size;
+        const auto &extents = options.numa ? numa_content.extents : sparse_content.extents;
+        if (compress_block_container(data, size, &extents, options, nodes, progress) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+        progress.finish();
+
+        const auto duration = std::chrono::duration<double>(high_resolution_clock::now() - start);
+        const int seconds = static_cast<int>(duration.count());
+        const int milliseconds = static_cast<int>((duration.count() - seconds) * 1000);
+
+        cout << "CPU Compression completed successfully!" << endl;
+        std::cout << std::left << std::setw(25) << "Execution time: " << std::right << std::setw(15) <<
+                seconds << "s" << std::setw(5) << milliseconds << "ms" << std::endl;
+        return EXIT_SUCCESS;
+    }
 
     // Validate non-empty input
     if (content.empty()) {
@@ -230,10 +879,12 @@ int main(int argc, char *argv[]) {
      *=========================================================================*/
 
     // Count frequency of each character using hash map for O(1) access
+    progress.begin_stage("histogram", content.size());
     unordered_map<char, int> frequency;
     for (char character: content) {
         frequency[character]++;
     }
+    progress.advance(content.size());
 
     /*=========================================================================
      * HUFFMAN TREE CONSTRUCTION
@@ -287,9 +938,9 @@ int main(int argc, char *argv[]) {
      *=========================================================================*/
 
     // Create output file for writing compressed data
-    ofstream out_file(argv[2], ios::binary);
+    ofstream out_file(options.output_path, ios::binary);
     if (!out_file) {
-        cerr << "Error: Cannot create output file " << argv[2] << endl;
+        cerr << "Error: Cannot create output file " << options.output_path << endl;
 
         // Clean up allocated tree memory before exit
         function<void(node *)> delete_tree = [&](const node *node) {
@@ -314,16 +965,23 @@ int main(int argc, char *argv[]) {
     // Write serialized tree structure for decompression
     serialize_tree(root, out_file);
     out_file.put('*'); // Tree end marker for parsing during decompression
+    const auto table_bytes = static_cast<uint64_t>(out_file.tellp()) - sizeof(original_size);
 
     /*=========================================================================
      * DATA ENCODING AND COMPRESSION
      *=========================================================================*/
 
     // Encode entire file content using generated Huffman codes
+    const auto encode_start = high_resolution_clock::now();
+    progress.begin_stage("encode", content.size());
     string encoded;
+    size_t encoded_count = 0;
     for (char character: content) {
         encoded += codes[character];
+        // Report in 1 MiB steps; advance() itself limits the event rate
+        if (++encoded_count % PROGRESS_STEP_BYTES == 0) progress.advance(PROGRESS_STEP_BYTES);
     }
+    progress.advance(encoded_count % PROGRESS_STEP_BYTES);
 
     // Pad encoded bit string to byte boundary
     int padding = 8 - (encoded.length() % 8);
@@ -337,18 +995,57 @@ int main(int argc, char *argv[]) {
      *=========================================================================*/
 
     // Convert encoded bit string to bytes and write to file
+    progress.begin_stage("write", encoded.length() / 8);
     for (size_t index = 0; index < encoded.length(); index += 8) {
         // Extract 8-bit chunk and convert to byte
         bitset<8> byte(encoded.substr(index, 8));
         out_file.put(static_cast<char>(byte.to_ulong()));
+        if ((index / 8 + 1) % PROGRESS_STEP_BYTES == 0) progress.advance(PROGRESS_STEP_BYTES);
     }
+    progress.advance(encoded.length() / 8 % PROGRESS_STEP_BYTES);
 
     out_file.close();
+    const auto encode_end = high_resolution_clock::now();
+
+    /*=========================================================================
+     * DIAGNOSTICS REPORT
+     *=========================================================================*/
+
+    // The tree format codes the whole file as one block
+    if (options.explain_path) {
+        uint64_t symbol_counts[256] = {};
+        uint8_t code_lengths[256] = {};
+        for (const auto &[character, count]: frequency) {
+            symbol_counts[static_cast<uint8_t>(character)] = count;
+            code_lengths[static_cast<uint8_t>(character)] = static_cast<uint8_t>(codes[character].size());
+        }
+
+        block_report report;
+        report.raw_bytes = original_size;
+        report.mode = "tree";
+        report.table_bytes = table_bytes;
+        report.payload_bytes = encoded.length() / 8;
+        report.stored_bytes = sizeof(original_size) + table_bytes + 1 + report.payload_bytes;
+        report.encode_microseconds = std::chrono::duration<double, micro>(encode_end - encode_start).count();
+        describe_block_code(symbol_counts, code_lengths, 256, HUFFMAN_LOOKUP_BITS, report);
+
+        block_report_writer explain;
+        if (string error; !explain.open(options.explain_path, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+        explain.write(report);
+        if (!explain.finish()) {
+            cerr << "Error: Failed to write report file " << options.explain_path << endl;
+            return EXIT_FAILURE;
+        }
+    }
 
     /*=========================================================================
      * PERFORMANCE MEASUREMENT AND REPORTING
      *=========================================================================*/
 
+    progress.finish();
     auto end = high_resolution_clock::now();
     const auto duration = std::chrono::duration<double>(end - start);
     const double total_seconds = duration.count();
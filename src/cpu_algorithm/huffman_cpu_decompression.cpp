@@ -1,10 +1,27 @@
+#include <algorithm>
 #include <iostream>
-#include <fstream>
 #include <vector>
-#include <bitset>
 #include <chrono>
 #include <iomanip>
-#include <functional>
+#include <string>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "adaptive_stream.h"
+#include "block_format.h"
+#include "block_reader.h"
+#include "in_place_decode.h"
+#include "legacy_formats.h"
+#include "mapped_file.h"
+#include "progress_reporter.h"
+#include "shared_block_cache.h"
+#include "sparse_file.h"
+#include "striped_container.h"
+#include "tuning_profile.h"
+#include "worker_pool.h"
 
 /**
  * @file huffman_cpu_decompression.cpp
@@ -15,8 +32,10 @@
  * original data using the embedded Huffman tree.
  *
  * Key features:
- * - Tree deserialization from binary format
- * - Bit-by-bit tree traversal for decoding
+ * - Decodes straight from a read-only mapping of the compressed file
+ *   (mapped_file.h, MADV_SEQUENTIAL; `--populate` prefaults it)
+ * - Tree format: byte-at-a-time table decoding of the embedded tree
+ *   (legacy_formats.h) instead of walking it bit by bit
  * - Robust error handling and validation
  * - Memory management with RAII patterns
  * - Performance measurement and reporting
@@ -26,100 +45,598 @@
  * - Handles padding removal correctly
  * - Supports single-character files
  * - Validates decompression accuracy
+ * - Detects the indexed block container (block_format.h) by its magic and
+ *   decodes its blocks in parallel; `--tables` supplies trained code tables,
+ *   `--threads` (or the autotune profile) sets the worker count and
+ *   `--max-threads` / `--max-rate` / `--cpu-budget` throttle it
+ * - `--decoder auto|table|limits` picks the canonical decoder of container
+ *   blocks: lookup tables, the table-less limit decoder (canonical_huffman.h),
+ *   or per block by table size and block length (default)
+ * - `--in-place` reads a block container into the tail of a single buffer of
+ *   the original size plus a small margin and decodes it into the front of
+ *   that buffer (in_place_decode.h) instead of mapping it
+ * - `--range <offset>:<length>` decodes only the blocks of a block container
+ *   that overlap that range of the original (block_reader.h) and writes just
+ *   those bytes; `--shared-cache <name>[:<MiB>]` shares the decoded blocks
+ *   with other processes on the host (shared_block_cache.h)
+ * - A stripe manifest (striped_container.h) is detected by its magic; its
+ *   stripes are mapped by one thread each and decoded like one container
+ * - `--progress <path>` streams JSON-lines progress events (progress_reporter.h)
+ * - Output is written sparse (sparse_file.h): zero blocks of the container are
+ *   neither decoded nor written, and aligned zero runs of either format are
+ *   skipped, so holes of the original come back as holes
+ * - Detects adaptive streams (adaptive_stream.h) by their magic and decodes
+ *   them frame by frame as they are read; "-" as input reads such a stream
+ *   from stdin and "-" as output writes to stdout
  */
 
 using namespace std;
 using namespace chrono;
 
 /*=============================================================================
- * TREE DATA STRUCTURE
+ * COMMAND LINE OPTIONS
  *=============================================================================*/
 
 /**
- * @struct node
- * @brief Simplified tree node for decompression operations
- *
- * This structure is optimized for decompression traversal rather than
- * construction, so it omits the frequency field used during compression:
- *
- * - character: The byte value stored in leaf nodes
- * - left/right: Child pointers for tree traversal during decoding
- *
- * The simpler structure reduces memory usage and improves cache locality
- * during the bit-by-bit traversal process that dominates decompression time.
+ * @struct decompression_options
+ * @brief Parsed command line of the CPU decompressor
  */
-struct node {
-    char character;     // Character value (meaningful only for leaf nodes)
-    node* left;         // Left child pointer (corresponds to '0' bit)
-    node* right;        // Right child pointer (corresponds to '1' bit)
+struct decompression_options {
+    const char *input_path = nullptr;
+    const char *output_path = nullptr;
+    const char *tables_path = nullptr;
+    const char *progress_path = nullptr;
+    unsigned threads = 0;
+    bool use_profile = true;
+    bool populate = false;
+    bool in_place = false;
+    bool has_range = false;
+    uint64_t range_offset = 0;
+    uint64_t range_length = 0;
+    string shared_cache_name;
+    uint64_t shared_cache_mib = SHARED_CACHE_DEFAULT_MIB;
+    decoder_engine engine = DECODER_ENGINE_AUTO;
+    resource_limits limits;
+};
 
-    // Default constructor for internal nodes
-    node() : character(0), left(nullptr), right(nullptr) {}
+/**
+ * @brief Parses `[options] <compressed_file> <output_file>`
+ * @return false on unknown options, missing values or a wrong positional count
+ */
+bool parse_arguments(const int argc, char *argv[], decompression_options &options) {
+    int positional = 0;
+    for (int index = 1; index < argc; index++) {
+        const string argument = argv[index];
+        const bool has_value = index + 1 < argc;
+
+        if (argument == "--tables" && has_value) {
+            options.tables_path = argv[++index];
+        } else if (argument == "--progress" && has_value) {
+            options.progress_path = argv[++index];
+        } else if (argument == "--threads" || argument == "--max-threads" || argument == "--max-rate" ||
+                   argument == "--cpu-budget") {
+            if (!has_value) return false;
+            try {
+                const string value = argv[++index];
+                if (argument == "--threads") options.threads = static_cast<unsigned>(stoul(value));
+                else if (argument == "--max-threads") options.limits.max_threads = static_cast<unsigned>(stoul(value));
+                else if (argument == "--max-rate") options.limits.max_rate_mbps = stod(value);
+                else options.limits.cpu_budget = stod(value);
+            } catch (const exception &) {
+                return false;
+            }
+            if (argument == "--threads" && options.threads == 0) return false;
+            if (argument == "--max-threads" && options.limits.max_threads == 0) return false;
+            if (argument == "--max-rate" && options.limits.max_rate_mbps <= 0) return false;
+            if (argument == "--cpu-budget" && options.limits.cpu_budget <= 0) return false;
+        } else if (argument == "--no-profile") {
+            options.use_profile = false;
+        } else if (argument == "--populate") {
+            options.populate = true;
+        } else if (argument == "--in-place") {
+            options.in_place = true;
+        } else if (argument == "--range" && has_value) {
+            const string value = argv[++index];
+            const size_t colon = value.find(':');
+            if (colon == string::npos) return false;
+            try {
+                options.range_offset = stoull(value.substr(0, colon));
+                options.range_length = stoull(value.substr(colon + 1));
+            } catch (const exception &) {
+                return false;
+            }
+            options.has_range = true;
+        } else if (argument == "--shared-cache" && has_value) {
+            const string value = argv[++index];
+            const size_t colon = value.find(':');
+            options.shared_cache_name = value.substr(0, colon);
+            if (colon != string::npos) {
+                try {
+                    options.shared_cache_mib = stoull(value.substr(colon + 1));
+                } catch (const exception &) {
+                    return false;
+                }
+                if (options.shared_cache_mib == 0) return false;
+            }
+            if (options.shared_cache_name.empty()) return false;
+        } else if (argument == "--decoder" && has_value) {
+            const string value = argv[++index];
+            if (value == "auto") options.engine = DECODER_ENGINE_AUTO;
+            else if (value == "table") options.engine = DECODER_ENGINE_TABLE;
+            else if (value == "limits") options.engine = DECODER_ENGINE_LIMITS;
+            else return false;
+        } else if (argument.rfind("--", 0) == 0) {
+            return false;
+        } else if (positional == 0) {
+            options.input_path = argv[index];
+            positional++;
+        } else if (positional == 1) {
+            options.output_path = argv[index];
+            positional++;
+        } else {
+            return false;
+        }
+    }
+    // --in-place does not map the input; the shared cache is used by range reads
+    return positional == 2 && !(options.in_place && options.populate) && !(options.in_place && options.has_range) &&
+           (options.shared_cache_name.empty() || options.has_range);
+}
 
-    // Constructor for leaf nodes with character
-    explicit node(const char character) : character(character), left(nullptr), right(nullptr) {}
-};
+/*=============================================================================
+ * ADAPTIVE STREAM DECOMPRESSION
+ *=============================================================================*/
+
+/**
+ * @brief Decodes an adaptive stream, writing each frame as soon as it is decoded
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int decompress_adaptive(const decompression_options &options) {
+    const bool from_stdin = strcmp(options.input_path, "-") == 0;
+    const bool to_stdout = strcmp(options.output_path, "-") == 0;
+
+    const int input = from_stdin ? STDIN_FILENO : open(options.input_path, O_RDONLY);
+    if (input < 0) {
+        cerr << "Error: Cannot open compressed file " << options.input_path << endl;
+        return EXIT_FAILURE;
+    }
+    const int output = to_stdout ? STDOUT_FILENO : open(options.output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (output < 0) {
+        cerr << "Error: Cannot create output file " << options.output_path << endl;
+        if (!from_stdin) close(input);
+        return EXIT_FAILURE;
+    }
+
+    adaptive_statistics stats;
+    string error;
+    const bool success = adaptive_decompress_stream(input, output, stats, error);
+    if (!from_stdin) close(input);
+    if (!to_stdout && close(output) != 0 && success) {
+        error = string("Cannot close output file: ") + strerror(errno);
+    }
+    if (!success || !error.empty()) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    (to_stdout ? cerr : cout) << left << setw(25) << "Frames: " << right << setw(20) << stats.frames << " ("
+            << stats.stored_frames << " stored)" << endl;
+    return EXIT_SUCCESS;
+}
 
 /*=============================================================================
- * TREE DESERIALIZATION
+ * BLOCK CONTAINER DECOMPRESSION
  *=============================================================================*/
 
 /**
- * @brief Recursively deserializes a Huffman tree from binary file format
- * @param in Input file stream positioned at tree data
- * @return Pointer to reconstructed tree root, or nullptr on error
- *
- * This function reverses the serialization process used during compression:
+ * @brief Worker count from --threads, else the autotune profile, else all cores, capped by --max-threads
+ * @param source Receives where the count came from, for the stats output
+ * @return false when the profile exists but cannot be read
+ */
+static bool resolve_thread_count(const decompression_options &options, unsigned &thread_count, string &source,
+                                 string &error) {
+    tuning_profile profile;
+    if (options.use_profile && !load_tuning_profile(default_profile_path(), profile, error)) return false;
+
+    source = "all cores";
+    thread_count = default_thread_count();
+    if (options.threads != 0) {
+        thread_count = options.threads;
+        source = "--threads";
+    } else if (profile.threads != 0) {
+        thread_count = profile.threads;
+        source = "profile";
+    }
+    if (options.limits.max_threads != 0 && thread_count > options.limits.max_threads) {
+        thread_count = options.limits.max_threads;
+        source = "--max-threads";
+    }
+    return true;
+}
+
+/**
+ * @brief Decompresses a block container in place: one buffer holds the input at its tail and the output at its front
+ * @param options Parsed command line (input and output path, tables, threads, decoder)
+ * @param progress Progress stream (may be disabled)
+ * @return EXIT_SUCCESS or EXIT_FAILURE
  *
- * Deserialization format (matches compression serialization):
- * - '1' + character_byte → Create leaf node with character
- * - '0' → Create internal node, then deserialize left and right subtrees
+ * The buffer is sized from the file header and trailer alone (original size
+ * plus in_place_margin_bound()), so peak memory is the original size plus a
+ * little more than one block instead of the compressed and original sizes
+ * together. Throttling options are not applied on this path.
+ */
+int decompress_in_place(const decompression_options &options, progress_reporter &progress) {
+    const int input = open(options.input_path, O_RDONLY);
+    struct stat status{};
+    if (input < 0 || fstat(input, &status) != 0) {
+        cerr << "Error: Cannot open compressed file " << options.input_path << endl;
+        if (input >= 0) close(input);
+        return EXIT_FAILURE;
+    }
+    const auto compressed_size = static_cast<size_t>(status.st_size);
+
+    string error;
+    uint8_t header[BLOCK_FILE_HEADER_SIZE];
+    uint8_t trailer[BLOCK_TRAILER_SIZE];
+    uint64_t original_size = 0;
+    uint32_t block_size = 0;
+    uint32_t block_count = 0;
+    if (compressed_size < BLOCK_FILE_HEADER_SIZE + BLOCK_TRAILER_SIZE ||
+        pread(input, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        pread(input, trailer, sizeof(trailer), static_cast<off_t>(compressed_size - sizeof(trailer))) !=
+        static_cast<ssize_t>(sizeof(trailer)) ||
+        !peek_block_container(header, trailer, original_size, block_size, block_count, error)) {
+        cerr << "Error: --in-place needs a block container (" << (error.empty() ? "file too short" : error) << ")"
+                << endl;
+        close(input);
+        return EXIT_FAILURE;
+    }
+
+    // A container that does not fit the bound is rejected by decode_in_place() with its exact margin
+    const uint64_t buffer_size = max<uint64_t>(original_size + in_place_margin_bound(block_size, block_count),
+                                               compressed_size);
+    zero_buffer buffer;
+    if (!buffer.allocate(buffer_size, error)) {
+        cerr << "Error: " << error << endl;
+        close(input);
+        return EXIT_FAILURE;
+    }
+
+    progress.begin_stage("read", compressed_size);
+    uint8_t *tail = buffer.data + buffer_size - compressed_size;
+    size_t received = 0;
+    while (received < compressed_size) {
+        const size_t wanted = min<size_t>(compressed_size - received, PROGRESS_STEP_BYTES);
+        const ssize_t count = read(input, tail + received, wanted);
+        if (count <= 0) break;
+        received += static_cast<size_t>(count);
+        progress.advance(static_cast<uint64_t>(count));
+    }
+    close(input);
+    if (received != compressed_size) {
+        cerr << "Error: Failed to read compressed file " << options.input_path << endl;
+        return EXIT_FAILURE;
+    }
+
+    code_table_set tables;
+    if (options.tables_path && !load_code_tables(options.tables_path, tables, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+    unsigned thread_count;
+    string threads_source;
+    if (!resolve_thread_count(options, thread_count, threads_source, error)) {
+        cerr << "Error: " << error << " (use --no-profile to ignore it)" << endl;
+        return EXIT_FAILURE;
+    }
+
+    progress.begin_stage("decode", original_size);
+    if (!decode_in_place(buffer.data, buffer_size, compressed_size, options.tables_path ? &tables : nullptr, error,
+                         options.engine, thread_count)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+    progress.advance(original_size);
+
+    const int out_file = open(options.output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_file < 0) {
+        cerr << "Error: Cannot create output file " << options.output_path << endl;
+        return EXIT_FAILURE;
+    }
+    progress.begin_stage("write", original_size);
+    const bool written = write_sparse(out_file, buffer.data, original_size, 0, error) &&
+                         finish_sparse_file(out_file, original_size, error);
+    if (close(out_file) != 0 || !written) {
+        cerr << "Error: " << (error.empty() ? "Failed to write output file" : error) << endl;
+        return EXIT_FAILURE;
+    }
+    progress.advance(original_size);
+
+    cout << left << setw(25) << "In-place buffer: " << right << setw(20) << buffer_size << "  B (margin "
+            << buffer_size - original_size << " B)" << endl;
+    cout << left << setw(25) << "Threads: " << right << setw(20) << thread_count << "    (" << threads_source << ")"
+            << endl;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Decodes one range of a block container's original data (--range)
+ * @param options Parsed command line (input and output path, range, tables, threads, shared cache)
+ * @param progress Progress stream (may be disabled)
+ * @return EXIT_SUCCESS or EXIT_FAILURE
  *
- * Error handling:
- * - Returns nullptr on file read errors or malformed tree data
- * - Cleans up partially constructed trees on failure
- * - Validates tree structure during construction
+ * Only the blocks overlapping the range are decoded, one task per block.
+ * With --shared-cache they are first looked up in the host-wide cache and
+ * published to it after decoding, so concurrent readers of the same hot
+ * ranges decode each block once per host.
+ */
+int decompress_range(const decompression_options &options, progress_reporter &progress) {
+    string error;
+    code_table_set tables;
+    if (options.tables_path && !load_code_tables(options.tables_path, tables, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+    block_reader reader;
+    if (!reader.open(options.input_path, options.tables_path ? &tables : nullptr, error)) {
+        cerr << "Error: --range needs a block container (" << error << ")" << endl;
+        return EXIT_FAILURE;
+    }
+    reader.engine = options.engine;
+    const block_container &container = reader.container;
+    if (options.range_offset > container.original_size ||
+        options.range_length > container.original_size - options.range_offset) {
+        cerr << "Error: Range " << options.range_offset << ":" << options.range_length
+                << " is beyond the original size " << container.original_size << endl;
+        return EXIT_FAILURE;
+    }
+
+    shared_block_cache cache;
+    if (!options.shared_cache_name.empty()) {
+        if (!cache.open(options.shared_cache_name, options.shared_cache_mib << 20, container.block_size, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+        reader.cache = &cache;
+    }
+
+    unsigned thread_count;
+    string threads_source;
+    if (!resolve_thread_count(options, thread_count, threads_source, error)) {
+        cerr << "Error: " << error << " (use --no-profile to ignore it)" << endl;
+        return EXIT_FAILURE;
+    }
+
+    zero_buffer decoded;
+    if (!decoded.allocate(options.range_length, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    // One task per overlapping block, each reading its own part of the range
+    const uint64_t range_end = options.range_offset + options.range_length;
+    const auto first = upper_bound(reader.block_starts.begin(), reader.block_starts.end(), options.range_offset) -
+                       reader.block_starts.begin() - 1;
+    const auto last = options.range_length == 0
+                          ? first
+                          : lower_bound(reader.block_starts.begin(), reader.block_starts.end(), range_end) -
+                            reader.block_starts.begin();
+    vector<string> block_errors(last - first);
+    progress.begin_stage("decode", options.range_length);
+    run_parallel(last - first, thread_count, [&](const size_t task, unsigned) {
+        const size_t index = first + task;
+        const uint64_t start = max(reader.block_starts[index], options.range_offset);
+        const uint64_t end = min(reader.block_starts[index] + container.blocks[index].raw_size, range_end);
+        reader.read(start, end - start, decoded.data + (start - options.range_offset), block_errors[task]);
+        progress.advance(end - start);
+    });
+    for (const string &block_error: block_errors) {
+        if (!block_error.empty()) {
+            cerr << "Error: " << block_error << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const int out_file = open(options.output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_file < 0) {
+        cerr << "Error: Cannot create output file " << options.output_path << endl;
+        return EXIT_FAILURE;
+    }
+    progress.begin_stage("write", options.range_length);
+    const bool written = write_sparse(out_file, decoded.data, options.range_length, 0, error) &&
+                         finish_sparse_file(out_file, options.range_length, error);
+    if (close(out_file) != 0 || !written) {
+        cerr << "Error: " << (error.empty() ? "Failed to write output file" : error) << endl;
+        return EXIT_FAILURE;
+    }
+    progress.advance(options.range_length);
+
+    cout << left << setw(25) << "Range: " << right << setw(20) << options.range_length << "  B at offset "
+            << options.range_offset << " (" << last - first << " of " << container.blocks.size() << " blocks)"
+            << endl;
+    cout << left << setw(25) << "Blocks decoded: " << right << setw(20) << reader.decoded_blocks.load() << endl;
+    if (!options.shared_cache_name.empty()) {
+        cout << left << setw(25) << "Shared cache: " << right << setw(20) << cache.hits.load() << " hits, "
+                << cache.misses.load() << " misses, " << cache.inserts.load() << " inserts ("
+                << (cache.capacity_bytes() >> 20) << " MiB)" << endl;
+    }
+    cout << left << setw(25) << "Threads: " << right << setw(20) << thread_count << "    (" << threads_source << ")"
+            << endl;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @struct block_source
+ * @brief Where one block of the original data is stored: its container, that container's bytes and its index entry
+ */
+struct block_source {
+    const block_container *container;
+    const uint8_t *data;
+    const block_index_entry *entry;
+};
+
+/**
+ * @brief Decodes blocks in parallel into one buffer and writes it to the output file
+ * @param blocks Every block of the original data, in order
+ * @param original_size Sum of the blocks' raw sizes
+ * @param options Parsed command line (output path, tables, threads)
+ * @param progress Progress stream (may be disabled)
+ * @return EXIT_SUCCESS or EXIT_FAILURE
  *
- * Memory management:
- * - Allocates nodes dynamically during reconstruction
- * - Provides cleanup on partial failure to prevent memory leaks
- * - Caller responsible for cleaning up successfully constructed trees
+ * Blocks are decoded in parallel into one output buffer and verified against
+ * their stored checksums. Zero blocks are left as untouched zero pages of
+ * that buffer and skipped on write, so holes cost neither decoding time nor
+ * memory nor disk space.
  */
-node* deserialize_tree(ifstream& in) {
-    // Read the node type marker
-    const char marker = in.get();
-    if (in.eof()) return nullptr;  // Unexpected end of file
-
-    if (marker == '1') {
-        // Leaf node: read the character value
-        const char ch = in.get();
-        if (in.eof()) return nullptr;  // Truncated leaf node data
-        return new node(ch);
-    }
-    if (marker == '0') {
-        // Internal node: create node and deserialize children
-        auto node = new struct node();
-        node->left = deserialize_tree(in);
-        node->right = deserialize_tree(in);
-
-        // If either subtree failed to deserialize, cleanup and return failure
-        if (!node->left || !node->right) {
-            // Recursive cleanup lambda to prevent memory leaks
-            function<void(struct node*)> delete_tree = [&](const struct node* node_param) {
-                if (!node_param) return;
-                delete_tree(node_param->left);
-                delete_tree(node_param->right);
-                delete node_param;
-            };
-            delete_tree(node);
-            return nullptr;
+static int decode_blocks(const vector<block_source> &blocks, const uint64_t original_size,
+                         const decompression_options &options, progress_reporter &progress) {
+    string error;
+    code_table_set tables;
+    if (options.tables_path && !load_code_tables(options.tables_path, tables, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    unsigned thread_count;
+    string threads_source;
+    if (!resolve_thread_count(options, thread_count, threads_source, error)) {
+        cerr << "Error: " << error << " (use --no-profile to ignore it)" << endl;
+        return EXIT_FAILURE;
+    }
+    resource_governor governor(options.limits, thread_count);
+    const bool throttled = options.limits.max_rate_mbps > 0 || options.limits.cpu_budget > 0;
+
+    // Output position of every block, so they can be decoded in any order
+    vector<uint64_t> output_offsets(blocks.size());
+    uint64_t output_offset = 0;
+    for (size_t index = 0; index < blocks.size(); index++) {
+        output_offsets[index] = output_offset;
+        output_offset += blocks[index].entry->raw_size;
+    }
+
+    zero_buffer decoded;
+    if (!decoded.allocate(original_size, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    // A zero block whose index entry agrees needs no work: the buffer is already zero there
+    vector<char> zero_blocks(blocks.size(), 0);
+    for (size_t index = 0; index < blocks.size(); index++) {
+        const block_index_entry &entry = *blocks[index].entry;
+        const block_header header = read_block_header(blocks[index].data + entry.offset);
+        zero_blocks[index] = header.mode == BLOCK_MODE_ZERO && header.payload_size == 0 &&
+                             header.raw_size == entry.raw_size && entry.checksum == zero_block_checksum(entry.raw_size);
+    }
+
+    vector<string> block_errors(blocks.size());
+    progress.begin_stage("decode", original_size);
+    run_parallel(blocks.size(), thread_count, [&](const size_t index, unsigned) {
+        const block_source &block = blocks[index];
+        const uint32_t raw_size = block.entry->raw_size;
+        if (zero_blocks[index]) {
+            progress.advance(raw_size);
+            return;
         }
+        if (throttled) governor.begin_task(raw_size);
+
+        const auto block_start = steady_clock::now();
+        decode_block(*block.container, block.data, *block.entry, options.tables_path ? &tables : nullptr,
+                     decoded.data + output_offsets[index], block_errors[index], options.engine);
 
-        return node;
+        if (throttled) governor.end_task(raw_size, duration<double>(steady_clock::now() - block_start).count());
+        progress.advance(raw_size);
+    });
+
+    for (size_t index = 0; index < blocks.size(); index++) {
+        if (!block_errors[index].empty()) {
+            cerr << "Error: " << block_errors[index] << " (block at offset " << blocks[index].entry->offset << ")"
+                    << endl;
+            return EXIT_FAILURE;
+        }
     }
 
-    // Invalid marker - corrupted tree data
-    return nullptr;
+    const int out_file = open(options.output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_file < 0) {
+        cerr << "Error: Cannot create output file " << options.output_path << endl;
+        return EXIT_FAILURE;
+    }
+    progress.begin_stage("write", original_size);
+    bool written = true;
+    for (size_t index = 0; index < blocks.size() && written; index++) {
+        if (!zero_blocks[index]) {
+            written = write_sparse(out_file, decoded.data + output_offsets[index], blocks[index].entry->raw_size,
+                                   output_offsets[index], error);
+        }
+        progress.advance(blocks[index].entry->raw_size);
+    }
+    written = written && finish_sparse_file(out_file, original_size, error);
+    if (close(out_file) != 0 || !written) {
+        cerr << "Error: " << (error.empty() ? "Failed to write output file" : error) << endl;
+        return EXIT_FAILURE;
+    }
+
+    cout << left << setw(25) << "Threads: " << right << setw(20) << thread_count << "    (" << threads_source << ")"
+            << endl;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Decompresses an indexed block container
+ * @param compressed Mapped compressed file
+ * @param options Parsed command line (output path, tables, threads)
+ * @param progress Progress stream (may be disabled)
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ *
+ * Blocks are located through the index at the end of the file and decoded by
+ * decode_blocks().
+ */
+int decompress_block_container(const mapped_file &compressed, const decompression_options &options,
+                               progress_reporter &progress) {
+    string error;
+    block_container container;
+    if (!parse_block_container(compressed.data, compressed.size, container, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<block_source> blocks;
+    blocks.reserve(container.blocks.size());
+    for (const block_index_entry &entry: container.blocks) blocks.push_back({&container, compressed.data, &entry});
+    return decode_blocks(blocks, container.original_size, options, progress);
+}
+
+/**
+ * @brief Decompresses a container written as stripes (--stripes of the compressor)
+ * @param manifest Mapped stripe manifest
+ * @param options Parsed command line (input path, output path, tables, threads, --populate)
+ * @param progress Progress stream (may be disabled)
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ *
+ * All stripes are mapped (and with --populate read) by one thread each. The
+ * manifest deals consecutive blocks to different stripes, so the decode
+ * workers fault in pages from all devices at once.
+ */
+int decompress_striped(const mapped_file &manifest, const decompression_options &options,
+                       progress_reporter &progress) {
+    string error;
+    striped_container striped;
+    if (!open_striped_container(manifest.data, manifest.size, options.input_path, options.populate, striped, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<block_source> blocks;
+    blocks.reserve(striped.block_stripes.size());
+    for (size_t index = 0; index < striped.block_stripes.size(); index++) {
+        const uint16_t stripe = striped.block_stripes[index];
+        const block_container &container = striped.containers[stripe];
+        blocks.push_back({&container, striped.files[stripe]->data, &container.blocks[striped.block_positions[index]]});
+    }
+    if (decode_blocks(blocks, striped.original_size, options, progress) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    cout << left << setw(25) << "Stripes: " << right << setw(20) << striped.containers.size() << endl;
+    return EXIT_SUCCESS;
 }
 
 /*=============================================================================
@@ -128,18 +645,17 @@ node* deserialize_tree(ifstream& in) {
 
 /**
  * @brief Main decompression program for CPU Huffman compressed files
- * @param argc Number of command line arguments (should be 3)
- * @param argv Array of arguments [program, compressed_file, output_file]
+ * @param argc Number of command line arguments
+ * @param argv Array of arguments [program, [--tables <table_file>], compressed_file, output_file]
  * @return EXIT_SUCCESS on successful decompression, EXIT_FAILURE on error
  *
  * Complete decompression pipeline:
- * 1. **File Format Parsing**: Reads structured compressed file header
- * 2. **Tree Reconstruction**: Deserializes embedded Huffman tree
- * 3. **Data Extraction**: Reads compressed bit stream with padding info
- * 4. **Bit Stream Conversion**: Converts bytes to bit string for processing
- * 5. **Tree Traversal Decoding**: Walks tree for each bit to decode characters
- * 6. **Validation**: Verifies output size matches expected original size
- * 7. **Output Generation**: Writes reconstructed data to output file
+ * 1. **File Mapping**: Maps the compressed file read-only
+ * 2. **Format Detection**: Adaptive stream, block container or tree format
+ * 3. **Tree Reconstruction**: Parses the embedded Huffman tree in place
+ * 4. **Table Decoding**: Decodes the bit stream a byte at a time from the mapping
+ * 5. **Validation**: Verifies output size matches expected original size
+ * 6. **Output Generation**: Writes reconstructed data to output file
  *
  * Error handling covers:
  * - File I/O failures
@@ -153,8 +669,13 @@ int main(int argc, char* argv[]) {
      * ARGUMENT VALIDATION
      *=========================================================================*/
 
-    if (argc != 3) {
-        cerr << "Usage: " << argv[0] << " <compressed_file> <output_file>" << endl;
+    decompression_options options;
+    if (!parse_arguments(argc, argv, options)) {
+        cerr << "Usage: " << argv[0] << " [--tables <table_file>] [--threads <n>] [--no-profile]"
+                << " [--max-threads <n>] [--max-rate <MB/s>] [--cpu-budget <cores>] [--progress <path|->]"
+                << " [--populate | --in-place] [--decoder auto|table|limits]"
+                << " [--range <offset>:<length> [--shared-cache <name>[:<MiB>]]] <compressed_file> <output_file>"
+                << endl;
         return EXIT_FAILURE;
     }
 
@@ -164,129 +685,143 @@ int main(int argc, char* argv[]) {
 
     auto start = high_resolution_clock::now();
 
-    /*=========================================================================
-     * COMPRESSED FILE INPUT AND HEADER PARSING
-     *=========================================================================*/
-
-    // Open the compressed file created by CPU compression
-    ifstream in_file(argv[1], ios::binary);
-    if (!in_file) {
-        cerr << "Error: Cannot open compressed file " << argv[1] << endl;
+    progress_reporter progress;
+    if (string error; options.progress_path && !progress.open(options.progress_path, error)) {
+        cerr << "Error: " << error << endl;
         return EXIT_FAILURE;
     }
 
-    // Read original file size from header (first 8 bytes)
-    size_t original_size;
-    in_file.read(reinterpret_cast<char*>(&original_size), sizeof(original_size));
-
     /*=========================================================================
-     * HUFFMAN TREE RECONSTRUCTION
+     * COMPRESSED FILE MAPPING
      *=========================================================================*/
 
-    // Deserialize the embedded Huffman tree structure
-    node* root = deserialize_tree(in_file);
-    if (!root) {
-        cerr << "Error: Failed to deserialize Huffman tree" << endl;
-        return EXIT_FAILURE;
-    }
+    if (options.in_place || options.has_range) {
+        if ((options.in_place ? decompress_in_place(options, progress) : decompress_range(options, progress)) !=
+            EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+        progress.finish();
 
-    /*=========================================================================
-     * COMPRESSED DATA BOUNDARY DETECTION
-     *=========================================================================*/
+        const auto duration = std::chrono::duration<double>(high_resolution_clock::now() - start);
+        const int seconds = static_cast<int>(duration.count());
+        const int milliseconds = static_cast<int>((duration.count() - seconds) * 1000);
 
-    // Find the tree end marker to locate start of compressed data
-    char marker;
-    while (in_file.get(marker) && marker != '*') {}
+        cout << "CPU Decompression completed successfully!" << endl;
+        std::cout << std::left << std::setw(25) << "Execution time: " << std::right << std::setw(15)
+                  << seconds << "s" << std::setw(5) << milliseconds << "ms" << std::endl;
+        return EXIT_SUCCESS;
+    }
 
-    // Read padding information (number of padding bits added during compression)
-    int padding = in_file.get();
+    // Map the compressed file; every format is decoded from the mapping (stdin can only carry an adaptive stream)
+    mapped_file compressed;
+    bool adaptive = strcmp(options.input_path, "-") == 0;
+    if (!adaptive) {
+        progress.begin_stage("read", 0);
+        if (string error; !compressed.open(options.input_path, options.populate, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+        progress.advance(compressed.size);
+        adaptive = is_adaptive_stream(compressed.data, compressed.size);
+    }
 
     /*=========================================================================
-     * COMPRESSED DATA READING
+     * ADAPTIVE STREAM AND BLOCK CONTAINER DETECTION
      *=========================================================================*/
 
-    // Read all remaining bytes as compressed data
-    vector<char> compressed_data;
-    char byte;
-    while (in_file.get(byte)) {
-        compressed_data.push_back(byte);
-    }
-    in_file.close();
+    if (adaptive) {
+        // Report on stderr when the decoded data itself goes to stdout
+        ostream &report = strcmp(options.output_path, "-") == 0 ? cerr : cout;
+        if (decompress_adaptive(options) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
 
-    /*=========================================================================
-     * BIT STRING CONVERSION
-     *=========================================================================*/
+        const auto duration = std::chrono::duration<double>(high_resolution_clock::now() - start);
+        const int seconds = static_cast<int>(duration.count());
+        const int milliseconds = static_cast<int>((duration.count() - seconds) * 1000);
 
-    // Convert compressed bytes to bit string for tree traversal
-    string bit_string;
-    for (char compressed_byte : compressed_data) {
-        // Convert each byte to 8-bit binary string
-        bitset<8> bits(static_cast<unsigned char>(compressed_byte));
-        bit_string += bits.to_string();
+        report << "CPU Decompression completed successfully!" << endl;
+        report << left << setw(25) << "Execution time: " << right << setw(15) << seconds << "s" << setw(5)
+                << milliseconds << "ms" << endl;
+        return EXIT_SUCCESS;
     }
 
-    /*=========================================================================
-     * PADDING REMOVAL
-     *=========================================================================*/
+    // The container and manifest magics occupy the legacy size field (see block_format.h)
+    if (is_block_container(compressed.data, compressed.size) || is_stripe_manifest(compressed.data, compressed.size)) {
+        const int status = is_stripe_manifest(compressed.data, compressed.size)
+                               ? decompress_striped(compressed, options, progress)
+                               : decompress_block_container(compressed, options, progress);
+        if (status != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+        progress.finish();
+
+        const auto duration = std::chrono::duration<double>(high_resolution_clock::now() - start);
+        const int seconds = static_cast<int>(duration.count());
+        const int milliseconds = static_cast<int>((duration.count() - seconds) * 1000);
 
-    // Remove padding bits that were added during compression for byte alignment
-    if (padding != 8 && !bit_string.empty()) {
-        // Remove 'padding' number of bits from the end
-        bit_string = bit_string.substr(0, bit_string.length() - padding);
+        cout << "CPU Decompression completed successfully!" << endl;
+        std::cout << std::left << std::setw(25) << "Execution time: " << std::right << std::setw(15)
+                  << seconds << "s" << std::setw(5) << milliseconds << "ms" << std::endl;
+        return EXIT_SUCCESS;
     }
 
     /*=========================================================================
-     * HUFFMAN DECODING VIA TREE TRAVERSAL
+     * HUFFMAN TREE RECONSTRUCTION
      *=========================================================================*/
 
-    // Decode the bit string by traversing the Huffman tree
-    string decoded;
-    node* current = root;
-    size_t decoded_count = 0;
-
-    // Process each bit in the compressed bit stream
-    for (char bit : bit_string) {
-        // Stop if we've decoded the expected amount of data
-        if (decoded_count >= original_size) break;
-
-        // Navigate tree based on current bit
-        if (bit == '0') {
-            current = current->left;   // '0' bit → go left
-        } else {
-            current = current->right;  // '1' bit → go right
-        }
-
-        // Check if we've reached a leaf node (found a character)
-        if (!current->left && !current->right) {
-            decoded += current->character;  // Add character to output
-            decoded_count++;                // Track progress
-            current = root;                 // Reset to root for next character
-        }
+    // Parse the embedded tree in place and turn it into byte-step decode tables
+    legacy_file legacy;
+    if (string error; !parse_legacy_file(compressed.data, compressed.size, LEGACY_FORMAT_CPU_TREE, legacy, error)) {
+        cerr << "Error: Failed to deserialize Huffman tree (" << error << ")" << endl;
+        return EXIT_FAILURE;
     }
+    legacy_tree_decoder decoder;
+    decoder.initialize(legacy);
+    const uint64_t original_size = legacy.original_size;
 
     /*=========================================================================
-     * SPECIAL CASE HANDLING
+     * HUFFMAN DECODING FROM THE MAPPING
      *=========================================================================*/
 
-    // Handle single character files (edge case)
-    // If nothing was decoded, but we expect data, file contains only one character type
-    if (decoded.empty() && original_size > 0) {
-        decoded = string(original_size, root->character);
+    zero_buffer decoded;
+    if (string error; !decoded.allocate(original_size, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Decode in progress-sized steps; the decoder stops early only if the bit stream ends
+    progress.begin_stage("decode", original_size);
+    uint64_t decoded_count = 0;
+    while (decoded_count < original_size) {
+        const auto step = static_cast<size_t>(min<uint64_t>(PROGRESS_STEP_BYTES, original_size - decoded_count));
+        const size_t produced = decoder.decode(decoded.data + decoded_count, step);
+        decoded_count += produced;
+        progress.advance(produced);
+        if (produced < step) break;
     }
 
     /*=========================================================================
      * OUTPUT FILE GENERATION
      *=========================================================================*/
 
-    // Write the completely reconstructed original data
-    ofstream out_file(argv[2], ios::binary);
-    if (!out_file) {
-        cerr << "Error: Cannot create output file " << argv[2] << endl;
+    // Write the completely reconstructed original data; aligned zero runs become holes
+    const int out_file = open(options.output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_file < 0) {
+        cerr << "Error: Cannot create output file " << options.output_path << endl;
         return EXIT_FAILURE;
     }
 
-    out_file.write(decoded.c_str(), decoded.size());
-    out_file.close();
+    progress.begin_stage("write", decoded_count);
+    string write_error;
+    const bool written = write_sparse(out_file, decoded.data, decoded_count, 0, write_error) &&
+                         finish_sparse_file(out_file, decoded_count, write_error);
+    if (close(out_file) != 0 || !written) {
+        cerr << "Error: " << (write_error.empty() ? "Failed to write output file" : write_error) << endl;
+        return EXIT_FAILURE;
+    }
+    progress.advance(decoded_count);
+    progress.finish();
 
     /*=========================================================================
      * PERFORMANCE MEASUREMENT AND REPORTING
@@ -307,24 +842,11 @@ int main(int argc, char* argv[]) {
      *=========================================================================*/
 
     // Validate that decompressed size matches expected size
-    if (decoded.size() != original_size) {
+    if (decoded_count != original_size) {
         cout << "Warning: Size mismatch detected!" << endl;
         cout << "Expected: " << original_size << " bytes" << endl;
-        cout << "Actual: " << decoded.size() << " bytes" << endl;
+        cout << "Actual: " << decoded_count << " bytes" << endl;
     }
 
-    /*=========================================================================
-     * MEMORY CLEANUP
-     *=========================================================================*/
-
-    // Clean up the reconstructed tree to prevent memory leaks
-    function<void(node*)> delete_tree = [&](const node* node) {
-        if (!node) return;
-        delete_tree(node->left);
-        delete_tree(node->right);
-        delete node;
-    };
-    delete_tree(root);
-
     return EXIT_SUCCESS;
 }
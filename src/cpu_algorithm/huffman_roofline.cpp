@@ -0,0 +1,326 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <algorithm>
+#include <unistd.h>
+
+#include "bench_utilities.h"
+#include "block_format.h"
+#include "canonical_huffman.h"
+#include "data_statistics.h"
+#include "format_utilities.h"
+#include "worker_pool.h"
+
+/**
+ * @file huffman_roofline.cpp
+ * @brief Reports every coding stage as a fraction of the machine's measured memory bandwidth
+ *
+ * Usage: huffman_roofline [--size <MiB>] [--repeat <n>] [--threads <n>] <sample_file>
+ *
+ * Absolute MB/s do not say how much faster a stage could still get. This
+ * harness first measures what the memory system delivers - a read stream, a
+ * write stream (memset) and memcpy, on one thread and on all threads - over
+ * buffers of 4x the last-level cache (64-512 MiB, --size overrides). It then runs each stage on the
+ * sample (repeated up to the same size), chunk by chunk like the block coder:
+ * - histogram: accumulate_byte_histogram()
+ * - offsets: per-chunk bit counts under the sample's code and their prefix
+ *   sum, the scan that places every chunk's output (the GPU compressor's
+ *   offsets pass)
+ * - encode: huffman_encode_bytes() into the offsets found by the scan
+ * - decode: huffman_decode_bytes() back into a separate buffer
+ * - checksum: data_checksum()
+ *
+ * A stage's bound is the time its own traffic needs at the measured rates,
+ * bytes read / read bandwidth + bytes written / write bandwidth; the report
+ * gives achieved time as a fraction of it. Stages at or above
+ * ROOFLINE_BANDWIDTH_FRACTION are flagged bandwidth-bound (faster code would
+ * barely help), the rest compute-bound (they still leave memory idle).
+ */
+
+using namespace std;
+using namespace chrono;
+
+// Work unit of every kernel and stage (same as the container's default block)
+#define ROOFLINE_CHUNK_SIZE DEFAULT_BLOCK_SIZE
+
+// Default working set: 4x the last-level cache, clamped to this range
+#define ROOFLINE_MIN_BYTES (64ull << 20)
+#define ROOFLINE_MAX_BYTES (512ull << 20)
+
+// Share of the bandwidth bound from which a stage counts as bandwidth-bound
+#define ROOFLINE_BANDWIDTH_FRACTION 0.5
+
+/**
+ * @struct stage_result
+ * @brief Traffic and best timings of one stage (index 0: one thread, 1: all threads)
+ */
+struct stage_result {
+    const char *name;
+    uint64_t read_bytes = 0;
+    uint64_t written_bytes = 0;
+    double seconds[2] = {};
+};
+
+/**
+ * @brief Runs chunk(offset, length, worker) over [0, size) in ROOFLINE_CHUNK_SIZE pieces
+ */
+void for_each_chunk(const size_t size, const unsigned threads,
+                    const function<void(size_t offset, size_t length, unsigned worker)> &chunk) {
+    const size_t count = (size + ROOFLINE_CHUNK_SIZE - 1) / ROOFLINE_CHUNK_SIZE;
+    run_parallel(count, threads, [&](const size_t index, const unsigned worker) {
+        const size_t offset = index * ROOFLINE_CHUNK_SIZE;
+        chunk(offset, min<size_t>(ROOFLINE_CHUNK_SIZE, size - offset), worker);
+    });
+}
+
+/**
+ * @brief Last-level cache size from sysconf (0 if unknown)
+ */
+size_t last_level_cache_size() {
+    const long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    return static_cast<size_t>(max(0L, max(l3, l2)));
+}
+
+/**
+ * @brief Loads up to `size` bytes of a file and repeats them until `size` bytes
+ * @return false if the file cannot be read or is empty
+ */
+bool load_repeated(const char *path, const size_t size, vector<uint8_t> &data) {
+    ifstream input(path, ios::binary);
+    if (!input) return false;
+    vector<uint8_t> sample(size);
+    input.read(reinterpret_cast<char *>(sample.data()), static_cast<streamsize>(size));
+    const auto loaded = static_cast<size_t>(input.gcount());
+    if (loaded == 0) return false;
+
+    data.resize(size);
+    for (size_t offset = 0; offset < size; offset += loaded) {
+        memcpy(data.data() + offset, sample.data(), min(loaded, size - offset));
+    }
+    return true;
+}
+
+/**
+ * @brief Formats bytes per second as GB/s
+ */
+string gbps(const uint64_t bytes, const double seconds) {
+    ostringstream text;
+    text << fixed << setprecision(2) << (seconds > 0 ? static_cast<double>(bytes) / seconds / 1e9 : 0.0) << " GB/s";
+    return text.str();
+}
+
+int main(int argc, char *argv[]) {
+    /*=========================================================================
+     * ARGUMENT VALIDATION
+     *=========================================================================*/
+
+    size_t size = clamp<size_t>(4 * last_level_cache_size(), ROOFLINE_MIN_BYTES, ROOFLINE_MAX_BYTES);
+    int repeat = 3;
+    unsigned threads = default_thread_count();
+    const char *sample_path = nullptr;
+    bool valid = true;
+
+    for (int index = 1; index < argc && valid; index++) {
+        const string argument = argv[index];
+        const bool has_value = index + 1 < argc;
+        try {
+            if (argument == "--size" && has_value) {
+                size = static_cast<size_t>(stoull(argv[++index])) << 20;
+                valid = size != 0;
+            } else if (argument == "--repeat" && has_value) {
+                repeat = stoi(argv[++index]);
+                valid = repeat > 0;
+            } else if (argument == "--threads" && has_value) {
+                threads = static_cast<unsigned>(stoul(argv[++index]));
+                valid = threads > 0;
+            } else if (argument.rfind("--", 0) != 0 && !sample_path) {
+                sample_path = argv[index];
+            } else {
+                valid = false;
+            }
+        } catch (const exception &) {
+            valid = false;
+        }
+    }
+    if (!valid || !sample_path) {
+        cerr << "Usage: " << argv[0] << " [--size <MiB>] [--repeat <n>] [--threads <n>] <sample_file>" << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<uint8_t> data;
+    if (!load_repeated(sample_path, size, data)) {
+        cerr << "Error: Cannot read sample file " << sample_path << endl;
+        return EXIT_FAILURE;
+    }
+    const unsigned thread_counts[2] = {1, threads};
+
+    /*=========================================================================
+     * MEMORY BANDWIDTH
+     *=========================================================================*/
+
+    // Destination buffer, faulted in before anything is timed
+    vector<uint8_t> scratch(size, 1);
+    vector<uint64_t> sinks(threads, 0);
+    double read_seconds[2], write_seconds[2], copy_seconds[2];
+
+    for (int column = 0; column < 2; column++) {
+        const unsigned count = thread_counts[column];
+        read_seconds[column] = best_of(repeat, [&] {
+            for_each_chunk(size, count, [&](const size_t offset, const size_t length, const unsigned worker) {
+                // Four independent sums keep the loads, not the adds, on the critical path
+                uint64_t sum[4] = {};
+                const uint8_t *chunk = data.data() + offset;
+                size_t position = 0;
+                for (; position + 32 <= length; position += 32) {
+                    for (int lane = 0; lane < 4; lane++) {
+                        uint64_t word;
+                        memcpy(&word, chunk + position + 8 * lane, 8);
+                        sum[lane] += word;
+                    }
+                }
+                sinks[worker] += sum[0] + sum[1] + sum[2] + sum[3] + position;
+            });
+        });
+        write_seconds[column] = best_of(repeat, [&] {
+            for_each_chunk(size, count, [&](const size_t offset, const size_t length, const unsigned worker) {
+                memset(scratch.data() + offset, static_cast<int>(worker + 1), length);
+            });
+        });
+        copy_seconds[column] = best_of(repeat, [&] {
+            for_each_chunk(size, count, [&](const size_t offset, const size_t length, unsigned) {
+                memcpy(scratch.data() + offset, data.data() + offset, length);
+            });
+        });
+    }
+
+    /*=========================================================================
+     * STAGES
+     *=========================================================================*/
+
+    // One code for the whole sample, as a trained table would be
+    uint64_t frequency[HUFFMAN_BYTE_ALPHABET] = {};
+    accumulate_byte_histogram(data.data(), size, frequency);
+    uint8_t lengths[HUFFMAN_BYTE_ALPHABET];
+    build_code_lengths(frequency, HUFFMAN_BYTE_ALPHABET, HUFFMAN_MAX_CODE_LENGTH, lengths);
+    canonical_code code;
+    canonical_decoder decoder;
+    assign_canonical_codes(lengths, HUFFMAN_BYTE_ALPHABET, code);
+    build_canonical_decoder(lengths, HUFFMAN_BYTE_ALPHABET, decoder);
+
+    const size_t chunk_count = (size + ROOFLINE_CHUNK_SIZE - 1) / ROOFLINE_CHUNK_SIZE;
+    vector<uint64_t> chunk_bits(chunk_count);
+    vector<uint64_t> chunk_offsets(chunk_count + 1, 0);
+    vector<uint8_t> encoded((predicted_code_bits(frequency, lengths, HUFFMAN_BYTE_ALPHABET) + 7) / 8 +
+                            chunk_count);
+    vector<vector<uint64_t> > histograms(threads, vector<uint64_t>(HUFFMAN_BYTE_ALPHABET));
+    bool verified = true;
+
+    stage_result stages[] = {{"histogram"}, {"offsets"}, {"encode"}, {"decode"}, {"checksum"}};
+    const function<void(unsigned)> stage_runs[] = {
+        [&](const unsigned count) {
+            for_each_chunk(size, count, [&](const size_t offset, const size_t length, const unsigned worker) {
+                accumulate_byte_histogram(data.data() + offset, length, histograms[worker].data());
+            });
+        },
+        [&](const unsigned count) {
+            for_each_chunk(size, count, [&](const size_t offset, const size_t length, unsigned) {
+                uint64_t bits = 0;
+                for (size_t position = 0; position < length; position++) bits += lengths[data[offset + position]];
+                chunk_bits[offset / ROOFLINE_CHUNK_SIZE] = bits;
+            });
+            for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+                chunk_offsets[chunk + 1] = chunk_offsets[chunk] + (chunk_bits[chunk] + 7) / 8;
+            }
+        },
+        [&](const unsigned count) {
+            for_each_chunk(size, count, [&](const size_t offset, const size_t length, unsigned) {
+                huffman_encode_bytes(data.data() + offset, length, code,
+                                     encoded.data() + chunk_offsets[offset / ROOFLINE_CHUNK_SIZE]);
+            });
+        },
+        [&](const unsigned count) {
+            for_each_chunk(size, count, [&](const size_t offset, const size_t length, unsigned) {
+                const size_t chunk = offset / ROOFLINE_CHUNK_SIZE;
+                if (!huffman_decode_bytes(encoded.data() + chunk_offsets[chunk],
+                                          chunk_offsets[chunk + 1] - chunk_offsets[chunk], decoder,
+                                          scratch.data() + offset, length)) {
+                    verified = false;
+                }
+            });
+        },
+        [&](const unsigned count) {
+            for_each_chunk(size, count, [&](const size_t offset, const size_t length, const unsigned worker) {
+                sinks[worker] += data_checksum(data.data() + offset, length);
+            });
+        },
+    };
+
+    for (int column = 0; column < 2; column++) {
+        for (size_t stage = 0; stage < sizeof(stages) / sizeof(stages[0]); stage++) {
+            stages[stage].seconds[column] = best_of(repeat, [&] { stage_runs[stage](thread_counts[column]); });
+        }
+    }
+    const uint64_t encoded_size = chunk_offsets[chunk_count];
+    verified = verified && memcmp(scratch.data(), data.data(), size) == 0;
+
+    stages[0].read_bytes = size;
+    stages[1].read_bytes = size;
+    stages[2].read_bytes = size;
+    stages[2].written_bytes = encoded_size;
+    stages[3].read_bytes = encoded_size;
+    stages[3].written_bytes = size;
+    stages[4].read_bytes = size;
+
+    /*=========================================================================
+     * REPORT
+     *=========================================================================*/
+
+    if (!verified) {
+        cerr << "Error: Decoded data does not match the sample" << endl;
+        return EXIT_FAILURE;
+    }
+
+    cout << left << setw(25) << "Working set: " << right << setw(20) << size << "  B  (sample repeated, "
+            << chunk_count << " chunks)" << endl;
+    cout << left << setw(25) << "Threads: " << right << setw(20) << threads << endl;
+    cout << left << setw(25) << "Compression ratio: " << right << setw(20) << fixed << setprecision(4)
+            << static_cast<double>(encoded_size) / static_cast<double>(size) << endl;
+    cout << endl << left << setw(25) << "Bandwidth" << right << setw(16) << "1 thread" << setw(16)
+            << (to_string(threads) + " threads") << endl;
+    cout << left << setw(25) << "Read stream: " << right << setw(16) << gbps(size, read_seconds[0]) << setw(16)
+            << gbps(size, read_seconds[1]) << endl;
+    cout << left << setw(25) << "Write stream (memset): " << right << setw(16) << gbps(size, write_seconds[0])
+            << setw(16) << gbps(size, write_seconds[1]) << endl;
+    cout << left << setw(25) << "memcpy: " << right << setw(16) << gbps(size, copy_seconds[0]) << setw(16)
+            << gbps(size, copy_seconds[1]) << endl;
+
+    cout << endl << left << setw(12) << "Stage" << right << setw(12) << "1T MB/s" << setw(10) << "bound" << setw(12)
+            << "NT MB/s" << setw(10) << "bound" << "  verdict (all threads)" << endl;
+    for (const stage_result &stage: stages) {
+        cout << left << setw(12) << stage.name << right;
+        double fraction = 0.0;
+        for (int column = 0; column < 2; column++) {
+            // Time the stage's own traffic needs at the measured stream rates
+            const double bound_seconds =
+                    static_cast<double>(stage.read_bytes) * read_seconds[column] / static_cast<double>(size) +
+                    static_cast<double>(stage.written_bytes) * write_seconds[column] / static_cast<double>(size);
+            fraction = stage.seconds[column] > 0 ? bound_seconds / stage.seconds[column] : 0.0;
+            cout << setw(12) << setprecision(1) << static_cast<double>(size) / stage.seconds[column] / 1e6
+                    << setw(9) << setprecision(0) << fraction * 100 << "%";
+        }
+        cout << "  " << (fraction >= ROOFLINE_BANDWIDTH_FRACTION ? "bandwidth-bound" : "compute-bound") << endl;
+    }
+
+    // Keeps the read and checksum kernels from being optimized away
+    uint64_t sink = 0;
+    for (const uint64_t value: sinks) sink ^= value;
+    if (sink == 1) cout << endl;
+    return EXIT_SUCCESS;
+}
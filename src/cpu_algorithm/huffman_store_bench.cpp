@@ -0,0 +1,219 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <atomic>
+#include <filesystem>
+
+#include "block_format.h"
+#include "code_tables.h"
+#include "compressed_store.h"
+#include "worker_pool.h"
+
+/**
+ * @file huffman_store_bench.cpp
+ * @brief Measures the compressed value store: memory saved, put / get latency and cache behaviour
+ *
+ * Usage: huffman_store_bench [--value-size <KiB>] [--values <n>] [--readers <n>] [--gets <n>]
+ *                            [--cache <MiB>] [--block-size <bytes>] [--tables <file>] <sample_file>
+ *
+ * Values are --value-size slices of the sample, taken cyclically at
+ * different offsets so that they are not identical. All of them are put
+ * once, then --readers threads each issue --gets reads into their own
+ * buffer; 80 % of the reads go to the hottest 20 % of the keys, as in a
+ * typical caching tier. Every 16th read is compared with the original.
+ */
+
+using namespace std;
+using namespace chrono;
+namespace fs = std::filesystem;
+
+// Share of reads that go to the hot fifth of the keys
+#define BENCH_HOT_READ_PERCENT 80
+
+// Every n-th read is compared with the original value
+#define BENCH_VERIFY_EVERY 16
+
+/**
+ * @brief Builds value `index`: value_size bytes of the sample starting at a per-value offset
+ */
+static void make_value(const vector<uint8_t> &sample, const size_t index, const size_t value_size,
+                       uint8_t *value) {
+    size_t position = index * 7919 * 4096 % sample.size();
+    for (size_t filled = 0; filled < value_size;) {
+        const size_t length = min(value_size - filled, sample.size() - position);
+        memcpy(value + filled, sample.data() + position, length);
+        filled += length;
+        position = 0;
+    }
+}
+
+static string value_key(const size_t index) {
+    return "value:" + to_string(index);
+}
+
+int main(int argc, char *argv[]) {
+    size_t value_size = 1024 << 10;
+    size_t value_count = 64;
+    unsigned readers = default_thread_count();
+    size_t gets_per_reader = 256;
+    size_t cache_bytes = STORE_DEFAULT_CACHE_BYTES;
+    uint32_t block_size = DEFAULT_BLOCK_SIZE;
+    const char *tables_path = nullptr;
+    const char *input_path = nullptr;
+    for (int index = 1; index < argc; index++) {
+        const string argument = argv[index];
+        try {
+            if (argument == "--value-size" && index + 1 < argc) {
+                value_size = stoul(argv[++index]) << 10;
+                continue;
+            }
+            if (argument == "--values" && index + 1 < argc) {
+                value_count = stoul(argv[++index]);
+                continue;
+            }
+            if (argument == "--readers" && index + 1 < argc) {
+                readers = static_cast<unsigned>(stoul(argv[++index]));
+                continue;
+            }
+            if (argument == "--gets" && index + 1 < argc) {
+                gets_per_reader = stoul(argv[++index]);
+                continue;
+            }
+            if (argument == "--cache" && index + 1 < argc) {
+                cache_bytes = stoul(argv[++index]) << 20;
+                continue;
+            }
+            if (argument == "--block-size" && index + 1 < argc) {
+                block_size = static_cast<uint32_t>(stoul(argv[++index]));
+                continue;
+            }
+            if (argument == "--tables" && index + 1 < argc) {
+                tables_path = argv[++index];
+                continue;
+            }
+        } catch (const exception &) {
+            input_path = nullptr;
+            break;
+        }
+        if (argument.rfind("--", 0) == 0 || input_path) {
+            input_path = nullptr;
+            break;
+        }
+        input_path = argv[index];
+    }
+    if (!input_path || value_size == 0 || value_count == 0 || readers == 0 || block_size == 0) {
+        cerr << "Usage: " << argv[0] << " [--value-size <KiB>] [--values <n>] [--readers <n>] [--gets <n>]"
+                << " [--cache <MiB>] [--block-size <bytes>] [--tables <file>] <sample_file>" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // A directory opens fine but throws on the first read
+    error_code status;
+    ifstream input(input_path, ios::binary);
+    if (!fs::is_regular_file(input_path, status) || !input) {
+        cerr << "Error: Cannot open input file " << input_path << endl;
+        return EXIT_FAILURE;
+    }
+    const vector<uint8_t> sample{istreambuf_iterator(input), istreambuf_iterator<char>()};
+    if (sample.empty()) {
+        cerr << "Error: Input file is empty" << endl;
+        return EXIT_FAILURE;
+    }
+
+    code_table_set tables;
+    if (tables_path) {
+        if (string error; !load_code_tables(tables_path, tables, error)) {
+            cerr << "Error: " << error << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto start_time = steady_clock::now();
+
+    block_encoder_settings settings;
+    settings.block_size = block_size;
+    settings.tables = tables_path ? &tables : nullptr;
+    compressed_store store(settings, cache_bytes);
+
+    /*=== PUT ===*/
+    vector<uint8_t> value(value_size);
+    const auto put_start = steady_clock::now();
+    for (size_t index = 0; index < value_count; index++) {
+        make_value(sample, index, value_size, value.data());
+        store.put(value_key(index), value.data(), value_size);
+    }
+    const double put_seconds = duration<double>(steady_clock::now() - put_start).count();
+
+    /*=== GET ===*/
+    atomic<uint64_t> failures{0};
+    const size_t hot_count = max<size_t>(1, value_count / 5);
+    const auto get_start = steady_clock::now();
+    run_parallel(readers, readers, [&](const size_t reader, unsigned) {
+        mt19937_64 random(reader + 1);
+        vector<uint8_t> output(value_size);
+        vector<uint8_t> expected(value_size);
+        string error;
+        for (size_t read = 0; read < gets_per_reader; read++) {
+            const bool hot = random() % 100 < BENCH_HOT_READ_PERCENT;
+            const size_t index = hot ? random() % hot_count : random() % value_count;
+            size_t size = 0;
+            if (!store.get(value_key(index), output.data(), output.size(), size, error)) {
+                cerr << "Error: " << error << endl;
+                failures.fetch_add(1, memory_order_relaxed);
+                continue;
+            }
+            if (read % BENCH_VERIFY_EVERY == 0) {
+                make_value(sample, index, value_size, expected.data());
+                if (size != value_size || memcmp(output.data(), expected.data(), value_size) != 0) {
+                    failures.fetch_add(1, memory_order_relaxed);
+                }
+            }
+        }
+    });
+    const double get_seconds = duration<double>(steady_clock::now() - get_start).count();
+
+    const auto end_time = steady_clock::now();
+
+    /*=== REPORT ===*/
+    const store_statistics stats = store.statistics();
+    const uint64_t gets = store.get_latency.count.load();
+    const auto mbps = [&](const double bytes, const double seconds) {
+        return seconds > 0 ? bytes / seconds / 1e6 : 0.0;
+    };
+    cout << left << setw(25) << "Values: " << right << setw(20) << stats.values << " x " << value_size
+            << " bytes" << endl;
+    cout << left << setw(25) << "Raw size: " << right << setw(20) << stats.raw_bytes << " bytes" << endl;
+    cout << left << setw(25) << "Resident size: " << right << setw(20) << stats.resident_bytes << " bytes" << endl;
+    cout << left << setw(25) << "Memory saved: " << right << setw(19) << fixed << setprecision(2)
+            << stats.savings() * 100.0 << "%" << endl;
+    cout << left << setw(25) << "Hot cache: " << right << setw(20) << stats.cache_bytes << " / " << cache_bytes
+            << " bytes" << endl;
+    cout << left << setw(25) << "Put throughput: " << right << setw(20) << setprecision(1)
+            << mbps(static_cast<double>(stats.raw_bytes), put_seconds) << " MB/s" << endl;
+    cout << left << setw(25) << "Put latency: " << right << setw(20) << store.put_latency.mean_microseconds()
+            << " us mean, p50 " << store.put_latency.quantile_microseconds(0.5) << " us, p99 "
+            << store.put_latency.quantile_microseconds(0.99) << " us" << endl;
+    cout << left << setw(25) << "Get throughput: " << right << setw(20)
+            << mbps(static_cast<double>(gets * value_size), get_seconds) << " MB/s (" << readers << " readers)"
+            << endl;
+    cout << left << setw(25) << "Get latency: " << right << setw(20) << store.get_latency.mean_microseconds()
+            << " us mean, p50 " << store.get_latency.quantile_microseconds(0.5) << " us, p99 "
+            << store.get_latency.quantile_microseconds(0.99) << " us" << endl;
+    cout << left << setw(25) << "Cache hit rate: " << right << setw(19) << setprecision(2)
+            << (gets ? 100.0 * static_cast<double>(stats.cache_hits) / static_cast<double>(gets) : 0.0) << "%"
+            << endl;
+    cout << left << setw(25) << "Verification: " << right << setw(20) << (failures == 0 ? "passed" : "FAILED")
+            << endl;
+
+    const auto total_duration = duration<double>(end_time - start_time);
+    const int seconds = static_cast<int>(total_duration.count());
+    const int milliseconds = static_cast<int>((total_duration.count() - seconds) * 1000);
+    cout << left << setw(25) << "Execution time: " << right << setw(15) << seconds << "s" << setw(5)
+            << milliseconds << "ms" << endl;
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,154 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <array>
+#include <string>
+#include <iomanip>
+
+#include "code_tables.h"
+
+/**
+ * @file huffman_train.cpp
+ * @brief Builds shared Huffman code tables from a corpus of sample files
+ *
+ * Usage: huffman_train [--clusters K] <table_file> <sample_file_or_directory>...
+ *
+ * Workflow:
+ * 1. Collect a byte histogram for every sample file (directories are walked recursively)
+ * 2. Group similar files into K clusters (k-means over normalized histograms)
+ * 3. Build one length-limited canonical code per cluster
+ * 4. Save the versioned table set for `cpu_huffman_compression --tables`
+ *
+ * Files compressed against the set only store a one-byte table id per block,
+ * so for many small, similar files the per-file code disappears entirely.
+ */
+
+using namespace std;
+namespace fs = std::filesystem;
+
+/**
+ * @brief Adds a sample path (or every regular file below a directory) to the list
+ */
+void collect_samples(const fs::path &path, vector<fs::path> &samples) {
+    if (fs::is_directory(path)) {
+        for (const auto &entry: fs::recursive_directory_iterator(path)) {
+            if (entry.is_regular_file()) samples.push_back(entry.path());
+        }
+    } else {
+        samples.push_back(path);
+    }
+}
+
+/**
+ * @brief Counts byte occurrences of one file
+ * @return false if the file cannot be read
+ */
+bool file_histogram(const fs::path &path, array<uint64_t, HUFFMAN_BYTE_ALPHABET> &histogram) {
+    ifstream input(path, ios::binary);
+    if (!input) return false;
+
+    histogram.fill(0);
+    vector<char> buffer(1 << 20);
+    while (input.read(buffer.data(), static_cast<streamsize>(buffer.size())) || input.gcount() > 0) {
+        const auto count = static_cast<size_t>(input.gcount());
+        for (size_t index = 0; index < count; index++) {
+            histogram[static_cast<uint8_t>(buffer[index])]++;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    /*=========================================================================
+     * ARGUMENT PARSING
+     *=========================================================================*/
+
+    unsigned cluster_count = 1;
+    int first_argument = 1;
+    if (argc > 2 && string(argv[1]) == "--clusters") {
+        try {
+            cluster_count = static_cast<unsigned>(stoul(argv[2]));
+        } catch (const exception &) {
+            cluster_count = 0;
+        }
+        first_argument = 3;
+    }
+
+    if (argc - first_argument < 2 || cluster_count == 0 || cluster_count > MAX_CODE_TABLES) {
+        cerr << "Usage: " << argv[0] << " [--clusters <1-" << MAX_CODE_TABLES << ">]"
+                << " <table_file> <sample_file_or_directory>..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    const char *table_path = argv[first_argument];
+    vector<fs::path> samples;
+    for (int index = first_argument + 1; index < argc; index++) {
+        collect_samples(argv[index], samples);
+    }
+
+    /*=========================================================================
+     * SAMPLE HISTOGRAMS
+     *=========================================================================*/
+
+    vector<array<uint64_t, HUFFMAN_BYTE_ALPHABET> > histograms;
+    vector<fs::path> used_samples;
+    uint64_t total_bytes = 0;
+    for (const fs::path &sample: samples) {
+        array<uint64_t, HUFFMAN_BYTE_ALPHABET> histogram{};
+        if (!file_histogram(sample, histogram)) {
+            cerr << "Warning: Skipping unreadable sample " << sample << endl;
+            continue;
+        }
+        uint64_t size = 0;
+        for (const uint64_t count: histogram) size += count;
+        if (size == 0) continue; // Empty files carry no statistics
+
+        histograms.push_back(histogram);
+        used_samples.push_back(sample);
+        total_bytes += size;
+    }
+
+    if (histograms.empty()) {
+        cerr << "Error: No non-empty sample files found" << endl;
+        return EXIT_FAILURE;
+    }
+
+    /*=========================================================================
+     * TRAINING AND OUTPUT
+     *=========================================================================*/
+
+    code_table_set set;
+    vector<unsigned> assignment;
+    train_code_tables(histograms, cluster_count, set, assignment);
+
+    if (string error; !save_code_tables(table_path, set, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Per-table summary: member files and predicted size of their payloads
+    vector<uint64_t> table_files(set.tables.size(), 0), table_raw(set.tables.size(), 0),
+            table_bits(set.tables.size(), 0);
+    for (size_t sample = 0; sample < histograms.size(); sample++) {
+        const unsigned table = assignment[sample];
+        table_files[table]++;
+        for (const uint64_t count: histograms[sample]) table_raw[table] += count;
+        table_bits[table] += predicted_code_bits(histograms[sample].data(), set.tables[table].lengths.data(),
+                                                 HUFFMAN_BYTE_ALPHABET);
+    }
+
+    cout << left << setw(25) << "Samples: " << right << setw(20) << histograms.size() << endl;
+    cout << left << setw(25) << "Sample bytes: " << right << setw(20) << total_bytes << "  B" << endl;
+    cout << left << setw(25) << "Tables: " << right << setw(20) << set.tables.size() << endl;
+    cout << left << setw(25) << "Table set id: " << right << setw(20) << hex << set.set_id << dec << endl;
+    for (size_t table = 0; table < set.tables.size(); table++) {
+        cout << "  table " << setw(3) << table << ": " << setw(8) << table_files[table] << " files, "
+                << fixed << setprecision(3)
+                << (table_raw[table] ? static_cast<double>(table_bits[table]) / table_raw[table] : 0.0)
+                << " bits/byte" << endl;
+    }
+
+    cout << "Tables written to " << table_path << endl;
+    return EXIT_SUCCESS;
+}
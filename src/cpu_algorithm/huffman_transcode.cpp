@@ -0,0 +1,271 @@
+#include <array>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <iomanip>
+
+#include "block_format.h"
+#include "data_statistics.h"
+#include "legacy_formats.h"
+#include "mapped_file.h"
+#include "progress_reporter.h"
+#include "sparse_file.h"
+#include "worker_pool.h"
+
+/**
+ * @file huffman_transcode.cpp
+ * @brief Converts legacy CPU tree and GPU frequency files into the block container in memory
+ *
+ * Usage: huffman_transcode [--format cpu|gpu] [--block-size <bytes>] [--threads <n>] [--progress <path|->]
+ *                          <legacy_file> <output_file>
+ *
+ * The legacy file is memory-mapped and decoded in place (mapped_file.h).
+ * The legacy bit stream has no index, so it is decoded sequentially
+ * (legacy_formats.h) - but only one batch of blocks ahead: while the workers
+ * code batch N into the container, a decoder thread fills the other buffer
+ * with batch N + 1. The uncompressed data never reaches the disk and only two
+ * batches (threads * 4 blocks each) are held in memory.
+ *
+ * Verification as it goes:
+ * - every batch must decode to its full size before the stream ends
+ * - the stream must end exactly after the last symbol (no unused bytes)
+ * - GPU files: the decoded byte histogram must equal the header frequencies
+ * - the container's index adds up to the legacy file's original size
+ */
+
+using namespace std;
+using namespace chrono;
+
+/**
+ * @struct transcode_options
+ * @brief Parsed command line of the transcoder
+ */
+struct transcode_options {
+    const char *input_path = nullptr;
+    const char *output_path = nullptr;
+    const char *progress_path = nullptr;
+    legacy_format format = LEGACY_FORMAT_UNKNOWN;
+    uint32_t block_size = DEFAULT_BLOCK_SIZE;
+    unsigned threads = 0;
+};
+
+/**
+ * @brief Parses `[options] <legacy_file> <output_file>`
+ */
+bool parse_arguments(const int argc, char *argv[], transcode_options &options) {
+    int positional = 0;
+    for (int index = 1; index < argc; index++) {
+        const string argument = argv[index];
+        const bool has_value = index + 1 < argc;
+
+        try {
+            if (argument == "--format" && has_value) {
+                const string value = argv[++index];
+                if (value == "cpu") options.format = LEGACY_FORMAT_CPU_TREE;
+                else if (value == "gpu") options.format = LEGACY_FORMAT_GPU_FREQUENCY;
+                else return false;
+                continue;
+            }
+            if (argument == "--block-size" && has_value) {
+                options.block_size = static_cast<uint32_t>(stoul(argv[++index]));
+                if (options.block_size == 0) return false;
+                continue;
+            }
+            if (argument == "--threads" && has_value) {
+                options.threads = static_cast<unsigned>(stoul(argv[++index]));
+                if (options.threads == 0) return false;
+                continue;
+            }
+            if (argument == "--progress" && has_value) {
+                options.progress_path = argv[++index];
+                continue;
+            }
+        } catch (const exception &) {
+            return false;
+        }
+
+        if (argument.rfind("--", 0) == 0) {
+            return false;
+        } else if (positional == 0) {
+            options.input_path = argv[index];
+        } else if (positional == 1) {
+            options.output_path = argv[index];
+        } else {
+            return false;
+        }
+        positional++;
+    }
+    return positional == 2;
+}
+
+int main(int argc, char *argv[]) {
+    /*=========================================================================
+     * ARGUMENT VALIDATION
+     *=========================================================================*/
+
+    transcode_options options;
+    if (!parse_arguments(argc, argv, options)) {
+        cerr << "Usage: " << argv[0] << " [--format cpu|gpu] [--block-size <bytes>] [--threads <n>]"
+                << " [--progress <path|->] <legacy_file> <output_file>" << endl;
+        return EXIT_FAILURE;
+    }
+    const auto start = high_resolution_clock::now();
+
+    progress_reporter progress;
+    if (string error; options.progress_path && !progress.open(options.progress_path, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    /*=========================================================================
+     * LEGACY FILE INPUT
+     *=========================================================================*/
+
+    progress.begin_stage("read", 0);
+    mapped_file input;
+    legacy_file legacy;
+    if (string error; !input.open(options.input_path, false, error)) {
+        cerr << "Error: " << error << endl;
+        return EXIT_FAILURE;
+    }
+    progress.advance(input.size);
+    if (is_block_container(input.data, input.size)) {
+        cerr << "Error: " << options.input_path << " is already a block container" << endl;
+        return EXIT_FAILURE;
+    }
+    if (string error; !parse_legacy_file(input.data, input.size, options.format, legacy, error)) {
+        cerr << "Error: " << options.input_path << ": " << error << endl;
+        return EXIT_FAILURE;
+    }
+
+    legacy_tree_decoder decoder;
+    decoder.initialize(legacy);
+
+    /*=========================================================================
+     * PIPELINED DECODE AND ENCODE
+     *=========================================================================*/
+
+    block_encoder_settings settings;
+    settings.block_size = options.block_size;
+    settings.thread_count = options.threads ? options.threads : default_thread_count();
+
+    ofstream out_file(options.output_path, ios::binary);
+    if (!out_file) {
+        cerr << "Error: Cannot create output file " << options.output_path << endl;
+        return EXIT_FAILURE;
+    }
+    block_container_writer writer(out_file);
+    writer.begin(settings.block_size, 0);
+
+    const size_t batch_blocks = static_cast<size_t>(settings.thread_count) * 4;
+    const uint64_t batch_bytes = static_cast<uint64_t>(batch_blocks) * settings.block_size;
+    vector<uint8_t> buffers[2];
+    uint64_t buffer_sizes[2] = {};
+    uint64_t decoded_total = 0;
+    double decode_seconds = 0.0;
+
+    // Decodes the next batch into a buffer; false once the bit stream ran out early
+    const auto decode_batch = [&](const int buffer) {
+        const auto decode_start = steady_clock::now();
+        const uint64_t wanted = min(batch_bytes, legacy.original_size - decoded_total);
+        buffers[buffer].resize(wanted);
+        buffer_sizes[buffer] = decoder.decode(buffers[buffer].data(), wanted);
+        decoded_total += buffer_sizes[buffer];
+        decode_seconds += duration<double>(steady_clock::now() - decode_start).count();
+        return buffer_sizes[buffer] == wanted;
+    };
+
+    vector<encoded_block> blocks(batch_blocks);
+    vector<array<uint64_t, HUFFMAN_BYTE_ALPHABET> > histograms(settings.thread_count);
+    const bool check_histogram = legacy.format == LEGACY_FORMAT_GPU_FREQUENCY;
+
+    progress.begin_stage("transcode", legacy.original_size);
+    int current = 0;
+    bool complete = decode_batch(current);
+    while (complete && buffer_sizes[current] > 0) {
+        // Decode ahead on a second thread while this batch is coded
+        thread decode_ahead;
+        bool ahead_complete = true;
+        if (decoded_total < legacy.original_size) {
+            decode_ahead = thread([&, next = 1 - current] { ahead_complete = decode_batch(next); });
+        } else {
+            buffer_sizes[1 - current] = 0;
+        }
+
+        const uint8_t *data = buffers[current].data();
+        const uint64_t size = buffer_sizes[current];
+        const size_t count = (size + settings.block_size - 1) / settings.block_size;
+        encode_block_batch(data, size, settings, 0, count, blocks.data(), nullptr);
+        if (check_histogram) {
+            run_parallel(count, settings.thread_count, [&](const size_t slot, const unsigned worker) {
+                const size_t offset = slot * settings.block_size;
+                accumulate_byte_histogram(data + offset, min<uint64_t>(settings.block_size, size - offset),
+                                          histograms[worker].data());
+            });
+        }
+        for (size_t slot = 0; slot < count; slot++) writer.append(blocks[slot]);
+        progress.advance(size);
+
+        if (decode_ahead.joinable()) decode_ahead.join();
+        complete = ahead_complete;
+        current = 1 - current;
+    }
+
+    /*=========================================================================
+     * VERIFICATION
+     *=========================================================================*/
+
+    if (!complete || decoded_total != legacy.original_size) {
+        cerr << "Error: Bit stream ends after " << decoded_total << " of " << legacy.original_size << " bytes" << endl;
+        return EXIT_FAILURE;
+    }
+    if (decoder.single_symbol < 0 && decoder.position != decoder.bit_bytes) {
+        cerr << "Error: " << decoder.bit_bytes - decoder.position << " unused bytes after the last symbol" << endl;
+        return EXIT_FAILURE;
+    }
+    if (check_histogram) {
+        for (unsigned symbol = 0; symbol < HUFFMAN_BYTE_ALPHABET; symbol++) {
+            uint64_t total = 0;
+            for (const auto &histogram: histograms) total += histogram[symbol];
+            if (total != legacy.frequency[symbol]) {
+                cerr << "Error: Byte " << symbol << " decoded " << total << " times, header says "
+                        << legacy.frequency[symbol] << endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    if (!writer.finish() || writer.original_size != legacy.original_size) {
+        cerr << "Error: Failed to write output file " << options.output_path << endl;
+        return EXIT_FAILURE;
+    }
+    progress.finish();
+
+    /*=========================================================================
+     * PERFORMANCE REPORTING
+     *=========================================================================*/
+
+    const auto duration = std::chrono::duration<double>(high_resolution_clock::now() - start);
+    const int seconds = static_cast<int>(duration.count());
+    const int milliseconds = static_cast<int>((duration.count() - seconds) * 1000);
+    const auto mbps = [&](const double time) {
+        return time > 0 ? static_cast<double>(legacy.original_size) / time / 1e6 : 0.0;
+    };
+
+    cout << "Transcoding completed successfully!" << endl;
+    cout << left << setw(25) << "Legacy format: " << right << setw(20) << legacy_format_name(legacy.format) << endl;
+    cout << left << setw(25) << "Legacy file size: " << right << setw(20) << input.size << "  B" << endl;
+    cout << left << setw(25) << "Original size: " << right << setw(20) << legacy.original_size << "  B" << endl;
+    cout << left << setw(25) << "Container size: " << right << setw(20) << writer.position << "  B" << endl;
+    cout << left << setw(25) << "Blocks: " << right << setw(20) << writer.index.size() << endl;
+    cout << left << setw(25) << "Threads: " << right << setw(20) << settings.thread_count << endl;
+    cout << left << setw(25) << "Decode throughput: " << right << setw(20) << fixed << setprecision(1)
+            << mbps(decode_seconds) << "  MB/s" << endl;
+    cout << left << setw(25) << "Overall throughput: " << right << setw(20) << mbps(duration.count()) << "  MB/s"
+            << endl;
+    cout << left << setw(25) << "Execution time: " << right << setw(15) << seconds << "s" << setw(5) << milliseconds
+            << "ms" << endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cstring>
+
+#include "format_utilities.h"
+#include "in_place_decode.h"
+#include "worker_pool.h"
+
+/**
+ * @file in_place_decode.cpp
+ * @brief Margin computation and wave-parallel in-place decoding of block containers
+ */
+
+using namespace std;
+
+uint64_t in_place_margin(const block_container &container, const uint64_t compressed_size) {
+    // Block i may be decoded once output_end(i) <= tail_start + offset(i), tail_start = original + margin - compressed
+    uint64_t margin = 0;
+    uint64_t output_end = 0;
+    for (const block_index_entry &entry: container.blocks) {
+        output_end += entry.raw_size;
+        const uint64_t needed = output_end + compressed_size - entry.offset;
+        if (needed > container.original_size) margin = max(margin, needed - container.original_size);
+    }
+    return margin;
+}
+
+uint64_t in_place_margin_bound(const uint32_t block_size, const uint32_t block_count) {
+    return block_size + static_cast<uint64_t>(block_count) * (BLOCK_HEADER_SIZE + BLOCK_INDEX_ENTRY_SIZE) +
+           BLOCK_HEADER_SIZE + BLOCK_TRAILER_SIZE;
+}
+
+bool peek_block_container(const uint8_t *header, const uint8_t *trailer, uint64_t &original_size,
+                          uint32_t &block_size, uint32_t &block_count, string &error) {
+    if (!is_block_container(header, BLOCK_FILE_HEADER_SIZE) || memcmp(trailer + 24, BLOCK_INDEX_MAGIC, 8) != 0) {
+        error = "Not a complete block container";
+        return false;
+    }
+    block_size = read_u32(header + 12);
+    original_size = read_u64(trailer);
+    block_count = read_u32(trailer + 8);
+    return true;
+}
+
+bool decode_in_place(uint8_t *buffer, const size_t buffer_size, const size_t compressed_size,
+                     const code_table_set *tables, string &error, const decoder_engine engine,
+                     const unsigned thread_count) {
+    if (compressed_size > buffer_size) {
+        error = "Compressed data is larger than the buffer";
+        return false;
+    }
+    const size_t tail_start = buffer_size - compressed_size;
+    const uint8_t *container_data = buffer + tail_start;
+
+    // The index is copied out by parsing, so the trailer may be overwritten later on
+    block_container container;
+    if (!parse_block_container(container_data, compressed_size, container, error)) return false;
+
+    const size_t block_count = container.blocks.size();
+    for (size_t index = 1; index < block_count; index++) {
+        if (container.blocks[index].offset <= container.blocks[index - 1].offset) {
+            error = "Container blocks are not in file order";
+            return false;
+        }
+    }
+    if (container.original_size + in_place_margin(container, compressed_size) > buffer_size) {
+        error = "Buffer of " + to_string(buffer_size) + " B is too small to decode in place (needs " +
+                to_string(container.original_size + in_place_margin(container, compressed_size)) + " B)";
+        return false;
+    }
+
+    vector<uint64_t> output_offsets(block_count + 1, 0);
+    for (size_t index = 0; index < block_count; index++) {
+        output_offsets[index + 1] = output_offsets[index] + container.blocks[index].raw_size;
+    }
+
+    // A wave is a run of blocks that all write below the first byte any of them reads
+    vector<string> block_errors(block_count);
+    size_t first = 0;
+    while (first < block_count) {
+        const uint64_t wave_input = tail_start + container.blocks[first].offset;
+        size_t end = first + 1;
+        while (end < block_count && output_offsets[end + 1] <= wave_input) end++;
+
+        run_parallel(end - first, max(1u, thread_count), [&](const size_t slot, unsigned) {
+            const size_t index = first + slot;
+            decode_block(container, container_data, container.blocks[index], tables, buffer + output_offsets[index],
+                         block_errors[index], engine);
+        });
+        for (size_t index = first; index < end; index++) {
+            if (!block_errors[index].empty()) {
+                error = block_errors[index] + " (block at offset " + to_string(container.blocks[index].offset) + ")";
+                return false;
+            }
+        }
+        first = end;
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "block_format.h"
+
+/**
+ * @file in_place_decode.h
+ * @brief Decoding a block container inside the buffer that holds it
+ *
+ * A consumer that holds a compressed blob in memory normally needs a second
+ * buffer of the original size to decode it into. Here the container is
+ * placed at the tail of one buffer of original_size + margin bytes, and the
+ * decoded data grows from the front of the same buffer:
+ *
+ *     [ decoded data ->          ][ margin ][    compressed container    ]
+ *     0                                      buffer_size - compressed_size
+ *
+ * Safety rule: a block is only decoded once its whole output range ends at
+ * or before the first byte of its own block header in the buffer. Every
+ * later block starts further back in the buffer, so no compressed byte that
+ * is still needed is ever overwritten. This is independent of the order in
+ * which a decoder reads its input and writes its output. The margin is the
+ * smallest tail gap for which the rule holds for every block:
+ *
+ *     margin = max(0, max over blocks i of (compressed bytes from block i to
+ *              the end of the container) - (original bytes after block i))
+ *
+ * Blocks never store more than their raw size plus the 12-byte header, so
+ * before the index has been read the margin is at most
+ *
+ *     block_size + block_count * (BLOCK_HEADER_SIZE + BLOCK_INDEX_ENTRY_SIZE)
+ *                + BLOCK_HEADER_SIZE + BLOCK_TRAILER_SIZE
+ *
+ * (in_place_margin_bound): one block plus 36 bytes per block. For 256 KiB
+ * blocks that is 256 KiB plus about 0.01 % of the original size. The block
+ * count comes from the trailer, since incremental runs may write more blocks
+ * than original_size / block_size (see incremental_update.h).
+ * decode_in_place() checks the exact margin of the container it is given and
+ * refuses buffers that are too small. Blocks must appear in the index in
+ * file order, as block_container_writer writes them.
+ */
+
+/**
+ * @brief Margin a container needs beyond its original size to be decoded in place
+ * @param container Parsed container
+ * @param compressed_size Size of the whole container in bytes
+ */
+uint64_t in_place_margin(const block_container &container, uint64_t compressed_size);
+
+/**
+ * @brief Upper bound of in_place_margin() for any container this encoder writes
+ * @param block_size Block size (container file header)
+ * @param block_count Number of blocks (container trailer)
+ */
+uint64_t in_place_margin_bound(uint32_t block_size, uint32_t block_count);
+
+/**
+ * @brief Reads the original size, block size and block count from a container's file header and trailer alone
+ * @param header First BLOCK_FILE_HEADER_SIZE bytes of the container
+ * @param trailer Last BLOCK_TRAILER_SIZE bytes of the container
+ * @return false if either part is not from a block container
+ *
+ * Enough to size an in-place buffer before the container itself is read.
+ */
+bool peek_block_container(const uint8_t *header, const uint8_t *trailer, uint64_t &original_size,
+                          uint32_t &block_size, uint32_t &block_count, std::string &error);
+
+/**
+ * @brief Decodes a container held at the tail of a buffer into the front of the same buffer
+ * @param buffer Buffer holding the container in its last compressed_size bytes
+ * @param buffer_size Buffer size, at least original size + in_place_margin()
+ * @param compressed_size Container size
+ * @param tables Loaded table set, required for shared-table blocks
+ * @param error Set when the container is corrupt or the margin is too small
+ * @param engine Canonical decoder (see decode_block)
+ * @param thread_count Workers; consecutive blocks whose outputs stay clear of each other's input are decoded together
+ * @return true with buffer[0, original size) holding the decoded data
+ *
+ * On failure the front of the buffer and possibly the container are
+ * overwritten; decoding cannot be retried from the same buffer.
+ */
+bool decode_in_place(uint8_t *buffer, size_t buffer_size, size_t compressed_size, const code_table_set *tables,
+                     std::string &error, decoder_engine engine = DECODER_ENGINE_AUTO, unsigned thread_count = 1);
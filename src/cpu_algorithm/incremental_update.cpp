@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <fstream>
+
+#include "format_utilities.h"
+#include "incremental_update.h"
+#include "worker_pool.h"
+
+/**
+ * @file incremental_update.cpp
+ * @brief Previous-archive loading, block matching, boundary resynchronization and the incremental encode loop
+ */
+
+using namespace std;
+
+// Multiplier of the rolling window hash (the 64-bit FNV prime)
+#define ROLLING_HASH_MULTIPLIER 0x100000001b3ull
+
+// Filter bits per previous block; a clear bit skips the hash map lookup at most positions
+#define ROLLING_FILTER_BITS_PER_BLOCK 64
+
+// Previous blocks indexed, and blocks of input scanned, by the first round of a shifted-match search
+#define RESYNC_WINDOW_BLOCKS 8
+
+bool load_previous_archive(const char *path, previous_archive &archive, string &error) {
+    ifstream input(path, ios::binary | ios::ate);
+    if (!input) {
+        error = "Cannot open previous archive " + string(path);
+        return false;
+    }
+    archive.bytes.resize(static_cast<size_t>(input.tellg()));
+    input.seekg(0, ios::beg);
+    if (!input.read(reinterpret_cast<char *>(archive.bytes.data()), static_cast<streamsize>(archive.bytes.size()))) {
+        error = "Failed to read previous archive " + string(path);
+        return false;
+    }
+    if (!parse_block_container(archive.bytes.data(), archive.bytes.size(), archive.container, error)) {
+        error = string(path) + ": " + error;
+        return false;
+    }
+
+    archive.full_blocks.clear();
+    for (uint32_t index = 0; index < archive.container.blocks.size(); index++) {
+        const block_index_entry &entry = archive.container.blocks[index];
+        if (entry.raw_size == archive.container.block_size) archive.full_blocks.emplace(entry.checksum, index);
+    }
+    return true;
+}
+
+/**
+ * @struct incremental_segment
+ * @brief One block of the new archive: a range of the input and where its coded bytes come from
+ */
+struct incremental_segment {
+    uint64_t offset;
+    uint32_t length;
+    int64_t source; // Previous index copied from, -1 when coded
+    uint64_t checksum; // Of a copied block
+};
+
+/**
+ * @struct rolling_index
+ * @brief Window hashes of previous full blocks, decoded and added as shifted-match searches need them
+ */
+struct rolling_index {
+    uint64_t top_power = 1; // MULTIPLIER^(block_size - 1): weight of the byte leaving the window
+    unsigned filter_shift = 0;
+    vector<uint64_t> filter; // One bit per hash prefix, set for every indexed block
+    unordered_map<uint64_t, uint32_t> blocks; // Window hash -> previous index
+    vector<uint8_t> visited; // Per previous block: already decoded (or not indexable)
+};
+
+/**
+ * @brief Polynomial hash of a window; rolls by one byte in constant time (see find_shifted_match)
+ */
+static uint64_t window_hash(const uint8_t *data, const size_t length) {
+    uint64_t hash = 0;
+    for (size_t index = 0; index < length; index++) hash = hash * ROLLING_HASH_MULTIPLIER + data[index];
+    return hash;
+}
+
+/**
+ * @brief Whether a previous block can be copied into the new archive as it is
+ */
+static bool reusable(const previous_archive &previous, const block_index_entry &entry, const uint32_t raw_size,
+                     const uint64_t checksum, const uint32_t table_set_id) {
+    if (entry.raw_size != raw_size || entry.checksum != checksum) return false;
+
+    const block_header header = read_block_header(previous.bytes.data() + entry.offset);
+    if (header.raw_size != entry.raw_size || BLOCK_HEADER_SIZE + static_cast<uint64_t>(header.payload_size) !=
+        entry.stored_size) {
+        return false; // Inconsistent block: code it again rather than copy it
+    }
+    return header.mode != BLOCK_MODE_SHARED_TABLE || previous.container.table_set_id == table_set_id;
+}
+
+/**
+ * @brief Sizes the filter for the previous archive; no block is decoded yet
+ */
+static void init_rolling_index(const previous_archive &previous, rolling_index &index) {
+    for (uint32_t power = 1; power < previous.container.block_size; power++) index.top_power *= ROLLING_HASH_MULTIPLIER;
+    const uint64_t filter_bits = bit_ceil(max<uint64_t>(uint64_t{1} << 16, previous.container.blocks.size() *
+                                                                            ROLLING_FILTER_BITS_PER_BLOCK));
+    index.filter_shift = 64 - countr_zero(filter_bits);
+    index.filter.assign(filter_bits / 64, 0);
+    index.visited.assign(previous.container.blocks.size(), 0);
+}
+
+/**
+ * @brief Decodes the previous full blocks in [first, end) not indexed yet and adds their window hashes
+ *
+ * The previous archive only holds checksums, which cannot be rolled, so a
+ * block's data is needed once before it can be found at a shifted offset.
+ */
+static void index_previous_blocks(const previous_archive &previous, const block_encoder_settings &settings,
+                                  const uint32_t table_set_id, const size_t first, size_t end, rolling_index &index) {
+    const uint32_t block_size = previous.container.block_size;
+    const vector<block_index_entry> &old_blocks = previous.container.blocks;
+    end = min(end, old_blocks.size());
+
+    vector<uint32_t> candidates;
+    for (auto block = static_cast<uint32_t>(first); block < end; block++) {
+        if (index.visited[block]) continue;
+        index.visited[block] = 1;
+        if (reusable(previous, old_blocks[block], block_size, old_blocks[block].checksum, table_set_id)) {
+            candidates.push_back(block);
+        }
+    }
+    if (candidates.empty()) return;
+
+    const unsigned thread_count = max(1u, settings.thread_count);
+    vector<vector<uint8_t> > buffers(thread_count);
+    vector<uint64_t> hashes(candidates.size());
+    vector<uint8_t> decoded(candidates.size(), 0);
+    run_parallel(candidates.size(), thread_count, [&](const size_t slot, const unsigned worker) {
+        vector<uint8_t> &buffer = buffers[worker];
+        buffer.resize(block_size);
+        string error;
+        if (decode_block(previous.container, previous.bytes.data(), old_blocks[candidates[slot]], settings.tables,
+                         buffer.data(), error)) {
+            hashes[slot] = window_hash(buffer.data(), block_size);
+            decoded[slot] = 1;
+        }
+    });
+
+    for (size_t slot = 0; slot < candidates.size(); slot++) {
+        if (!decoded[slot]) continue;
+        const uint64_t bit = hashes[slot] >> index.filter_shift;
+        index.filter[bit / 64] |= uint64_t{1} << (bit % 64);
+        index.blocks.emplace(hashes[slot], candidates[slot]);
+    }
+}
+
+/**
+ * @brief Finds the first block match in [from, limit), aligned or at a shifted offset among the indexed blocks
+ * @param aligned Previous index matching each grid block, -1 for none
+ * @param match Receives the matching block; unchanged when there is none
+ * @return Offset of the match, or limit when there is none
+ *
+ * Rolls the window hash over the input one byte at a time and verifies a hit
+ * against the previous block's checksum before accepting it. The search
+ * stops early at a grid block that already matched in place.
+ */
+static uint64_t scan_for_match(const uint8_t *data, const size_t size, const uint64_t from, const uint64_t limit,
+                               const previous_archive &previous, const vector<uint64_t> &checksums,
+                               const vector<int64_t> &aligned, const uint32_t table_set_id,
+                               const rolling_index &index, incremental_segment &match) {
+    const uint32_t block_size = previous.container.block_size;
+    const vector<block_index_entry> &old_blocks = previous.container.blocks;
+    uint64_t hash = from + block_size <= size ? window_hash(data + from, block_size) : 0;
+
+    for (uint64_t position = from; position < limit; position++) {
+        if (position % block_size == 0 && aligned[position / block_size] >= 0) {
+            const size_t grid = position / block_size;
+            match = {position, static_cast<uint32_t>(min<uint64_t>(block_size, size - position)), aligned[grid],
+                     checksums[grid]};
+            return position;
+        }
+        if (position + block_size > size || index.blocks.empty()) continue;
+        if (position != from) {
+            hash = (hash - data[position - 1] * index.top_power) * ROLLING_HASH_MULTIPLIER +
+                   data[position + block_size - 1];
+        }
+
+        const uint64_t bit = hash >> index.filter_shift;
+        if (!(index.filter[bit / 64] >> (bit % 64) & 1)) continue;
+        const auto candidate = index.blocks.find(hash);
+        if (candidate == index.blocks.end()) continue;
+        const uint64_t checksum = data_checksum(data + position, block_size);
+        if (reusable(previous, old_blocks[candidate->second], block_size, checksum, table_set_id)) {
+            match = {position, block_size, candidate->second, checksum};
+            return position;
+        }
+    }
+    return limit;
+}
+
+/**
+ * @brief Finds where the previous data resumes after a change, starting at `from`
+ * @param expected Previous block that would follow the change if nothing else moved
+ * @return Offset of the match, or size when the rest of the input matches nothing
+ *
+ * Data after an insertion of n bytes is found n bytes further on, data after
+ * a deletion of n bytes in the previous block about n / block_size after the
+ * expected one. Each round therefore indexes the previous blocks from
+ * `expected` on and scans the input from `from` over twice as many blocks as
+ * the round before, so the decoding and scanning done stay proportional to
+ * the size of the change rather than to the size of the file.
+ */
+static uint64_t find_shifted_match(const uint8_t *data, const size_t size, const uint64_t from,
+                                   const size_t expected, const previous_archive &previous,
+                                   const block_encoder_settings &settings, const vector<uint64_t> &checksums,
+                                   const vector<int64_t> &aligned, const uint32_t table_set_id,
+                                   rolling_index &index, incremental_segment &match) {
+    const uint32_t block_size = previous.container.block_size;
+    const size_t old_count = previous.container.blocks.size();
+    for (uint64_t window = RESYNC_WINDOW_BLOCKS;; window *= 2) {
+        index_previous_blocks(previous, settings, table_set_id, expected, expected + window, index);
+        const uint64_t limit = min<uint64_t>(size, from + window * block_size);
+        const uint64_t next = scan_for_match(data, size, from, limit, previous, checksums, aligned, table_set_id,
+                                             index, match);
+        if (next < limit) return next;
+        if (limit == size && expected + window >= old_count) return size;
+    }
+}
+
+/**
+ * @brief Appends [offset, end) as coded segments of at most one block each, starting at offset
+ *
+ * A gap that starts on the block grid is cut on the grid, so runs without
+ * shifted data produce the same blocks as a full run.
+ */
+static void append_gap(const uint64_t offset, const uint64_t end, const uint32_t block_size,
+                       vector<incremental_segment> &segments) {
+    for (uint64_t position = offset; position < end; position += block_size) {
+        segments.push_back({position, static_cast<uint32_t>(min<uint64_t>(block_size, end - position)), -1, 0});
+    }
+}
+
+void encode_blocks_incremental(const uint8_t *data, const size_t size, const block_encoder_settings &settings,
+                               const previous_archive &previous, const bool explain,
+                               const function<void(const encoded_block &block, const block_report *report)> &emit,
+                               incremental_statistics &stats) {
+    const uint32_t block_size = settings.block_size;
+    const size_t block_count = (size + block_size - 1) / block_size;
+    const unsigned thread_count = max(1u, settings.thread_count);
+    const uint32_t table_set_id = settings.tables ? settings.tables->set_id : 0;
+    const vector<block_index_entry> &old_blocks = previous.container.blocks;
+
+    /*=== GRID PASS ===*/
+
+    // Every block of the grid is hashed and matched at the same index first, then anywhere
+    vector<uint64_t> checksums(block_count);
+    vector<int64_t> aligned(block_count, -1);
+    run_parallel(block_count, thread_count, [&](const size_t index, unsigned) {
+        const size_t offset = index * block_size;
+        const auto length = static_cast<uint32_t>(min<size_t>(block_size, size - offset));
+        if (settings.governor) settings.governor->begin_task(length);
+        const auto start = chrono::steady_clock::now();
+
+        // Holes hash to the zero checksum without being read
+        const bool hole = settings.data_extents && !range_has_data(*settings.data_extents, offset, length);
+        const uint64_t checksum = hole ? zero_block_checksum(length) : data_checksum(data + offset, length);
+        checksums[index] = checksum;
+
+        if (index < old_blocks.size() && reusable(previous, old_blocks[index], length, checksum, table_set_id)) {
+            aligned[index] = static_cast<int64_t>(index);
+        } else if (const auto match = previous.full_blocks.find(checksum);
+                   match != previous.full_blocks.end() &&
+                   reusable(previous, old_blocks[match->second], length, checksum, table_set_id)) {
+            aligned[index] = match->second;
+        }
+        if (settings.governor) {
+            settings.governor->end_task(length, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+    });
+
+    /*=== RESYNCHRONIZATION ===*/
+
+    // Changed grid blocks followed by a match in place are coded on the grid. Longer changes
+    // that run to the end of the input or into zeros (data shifted by an insertion or deletion)
+    // and misses after a shifted match are searched for previous blocks at any byte offset.
+    vector<incremental_segment> segments;
+    segments.reserve(block_count);
+    rolling_index index;
+    size_t expected = 0; // Previous block after the last one reused
+    uint64_t position = 0;
+    while (position < size) {
+        incremental_segment match{};
+        const auto length = static_cast<uint32_t>(min<uint64_t>(block_size, size - position));
+        if (position % block_size == 0) {
+            const size_t grid = position / block_size;
+            if (aligned[grid] >= 0) {
+                segments.push_back({position, length, aligned[grid], checksums[grid]});
+                expected = static_cast<size_t>(aligned[grid]) + 1;
+                position += length;
+                continue;
+            }
+            size_t gap_end = grid + 1;
+            while (gap_end < block_count && aligned[gap_end] < 0) gap_end++;
+            // Zero blocks match at any shift, so they do not show that the data after the gap is in place
+            const bool in_place = gap_end < block_count &&
+                                  checksums[gap_end] != zero_block_checksum(static_cast<uint32_t>(
+                                      min<uint64_t>(block_size, size - gap_end * block_size)));
+            const bool shifted = !in_place && gap_end - grid >= 2 && grid + 1 < old_blocks.size();
+            if (!shifted) {
+                append_gap(position, min<uint64_t>(gap_end * block_size, size), block_size, segments);
+                position = min<uint64_t>(gap_end * block_size, size);
+                continue;
+            }
+            expected = grid;
+        } else {
+            // Right after a shifted match the next block usually follows at the same shift,
+            // up to the previous last block, which may be shorter
+            const uint64_t checksum = data_checksum(data + position, length);
+            int64_t source = -1;
+            if (length == block_size) {
+                if (const auto found = previous.full_blocks.find(checksum); found != previous.full_blocks.end()) {
+                    source = found->second;
+                }
+            } else if (!old_blocks.empty()) {
+                source = static_cast<int64_t>(old_blocks.size() - 1);
+            }
+            if (source >= 0 && reusable(previous, old_blocks[static_cast<size_t>(source)], length, checksum,
+                                        table_set_id)) {
+                segments.push_back({position, length, source, checksum});
+                expected = static_cast<size_t>(source) + 1;
+                position += length;
+                continue;
+            }
+        }
+
+        if (index.filter.empty()) init_rolling_index(previous, index);
+        const uint64_t next = find_shifted_match(data, size, position + 1, expected, previous, settings, checksums,
+                                                 aligned, table_set_id, index, match);
+        append_gap(position, next, block_size, segments);
+        if (next < size) {
+            segments.push_back(match);
+            expected = static_cast<size_t>(match.source) + 1;
+        }
+        position = next < size ? next + match.length : size;
+    }
+
+    /*=== CODING ===*/
+
+    // Changed blocks are coded one at a time inside this loop, which already consults the governor
+    block_encoder_settings coding = settings;
+    coding.governor = nullptr;
+
+    const size_t batch_size = static_cast<size_t>(thread_count) * 4;
+    vector<encoded_block> blocks(min(batch_size, segments.size()));
+    vector<block_report> reports(explain ? blocks.size() : 0);
+
+    for (size_t first = 0; first < segments.size(); first += batch_size) {
+        const size_t count = min(batch_size, segments.size() - first);
+        run_parallel(count, thread_count, [&](const size_t slot, unsigned) {
+            const incremental_segment &segment = segments[first + slot];
+            block_report *report = explain ? &reports[slot] : nullptr;
+            encoded_block &block = blocks[slot];
+            const auto start = chrono::steady_clock::now();
+
+            if (segment.source >= 0) {
+                const block_index_entry &entry = old_blocks[static_cast<size_t>(segment.source)];
+                const uint8_t *stored = previous.bytes.data() + entry.offset;
+                block.bytes.assign(stored, stored + entry.stored_size);
+                block.raw_size = segment.length;
+                block.checksum = segment.checksum;
+                block.selection_seconds = 0;
+                if (report) {
+                    *report = block_report{};
+                    report->raw_bytes = segment.length;
+                    report->stored_bytes = entry.stored_size;
+                    report->mode = "reused";
+                    report->payload_bytes = entry.stored_size - BLOCK_HEADER_SIZE;
+                }
+            } else {
+                if (settings.governor) settings.governor->begin_task(segment.length);
+                const bool on_grid = segment.offset % block_size == 0 &&
+                                     segment.length == min<uint64_t>(block_size, size - segment.offset);
+                if (on_grid) {
+                    // A grid block: coded exactly as a full run would, holes included
+                    encode_block_batch(data, size, coding, segment.offset / block_size, 1, &block, report);
+                } else {
+                    encode_block(data + segment.offset, segment.length, coding, block, report);
+                }
+            }
+            const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            block.encode_seconds = seconds;
+
+            if (segment.source < 0 && settings.governor) settings.governor->end_task(segment.length, seconds);
+            if (report) {
+                report->encode_microseconds = seconds * 1e6;
+                report->index = first + slot;
+                report->offset = segment.offset;
+            }
+        });
+
+        for (size_t slot = 0; slot < count; slot++) {
+            const incremental_segment &segment = segments[first + slot];
+            if (segment.source >= 0) {
+                stats.reused_blocks++;
+                stats.reused_bytes += segment.length;
+                if (segment.source != static_cast<int64_t>(first + slot)) stats.moved_blocks++;
+                if (segment.offset % block_size != 0) stats.shifted_blocks++;
+            } else {
+                stats.encoded_blocks++;
+                stats.encoded_bytes += segment.length;
+            }
+            emit(blocks[slot], explain ? &reports[slot] : nullptr);
+        }
+    }
+}
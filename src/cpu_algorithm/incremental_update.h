@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "block_format.h"
+
+/**
+ * @file incremental_update.h
+ * @brief Re-compression that copies unchanged blocks from the previous archive
+ *
+ * The container index already stores data_checksum() of every block's
+ * original data, so a previous archive is its own change map. The new input
+ * is hashed block by block (several GB/s per core, holes cost nothing) and
+ * only blocks whose hash has no match are coded again; the others are copied
+ * from the previous archive byte for byte. Re-compressing a file where a few
+ * regions changed therefore costs one hashing pass plus coding the changed
+ * blocks, instead of coding everything.
+ *
+ * A block matches a previous block with the same raw size and checksum - at
+ * the same index first, otherwise anywhere in the previous archive, so whole
+ * blocks that moved by a multiple of the block size are reused too. Blocks
+ * coded with trained tables are only reused when the same table set is loaded.
+ *
+ * Boundary resynchronization: after an insertion or deletion that is not a
+ * multiple of the block size, no later block lines up with the grid any
+ * more, so every grid block from the change to the end of the input (or to
+ * the next all-zero block, which matches at any shift) misses. Such a run of
+ * two or more changed blocks, and a miss right after a shifted match, start
+ * a byte-wise search: a rolling hash over a whole block's window is compared
+ * with the window hashes of previous full blocks, and a hit is accepted once
+ * the block checksum matches. The previous archive holds no original data,
+ * so the previous blocks from the change on are decoded to index them, a
+ * window at a time that doubles with every unsuccessful round; the work
+ * grows with the size of the insertion or deletion, not with the file.
+ * After a match the following blocks, including the shorter last one, are
+ * checked at the same shift directly. The bytes between matches are coded as
+ * new blocks of at most the block size, so the archive may then hold short
+ * blocks in the middle; the index records every block's raw size, and all
+ * readers follow it.
+ *
+ * Changed blocks followed by a block that matches in place (edits that keep
+ * the length, appended data) are coded on the grid without a search, so
+ * without shifted data the output equals a full run. An insertion that is
+ * later undone by a deletion of the same length is not searched either.
+ *
+ * Matching trusts the 64-bit checksum, the same check decompression relies
+ * on to verify blocks.
+ */
+
+/**
+ * @struct previous_archive
+ * @brief A block container loaded as the reference of an incremental run
+ *
+ * The archive is read into memory, so it may be the file being replaced.
+ */
+struct previous_archive {
+    std::vector<uint8_t> bytes;
+    block_container container;
+    std::unordered_map<uint64_t, uint32_t> full_blocks; // Checksum -> index, full-size blocks only
+};
+
+/**
+ * @brief Reads and parses the previous archive and indexes its blocks by checksum
+ * @return false when the file is missing or not a valid block container
+ */
+bool load_previous_archive(const char *path, previous_archive &archive, std::string &error);
+
+/**
+ * @struct incremental_statistics
+ * @brief What an incremental run reused and what it coded
+ */
+struct incremental_statistics {
+    uint64_t reused_blocks = 0;
+    uint64_t reused_bytes = 0;
+    uint64_t moved_blocks = 0; // Reused from a different index
+    uint64_t shifted_blocks = 0; // Reused at an offset off the block grid (found by resynchronization)
+    uint64_t encoded_blocks = 0;
+    uint64_t encoded_bytes = 0;
+};
+
+/**
+ * @brief encode_blocks() that copies blocks found unchanged in the previous archive
+ * @param data Input data
+ * @param size Input length
+ * @param settings Encoder options; block_size must equal the previous archive's (it sets the rolling window)
+ * @param previous Reference archive from load_previous_archive()
+ * @param explain Fill a block_report per block (mode "reused" for copied blocks)
+ * @param emit Called once per block, in input order
+ * @param stats Output totals
+ */
+void encode_blocks_incremental(const uint8_t *data, size_t size, const block_encoder_settings &settings,
+                               const previous_archive &previous, bool explain,
+                               const std::function<void(const encoded_block &block, const block_report *report)>
+                               &emit, incremental_statistics &stats);
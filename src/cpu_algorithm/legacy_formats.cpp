@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cstring>
+
+#include "format_utilities.h"
+#include "legacy_formats.h"
+
+/**
+ * @file legacy_formats.cpp
+ * @brief Legacy header parsing, tree reconstruction and the byte-step decoder
+ */
+
+using namespace std;
+
+// A tree over 256 symbols has at most 511 nodes; anything larger is corrupt
+#define LEGACY_MAX_TREE_NODES 511
+
+const char *legacy_format_name(const legacy_format format) {
+    switch (format) {
+        case LEGACY_FORMAT_CPU_TREE:
+            return "cpu-tree";
+        case LEGACY_FORMAT_GPU_FREQUENCY:
+            return "gpu-frequency";
+        default:
+            return "unknown";
+    }
+}
+
+/*=============================================================================
+ * TREE RECONSTRUCTION
+ *=============================================================================*/
+
+/**
+ * @brief Parses the CPU format's pre-order tree; returns the node index or -1
+ */
+static int parse_cpu_tree(const uint8_t *data, const size_t size, size_t &position, legacy_tree &tree) {
+    if (position >= size || tree.nodes.size() >= LEGACY_MAX_TREE_NODES) return -1;
+
+    const uint8_t marker = data[position++];
+    if (marker == '1') {
+        if (position >= size) return -1;
+        tree.nodes.push_back({-1, -1, data[position++]});
+        return static_cast<int>(tree.nodes.size()) - 1;
+    }
+    if (marker != '0') return -1;
+
+    const auto index = static_cast<int>(tree.nodes.size());
+    tree.nodes.emplace_back();
+    const int left = parse_cpu_tree(data, size, position, tree);
+    const int right = left < 0 ? -1 : parse_cpu_tree(data, size, position, tree);
+    if (right < 0) return -1;
+    tree.nodes[index].left = left;
+    tree.nodes[index].right = right;
+    return index;
+}
+
+/**
+ * @brief Rebuilds the GPU format's tree from its frequencies
+ *
+ * Mirrors sort_huffman_tree() / build_huffman_tree() of serial_utilities.c
+ * step by step - leaves in byte order, a stable insertion sort of the
+ * uncombined range, the two lowest nodes merged as left and right child - so
+ * the codes come out bit-identical to the compressor's.
+ */
+static void build_gpu_tree(const uint32_t *frequency, legacy_tree &tree) {
+    struct weighted_node {
+        uint64_t count;
+        int node;
+    };
+    vector<weighted_node> work;
+    for (unsigned symbol = 0; symbol < 256; symbol++) {
+        if (frequency[symbol] == 0) continue;
+        tree.nodes.push_back({-1, -1, static_cast<uint8_t>(symbol)});
+        work.push_back({frequency[symbol], static_cast<int>(tree.nodes.size()) - 1});
+    }
+    const size_t distinct = work.size();
+    if (distinct == 0) return;
+    tree.root = work[0].node;
+    work.resize(2 * distinct - 1);
+
+    for (size_t index = 0; index + 1 < distinct; index++) {
+        const size_t combined = 2 * index;
+        const size_t end = distinct - 1 + index;
+        for (size_t next = combined + 1; next <= end; next++) {
+            const weighted_node item = work[next];
+            size_t slot = next;
+            while (slot > combined && work[slot - 1].count > item.count) {
+                work[slot] = work[slot - 1];
+                slot--;
+            }
+            work[slot] = item;
+        }
+
+        tree.nodes.push_back({work[combined].node, work[combined + 1].node, 0});
+        tree.root = static_cast<int>(tree.nodes.size()) - 1;
+        work[distinct + index] = {work[combined].count + work[combined + 1].count, tree.root};
+    }
+}
+
+/*=============================================================================
+ * FORMAT DETECTION
+ *=============================================================================*/
+
+/**
+ * @brief Whether data starts with a GPU header whose frequencies add up to its size field
+ */
+static bool looks_like_gpu_file(const uint8_t *data, const size_t size) {
+    if (size < LEGACY_GPU_HEADER_SIZE) return false;
+    uint64_t total = 0;
+    for (unsigned symbol = 0; symbol < 256; symbol++) total += read_u32(data + 4 + 4 * symbol);
+    return total == read_u32(data) && total != 0;
+}
+
+bool parse_legacy_file(const uint8_t *data, const size_t size, legacy_format format, legacy_file &file,
+                       string &error) {
+    const bool detected = format == LEGACY_FORMAT_UNKNOWN;
+    if (detected) {
+        format = looks_like_gpu_file(data, size) ? LEGACY_FORMAT_GPU_FREQUENCY : LEGACY_FORMAT_CPU_TREE;
+    }
+    file = legacy_file{};
+    file.format = format;
+
+    if (format == LEGACY_FORMAT_GPU_FREQUENCY) {
+        if (size < LEGACY_GPU_HEADER_SIZE) {
+            error = "File is shorter than the GPU format header";
+            return false;
+        }
+        file.original_size = read_u32(data);
+        for (unsigned symbol = 0; symbol < 256; symbol++) file.frequency[symbol] = read_u32(data + 4 + 4 * symbol);
+        build_gpu_tree(file.frequency, file.tree);
+        file.bits = data + LEGACY_GPU_HEADER_SIZE;
+        file.bit_bytes = size - LEGACY_GPU_HEADER_SIZE;
+        if (file.tree.root < 0 && file.original_size != 0) {
+            error = "GPU format header has no symbols";
+            return false;
+        }
+        return true;
+    }
+
+    // CPU tree format: size, tree, '*', padding count, bits
+    size_t position = 8;
+    if (size < position + 4 || (data[position] != '0' && data[position] != '1')) {
+        error = detected ? "Neither a CPU tree nor a GPU frequency file" : "Not a CPU tree format file";
+        return false;
+    }
+    file.original_size = read_u64(data);
+    file.tree.root = parse_cpu_tree(data, size, position, file.tree);
+    if (file.tree.root < 0 || position + 2 > size || data[position] != '*' || data[position + 1] > 8) {
+        error = "CPU tree format header is corrupted";
+        return false;
+    }
+    file.bits = data + position + 2;
+    file.bit_bytes = size - position - 2;
+    return true;
+}
+
+/*=============================================================================
+ * DECODER
+ *=============================================================================*/
+
+void legacy_tree_decoder::initialize(const legacy_file &file) {
+    *this = legacy_tree_decoder{};
+    bits = file.bits;
+    bit_bytes = file.bit_bytes;
+
+    const legacy_tree &tree = file.tree;
+    if (tree.root < 0) return;
+    const auto is_leaf = [&](const int node) { return tree.nodes[node].left < 0; };
+    if (is_leaf(tree.root)) {
+        single_symbol = tree.nodes[tree.root].symbol;
+        return;
+    }
+
+    // Dense numbering of the internal nodes (the root is state 0)
+    vector<int> internal_nodes{tree.root};
+    vector<int> state_of(tree.nodes.size(), -1);
+    for (size_t index = 0; index < tree.nodes.size(); index++) {
+        if (!is_leaf(static_cast<int>(index)) && static_cast<int>(index) != tree.root) {
+            internal_nodes.push_back(static_cast<int>(index));
+        }
+    }
+    for (size_t state_index = 0; state_index < internal_nodes.size(); state_index++) {
+        state_of[internal_nodes[state_index]] = static_cast<int>(state_index);
+    }
+
+    // Walk 8 bits from every internal node for every byte value
+    steps.resize(internal_nodes.size() * 256);
+    for (size_t state_index = 0; state_index < internal_nodes.size(); state_index++) {
+        for (unsigned byte = 0; byte < 256; byte++) {
+            decode_step &step = steps[state_index * 256 + byte];
+            step.count = 0;
+            int node = internal_nodes[state_index];
+            for (int bit = 7; bit >= 0; bit--) {
+                node = (byte >> bit) & 1 ? tree.nodes[node].right : tree.nodes[node].left;
+                if (is_leaf(node)) {
+                    step.symbols[step.count++] = tree.nodes[node].symbol;
+                    node = tree.root;
+                }
+            }
+            step.next = static_cast<uint16_t>(state_of[node]);
+        }
+    }
+}
+
+size_t legacy_tree_decoder::decode(uint8_t *output, const size_t count) {
+    if (single_symbol >= 0) {
+        memset(output, single_symbol, count);
+        return count;
+    }
+
+    size_t produced = 0;
+    while (pending_count > 0 && produced < count) {
+        output[produced++] = pending[pending_start++];
+        pending_count--;
+    }
+
+    // Fast path: room for a whole step, so its 8 symbol slots are copied unconditionally
+    const decode_step *table = steps.data();
+    while (count - produced >= 8 && position < bit_bytes) {
+        const decode_step &step = table[static_cast<size_t>(state) * 256 + bits[position++]];
+        memcpy(output + produced, step.symbols, 8);
+        produced += step.count;
+        state = step.next;
+    }
+
+    while (produced < count && position < bit_bytes) {
+        const decode_step &step = table[static_cast<size_t>(state) * 256 + bits[position++]];
+        state = step.next;
+        const size_t taken = min<size_t>(step.count, count - produced);
+        memcpy(output + produced, step.symbols, taken);
+        produced += taken;
+        if (taken < step.count) {
+            pending_count = static_cast<uint8_t>(step.count - taken);
+            pending_start = 0;
+            memcpy(pending, step.symbols + taken, pending_count);
+        }
+    }
+    return produced;
+}
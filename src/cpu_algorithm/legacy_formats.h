@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file legacy_formats.h
+ * @brief Table-driven decoding of the two pre-container file formats
+ *
+ * Formats (both code the whole file with one Huffman tree, bits MSB first):
+ * - CPU tree format (huffman_cpu_compression without block options):
+ *   original size (8), pre-order tree ('0' internal, '1' + byte leaf), '*',
+ *   padding bit count (1), bit stream
+ * - GPU frequency format (huffman_compression): original size (4), 256
+ *   frequencies (4 each, 1028 header bytes in total), bit stream; the tree is
+ *   rebuilt from the frequencies exactly as serial_utilities.c does
+ *
+ * legacy_tree_decoder replaces the bit-by-bit tree walk of the original
+ * decompressors with a state machine: for every internal node and every
+ * input byte a table entry holds the symbols that byte completes (at most 8)
+ * and the node the walk ends at, so each compressed byte costs one lookup.
+ */
+
+// Size of the GPU format header: original size + 256 frequencies
+#define LEGACY_GPU_HEADER_SIZE 1028
+
+enum legacy_format {
+    LEGACY_FORMAT_UNKNOWN = 0,
+    LEGACY_FORMAT_CPU_TREE = 1,
+    LEGACY_FORMAT_GPU_FREQUENCY = 2,
+};
+
+/**
+ * @struct legacy_tree
+ * @brief A code tree; leaves have left == right == -1
+ */
+struct legacy_tree {
+    struct tree_node {
+        int left = -1;
+        int right = -1;
+        uint8_t symbol = 0;
+    };
+    std::vector<tree_node> nodes;
+    int root = -1;
+};
+
+/**
+ * @struct legacy_file
+ * @brief A parsed legacy file held in memory
+ */
+struct legacy_file {
+    legacy_format format = LEGACY_FORMAT_UNKNOWN;
+    uint64_t original_size = 0;
+    legacy_tree tree;
+    const uint8_t *bits = nullptr; // Start of the bit stream
+    size_t bit_bytes = 0;
+    uint32_t frequency[256] = {}; // GPU format only: the header's symbol counts
+};
+
+/**
+ * @brief Name of a format for messages ("cpu-tree", "gpu-frequency")
+ */
+const char *legacy_format_name(legacy_format format);
+
+/**
+ * @brief Identifies and parses a legacy file
+ * @param data File contents
+ * @param size File length
+ * @param format Expected format, or LEGACY_FORMAT_UNKNOWN to detect it (a GPU
+ *        header is recognized by frequencies that add up to its size field)
+ * @param file Output; bits points into data
+ * @param error Set when the data is neither format or the tree is invalid
+ */
+bool parse_legacy_file(const uint8_t *data, size_t size, legacy_format format, legacy_file &file, std::string &error);
+
+/**
+ * @struct legacy_tree_decoder
+ * @brief Resumable byte-at-a-time decoder of a legacy bit stream
+ *
+ * decode() can be called repeatedly with any output size, so a file can be
+ * decoded block by block; symbols completed by a byte beyond the requested
+ * amount are kept for the next call.
+ */
+struct legacy_tree_decoder {
+    struct decode_step {
+        uint8_t symbols[8];
+        uint8_t count;
+        uint16_t next; // Internal node index the walk ends at
+    };
+
+    std::vector<decode_step> steps; // [internal node * 256 + byte]
+    int single_symbol = -1; // Tree is a single leaf: every output byte is this symbol
+    const uint8_t *bits = nullptr;
+    size_t bit_bytes = 0;
+    size_t position = 0; // Next input byte
+    uint16_t state = 0;
+    uint8_t pending[8] = {};
+    uint8_t pending_count = 0;
+    uint8_t pending_start = 0;
+
+    /**
+     * @brief Builds the step table for a file's tree and positions at its first bit
+     */
+    void initialize(const legacy_file &file);
+
+    /**
+     * @brief Decodes up to `count` bytes
+     * @return Bytes produced; fewer than count only when the bit stream is exhausted
+     */
+    size_t decode(uint8_t *output, size_t count);
+};
@@ -0,0 +1,47 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+/**
+ * @file mapped_file.cpp
+ * @brief mmap / madvise wrapper for the decompressors
+ */
+
+using namespace std;
+
+mapped_file::~mapped_file() {
+    if (data) munmap(const_cast<uint8_t *>(data), size);
+}
+
+bool mapped_file::open(const char *path, const bool populate, string &error) {
+    const int descriptor = ::open(path, O_RDONLY);
+    struct stat status{};
+    if (descriptor < 0 || fstat(descriptor, &status) != 0) {
+        error = "Cannot open compressed file " + string(path);
+        if (descriptor >= 0) close(descriptor);
+        return false;
+    }
+
+    size = static_cast<size_t>(status.st_size);
+    if (size == 0) {
+        close(descriptor);
+        return true;
+    }
+
+    // The mapping keeps the file referenced, so the descriptor can go right away
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), descriptor, 0);
+    close(descriptor);
+    if (mapping == MAP_FAILED) {
+        error = "Cannot map " + string(path) + ": " + strerror(errno);
+        size = 0;
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t *>(mapping);
+    return true;
+}
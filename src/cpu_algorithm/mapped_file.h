@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @file mapped_file.h
+ * @brief Read-only memory mapping of compressed input
+ *
+ * The decompressors decode straight from the page cache instead of copying
+ * the compressed file into a heap buffer first: no read() copy, and the
+ * mapped pages are clean file pages the kernel can drop under pressure, so
+ * peak private memory is just the decoded output. The mapping is advised
+ * MADV_SEQUENTIAL (aggressive read-ahead, pages behind the reader are cheap
+ * to evict); `populate` adds MAP_POPULATE to fault the whole file in up
+ * front, which helps when the file is known to be cached or on fast storage
+ * and page faults would otherwise interrupt the decode loop.
+ */
+
+/**
+ * @struct mapped_file
+ * @brief A whole file mapped read-only; empty files map to data == nullptr
+ */
+struct mapped_file {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    mapped_file() = default;
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    ~mapped_file();
+
+    /**
+     * @brief Maps a file
+     * @param path File to map
+     * @param populate Prefault every page (MAP_POPULATE)
+     * @param error Set when the file cannot be opened or mapped
+     */
+    bool open(const char *path, bool populate, std::string &error);
+};
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <thread>
+#include <fcntl.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "numa_topology.h"
+
+/**
+ * @file numa_topology.cpp
+ * @brief sysfs topology parsing, affinity masks and first-touch input reading
+ */
+
+using namespace std;
+
+/**
+ * @brief Parses a kernel CPU list such as "0-3,8-11"
+ */
+static vector<int> parse_cpu_list(const string &list) {
+    vector<int> cpus;
+    size_t start = 0;
+    while (start < list.size()) {
+        const size_t end = min(list.find(',', start), list.size());
+        const string range = list.substr(start, end - start);
+        try {
+            const size_t dash = range.find('-');
+            const int first = stoi(range.substr(0, dash));
+            const int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+        } catch (const exception &) {
+            // Ignore malformed entries (e.g. a trailing newline)
+        }
+        start = end + 1;
+    }
+    return cpus;
+}
+
+vector<numa_node> load_numa_topology() {
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    const bool have_affinity = sched_getaffinity(0, sizeof(affinity), &affinity) == 0;
+    auto allowed = [&](const int cpu) {
+        return !have_affinity || (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &affinity));
+    };
+
+    vector<numa_node> nodes;
+    string online;
+    if (ifstream online_file("/sys/devices/system/node/online"); getline(online_file, online)) {
+        for (const int id: parse_cpu_list(online)) {
+            string cpu_list;
+            ifstream cpu_file("/sys/devices/system/node/node" + to_string(id) + "/cpulist");
+            if (!getline(cpu_file, cpu_list)) continue;
+
+            numa_node node;
+            node.id = id;
+            for (const int cpu: parse_cpu_list(cpu_list)) {
+                if (allowed(cpu)) node.cpus.push_back(cpu);
+            }
+            if (!node.cpus.empty()) nodes.push_back(move(node));
+        }
+    }
+
+    // No sysfs topology: one node with every CPU we may use
+    if (nodes.empty()) {
+        numa_node node;
+        const int count = static_cast<int>(max(1u, thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < CPU_SETSIZE && (have_affinity || cpu < count); cpu++) {
+            if (allowed(cpu)) node.cpus.push_back(cpu);
+        }
+        if (node.cpus.empty()) node.cpus.push_back(0);
+        nodes.push_back(move(node));
+    }
+    return nodes;
+}
+
+bool pin_thread_to_node(const numa_node &node) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (const int cpu: node.cpus) CPU_SET(cpu, &mask);
+    return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+}
+
+void memory_nodes(const uint8_t *data, const size_t stride, const size_t count, vector<int> &nodes) {
+    nodes.assign(count, -1);
+
+    // move_pages(2) with no target nodes only reports where each page lives
+    constexpr size_t query_batch = 4096;
+    vector<void *> pages;
+    vector<int> status;
+    for (size_t first = 0; first < count; first += query_batch) {
+        const size_t batch = min(query_batch, count - first);
+        pages.resize(batch);
+        status.assign(batch, -1);
+        for (size_t index = 0; index < batch; index++) {
+            pages[index] = const_cast<uint8_t *>(data + (first + index) * stride);
+        }
+        if (syscall(SYS_move_pages, 0, batch, pages.data(), nullptr, status.data(), 0) != 0) return;
+        for (size_t index = 0; index < batch; index++) {
+            nodes[first + index] = status[index] >= 0 ? status[index] : -1;
+        }
+    }
+}
+
+bool load_input_numa(const char *path, const vector<numa_node> &nodes, numa_input &input, string &error) {
+    const int descriptor = open(path, O_RDONLY);
+    struct stat status{};
+    if (descriptor < 0 || fstat(descriptor, &status) != 0) {
+        error = "Cannot open input file " + string(path);
+        if (descriptor >= 0) close(descriptor);
+        return false;
+    }
+
+    const auto size = static_cast<size_t>(status.st_size);
+    file_data_extents(descriptor, size, input.extents);
+
+    // Anonymous memory is not placed until first touched, i.e. by the pread below
+    if (!input.allocate(size, error)) {
+        close(descriptor);
+        return false;
+    }
+
+    // Stripe s is read by node s % nodes.size(), from a thread pinned to that node
+    const size_t stripes = (input.size + NUMA_STRIPE_BYTES - 1) / NUMA_STRIPE_BYTES;
+    atomic<bool> failed{false};
+    auto read_stripes = [&](const size_t node_index) {
+        pin_thread_to_node(nodes[node_index]);
+        for (size_t stripe = node_index; stripe < stripes && !failed; stripe += nodes.size()) {
+            const size_t stripe_start = stripe * NUMA_STRIPE_BYTES;
+            const size_t stripe_end = min(input.size, stripe_start + NUMA_STRIPE_BYTES);
+
+            // Only the parts of the stripe that are data; holes stay untouched zero pages
+            for (const data_extent &extent: input.extents) {
+                size_t done = max<size_t>(stripe_start, extent.offset);
+                const size_t end = min<size_t>(stripe_end, extent.offset + extent.length);
+                while (done < end) {
+                    const ssize_t count = pread(descriptor, input.data + done, end - done, static_cast<off_t>(done));
+                    if (count <= 0) {
+                        if (count < 0 && errno == EINTR) continue;
+                        failed = true;
+                        break;
+                    }
+                    done += static_cast<size_t>(count);
+                }
+            }
+        }
+    };
+
+    // Readers are separate threads so the caller keeps its own affinity mask
+    vector<thread> readers;
+    for (size_t node_index = 0; node_index < nodes.size(); node_index++) {
+        readers.emplace_back(read_stripes, node_index);
+    }
+    for (thread &reader: readers) reader.join();
+    close(descriptor);
+
+    if (failed) {
+        error = "Failed to read input file " + string(path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sparse_file.h"
+
+/**
+ * @file numa_topology.h
+ * @brief NUMA nodes from sysfs, worker pinning and node-local input placement
+ *
+ * On multi-socket hosts a buffer read by a single thread ends up entirely on
+ * that thread's node, and every worker on the other sockets then pulls its
+ * blocks across the interconnect. The helpers here avoid that without
+ * libnuma:
+ * - load_numa_topology() reads /sys/devices/system/node/node<N>/cpulist and
+ *   keeps only the CPUs in this process's affinity mask
+ * - load_input_numa() reads the input in NUMA_STRIPE_BYTES stripes assigned
+ *   round-robin to the nodes, each from a thread pinned to its node, so
+ *   first-touch places every stripe's pages on the node that reads it; holes
+ *   of sparse files are skipped as in read_sparse_input()
+ * - memory_nodes() asks the kernel (move_pages in query mode) where pages
+ *   actually reside, which is what the block scheduler matches workers to
+ *
+ * Hosts without /sys/devices/system/node (or with one node) get a single
+ * node holding every allowed CPU, so the same code path works everywhere.
+ */
+
+// Input bytes per placement stripe; a multiple of every sensible block size
+#define NUMA_STRIPE_BYTES (16u << 20)
+
+/**
+ * @struct numa_node
+ * @brief One node and the CPUs of it this process may run on
+ */
+struct numa_node {
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+/**
+ * @brief Discovers the nodes that have at least one usable CPU
+ * @return Nodes in id order, never empty
+ */
+std::vector<numa_node> load_numa_topology();
+
+/**
+ * @brief Restricts the calling thread to the CPUs of one node
+ *
+ * Threads created afterwards by this thread inherit the mask, so pinning the
+ * thread that starts a worker group pins the whole group.
+ */
+bool pin_thread_to_node(const numa_node &node);
+
+/**
+ * @brief Node of the page holding each address data + i * stride, i < count
+ * @param nodes Output, -1 where the page is not resident or the kernel does not tell
+ */
+void memory_nodes(const uint8_t *data, size_t stride, size_t count, std::vector<int> &nodes);
+
+/**
+ * @struct numa_input
+ * @brief Input file held in anonymous memory placed stripe by stripe
+ */
+struct numa_input : zero_buffer {
+    std::vector<data_extent> extents;
+};
+
+/**
+ * @brief Reads a whole file with one pinned reader thread per node
+ * @param path Input file
+ * @param nodes Topology from load_numa_topology()
+ * @param input Output buffer
+ * @param error Set when the file cannot be opened, mapped or read
+ */
+bool load_input_numa(const char *path, const std::vector<numa_node> &nodes, numa_input &input, std::string &error);
@@ -0,0 +1,82 @@
+#include <cstring>
+#include <cerrno>
+
+#include "progress_reporter.h"
+
+/**
+ * @file progress_reporter.cpp
+ * @brief JSON-lines progress events for the GUI and other front ends
+ */
+
+using namespace std;
+using namespace chrono;
+
+progress_reporter::~progress_reporter() {
+    if (output && output != stderr) fclose(output);
+}
+
+bool progress_reporter::open(const char *path, string &error) {
+    if (strcmp(path, "-") == 0) {
+        output = stderr;
+    } else if (!(output = fopen(path, "w"))) {
+        error = "Cannot open progress stream " + string(path) + ": " + strerror(errno);
+        return false;
+    }
+    start_time = clock::now();
+    return true;
+}
+
+void progress_reporter::begin_stage(const char *name, const uint64_t total) {
+    if (!output) return;
+
+    lock_guard lock(mutex);
+    // Final event of the stage, unless advance() just reported the same count
+    if (!stage.empty() && stage_bytes.load(memory_order_relaxed) != last_event_bytes) write_event("progress");
+    stage = name;
+    stage_total = total;
+    stage_bytes.store(0, memory_order_relaxed);
+    last_event_bytes = 0;
+    write_event("stage");
+}
+
+void progress_reporter::advance(const uint64_t bytes) {
+    if (!output) return;
+
+    stage_bytes.fetch_add(bytes, memory_order_relaxed);
+    const int64_t now_ns = duration_cast<nanoseconds>(clock::now() - start_time).count();
+    int64_t due = next_event_ns.load(memory_order_relaxed);
+    // Only the worker that moves the deadline forward writes the event
+    if (now_ns < due || !next_event_ns.compare_exchange_strong(due, now_ns + PROGRESS_INTERVAL_MS * 1000000ll)) {
+        return;
+    }
+
+    lock_guard lock(mutex);
+    write_event("progress");
+}
+
+void progress_reporter::finish() {
+    if (!output) return;
+
+    lock_guard lock(mutex);
+    if (!stage.empty() && stage_bytes.load(memory_order_relaxed) != last_event_bytes) write_event("progress");
+    write_event("done");
+}
+
+void progress_reporter::write_event(const char *event) {
+    const double elapsed = duration<double>(clock::now() - start_time).count();
+    const uint64_t bytes = stage_bytes.load(memory_order_relaxed);
+
+    // Instantaneous rate: bytes since the previous event of this stage
+    const double interval = elapsed - last_event_seconds;
+    const double mbps = interval > 0 && bytes >= last_event_bytes
+                            ? static_cast<double>(bytes - last_event_bytes) / interval / 1e6
+                            : 0.0;
+    last_event_seconds = elapsed;
+    last_event_bytes = bytes;
+
+    fprintf(output, R"({"event":"%s","stage":"%s","bytes":%llu,"total":%llu,"elapsed":%.3f,"mbps":%.1f})" "\n",
+            event, stage.c_str(), static_cast<unsigned long long>(bytes), static_cast<unsigned long long>(stage_total),
+            elapsed, mbps);
+    // Readers act on events as they arrive
+    fflush(output);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+/**
+ * @file progress_reporter.h
+ * @brief Structured progress events written by the tools' `--progress` option
+ *
+ * Events are single-line JSON objects, one per line, so a reader can parse
+ * them as they arrive:
+ *
+ *   {"event":"progress","stage":"encode","bytes":1048576,"total":8388608,"elapsed":0.412,"mbps":254.3}
+ *
+ * - event: "stage" when a stage starts, "progress" while it runs (at most every
+ *   PROGRESS_INTERVAL_MS, plus once when it ends), "done" at the end of the run
+ * - bytes / total: bytes processed in the current stage and its size (0 if unknown)
+ * - elapsed: seconds since the reporter was opened
+ * - mbps: throughput since the previous event (10^6 bytes per second)
+ *
+ * The destination is a path; "-" means stderr and "/dev/fd/<n>" an inherited
+ * pipe, which keeps the events out of the human-readable stdout. A reporter
+ * that was never opened ignores all calls, so the hot loops only pay for one
+ * branch when progress is off.
+ */
+
+// Minimum spacing of "progress" events
+#define PROGRESS_INTERVAL_MS 100
+
+// Granularity at which byte-wise loops call advance()
+#define PROGRESS_STEP_BYTES (1u << 20)
+
+/**
+ * @struct progress_reporter
+ * @brief Thread-safe: advance() may be called from every worker
+ */
+struct progress_reporter {
+    using clock = std::chrono::steady_clock;
+
+    FILE *output = nullptr;
+    std::mutex mutex;
+    std::string stage;
+    uint64_t stage_total = 0;
+    std::atomic<uint64_t> stage_bytes{0};
+    std::atomic<int64_t> next_event_ns{0}; // Since start; cheap check before taking the mutex
+    clock::time_point start_time;
+    double last_event_seconds = 0.0;
+    uint64_t last_event_bytes = 0;
+
+    progress_reporter() = default;
+    progress_reporter(const progress_reporter &) = delete;
+    progress_reporter &operator=(const progress_reporter &) = delete;
+    ~progress_reporter();
+
+    // Opens the destination (see above); returns false with a message if it cannot be opened
+    bool open(const char *path, std::string &error);
+
+    [[nodiscard]] bool enabled() const { return output != nullptr; }
+
+    // Ends the current stage (final "progress" event) and announces the next one
+    void begin_stage(const char *name, uint64_t total);
+
+    // Adds processed bytes to the current stage
+    void advance(uint64_t bytes);
+
+    // Ends the current stage and writes the "done" event
+    void finish();
+
+    // Writes one event (mutex held)
+    void write_event(const char *event);
+};
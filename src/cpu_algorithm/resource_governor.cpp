@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <ctime>
+
+#include "resource_governor.h"
+
+/**
+ * @file resource_governor.cpp
+ * @brief Token-bucket pacing, CPU budget and dynamic worker count
+ */
+
+using namespace std;
+using namespace chrono;
+
+/**
+ * @brief CPU time consumed by all threads of this process
+ */
+static double process_cpu_seconds() {
+    timespec time{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1e-9;
+}
+
+resource_governor::resource_governor(const resource_limits &limits, const unsigned worker_count)
+    : limits(limits), worker_count(max(1u, worker_count)), rate_bytes(limits.max_rate_mbps * 1e6),
+      next_release(clock::now()), start_time(clock::now()), start_cpu_seconds(process_cpu_seconds()) {
+    update_active_workers();
+}
+
+void resource_governor::begin_task(const size_t bytes) {
+    // Token bucket: reserve this block's bytes and wait until they are paid for
+    if (rate_bytes > 0) {
+        clock::time_point release;
+        {
+            lock_guard lock(mutex);
+            const auto earliest = clock::now() - duration_cast<clock::duration>(duration<double>(RATE_BURST_SECONDS));
+            if (next_release < earliest) next_release = earliest;
+            release = next_release;
+            next_release += duration_cast<clock::duration>(duration<double>(static_cast<double>(bytes) / rate_bytes));
+        }
+        this_thread::sleep_until(release);
+    }
+
+    // CPU budget: sleep until the average usage is back under the budget
+    if (limits.cpu_budget > 0) {
+        const double used = process_cpu_seconds() - start_cpu_seconds;
+        const double elapsed = duration<double>(clock::now() - start_time).count();
+        if (const double excess = used / limits.cpu_budget - elapsed; excess > 0) {
+            this_thread::sleep_for(duration<double>(excess));
+        }
+    }
+
+    unique_lock lock(mutex);
+    slot_released.wait(lock, [&] { return running < active; });
+    running++;
+}
+
+void resource_governor::end_task(const size_t bytes, const double seconds) {
+    {
+        lock_guard lock(mutex);
+        running--;
+        if (seconds > 0) {
+            const double speed = static_cast<double>(bytes) / seconds;
+            worker_bytes_per_second = worker_bytes_per_second == 0 ? speed : 0.8 * worker_bytes_per_second + 0.2 * speed;
+        }
+        update_active_workers();
+    }
+    slot_released.notify_all();
+}
+
+void resource_governor::update_active_workers() {
+    unsigned limit = worker_count;
+    if (limits.cpu_budget > 0) {
+        limit = min(limit, max(1u, static_cast<unsigned>(ceil(limits.cpu_budget))));
+    }
+    // Only as many workers as the target rate needs at the measured per-worker speed
+    if (rate_bytes > 0 && worker_bytes_per_second > 0) {
+        limit = min(limit, max(1u, static_cast<unsigned>(ceil(rate_bytes / worker_bytes_per_second))));
+    }
+    active = limit;
+}
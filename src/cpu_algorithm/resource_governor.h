@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+/**
+ * @file resource_governor.h
+ * @brief Throughput and CPU budgets for background compression
+ *
+ * The block scheduler asks the governor for permission before every block and
+ * reports back afterwards. Three limits are enforced:
+ * - max_workers: at most this many blocks are coded concurrently
+ * - rate (bytes/s): token bucket over the input bytes; a block waits until the
+ *   bucket has paid for it, with up to RATE_BURST_SECONDS of accumulated credit
+ * - cpu_budget (cores): the process's CPU time may not exceed
+ *   cpu_budget x wall time; workers sleep off any excess
+ *
+ * The number of active workers is also adjusted while running: with a rate
+ * limit only as many workers as the measured per-block speed needs are kept
+ * busy, and never more than ceil(cpu_budget). Idle workers block instead of
+ * spinning, so a throttled run leaves the remaining cores untouched.
+ */
+
+// Credit a paced run may accumulate while idle, in seconds of the target rate
+#define RATE_BURST_SECONDS 0.25
+
+/**
+ * @struct resource_limits
+ * @brief User-facing limits; 0 disables a limit
+ */
+struct resource_limits {
+    unsigned max_threads = 0;
+    double max_rate_mbps = 0.0; // MB/s (10^6 bytes)
+    double cpu_budget = 0.0; // Cores, e.g. 0.5 or 2
+};
+
+/**
+ * @struct resource_governor
+ * @brief Shared by all workers of a run; begin_task/end_task are thread-safe
+ */
+struct resource_governor {
+    using clock = std::chrono::steady_clock;
+
+    resource_limits limits;
+    unsigned worker_count;
+    unsigned active = 1; // Workers currently allowed to run blocks
+    unsigned running = 0;
+
+    double rate_bytes = 0.0; // Bytes per second, 0 = unlimited
+    clock::time_point next_release; // Token bucket: when the bytes granted so far are paid for
+    clock::time_point start_time;
+    double start_cpu_seconds = 0.0;
+    double worker_bytes_per_second = 0.0; // Smoothed single-worker speed
+
+    std::mutex mutex;
+    std::condition_variable slot_released;
+
+    resource_governor(const resource_limits &limits, unsigned worker_count);
+
+    // Blocks until the block may start (rate, CPU budget, active worker count)
+    void begin_task(size_t bytes);
+
+    // Releases the worker slot and updates the speed estimate
+    void end_task(size_t bytes, double seconds);
+
+    // Recomputes `active` from the limits and the speed estimate (mutex held)
+    void update_active_workers();
+};
@@ -0,0 +1,235 @@
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "format_utilities.h"
+#include "shared_block_cache.h"
+
+/**
+ * @file shared_block_cache.cpp
+ * @brief Shared-memory segment setup, seqlock lookups and per-set CLOCK eviction
+ */
+
+using namespace std;
+
+/*=============================================================================
+ * SEGMENT
+ *=============================================================================*/
+
+// Alignment of the slot data, so every slot starts on its own pages
+#define SHARED_CACHE_DATA_ALIGNMENT 4096
+
+static size_t align_up(const size_t value, const size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief Byte offsets of the segment parts for a slot count
+ */
+static void segment_layout(const uint64_t slot_count, size_t &hands_offset, size_t &slots_offset,
+                           size_t &data_offset) {
+    hands_offset = align_up(sizeof(shared_cache_header), alignof(shared_cache_slot));
+    slots_offset = align_up(hands_offset + slot_count / SHARED_CACHE_WAYS * sizeof(atomic<uint32_t>),
+                            alignof(shared_cache_slot));
+    data_offset = align_up(slots_offset + slot_count * sizeof(shared_cache_slot), SHARED_CACHE_DATA_ALIGNMENT);
+}
+
+static string segment_name(const string &name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+shared_block_cache::~shared_block_cache() {
+    if (header) munmap(header, mapping_size);
+}
+
+bool shared_block_cache::open(const string &name, const uint64_t bytes, const uint32_t slot_size, string &error) {
+    const string path = segment_name(name);
+    int descriptor = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    const bool creator = descriptor >= 0;
+    if (!creator && errno == EEXIST) descriptor = shm_open(path.c_str(), O_RDWR, 0);
+    if (descriptor < 0) {
+        error = "Cannot open shared cache " + path + ": " + strerror(errno);
+        return false;
+    }
+
+    size_t hands_offset, slots_offset, data_offset;
+    void *mapping = MAP_FAILED;
+    if (creator) {
+        // Whole sets of at least one slot each; the hands and slots start zeroed by ftruncate
+        const uint64_t set_count = max<uint64_t>(1, bytes / max<uint32_t>(slot_size, 1) / SHARED_CACHE_WAYS);
+        const uint64_t slot_count = set_count * SHARED_CACHE_WAYS;
+        segment_layout(slot_count, hands_offset, slots_offset, data_offset);
+        mapping_size = data_offset + slot_count * slot_size;
+        if (ftruncate(descriptor, static_cast<off_t>(mapping_size)) == 0) {
+            mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        }
+        if (mapping == MAP_FAILED) {
+            error = "Cannot create shared cache " + path + ": " + strerror(errno);
+            shm_unlink(path.c_str());
+            close(descriptor);
+            return false;
+        }
+        header = new (mapping) shared_cache_header{};
+        header->version = SHARED_CACHE_VERSION;
+        header->ways = SHARED_CACHE_WAYS;
+        header->slot_count = slot_count;
+        header->slot_size = slot_size;
+        header->segment_size = mapping_size;
+        header->magic.store(SHARED_CACHE_MAGIC, memory_order_release);
+    } else {
+        // The creator may still be sizing or initializing the segment
+        const auto deadline = chrono::steady_clock::now() + chrono::milliseconds(SHARED_CACHE_INIT_TIMEOUT_MS);
+        struct stat status{};
+        bool ready = false;
+        while (!ready && chrono::steady_clock::now() < deadline) {
+            if (fstat(descriptor, &status) == 0 && static_cast<size_t>(status.st_size) >= sizeof(shared_cache_header)) {
+                if (mapping == MAP_FAILED) {
+                    mapping = mmap(nullptr, sizeof(shared_cache_header), PROT_READ, MAP_SHARED, descriptor, 0);
+                }
+                ready = mapping != MAP_FAILED &&
+                        static_cast<shared_cache_header *>(mapping)->magic.load(memory_order_acquire) ==
+                        SHARED_CACHE_MAGIC;
+            }
+            if (!ready) this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        if (!ready) {
+            error = "Shared cache " + path + " was not initialized";
+            if (mapping != MAP_FAILED) munmap(mapping, sizeof(shared_cache_header));
+            close(descriptor);
+            return false;
+        }
+        const auto *existing = static_cast<shared_cache_header *>(mapping);
+        const bool compatible = existing->version == SHARED_CACHE_VERSION && existing->ways == SHARED_CACHE_WAYS &&
+                                existing->segment_size <= static_cast<uint64_t>(status.st_size);
+        mapping_size = existing->segment_size;
+        munmap(mapping, sizeof(shared_cache_header));
+        mapping = compatible ? mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0)
+                             : MAP_FAILED;
+        if (mapping == MAP_FAILED) {
+            error = "Cannot use shared cache " + path + (compatible ? ": " + string(strerror(errno))
+                                                                   : " (different version or truncated)");
+            close(descriptor);
+            return false;
+        }
+        header = static_cast<shared_cache_header *>(mapping);
+        segment_layout(header->slot_count, hands_offset, slots_offset, data_offset);
+    }
+    close(descriptor);
+
+    auto *base = static_cast<uint8_t *>(mapping);
+    hands = reinterpret_cast<atomic<uint32_t> *>(base + hands_offset);
+    slots = reinterpret_cast<shared_cache_slot *>(base + slots_offset);
+    slot_data = base + data_offset;
+    return true;
+}
+
+uint64_t shared_block_cache::capacity_bytes() const {
+    return header ? header->slot_count * header->slot_size : 0;
+}
+
+bool file_identity(const char *path, uint64_t &file_id, string &error) {
+    struct stat status{};
+    if (stat(path, &status) != 0) {
+        error = "Cannot stat " + string(path) + ": " + strerror(errno);
+        return false;
+    }
+    const uint64_t fields[] = {
+        static_cast<uint64_t>(status.st_dev), static_cast<uint64_t>(status.st_ino),
+        static_cast<uint64_t>(status.st_size), static_cast<uint64_t>(status.st_mtim.tv_sec),
+        static_cast<uint64_t>(status.st_mtim.tv_nsec)
+    };
+    file_id = data_checksum(reinterpret_cast<const uint8_t *>(fields), sizeof(fields));
+    return true;
+}
+
+bool remove_shared_block_cache(const string &name, string &error) {
+    const string path = segment_name(name);
+    if (shm_unlink(path.c_str()) != 0) {
+        error = "Cannot remove shared cache " + path + ": " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+/*=============================================================================
+ * LOOKUP AND INSERT
+ *=============================================================================*/
+
+/**
+ * @brief First slot of the key's set
+ */
+static uint64_t set_base(const shared_cache_key &key, const uint64_t slot_count) {
+    uint64_t hash = key.file_id ^ key.block * 0x9E3779B97F4A7C15ull ^ key.checksum;
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    return hash % (slot_count / SHARED_CACHE_WAYS) * SHARED_CACHE_WAYS;
+}
+
+static bool slot_matches(const shared_cache_slot &slot, const shared_cache_key &key) {
+    return slot.file_id.load(memory_order_relaxed) == key.file_id &&
+           slot.block.load(memory_order_relaxed) == key.block &&
+           slot.checksum.load(memory_order_relaxed) == key.checksum;
+}
+
+bool shared_block_cache::lookup(const shared_cache_key &key, uint8_t *output, const size_t capacity, size_t &length) {
+    const uint64_t base = set_base(key, header->slot_count);
+    for (uint64_t index = base; index < base + SHARED_CACHE_WAYS; index++) {
+        shared_cache_slot &slot = slots[index];
+        const uint64_t sequence = slot.sequence.load(memory_order_acquire);
+        if (sequence == 0 || sequence & 1 || !slot_matches(slot, key)) continue;
+        const uint32_t stored_length = slot.length.load(memory_order_relaxed);
+        if (stored_length > capacity) continue;
+
+        memcpy(output, slot_data + index * header->slot_size, stored_length);
+        // The copy only counts if no writer claimed the slot meanwhile
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.sequence.load(memory_order_relaxed) != sequence) continue;
+
+        slot.referenced.store(1, memory_order_relaxed);
+        length = stored_length;
+        hits.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+    misses.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+bool shared_block_cache::insert(const shared_cache_key &key, const uint8_t *data, const size_t length) {
+    if (length == 0 || length > header->slot_size) return false;
+    const uint64_t base = set_base(key, header->slot_count);
+    for (uint64_t index = base; index < base + SHARED_CACHE_WAYS; index++) {
+        const uint64_t sequence = slots[index].sequence.load(memory_order_acquire);
+        if (sequence != 0 && !(sequence & 1) && slot_matches(slots[index], key)) return false;
+    }
+
+    // Two sweeps of the hand: the first may only clear referenced bits
+    atomic<uint32_t> &hand = hands[base / SHARED_CACHE_WAYS];
+    for (unsigned attempt = 0; attempt < 2 * SHARED_CACHE_WAYS; attempt++) {
+        const uint64_t index = base + hand.fetch_add(1, memory_order_relaxed) % SHARED_CACHE_WAYS;
+        shared_cache_slot &slot = slots[index];
+        uint64_t sequence = slot.sequence.load(memory_order_acquire);
+        if (sequence & 1) continue;
+        if (sequence != 0 && slot.referenced.exchange(0, memory_order_relaxed) != 0) continue;
+        if (!slot.sequence.compare_exchange_strong(sequence, sequence + 1, memory_order_acquire)) continue;
+        // Readers that see any of the new contents also see the odd sequence
+        atomic_thread_fence(memory_order_release);
+
+        slot.file_id.store(key.file_id, memory_order_relaxed);
+        slot.block.store(key.block, memory_order_relaxed);
+        slot.checksum.store(key.checksum, memory_order_relaxed);
+        slot.length.store(static_cast<uint32_t>(length), memory_order_relaxed);
+        memcpy(slot_data + index * header->slot_size, data, length);
+        slot.sequence.store(sequence + 2, memory_order_release);
+        slot.referenced.store(1, memory_order_relaxed);
+        inserts.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
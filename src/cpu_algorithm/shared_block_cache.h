@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @file shared_block_cache.h
+ * @brief Host-wide cache of decoded blocks in POSIX shared memory
+ *
+ * Worker processes that read the same containers would otherwise each decode
+ * the same hot blocks. Any process that opens the same segment name shares
+ * one set of decoded blocks, keyed by (file identity, block index, block
+ * checksum); the checksum comes from the container index, so a rewritten
+ * file never hits stale entries even if its identity were reused.
+ *
+ * Layout: a header, one clock hand per set, the slot descriptors (one cache
+ * line each) and the slot data. The cache is set-associative: a key hashes
+ * to a set of SHARED_CACHE_WAYS slots, and only those are searched.
+ *
+ * Lookup is lock-free. Every slot carries a sequence number that is odd
+ * while a writer fills it (a seqlock): a reader copies the slot and keeps the
+ * copy only if the sequence was even and unchanged around it. A writer
+ * claims a slot with a compare-and-swap from even to odd, so writers never
+ * wait for each other either; a writer that finds every slot of the set busy
+ * simply does not insert.
+ *
+ * Eviction is CLOCK within a set: lookups set a slot's referenced bit, and
+ * the set's hand clears referenced bits until it reaches a slot without one,
+ * which is replaced. Slots a crashed writer left odd are skipped until the
+ * segment is removed (remove_shared_block_cache). Two processes that miss
+ * the same block at the same moment both decode it; one copy is kept.
+ */
+
+// Segment format
+#define SHARED_CACHE_MAGIC 0x0A434D4853465548ull // "HUFSHMC\n" read as a little-endian u64
+#define SHARED_CACHE_VERSION 1
+
+// Slots per set searched by a lookup
+#define SHARED_CACHE_WAYS 8
+
+// Default segment size for --shared-cache without a size
+#define SHARED_CACHE_DEFAULT_MIB 256
+
+// How long a process waits for another one to initialize a new segment
+#define SHARED_CACHE_INIT_TIMEOUT_MS 2000
+
+/**
+ * @struct shared_cache_key
+ * @brief Identity of one decoded block
+ */
+struct shared_cache_key {
+    uint64_t file_id; // file_identity() of the container
+    uint64_t block; // Block index in the container
+    uint64_t checksum; // Index checksum of the block's decoded data
+};
+
+/**
+ * @struct shared_cache_header
+ * @brief First bytes of the segment; geometry is fixed by the process that created it
+ */
+struct shared_cache_header {
+    std::atomic<uint64_t> magic; // Stored last, once the rest is initialized
+    uint32_t version;
+    uint32_t ways;
+    uint64_t slot_count;
+    uint64_t slot_size; // Largest block the cache holds
+    uint64_t segment_size;
+};
+
+/**
+ * @struct shared_cache_slot
+ * @brief Descriptor of one slot; a sequence of 0 marks a slot that was never filled
+ */
+struct alignas(64) shared_cache_slot {
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> file_id;
+    std::atomic<uint64_t> block;
+    std::atomic<uint64_t> checksum;
+    std::atomic<uint32_t> length;
+    std::atomic<uint32_t> referenced;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory atomics must be address-free");
+
+/**
+ * @struct shared_block_cache
+ * @brief One process's mapping of a shared cache segment
+ */
+struct shared_block_cache {
+    shared_cache_header *header = nullptr;
+    std::atomic<uint32_t> *hands = nullptr; // One clock hand per set
+    shared_cache_slot *slots = nullptr;
+    uint8_t *slot_data = nullptr;
+    size_t mapping_size = 0;
+
+    // This process's counters
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> inserts{0};
+
+    shared_block_cache() = default;
+    shared_block_cache(const shared_block_cache &) = delete;
+    shared_block_cache &operator=(const shared_block_cache &) = delete;
+    ~shared_block_cache();
+
+    /**
+     * @brief Opens a segment, creating it if no process has yet
+     * @param name Segment name ("/" is prepended when missing)
+     * @param bytes Data size of a new segment; ignored when it exists
+     * @param slot_size Largest block a new segment holds (the block size of the reader's container)
+     * @param error Set when the segment cannot be created, mapped or is from another version
+     */
+    bool open(const std::string &name, uint64_t bytes, uint32_t slot_size, std::string &error);
+
+    /**
+     * @brief Copies a cached block into output
+     * @param capacity Room in output; entries longer than this are not returned
+     * @param length Receives the block length on a hit
+     */
+    bool lookup(const shared_cache_key &key, uint8_t *output, size_t capacity, size_t &length);
+
+    /**
+     * @brief Publishes a decoded block
+     * @return false when the block is larger than a slot, already cached or every slot of its set is being written
+     */
+    bool insert(const shared_cache_key &key, const uint8_t *data, size_t length);
+
+    // Decoded bytes the mapped segment can hold (slot count times slot size)
+    [[nodiscard]] uint64_t capacity_bytes() const;
+};
+
+/**
+ * @brief Host-unique identity of a file's current contents (device, inode, size, modification time)
+ * @return false when the file cannot be stat'ed
+ */
+bool file_identity(const char *path, uint64_t &file_id, std::string &error);
+
+/**
+ * @brief Removes a segment; processes that have it mapped keep using it until they exit
+ */
+bool remove_shared_block_cache(const std::string &name, std::string &error);
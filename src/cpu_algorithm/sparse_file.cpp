@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sparse_file.h"
+
+/**
+ * @file sparse_file.cpp
+ * @brief SEEK_DATA / SEEK_HOLE extents, zero checks and hole-preserving writes
+ */
+
+using namespace std;
+
+void file_data_extents(const int descriptor, const uint64_t size, vector<data_extent> &extents) {
+    extents.clear();
+    off_t position = 0;
+    while (static_cast<uint64_t>(position) < size) {
+        const off_t data = lseek(descriptor, position, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) break; // Only a hole remains
+            extents.assign(1, {0, size}); // No hole reporting: treat everything as data
+            return;
+        }
+        off_t hole = lseek(descriptor, data, SEEK_HOLE);
+        if (hole < 0) hole = static_cast<off_t>(size);
+        hole = min(hole, static_cast<off_t>(size));
+        extents.push_back({static_cast<uint64_t>(data), static_cast<uint64_t>(hole - data)});
+        position = hole;
+    }
+}
+
+bool range_has_data(const vector<data_extent> &extents, const uint64_t offset, const uint64_t length) {
+    // First extent ending after offset; the range has data if it also starts before the range ends
+    const auto extent = upper_bound(extents.begin(), extents.end(), offset, [](const uint64_t value,
+                                                                               const data_extent &candidate) {
+        return value < candidate.offset + candidate.length;
+    });
+    return extent != extents.end() && extent->offset < offset + length;
+}
+
+bool is_zero_block(const uint8_t *data, const size_t length) {
+    constexpr size_t head = 16;
+    for (size_t index = 0; index < min(head, length); index++) {
+        if (data[index] != 0) return false;
+    }
+    return length <= head || memcmp(data, data + head, length - head) == 0;
+}
+
+zero_buffer::~zero_buffer() {
+    if (data) munmap(data, size);
+}
+
+bool zero_buffer::allocate(const size_t bytes, string &error) {
+    if (bytes == 0) return true;
+    void *mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        error = "Cannot allocate " + to_string(bytes) + " bytes: " + strerror(errno);
+        return false;
+    }
+    data = static_cast<uint8_t *>(mapping);
+    size = bytes;
+    return true;
+}
+
+bool read_sparse_input(const char *path, sparse_input &input, string &error) {
+    const int descriptor = open(path, O_RDONLY);
+    struct stat status{};
+    if (descriptor < 0 || fstat(descriptor, &status) != 0) {
+        error = "Cannot open input file " + string(path);
+        if (descriptor >= 0) close(descriptor);
+        return false;
+    }
+
+    const auto size = static_cast<size_t>(status.st_size);
+    file_data_extents(descriptor, size, input.extents);
+    if (!input.allocate(size, error)) {
+        close(descriptor);
+        return false;
+    }
+
+    for (const data_extent &extent: input.extents) {
+        uint64_t done = extent.offset;
+        const uint64_t end = extent.offset + extent.length;
+        while (done < end) {
+            const ssize_t count = pread(descriptor, input.data + done, end - done, static_cast<off_t>(done));
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) {
+                error = "Failed to read input file " + string(path);
+                close(descriptor);
+                return false;
+            }
+            done += static_cast<uint64_t>(count);
+        }
+        input.data_bytes += extent.length;
+    }
+    close(descriptor);
+    return true;
+}
+
+/**
+ * @brief pwrite() until everything is written
+ */
+static bool write_all(const int descriptor, const uint8_t *data, size_t size, uint64_t offset, string &error) {
+    while (size > 0) {
+        const ssize_t count = pwrite(descriptor, data, size, static_cast<off_t>(offset));
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) {
+            error = string("Write failed: ") + strerror(errno);
+            return false;
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+        offset += static_cast<uint64_t>(count);
+    }
+    return true;
+}
+
+bool write_sparse(const int descriptor, const uint8_t *data, const size_t size, const uint64_t offset,
+                  string &error) {
+    // Walk file-aligned granules; runs of data granules are written with one pwrite each
+    size_t run_start = 0;
+    size_t position = 0;
+    while (position < size) {
+        const uint64_t file_position = offset + position;
+        const size_t granule = min<size_t>(SPARSE_GRANULE_BYTES - file_position % SPARSE_GRANULE_BYTES,
+                                           size - position);
+        if (granule == SPARSE_GRANULE_BYTES && is_zero_block(data + position, granule)) {
+            if (!write_all(descriptor, data + run_start, position - run_start, offset + run_start, error)) {
+                return false;
+            }
+            run_start = position + granule;
+        }
+        position += granule;
+    }
+    return write_all(descriptor, data + run_start, size - run_start, offset + run_start, error);
+}
+
+bool finish_sparse_file(const int descriptor, const uint64_t size, string &error) {
+    if (ftruncate(descriptor, static_cast<off_t>(size)) != 0) {
+        error = string("Cannot set the output length: ") + strerror(errno);
+        return false;
+    }
+    return true;
+}
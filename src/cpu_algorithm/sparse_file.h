@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file sparse_file.h
+ * @brief Hole-aware reading and writing for sparse inputs (VM and database images)
+ *
+ * Reading: file_data_extents() asks the file system for the ranges that hold
+ * data (lseek SEEK_DATA / SEEK_HOLE); read_sparse_input() reads only those
+ * into an anonymous mapping whose untouched pages read as zero without
+ * costing memory. File systems without hole reporting return one extent
+ * covering the whole file, so every caller works unchanged on them.
+ *
+ * Writing: write_sparse() skips every SPARSE_GRANULE_BYTES-aligned run of
+ * zero bytes instead of writing it and finish_sparse_file() sets the final
+ * length, so the runs become holes again.
+ */
+
+// Granule below which zero runs are written instead of skipped (the usual file system block)
+#define SPARSE_GRANULE_BYTES 4096
+
+/**
+ * @struct data_extent
+ * @brief A byte range of a file that holds data
+ */
+struct data_extent {
+    uint64_t offset;
+    uint64_t length;
+};
+
+/**
+ * @brief Lists the data ranges of an open file, in offset order
+ * @param descriptor Open file
+ * @param size File size
+ * @param extents Output; a single full-size extent when holes cannot be queried
+ */
+void file_data_extents(int descriptor, uint64_t size, std::vector<data_extent> &extents);
+
+/**
+ * @brief Whether any byte of [offset, offset + length) lies in a data extent
+ */
+bool range_has_data(const std::vector<data_extent> &extents, uint64_t offset, uint64_t length);
+
+/**
+ * @brief Whether a buffer is all zero
+ *
+ * Checks the first 16 bytes and then compares the buffer with itself shifted
+ * by 16, which libc's vectorized memcmp does at memory speed and stops at the
+ * first non-zero byte.
+ */
+bool is_zero_block(const uint8_t *data, size_t length);
+
+/**
+ * @struct zero_buffer
+ * @brief Zero-filled anonymous memory that costs nothing until written
+ */
+struct zero_buffer {
+    uint8_t *data = nullptr;
+    size_t size = 0;
+
+    zero_buffer() = default;
+    zero_buffer(const zero_buffer &) = delete;
+    zero_buffer &operator=(const zero_buffer &) = delete;
+    ~zero_buffer();
+
+    bool allocate(size_t bytes, std::string &error);
+};
+
+/**
+ * @struct sparse_input
+ * @brief A file read hole-aware into anonymous memory
+ */
+struct sparse_input : zero_buffer {
+    std::vector<data_extent> extents;
+    uint64_t data_bytes = 0; // Bytes actually read (sum of the extents)
+};
+
+/**
+ * @brief Reads the data extents of a file; holes stay as untouched zero pages
+ */
+bool read_sparse_input(const char *path, sparse_input &input, std::string &error);
+
+/**
+ * @brief Writes data at a file offset, leaving aligned zero granules as holes
+ * @param descriptor File opened for writing (and truncated, so skipped ranges read as zero)
+ * @param data Data to write
+ * @param size Length of data
+ * @param offset File offset of data[0]
+ * @param error Set when a write fails
+ */
+bool write_sparse(int descriptor, const uint8_t *data, size_t size, uint64_t offset, std::string &error);
+
+/**
+ * @brief Sets the final length, creating the trailing hole if the file ends in zeros
+ */
+bool finish_sparse_file(int descriptor, uint64_t size, std::string &error);
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "format_utilities.h"
+#include "striped_container.h"
+#include "worker_pool.h"
+
+/**
+ * @file striped_container.cpp
+ * @brief Stripe writer threads, block assignment policies and the stripe manifest
+ */
+
+using namespace std;
+
+bool parse_stripe_policy(const string &text, stripe_policy &policy) {
+    if (text == "round-robin") policy = STRIPE_ROUND_ROBIN;
+    else if (text == "queue-depth") policy = STRIPE_QUEUE_DEPTH;
+    else return false;
+    return true;
+}
+
+string resolve_stripe_path(const string &manifest_path, const string &stripe_path) {
+    const size_t slash = manifest_path.rfind('/');
+    if (stripe_path.empty() || stripe_path[0] == '/' || slash == string::npos) return stripe_path;
+    return manifest_path.substr(0, slash + 1) + stripe_path;
+}
+
+uint64_t stripe_digest(const vector<block_index_entry> &blocks) {
+    vector<uint8_t> checksums;
+    checksums.reserve(blocks.size() * 8);
+    for (const block_index_entry &entry: blocks) append_u64(checksums, entry.checksum);
+    return data_checksum(checksums.data(), checksums.size());
+}
+
+/*=============================================================================
+ * WRITING
+ *=============================================================================*/
+
+/**
+ * @brief Writer thread of one stripe: writes queued blocks until the writer closes and the queue is empty
+ */
+static void stripe_writer_thread(striped_container_writer &writer, stripe_output &stripe) {
+    unique_lock lock(writer.mutex);
+    while (true) {
+        writer.work_ready.wait(lock, [&] { return !stripe.queue.empty() || writer.closing; });
+        if (stripe.queue.empty()) return;
+        const encoded_block block = std::move(stripe.queue.front());
+        stripe.queue.pop_front();
+        lock.unlock();
+
+        const auto start = chrono::steady_clock::now();
+        stripe.writer.append(block);
+        stripe.write_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        stripe.queued_bytes -= block.bytes.size();
+        writer.queued_bytes -= block.bytes.size();
+        stripe.blocks++;
+        writer.space_ready.notify_all();
+    }
+}
+
+striped_container_writer::~striped_container_writer() {
+    stop();
+}
+
+bool striped_container_writer::open(const string &manifest_path, const vector<string> &stripe_paths,
+                                    const stripe_policy policy, string &error) {
+    if (stripe_paths.empty() || stripe_paths.size() > STRIPE_MAX_COUNT) {
+        error = "Between 1 and " + to_string(STRIPE_MAX_COUNT) + " stripes are supported";
+        return false;
+    }
+    this->manifest_path = manifest_path;
+    this->stripe_paths = stripe_paths;
+    this->policy = policy;
+    for (const string &stripe_path: stripe_paths) {
+        auto stripe = make_unique<stripe_output>();
+        stripe->path = resolve_stripe_path(manifest_path, stripe_path);
+        if (stripe_path.size() > UINT16_MAX || stripe->path == manifest_path) {
+            error = "Invalid stripe path " + stripe_path;
+            return false;
+        }
+        stripe->file.open(stripe->path, ios::binary);
+        if (!stripe->file) {
+            error = "Cannot create stripe file " + stripe->path;
+            return false;
+        }
+        stripes.push_back(std::move(stripe));
+    }
+    return true;
+}
+
+void striped_container_writer::begin(const uint32_t block_size, const uint32_t table_set_id) {
+    this->block_size = block_size;
+    this->table_set_id = table_set_id;
+    for (const auto &stripe: stripes) {
+        stripe->writer.begin(block_size, table_set_id);
+        stripe->thread = thread(stripe_writer_thread, ref(*this), ref(*stripe));
+    }
+}
+
+void striped_container_writer::append(const encoded_block &block) {
+    encoded_block copy = block; // Outside the lock, which the writer threads share
+    unique_lock lock(mutex);
+    space_ready.wait(lock, [&] { return queued_bytes < STRIPE_QUEUE_LIMIT_BYTES; });
+
+    // Ties of the queue-depth policy fall back to round-robin order
+    size_t chosen = block_stripes.size() % stripes.size();
+    if (policy == STRIPE_QUEUE_DEPTH) {
+        for (size_t step = 1; step < stripes.size(); step++) {
+            const size_t candidate = (block_stripes.size() + step) % stripes.size();
+            if (stripes[candidate]->queued_bytes < stripes[chosen]->queued_bytes) chosen = candidate;
+        }
+    }
+    stripes[chosen]->queued_bytes += copy.bytes.size();
+    queued_bytes += copy.bytes.size();
+    block_stripes.push_back(static_cast<uint16_t>(chosen));
+    original_size += copy.raw_size;
+    stripes[chosen]->queue.push_back(std::move(copy));
+    lock.unlock();
+    work_ready.notify_all();
+}
+
+void striped_container_writer::stop() {
+    {
+        lock_guard lock(mutex);
+        closing = true;
+    }
+    work_ready.notify_all();
+    for (const auto &stripe: stripes) {
+        if (stripe->thread.joinable()) stripe->thread.join();
+    }
+}
+
+bool striped_container_writer::finish(string &error) {
+    stop();
+    for (const auto &stripe: stripes) {
+        stripe->file.flush();
+        if (!stripe->writer.finish()) {
+            error = "Failed to write stripe file " + stripe->path;
+            return false;
+        }
+        stripe->file.close();
+    }
+
+    vector<uint8_t> manifest(STRIPE_MANIFEST_MAGIC, STRIPE_MANIFEST_MAGIC + 8);
+    append_u16(manifest, STRIPE_MANIFEST_VERSION);
+    append_u16(manifest, static_cast<uint16_t>(stripes.size()));
+    append_u32(manifest, block_size);
+    append_u32(manifest, table_set_id);
+    append_u32(manifest, static_cast<uint32_t>(block_stripes.size()));
+    append_u64(manifest, original_size);
+    for (size_t stripe = 0; stripe < stripes.size(); stripe++) {
+        append_u16(manifest, static_cast<uint16_t>(stripe_paths[stripe].size()));
+        manifest.insert(manifest.end(), stripe_paths[stripe].begin(), stripe_paths[stripe].end());
+        append_u64(manifest, stripe_digest(stripes[stripe]->writer.index));
+    }
+    for (const uint16_t stripe: block_stripes) append_u16(manifest, stripe);
+    append_u64(manifest, data_checksum(manifest.data(), manifest.size()));
+
+    ofstream output(manifest_path, ios::binary);
+    output.write(reinterpret_cast<const char *>(manifest.data()), static_cast<streamsize>(manifest.size()));
+    output.close();
+    if (!output) {
+        error = "Failed to write stripe manifest " + manifest_path;
+        return false;
+    }
+    manifest_size = manifest.size();
+    return true;
+}
+
+uint64_t striped_container_writer::stored_size() const {
+    uint64_t size = manifest_size;
+    for (const auto &stripe: stripes) size += stripe->writer.position;
+    return size;
+}
+
+/*=============================================================================
+ * READING
+ *=============================================================================*/
+
+bool is_stripe_manifest(const uint8_t *data, const size_t size) {
+    return size >= 8 && memcmp(data, STRIPE_MANIFEST_MAGIC, 8) == 0;
+}
+
+bool open_striped_container(const uint8_t *data, const size_t size, const string &manifest_path,
+                            const bool populate, striped_container &striped, string &error) {
+    if (!is_stripe_manifest(data, size) || size < STRIPE_MANIFEST_HEADER_SIZE + 8 ||
+        read_u64(data + size - 8) != data_checksum(data, size - 8)) {
+        error = "Stripe manifest is truncated or corrupted";
+        return false;
+    }
+    if (read_u16(data + 8) != STRIPE_MANIFEST_VERSION) {
+        error = "Unsupported stripe manifest version " + to_string(read_u16(data + 8));
+        return false;
+    }
+    const size_t stripe_count = read_u16(data + 10);
+    striped.block_size = read_u32(data + 12);
+    striped.table_set_id = read_u32(data + 16);
+    const size_t block_count = read_u32(data + 20);
+    striped.original_size = read_u64(data + 24);
+
+    // Stripe paths and digests, then one stripe number per block, then the checksum
+    const size_t end = size - 8;
+    size_t position = STRIPE_MANIFEST_HEADER_SIZE;
+    vector<uint64_t> digests;
+    for (size_t stripe = 0; stripe < stripe_count; stripe++) {
+        if (position + 2 > end || position + 2 + read_u16(data + position) + 8 > end) {
+            error = "Stripe manifest is truncated";
+            return false;
+        }
+        const size_t length = read_u16(data + position);
+        striped.stripe_paths.push_back(resolve_stripe_path(
+            manifest_path, string(reinterpret_cast<const char *>(data + position + 2), length)));
+        digests.push_back(read_u64(data + position + 2 + length));
+        position += 2 + length + 8;
+    }
+    if (stripe_count == 0 || end - position != 2 * block_count) {
+        error = "Stripe manifest does not match its block count";
+        return false;
+    }
+    vector<uint32_t> stripe_blocks(stripe_count, 0);
+    striped.block_stripes.resize(block_count);
+    striped.block_positions.resize(block_count);
+    for (size_t block = 0; block < block_count; block++) {
+        const uint16_t stripe = read_u16(data + position + 2 * block);
+        if (stripe >= stripe_count) {
+            error = "Stripe manifest names stripe " + to_string(stripe) + " of " + to_string(stripe_count);
+            return false;
+        }
+        striped.block_stripes[block] = stripe;
+        striped.block_positions[block] = stripe_blocks[stripe]++;
+    }
+
+    // One thread per stripe, so each device's reads (and MAP_POPULATE faults) proceed in parallel
+    striped.files.clear();
+    for (size_t stripe = 0; stripe < stripe_count; stripe++) striped.files.push_back(make_unique<mapped_file>());
+    striped.containers.assign(stripe_count, block_container{});
+    vector<string> stripe_errors(stripe_count);
+    run_parallel(stripe_count, static_cast<unsigned>(stripe_count), [&](const size_t stripe, unsigned) {
+        string &stripe_error = stripe_errors[stripe];
+        mapped_file &file = *striped.files[stripe];
+        block_container &container = striped.containers[stripe];
+        if (!file.open(striped.stripe_paths[stripe].c_str(), populate, stripe_error) ||
+            !parse_block_container(file.data, file.size, container, stripe_error)) {
+            stripe_error = striped.stripe_paths[stripe] + ": " + stripe_error;
+        } else if (container.block_size != striped.block_size || container.table_set_id != striped.table_set_id ||
+                   container.blocks.size() != stripe_blocks[stripe] ||
+                   stripe_digest(container.blocks) != digests[stripe]) {
+            stripe_error = striped.stripe_paths[stripe] + " does not belong to this manifest";
+        }
+    });
+    uint64_t original_size = 0;
+    for (size_t stripe = 0; stripe < stripe_count; stripe++) {
+        if (!stripe_errors[stripe].empty()) {
+            error = stripe_errors[stripe];
+            return false;
+        }
+        original_size += striped.containers[stripe].original_size;
+    }
+    if (original_size != striped.original_size) {
+        error = "Stripes hold " + to_string(original_size) + " B instead of " + to_string(striped.original_size) + " B";
+        return false;
+    }
+    return true;
+}
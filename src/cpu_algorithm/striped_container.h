@@ -0,0 +1,184 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "block_format.h"
+#include "mapped_file.h"
+
+/**
+ * @file striped_container.h
+ * @brief Block container split over several stripe files, e.g. one per NVMe drive
+ *
+ * A single output file on one device caps a large run at that device's write
+ * bandwidth while the encoder could go faster. With stripes, the blocks are
+ * dealt out to N stripe files, each written by its own thread, and a small
+ * manifest at the output path records which stripe holds each block.
+ *
+ * Every stripe is an ordinary block container holding its share of the
+ * blocks in their original order (so its own index and checksums apply); a
+ * block's position within its stripe follows from the manifest by counting
+ * the earlier blocks of the same stripe.
+ *
+ * Assignment policies:
+ * - round-robin: block i goes to stripe i % N; best for identical devices
+ * - queue-depth: each block goes to the stripe with the fewest bytes still
+ *   queued for writing, so a slower or busier device receives fewer blocks
+ *
+ * Manifest layout (little-endian):
+ * 1. Header (32 bytes): magic "\x89HUFSTR\n" (8), version (2), stripe count
+ *    (2), block size (4), table set id (4), block count (4), original size (8)
+ * 2. Per stripe: path length (2), path bytes and the stripe digest (8);
+ *    relative paths are relative to the manifest's directory
+ * 3. Per block: stripe number (2)
+ * 4. data_checksum() of everything before it (8)
+ */
+
+#define STRIPE_MANIFEST_MAGIC "\x89HUFSTR\n"
+#define STRIPE_MANIFEST_VERSION 1
+#define STRIPE_MANIFEST_HEADER_SIZE 32
+
+// Most stripes one manifest can name
+#define STRIPE_MAX_COUNT 256
+
+// Coded bytes that may wait in the stripe queues before the encoder is held back
+#define STRIPE_QUEUE_LIMIT_BYTES (64u << 20)
+
+/**
+ * @enum stripe_policy
+ * @brief How blocks are assigned to stripes
+ */
+enum stripe_policy {
+    STRIPE_ROUND_ROBIN = 0,
+    STRIPE_QUEUE_DEPTH
+};
+
+/**
+ * @brief data_checksum() of a stripe's block checksums in order; ties a stripe file to its manifest
+ */
+uint64_t stripe_digest(const std::vector<block_index_entry> &blocks);
+
+/**
+ * @brief Parses a --stripe-policy value ("round-robin" or "queue-depth")
+ */
+bool parse_stripe_policy(const std::string &text, stripe_policy &policy);
+
+/**
+ * @brief Path of a stripe as opened: relative stripe paths are taken relative to the manifest's directory
+ */
+std::string resolve_stripe_path(const std::string &manifest_path, const std::string &stripe_path);
+
+/*=============================================================================
+ * WRITING
+ *=============================================================================*/
+
+/**
+ * @struct stripe_output
+ * @brief One stripe file with its write queue and writer thread
+ */
+struct stripe_output {
+    std::string path;
+    std::ofstream file;
+    block_container_writer writer{file};
+    std::deque<encoded_block> queue;
+    uint64_t queued_bytes = 0;
+    uint64_t blocks = 0;
+    double write_seconds = 0; // Time the thread spent writing
+    std::thread thread;
+};
+
+/**
+ * @struct striped_container_writer
+ * @brief Deals coded blocks out to stripe writer threads and writes the manifest on finish
+ *
+ * append() is called from the encoder's emit callback, in block order, and
+ * only waits when STRIPE_QUEUE_LIMIT_BYTES are already queued.
+ */
+struct striped_container_writer {
+    std::string manifest_path;
+    std::vector<std::string> stripe_paths; // As recorded in the manifest
+    std::vector<std::unique_ptr<stripe_output> > stripes;
+    stripe_policy policy = STRIPE_ROUND_ROBIN;
+    uint32_t block_size = 0;
+    uint32_t table_set_id = 0;
+    uint64_t original_size = 0;
+    uint64_t manifest_size = 0;
+    std::vector<uint16_t> block_stripes;
+
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable space_ready;
+    uint64_t queued_bytes = 0;
+    bool closing = false;
+
+    striped_container_writer() = default;
+    striped_container_writer(const striped_container_writer &) = delete;
+    striped_container_writer &operator=(const striped_container_writer &) = delete;
+    ~striped_container_writer();
+
+    /**
+     * @brief Creates the stripe files
+     * @param manifest_path Output path; the manifest is written there by finish()
+     * @param stripe_paths Stripe files, relative paths resolved against the manifest's directory
+     * @param error Set when a stripe cannot be created or the count is out of range
+     */
+    bool open(const std::string &manifest_path, const std::vector<std::string> &stripe_paths, stripe_policy policy,
+              std::string &error);
+
+    // Writes the stripes' file headers and starts their writer threads
+    void begin(uint32_t block_size, uint32_t table_set_id);
+
+    // Queues one coded block on the stripe chosen by the policy
+    void append(const encoded_block &block);
+
+    // Drains the queues, finishes every stripe and writes the manifest
+    bool finish(std::string &error);
+
+    // Bytes of all stripes plus the manifest
+    [[nodiscard]] uint64_t stored_size() const;
+
+    // Joins the writer threads (also on error paths)
+    void stop();
+};
+
+/*=============================================================================
+ * READING
+ *=============================================================================*/
+
+/**
+ * @struct striped_container
+ * @brief Parsed manifest plus the mapped and parsed stripes
+ */
+struct striped_container {
+    uint32_t block_size = 0;
+    uint32_t table_set_id = 0;
+    uint64_t original_size = 0;
+    std::vector<std::string> stripe_paths; // Resolved
+    std::vector<uint16_t> block_stripes;
+
+    std::vector<std::unique_ptr<mapped_file> > files;
+    std::vector<block_container> containers;
+    std::vector<uint32_t> block_positions; // Index of every block within its stripe
+};
+
+/**
+ * @brief Checks whether a buffer starts with the stripe manifest magic
+ */
+bool is_stripe_manifest(const uint8_t *data, size_t size);
+
+/**
+ * @brief Parses a manifest, then maps and parses all stripes concurrently
+ * @param manifest_path Path of the manifest, for resolving relative stripe paths
+ * @param populate Prefault every stripe (MAP_POPULATE), one thread per stripe
+ * @param error Set when the manifest is corrupt, a stripe is missing or does not match it
+ */
+bool open_striped_container(const uint8_t *data, size_t size, const std::string &manifest_path, bool populate,
+                            striped_container &striped, std::string &error);
@@ -0,0 +1,95 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "tuning_profile.h"
+
+/**
+ * @file tuning_profile.cpp
+ * @brief Lookup, parsing and writing of the autotune profile
+ */
+
+using namespace std;
+
+string default_profile_path() {
+    if (const char *path = getenv("HUFFMAN_PROFILE"); path && *path) return path;
+    if (const char *config = getenv("XDG_CONFIG_HOME"); config && *config) {
+        return string(config) + "/cuda_compression/profile";
+    }
+    if (const char *home = getenv("HOME"); home && *home) return string(home) + "/.config/cuda_compression/profile";
+    return "";
+}
+
+bool load_tuning_profile(const string &path, tuning_profile &profile, string &error) {
+    profile = tuning_profile{};
+    profile.path = path;
+    if (path.empty() || !filesystem::exists(path)) return true;
+
+    ifstream input(path);
+    if (!input) {
+        error = "Cannot read profile " + path;
+        return false;
+    }
+
+    string line;
+    for (int line_number = 1; getline(input, line); line_number++) {
+        if (line.empty() || line[0] == '#') continue;
+
+        const size_t separator = line.find('=');
+        if (separator == string::npos) {
+            error = "Malformed line " + to_string(line_number) + " in profile " + path;
+            return false;
+        }
+        const string key = line.substr(0, separator);
+        const string value = line.substr(separator + 1);
+
+        try {
+            if (key == "block_size") profile.block_size = static_cast<uint32_t>(stoul(value));
+            else if (key == "threads") profile.threads = static_cast<unsigned>(stoul(value));
+            else if (key == "backend") profile.backend = value;
+            else if (key == "gpu_chunk_bytes") profile.gpu_chunk_bytes = stoull(value);
+            else if (key == "cpu_mbps") profile.cpu_mbps = stod(value);
+            else if (key == "gpu_mbps") profile.gpu_mbps = stod(value);
+            // Unknown keys are skipped so newer profiles stay readable
+        } catch (const exception &) {
+            error = "Invalid value for " + key + " in profile " + path;
+            return false;
+        }
+    }
+
+    if (!profile.backend.empty() && profile.backend != "cpu" && profile.backend != "gpu") {
+        error = "Unknown backend '" + profile.backend + "' in profile " + path;
+        return false;
+    }
+    profile.loaded = true;
+    return true;
+}
+
+bool save_tuning_profile(const string &path, const tuning_profile &profile, const string &comment,
+                         string &error) {
+    const filesystem::path file(path);
+    if (error_code ignored; file.has_parent_path()) filesystem::create_directories(file.parent_path(), ignored);
+
+    ofstream output(path);
+    if (!output) {
+        error = "Cannot create profile " + path;
+        return false;
+    }
+
+    istringstream comment_lines(comment);
+    for (string line; getline(comment_lines, line);) output << "# " << line << '\n';
+
+    output << "block_size=" << profile.block_size << '\n'
+            << "threads=" << profile.threads << '\n'
+            << "backend=" << profile.backend << '\n'
+            << "gpu_chunk_bytes=" << profile.gpu_chunk_bytes << '\n'
+            << "cpu_mbps=" << profile.cpu_mbps << '\n'
+            << "gpu_mbps=" << profile.gpu_mbps << '\n';
+    output.flush();
+    if (!output) {
+        error = "Failed to write profile " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @file tuning_profile.h
+ * @brief Machine profile written by huffman_autotune and loaded by the tools
+ *
+ * The profile is a small `key=value` text file (lines starting with '#' are
+ * comments). It is looked up in this order:
+ * 1. $HUFFMAN_PROFILE
+ * 2. $XDG_CONFIG_HOME/cuda_compression/profile
+ * 3. $HOME/.config/cuda_compression/profile
+ *
+ * Every value is optional; 0 / empty means "no preference" and the tool falls
+ * back to its built-in default. Command line options always win over the
+ * profile, and the tools print where each setting came from.
+ *
+ * Keys:
+ * - block_size: CPU block container block size in bytes
+ * - threads: CPU worker threads
+ *   (either one makes a plain CPU compressor run use the block container)
+ * - backend: "cpu" or "gpu", whichever compressed the sample data faster;
+ *   the GUI preselects it as the hardware for single runs
+ * - gpu_chunk_bytes: cap on the GPU compressed-data buffer per kernel run
+ *   (otherwise derived from cudaMemGetInfo alone)
+ * - cpu_mbps / gpu_mbps: throughput measured for the chosen settings
+ */
+
+/**
+ * @struct tuning_profile
+ * @brief Parsed profile; `loaded` is false when no profile file exists
+ */
+struct tuning_profile {
+    uint32_t block_size = 0;
+    unsigned threads = 0;
+    std::string backend;
+    uint64_t gpu_chunk_bytes = 0;
+    double cpu_mbps = 0.0;
+    double gpu_mbps = 0.0;
+
+    std::string path;
+    bool loaded = false;
+};
+
+/**
+ * @brief Path of the profile file according to the lookup order above
+ * @return Empty string when neither HUFFMAN_PROFILE, XDG_CONFIG_HOME nor HOME is set
+ */
+std::string default_profile_path();
+
+/**
+ * @brief Loads a profile file
+ * @param path Profile path (usually default_profile_path())
+ * @param profile Filled on success; profile.loaded is false if the file does not exist
+ * @param error Set on malformed content
+ * @return false only for unreadable or malformed files - a missing profile is not an error
+ */
+bool load_tuning_profile(const std::string &path, tuning_profile &profile, std::string &error);
+
+/**
+ * @brief Writes a profile, creating the parent directory if needed
+ * @param path Destination file
+ * @param profile Values to store
+ * @param comment Free text written as '#' comment lines above the values
+ * @param error Set when the file cannot be written
+ */
+bool save_tuning_profile(const std::string &path, const tuning_profile &profile, const std::string &comment,
+                         std::string &error);
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sched.h>
+
+#include "worker_pool.h"
+
+/**
+ * @file worker_pool.cpp
+ * @brief Atomic-counter task distribution over std::thread workers
+ */
+
+using namespace std;
+
+/**
+ * @brief CPU limit of the process's cgroup, rounded up (0 = unlimited / unknown)
+ */
+static unsigned cgroup_cpu_limit() {
+    // cgroup v2: "<quota> <period>" or "max <period>" in the process's own cgroup
+    string cgroup_path;
+    ifstream cgroups("/proc/self/cgroup");
+    for (string line; getline(cgroups, line);) {
+        if (line.rfind("0::", 0) == 0) cgroup_path = line.substr(3);
+    }
+    for (const string &directory: {"/sys/fs/cgroup" + cgroup_path, string("/sys/fs/cgroup")}) {
+        ifstream cpu_max(directory + "/cpu.max");
+        string quota;
+        double period = 0;
+        if (cpu_max >> quota >> period) {
+            if (quota == "max" || period <= 0) return 0;
+            return static_cast<unsigned>(ceil(stod(quota) / period));
+        }
+    }
+
+    // cgroup v1: quota of -1 means unlimited
+    ifstream quota_file("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+    ifstream period_file("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+    double quota = 0, period = 0;
+    if (quota_file >> quota && period_file >> period && quota > 0 && period > 0) {
+        return static_cast<unsigned>(ceil(quota / period));
+    }
+    return 0;
+}
+
+unsigned default_thread_count() {
+    unsigned count = max(1u, thread::hardware_concurrency());
+
+    cpu_set_t affinity;
+    if (sched_getaffinity(0, sizeof(affinity), &affinity) == 0) {
+        count = min(count, static_cast<unsigned>(max(1, CPU_COUNT(&affinity))));
+    }
+    if (const unsigned limit = cgroup_cpu_limit(); limit != 0) {
+        count = min(count, max(1u, limit));
+    }
+    return count;
+}
+
+void run_parallel(const size_t task_count, const unsigned thread_count,
+                  const function<void(size_t, unsigned)> &task) {
+    if (task_count == 0) return;
+
+    const auto workers = static_cast<unsigned>(max<size_t>(1, min<size_t>(thread_count, task_count)));
+    atomic<size_t> next_task{0};
+
+    // Every worker keeps claiming the next unprocessed index until none are left
+    auto worker_loop = [&](const unsigned worker) {
+        for (size_t index = next_task.fetch_add(1); index < task_count; index = next_task.fetch_add(1)) {
+            task(index, worker);
+        }
+    };
+
+    vector<thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned worker = 1; worker < workers; worker++) {
+        threads.emplace_back(worker_loop, worker);
+    }
+    worker_loop(0);
+
+    for (thread &worker: threads) {
+        worker.join();
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * @file worker_pool.h
+ * @brief Minimal fork-join helper for the multi-threaded CPU tools
+ *
+ * Work is expressed as a number of independent tasks (blocks, chunks). Worker
+ * threads claim task indices from a shared atomic counter, so faster workers
+ * simply take more tasks and no static partitioning is needed.
+ */
+
+/**
+ * @brief Number of worker threads to use when the user did not choose one
+ * @return CPUs this process may actually use (at least 1)
+ *
+ * Hardware concurrency, reduced to the scheduler affinity mask and to the
+ * cgroup CPU quota (cgroup v2 cpu.max or v1 cpu.cfs_quota_us), so a container
+ * limited to two CPUs does not start one busy worker per host core.
+ */
+unsigned default_thread_count();
+
+/**
+ * @brief Runs task(index, worker) for every index in [0, task_count)
+ * @param task_count Number of tasks
+ * @param thread_count Number of workers (clamped to [1, task_count])
+ * @param task Callable receiving the task index and the worker number
+ *
+ * The calling thread acts as worker 0 and the call returns once every task
+ * has completed. Worker numbers are dense, so callers can keep per-worker
+ * accumulators in a plain vector of thread_count elements.
+ */
+void run_parallel(size_t task_count, unsigned thread_count, const std::function<void(size_t, unsigned)> &task);
@@ -4,8 +4,15 @@
 #include <iomanip>
 #include <iostream>
 #include <chrono>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "parallel.h"
+#include "block_report.h"
+#include "progress_reporter.h"
+#include "sparse_file.h"
+#include "tuning_profile.h"
 
 /**
  * @file main_compress.cu
@@ -21,6 +28,24 @@
  *
  * The system automatically adapts to available GPU memory and file characteristics,
  * choosing optimal compression strategies without user intervention.
+ *
+ * Usage: huffman_compression [--explain <report.csv|report.json>] [--progress <path|->] [--no-profile]
+ *                            <input_file> <output_file>
+ * The report holds a single record for the whole file; its slow_path column is
+ * const_memory_flag (codes of 192 bits or more that spill into constant memory).
+ * The progress stream (progress_reporter.h) reports stage transitions; the
+ * kernel runs are reported as one "encode" stage.
+ *
+ * A gpu_chunk_bytes entry in the huffman_autotune profile (tuning_profile.h)
+ * caps the compressed-data buffer per kernel run; otherwise the split is
+ * derived from cudaMemGetInfo alone. The stats output names the source.
+ * `--no-profile` skips the profile, and a malformed one only draws a warning,
+ * since the split is a performance setting that never changes the output.
+ *
+ * Sparse inputs are read hole-aware (SEEK_DATA / SEEK_HOLE, sparse_file.h):
+ * only data extents are read into a zero-initialized buffer and the holes are
+ * added to the histogram as zero bytes without being scanned. The format has
+ * no block structure, so the kernels still encode the zeros.
  */
 
 // Minimum GPU scratch space required for safe operation (50MB)
@@ -75,24 +100,64 @@ int main(const int argc, char **argv) {
      * ARGUMENT VALIDATION AND FILE INPUT
      *=========================================================================*/
 
-    // Validate command line arguments
-    if (argc != 3) {
+    // Validate command line arguments (optional --explain <report> / --progress <path> / --no-profile first)
+    const char *explain_path = nullptr;
+    const char *progress_path = nullptr;
+    bool use_profile = true;
+    int remaining = argc;
+    while (remaining > 3) {
+        if (strcmp(argv[1], "--no-profile") == 0) {
+            use_profile = false;
+            argv += 1;
+            remaining -= 1;
+        } else if (remaining >= 5 && (strcmp(argv[1], "--explain") == 0 || strcmp(argv[1], "--progress") == 0)) {
+            if (strcmp(argv[1], "--explain") == 0) explain_path = argv[2];
+            else progress_path = argv[2];
+            argv += 2;
+            remaining -= 2;
+        } else {
+            break;
+        }
+    }
+    if (remaining != 3) {
         std::cerr << "Invalid number of arguments." << std::endl <<
-                "Example: <path_to_input_file> <path_to_output_file>" << std::endl;
+                "Example: [--explain <report_file>] [--progress <path|->] [--no-profile] <path_to_input_file> "
+                "<path_to_output_file>" << std::endl;
         return EXIT_FAILURE;
     }
 
-    // Read entire input file into memory
-    // Using binary mode to handle all file types correctly
-    FILE *input_file = fopen(argv[1], "rb");
-    fseek(input_file, 0, SEEK_END); // Seek to end to get file size
-    input_file_length = ftell(input_file); // Get file size in bytes
-    fseek(input_file, 0, SEEK_SET); // Return to beginning for reading
+    progress_reporter progress;
+    if (std::string error; progress_path && !progress.open(progress_path, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
 
-    // Allocate memory buffer for entire file content
-    auto *input_file_data = static_cast<unsigned char *>(malloc(input_file_length * sizeof(unsigned char)));
-    fread(input_file_data, sizeof(unsigned char), input_file_length, input_file);
-    fclose(input_file);
+    // Read entire input file into memory, skipping the holes of sparse files
+    const int input_file = open(argv[1], O_RDONLY);
+    if (input_file < 0) {
+        std::cerr << "Error: Cannot open input file " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    input_file_length = lseek(input_file, 0, SEEK_END); // Get file size in bytes
+    std::vector<data_extent> extents;
+    file_data_extents(input_file, input_file_length, extents);
+
+    // calloc'd memory reads as zero, so holes need no I/O (large blocks come from fresh zero pages)
+    progress.begin_stage("read", input_file_length);
+    auto *input_file_data = static_cast<unsigned char *>(calloc(input_file_length, sizeof(unsigned char)));
+    for (const data_extent &extent: extents) {
+        for (uint64_t done = extent.offset; done < extent.offset + extent.length;) {
+            const ssize_t count = pread(input_file, input_file_data + done, extent.offset + extent.length - done,
+                                        static_cast<off_t>(done));
+            if (count <= 0) {
+                std::cerr << "Error: Failed to read input file " << argv[1] << std::endl;
+                return EXIT_FAILURE;
+            }
+            done += count;
+        }
+    }
+    close(input_file);
+    progress.advance(input_file_length);
 
     /*=========================================================================
      * PERFORMANCE TIMING SETUP
@@ -112,9 +177,17 @@ int main(const int argc, char **argv) {
 
     // Count occurrence of each character in input data
     // This statistical analysis determines the optimal Huffman tree structure
-    for (index = 0; index < input_file_length; index++) {
-        frequency[input_file_data[index]]++;
+    // Only data extents are scanned; every hole byte is a zero
+    progress.begin_stage("histogram", input_file_length);
+    unsigned int hole_bytes = input_file_length;
+    for (const data_extent &extent: extents) {
+        for (index = extent.offset; index < extent.offset + extent.length; index++) {
+            frequency[input_file_data[index]]++;
+        }
+        hole_bytes -= extent.length;
     }
+    frequency[0] += hole_bytes;
+    progress.advance(input_file_length);
 
     /*=========================================================================
      * HUFFMAN TREE INITIALIZATION
@@ -215,7 +288,18 @@ int main(const int argc, char **argv) {
      *=========================================================================*/
 
     // Calculate available memory for compressed data buffers (with 10MB safety margin)
-    const long unsigned int mem_req = mem_free - mem_data - 10 * 1024 * 1024;
+    long unsigned int mem_req = mem_free - mem_data - 10 * 1024 * 1024;
+
+    // An autotuned chunk size may split the work into more, smaller kernel runs; a broken profile is only skipped
+    tuning_profile profile;
+    if (std::string error; use_profile && !load_tuning_profile(default_profile_path(), profile, error)) {
+        std::cerr << "Warning: " << error << " (using the free VRAM split; --no-profile silences this)" << std::endl;
+        profile = tuning_profile();
+    }
+    const bool chunk_from_profile = profile.gpu_chunk_bytes != 0 && profile.gpu_chunk_bytes < mem_req;
+    if (chunk_from_profile) {
+        mem_req = profile.gpu_chunk_bytes;
+    }
 
     // Determine number of kernel runs needed based on memory constraints
     // If compressed data fits in GPU memory: 1 run
@@ -235,6 +319,9 @@ int main(const int argc, char **argv) {
             << input_file_length << "  B" << std::endl;
     std::cout << std::left << std::setw(25) << "Compressed file size: " << std::right << std::setw(20)
             << mem_offset / 8 << "  B" << std::endl;
+    std::cout << std::left << std::setw(25) << "Kernel runs: " << std::right << std::setw(20) << num_kernel_runs
+            << "    (chunk " << mem_req / (1024 * 1024) << " MB from "
+            << (chunk_from_profile ? "profile " + profile.path : std::string("free VRAM")) << ")" << std::endl;
 
     /*=========================================================================
      * OFFSET ARRAY ALLOCATION AND COMPRESSION EXECUTION
@@ -250,8 +337,10 @@ int main(const int argc, char **argv) {
     // - GPU memory management
     // - Kernel selection based on scenario
     // - Result retrieval
+    progress.begin_stage("encode", input_file_length);
     launch_cuda_huffman_compress(input_file_data, compressed_data_offset, input_file_length, num_kernel_runs,
                                  integer_overflow_flag, mem_req);
+    progress.advance(input_file_length);
 
     /*=========================================================================
      * PERFORMANCE MEASUREMENT
@@ -268,11 +357,14 @@ int main(const int argc, char **argv) {
     // 1. Original file length (4 bytes) - needed to allocate decompression buffer
     // 2. Character frequency table (1024 bytes) - needed to reconstruct Huffman tree
     // 3. Compressed data (variable length) - the actual compressed content
+    progress.begin_stage("write", mem_offset / 8);
     FILE *compressed_file = fopen(argv[2], "wb");
     fwrite(&input_file_length, sizeof(unsigned int), 1, compressed_file); // Original size
     fwrite(frequency, sizeof(unsigned int), 256, compressed_file); // Frequency table
     fwrite(input_file_data, sizeof(unsigned char), mem_offset / 8, compressed_file); // Compressed data
     fclose(compressed_file);
+    progress.advance(mem_offset / 8);
+    progress.finish();
 
     /*=========================================================================
      * PERFORMANCE REPORTING
@@ -289,6 +381,39 @@ int main(const int argc, char **argv) {
 
     std::cout << "GPU Compression completed successfully!" << std::endl << std::endl;
 
+    /*=========================================================================
+     * DIAGNOSTICS REPORT
+     *=========================================================================*/
+
+    if (explain_path) {
+        uint64_t symbol_counts[256];
+        for (index = 0; index < 256; index++) {
+            symbol_counts[index] = frequency[index];
+        }
+
+        block_report report;
+        report.raw_bytes = input_file_length;
+        report.mode = "gpu";
+        report.table_bytes = sizeof(frequency);
+        report.payload_bytes = mem_offset / 8;
+        report.stored_bytes = sizeof(input_file_length) + report.table_bytes + report.payload_bytes;
+        report.encode_microseconds = std::chrono::duration<double, std::micro>(end - start).count();
+        describe_block_code(symbol_counts, huffman_dictionary.bit_sequence_length, 256, 191, report);
+        report.slow_path = const_memory_flag == 1;
+
+        block_report_writer explain;
+        std::string error;
+        if (!explain.open(explain_path, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        explain.write(report);
+        if (!explain.finish()) {
+            std::cerr << "Error: Failed to write report file " << explain_path << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
     /*=========================================================================
      * CLEANUP AND EXIT
      *=========================================================================*/
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "serial_utilities.h"
 
@@ -9,7 +10,7 @@
  * @brief Main decompression program for Huffman-compressed files
  *
  * This program reverses the compression process by:
- * 1. Reading the compressed file with embedded metadata
+ * 1. Mapping the compressed file and reading its embedded metadata
  * 2. Reconstructing the identical Huffman tree used during compression
  * 3. Performing bit-by-bit tree traversal to decode compressed data
  * 4. Writing the fully restored original data to output file
@@ -21,6 +22,12 @@
  * - Reads files created by the GPU compression system
  * - Expects specific header format: length + frequencies + compressed data
  * - Handles all compression scenarios (single/multiple kernels, overflow/no overflow)
+ *
+ * Usage: huffman_decompression [--progress <path|->] [--populate] <compressed_file> <output_file>
+ * With --progress, JSON-lines progress events (see progress_stream) are written
+ * while the bit stream is decoded. The compressed file is memory-mapped and
+ * decoded in place (map_input_file); --populate prefaults the whole mapping. The output is written sparse
+ * (write_sparse_file), so zero runs of the original become holes again.
  */
 
 /*=============================================================================
@@ -34,8 +41,8 @@ struct huffman_tree huffman_tree_node[512];         // All tree nodes for decomp
 
 /**
  * @brief Main decompression program entry point
- * @param argc Number of command line arguments (should be 3)
- * @param argv Array of argument strings [program, input_file, output_file]
+ * @param argc Number of command line arguments
+ * @param argv Array of argument strings [program, [--progress <path>] [--populate], input_file, output_file]
  * @return EXIT_SUCCESS on successful decompression, EXIT_FAILURE on error
  *
  * Complete decompression pipeline that:
@@ -55,39 +62,62 @@ int main(int argc, char **argv) {
     unsigned char bit_sequence[255];
     const unsigned char bit_sequence_length = 0;
 
+    // Options before the file arguments
+    struct progress_stream progress = {0};
+    const char *progress_path = NULL;
+    int populate = 0;
+    int argument = 1;
+    for (; argument < argc - 2; argument++) {
+        if (strcmp(argv[argument], "--progress") == 0 && argument + 1 < argc - 2) {
+            progress_path = argv[++argument];
+        } else if (strcmp(argv[argument], "--populate") == 0) {
+            populate = 1;
+        } else {
+            break;
+        }
+    }
+    if (argc < 3 || argument != argc - 2) {
+        fprintf(stderr, "Usage: %s [--progress <path|->] [--populate] <compressed_file> <output_file>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *input_path = argv[argc - 2];
+    const char *output_path = argv[argc - 1];
+    if (progress_path && progress_open(&progress, progress_path) != 0) {
+        fprintf(stderr, "Error: Cannot open progress stream %s\n", progress_path);
+        return EXIT_FAILURE;
+    }
+
     /*=========================================================================
      * COMPRESSED FILE PARSING AND HEADER EXTRACTION
      *=========================================================================*/
 
-    // Open the compressed file created by the GPU compression system
-    FILE *compressed_file = fopen(argv[1], "rb");
+    // Map the compressed file created by the GPU compression system; nothing is copied
+    progress_stage(&progress, "read", 0);
+    size_t mapped_size = 0;
+    const unsigned char *mapped_file = map_input_file(input_path, populate, &mapped_size);
+    if (mapped_file == NULL || mapped_size < 1028) {
+        fprintf(stderr, "Error: Cannot open compressed file %s\n", input_path);
+        unmap_input_file(mapped_file, mapped_size);
+        return EXIT_FAILURE;
+    }
 
     // Read the embedded metadata from file header:
     // 1. Original file length (4 bytes) - tells us how much data to reconstruct
-    fread(&output_file_length, sizeof(unsigned int), 1, compressed_file);
+    memcpy(&output_file_length, mapped_file, sizeof(unsigned int));
 
     // 2. Character frequency table (1024 bytes) - enables tree reconstruction
     // This is the same frequency data calculated during compression
-    fread(frequency, 256 * sizeof(unsigned int), 1, compressed_file);
+    memcpy(frequency, mapped_file + sizeof(unsigned int), 256 * sizeof(unsigned int));
 
     /*=========================================================================
-     * COMPRESSED DATA SIZE CALCULATION
+     * COMPRESSED DATA LOCATION
      *=========================================================================*/
 
-    // Calculate the size of the actual compressed data
     // File structure: 4 bytes (length) + 1024 bytes (frequencies) + compressed data
-    fseek(compressed_file, 0, SEEK_END);                                    // Go to end of file
-    const unsigned int compressed_file_length = ftell(compressed_file) - 1028;  // Subtract header size
-    fseek(compressed_file, 1028, SEEK_SET);                                 // Position at start of compressed data
-
-    /*=========================================================================
-     * COMPRESSED DATA LOADING
-     *=========================================================================*/
-
-    // Allocate memory and read the entire compressed bit stream
-    unsigned char *compressed_data = malloc((compressed_file_length) * sizeof(unsigned char));
-    fread(compressed_data, sizeof(unsigned char), (compressed_file_length), compressed_file);
-    fclose(compressed_file);
+    // The bit stream is decoded directly from the mapping after the header
+    const unsigned char *compressed_data = mapped_file + 1028;
+    const size_t compressed_file_length = mapped_size - 1028;
+    progress_update(&progress, mapped_size);
 
     /*=========================================================================
      * PERFORMANCE TIMING SETUP
@@ -154,8 +184,14 @@ int main(int argc, char **argv) {
      *=========================================================================*/
 
     // Process each byte of compressed data
-    for (index = 0; index < compressed_file_length; index++) {
-        unsigned char current_input_byte = compressed_data[index];
+    progress_stage(&progress, "decode", output_file_length);
+    for (size_t position = 0; position < compressed_file_length; position++) {
+        unsigned char current_input_byte = compressed_data[position];
+
+        // Progress in decoded bytes, checked once per 64 KiB of input
+        if ((position & 0xFFFF) == 0) {
+            progress_update(&progress, output_file_length_counter);
+        }
 
         // Process each bit within the current byte (8 bits per byte)
         for (unsigned int bit = 0; bit < 8; bit++) {
@@ -208,9 +244,17 @@ int main(int argc, char **argv) {
      *=========================================================================*/
 
     // Write the completely reconstructed original data to output file
-    FILE *output_file = fopen(argv[2], "wb");
-    fwrite(output_data, sizeof(unsigned char), output_file_length, output_file);
-    fclose(output_file);
+    progress_update(&progress, output_file_length_counter);
+    progress_stage(&progress, "write", output_file_length);
+    // Aligned zero runs are left as holes, so sparse originals stay sparse
+    if (write_sparse_file(output_path, output_data, output_file_length) != 0) {
+        fprintf(stderr, "Error: Cannot write output file %s\n", output_path);
+        free(output_data);
+        unmap_input_file(mapped_file, mapped_size);
+        return EXIT_FAILURE;
+    }
+    progress_update(&progress, output_file_length);
+    progress_finish(&progress);
 
     /*=========================================================================
      * PERFORMANCE REPORTING
@@ -226,9 +270,9 @@ int main(int argc, char **argv) {
      * CLEANUP AND EXIT
      *=========================================================================*/
 
-    // Free all dynamically allocated memory
+    // Free the output buffer and release the input mapping
     free(output_data);
-    free(compressed_data);
+    unmap_input_file(mapped_file, mapped_size);
 
     return EXIT_SUCCESS;
 }
@@ -1,5 +1,11 @@
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 #include "serial_utilities.h"
 
 
@@ -140,3 +146,148 @@ void build_huffman_dictionary(const struct huffman_tree *root, unsigned char *bi
                bit_sequence_length * sizeof(unsigned char));
     }
 }
+
+/*=============================================================================
+ * PROGRESS EVENTS
+ *=============================================================================*/
+
+// Minimum spacing of "progress" events (matches PROGRESS_INTERVAL_MS of the CPU tools)
+#define PROGRESS_INTERVAL_SECONDS 0.1
+
+static double monotonic_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+
+static void progress_event(struct progress_stream *progress, const char *event) {
+    const double now = monotonic_seconds();
+    const double interval = now - progress->last_event;
+    const double mbps = interval > 0 && progress->bytes >= progress->last_event_bytes
+                            ? (double) (progress->bytes - progress->last_event_bytes) / interval / 1e6
+                            : 0.0;
+    progress->last_event = now;
+    progress->last_event_bytes = progress->bytes;
+
+    fprintf(progress->output,
+            "{\"event\":\"%s\",\"stage\":\"%s\",\"bytes\":%llu,\"total\":%llu,\"elapsed\":%.3f,\"mbps\":%.1f}\n",
+            event, progress->stage ? progress->stage : "", progress->bytes, progress->total, now - progress->start,
+            mbps);
+    fflush(progress->output);
+}
+
+int progress_open(struct progress_stream *progress, const char *path) {
+    memset(progress, 0, sizeof(*progress));
+    progress->output = strcmp(path, "-") == 0 ? stderr : fopen(path, "w");
+    if (!progress->output) return -1;
+
+    progress->start = progress->last_event = monotonic_seconds();
+    return 0;
+}
+
+void progress_stage(struct progress_stream *progress, const char *stage, const unsigned long long total) {
+    if (!progress->output) return;
+
+    if (progress->stage && progress->bytes != progress->last_event_bytes) progress_event(progress, "progress");
+    progress->stage = stage;
+    progress->total = total;
+    progress->bytes = 0;
+    progress->last_event_bytes = 0;
+    progress_event(progress, "stage");
+}
+
+void progress_update(struct progress_stream *progress, const unsigned long long bytes) {
+    if (!progress->output) return;
+
+    progress->bytes = bytes;
+    const double now = monotonic_seconds();
+    if (now < progress->next_event) return;
+    progress->next_event = now + PROGRESS_INTERVAL_SECONDS;
+    progress_event(progress, "progress");
+}
+
+void progress_finish(struct progress_stream *progress) {
+    if (!progress->output) return;
+
+    if (progress->stage && progress->bytes != progress->last_event_bytes) progress_event(progress, "progress");
+    progress_event(progress, "done");
+    if (progress->output != stderr) fclose(progress->output);
+    progress->output = NULL;
+}
+
+/*=============================================================================
+ * SPARSE OUTPUT
+ *=============================================================================*/
+
+/**
+ * @brief Whether a buffer is all zero (first 16 bytes, then memcmp against itself shifted by 16)
+ */
+static int is_zero_granule(const unsigned char *data, const size_t length) {
+    for (size_t index = 0; index < 16 && index < length; index++) {
+        if (data[index] != 0) return 0;
+    }
+    return length <= 16 || memcmp(data, data + 16, length - 16) == 0;
+}
+
+/**
+ * @brief pwrite() until everything is written
+ */
+static int write_all(const int descriptor, const unsigned char *data, size_t size, off_t offset) {
+    while (size > 0) {
+        const ssize_t count = pwrite(descriptor, data, size, offset);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return -1;
+        data += count;
+        size -= (size_t) count;
+        offset += count;
+    }
+    return 0;
+}
+
+int write_sparse_file(const char *path, const unsigned char *data, const unsigned long long size) {
+    const int descriptor = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0) return -1;
+
+    // Runs of data granules are written with one pwrite each; zero granules are skipped
+    unsigned long long run_start = 0;
+    int result = 0;
+    for (unsigned long long position = 0; position < size && result == 0; position += SPARSE_GRANULE_BYTES) {
+        const size_t granule = size - position < SPARSE_GRANULE_BYTES ? (size_t) (size - position)
+                                                                       : SPARSE_GRANULE_BYTES;
+        if (granule == SPARSE_GRANULE_BYTES && is_zero_granule(data + position, granule)) {
+            result = write_all(descriptor, data + run_start, position - run_start, (off_t) run_start);
+            run_start = position + granule;
+        }
+    }
+    if (result == 0) result = write_all(descriptor, data + run_start, size - run_start, (off_t) run_start);
+    if (result == 0 && ftruncate(descriptor, (off_t) size) != 0) result = -1;
+    if (close(descriptor) != 0) result = -1;
+    return result;
+}
+
+/*=============================================================================
+ * MAPPED INPUT
+ *=============================================================================*/
+
+const unsigned char *map_input_file(const char *path, const int populate, size_t *size) {
+    const int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) return NULL;
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        close(descriptor);
+        return NULL;
+    }
+    *size = (size_t) status.st_size;
+
+    // The mapping keeps the file referenced, so the descriptor can be closed right away
+    void *mapping = mmap(NULL, *size, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), descriptor, 0);
+    close(descriptor);
+    if (mapping == MAP_FAILED) return NULL;
+    madvise(mapping, *size, MADV_SEQUENTIAL);
+    return mapping;
+}
+
+void unmap_input_file(const unsigned char *data, const size_t size) {
+    if (data) munmap((void *) data, size);
+}
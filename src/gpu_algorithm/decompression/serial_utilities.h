@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdio.h>
+
 /**
  * @file serial_utilities.h
  * @brief Header file for serial Huffman decompression system
@@ -158,6 +160,47 @@ void build_huffman_tree(int index, int distinct_character_count, int combined_hu
 void build_huffman_dictionary(const struct huffman_tree *root, unsigned char *bit_sequence,
                               unsigned char bit_sequence_length);
 
+/*=============================================================================
+ * PROGRESS EVENTS
+ *=============================================================================*/
+
+/**
+ * @struct progress_stream
+ * @brief C counterpart of the CPU tools' progress_reporter (`--progress <path|->`)
+ *
+ * Writes the same JSON-lines events ("stage", "progress", "done" with stage,
+ * bytes, total, elapsed and instantaneous mbps) so the GUI reads both the
+ * same way. A stream whose output is NULL ignores all calls.
+ */
+struct progress_stream {
+    FILE *output;                           // NULL when progress is off
+    const char *stage;                      // Current stage name
+    unsigned long long bytes, total;        // Progress of the current stage
+    double start, last_event, next_event;   // Monotonic seconds
+    unsigned long long last_event_bytes;    // For the instantaneous rate
+};
+
+/**
+ * @brief Opens the progress destination ("-" is stderr)
+ * @return 0 on success, -1 if the file cannot be opened
+ */
+int progress_open(struct progress_stream *progress, const char *path);
+
+/**
+ * @brief Ends the current stage and starts the next one
+ */
+void progress_stage(struct progress_stream *progress, const char *stage, unsigned long long total);
+
+/**
+ * @brief Sets the bytes processed in the current stage; emits an event at most every 100 ms
+ */
+void progress_update(struct progress_stream *progress, unsigned long long bytes);
+
+/**
+ * @brief Ends the last stage, writes the "done" event and closes the stream
+ */
+void progress_finish(struct progress_stream *progress);
+
 /*=============================================================================
  * DECOMPRESSION INTERFACE (LEGACY)
  *=============================================================================*/
@@ -180,3 +223,45 @@ void build_huffman_dictionary(const struct huffman_tree *root, unsigned char *bi
  * 4. Output reconstructed original data
  */
 int wrapper_gpu(char **file, unsigned char *input_file_data, int input_file_length);
+
+/*=============================================================================
+ * SPARSE OUTPUT
+ *=============================================================================*/
+
+// Zero runs shorter than this (or unaligned to it) are written instead of skipped
+#define SPARSE_GRANULE_BYTES 4096
+
+/**
+ * @brief Writes a buffer to a new file, leaving aligned all-zero granules as holes
+ * @param path Output file (created or truncated)
+ * @param data Data to write
+ * @param size Length of data
+ * @return 0 on success, -1 on any open/write/truncate error
+ *
+ * Counterpart of the CPU tools' write_sparse(): zero granules are skipped with
+ * pwrite offsets and the final ftruncate sets the length, so holes of a sparse
+ * original (VM or database images) are not materialized on disk.
+ */
+int write_sparse_file(const char *path, const unsigned char *data, unsigned long long size);
+
+/*=============================================================================
+ * MAPPED INPUT
+ *=============================================================================*/
+
+/**
+ * @brief Maps a whole file read-only for sequential decoding
+ * @param path File to map
+ * @param populate Non-zero to prefault every page (MAP_POPULATE)
+ * @param size Receives the file length
+ * @return The mapping, or NULL if the file cannot be opened or mapped (or is empty)
+ *
+ * The bit stream is decoded straight from the page cache instead of being
+ * read() into a heap copy. The mapping is advised MADV_SEQUENTIAL, so the
+ * kernel reads ahead aggressively and can drop the pages behind the decoder.
+ */
+const unsigned char *map_input_file(const char *path, int populate, size_t *size);
+
+/**
+ * @brief Releases a mapping returned by map_input_file()
+ */
+void unmap_input_file(const unsigned char *data, size_t size);